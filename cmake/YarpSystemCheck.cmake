@@ -348,6 +348,7 @@ check_include_files(sys/signal.h YARP_HAS_SYS_SIGNAL_H)
 check_include_files(netdb.h YARP_HAS_NETDB_H)
 check_include_files(dlfcn.h YARP_HAS_DLFCN_H)
 check_include_files(ifaddrs.h YARP_HAS_IFADDRS_H)
+check_include_files(sys/mman.h YARP_HAS_SYS_MMAN_H)
 
 
 #########################################################################
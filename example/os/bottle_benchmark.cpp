@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+// Compares the cost of common Bottle operations with elements kept in a
+// flat buffer (the default) and with one Storable created per element.
+
+#include <cstdio>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/ConstString.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/impl/BottleImpl.h>
+
+using namespace yarp::os;
+using yarp::os::impl::BottleImpl;
+
+static const int elements = 100;
+static const int times = 20000;
+
+static void report(const char *what, double t0, double t1) {
+    printf("  %-28s %10.0f bottles/s\n", what, times/(t1-t0));
+}
+
+static void run(bool flat) {
+    BottleImpl::setFlatStorage(flat);
+    printf("%s\n", flat ? "flat storage" : "one storable per element");
+
+    Bottle b;
+    double t0 = Time::now();
+    for (int k=0; k<times; k++) {
+        b.clear();
+        for (int i=0; i<elements; i++) {
+            b.addDouble(i*0.5);
+        }
+    }
+    report("addDouble", t0, Time::now());
+
+    size_t len = 0;
+    t0 = Time::now();
+    for (int k=0; k<times; k++) {
+        b.clear();
+        for (int i=0; i<elements; i++) {
+            b.addDouble(i*0.5);
+        }
+        b.toBinary(&len);
+    }
+    report("addDouble + toBinary", t0, Time::now());
+
+    Bottle mixed;
+    for (int i=0; i<elements; i++) {
+        switch (i%4) {
+        case 0: mixed.addInt(i); break;
+        case 1: mixed.addDouble(i*0.5); break;
+        case 2: mixed.addString("joint"); break;
+        case 3: mixed.addList().addDouble(i); break;
+        }
+    }
+    const char *raw = mixed.toBinary(&len);
+    ConstString data(raw, len);
+
+    Bottle in;
+    t0 = Time::now();
+    for (int k=0; k<times; k++) {
+        in.fromBinary(data.c_str(), (int)data.length());
+    }
+    report("fromBinary", t0, Time::now());
+
+    t0 = Time::now();
+    for (int k=0; k<times; k++) {
+        in.fromBinary(data.c_str(), (int)data.length());
+        in.toBinary(&len);
+    }
+    report("fromBinary + toBinary", t0, Time::now());
+
+    double total = 0;
+    t0 = Time::now();
+    for (int k=0; k<times; k++) {
+        in.fromBinary(data.c_str(), (int)data.length());
+        for (int i=0; i<in.size(); i++) {
+            total += in.get(i).asDouble();
+        }
+    }
+    report("fromBinary + get all", t0, Time::now());
+    if (total<0) {
+        printf("%g\n", total);
+    }
+}
+
+int main() {
+    run(false);
+    run(true);
+    return 0;
+}
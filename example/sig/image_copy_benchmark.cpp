@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+// Compares the cost of Image::copy() between pixel formats with the per
+// pixel loop, with the vectorized conversions in one thread, and with the
+// vectorized conversions split among threads, then the cost of the
+// filters of the scaled copy.
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <yarp/os/Time.h>
+#include <yarp/sig/Image.h>
+#include <yarp/sig/impl/PixelConversion.h>
+
+using namespace yarp::os;
+using namespace yarp::sig;
+using yarp::sig::impl::PixelConversion;
+
+static const int width = 1920;
+static const int height = 1080;
+static const int times = 50;
+
+struct Format {
+    int code;
+    int size;
+    const char *name;
+};
+
+static const Format formats[] = {
+    { VOCAB_PIXEL_RGB, 3, "rgb" },
+    { VOCAB_PIXEL_BGR, 3, "bgr" },
+    { VOCAB_PIXEL_RGBA, 4, "rgba" },
+    { VOCAB_PIXEL_BGRA, 4, "bgra" },
+    { VOCAB_PIXEL_MONO, 1, "mono" },
+    { VOCAB_PIXEL_MONO16, 2, "mono16" }
+};
+
+static void run(const Format& from, const Format& to) {
+    FlexImage src, dest;
+    src.setPixelCode(from.code);
+    src.setPixelSize(from.size);
+    src.resize(width, height);
+    for (int i=0; i<src.getRawImageSize(); i++) {
+        src.getRawImage()[i] = (unsigned char)rand();
+    }
+    dest.setPixelCode(to.code);
+    dest.setPixelSize(to.size);
+    dest.resize(width, height);
+
+    PixelConversion::InstructionSet supported = PixelConversion::getSupportedInstructionSet();
+    printf("%6s -> %-6s", from.name, to.name);
+    for (int mode=0; mode<3; mode++) {
+        PixelConversion::setInstructionSet(mode==0 ? PixelConversion::SIMD_NONE : supported);
+        PixelConversion::setThreads(mode==1 ? 1 : 0);
+        double t0 = Time::now();
+        for (int k=0; k<times; k++) {
+            dest.copy(src);
+        }
+        printf(" %10.1f", times/(Time::now()-t0));
+    }
+    printf("\n");
+}
+
+static void runScaled(const Format& format) {
+    FlexImage src, dest;
+    src.setPixelCode(format.code);
+    src.setPixelSize(format.size);
+    src.resize(width, height);
+    for (int i=0; i<src.getRawImageSize(); i++) {
+        src.getRawImage()[i] = (unsigned char)rand();
+    }
+    dest.setPixelCode(format.code);
+    dest.setPixelSize(format.size);
+
+    printf("%16s", format.name);
+    const Image::ResampleMode modes[] = { Image::RESAMPLE_NEAREST, Image::RESAMPLE_BILINEAR, Image::RESAMPLE_AREA };
+    for (int m=0; m<3; m++) {
+        double t0 = Time::now();
+        for (int k=0; k<times; k++) {
+            dest.copy(src, width/3, height/3, modes[m]);
+        }
+        printf(" %10.1f", times/(Time::now()-t0));
+    }
+    printf("\n");
+}
+
+int main() {
+    printf("%dx%d images, instructions %s\n", width, height,
+           PixelConversion::getInstructionSetName(PixelConversion::getSupportedInstructionSet()));
+    printf("%16s %10s %10s %10s  (images/s)\n", "", "scalar", "1 thread", "threads");
+    const int n = sizeof(formats)/sizeof(formats[0]);
+    for (int i=0; i<n; i++) {
+        for (int j=0; j<n; j++) {
+            if (i!=j && PixelConversion::isVectorized(formats[i].code, formats[j].code)) {
+                run(formats[i], formats[j]);
+            }
+        }
+    }
+
+    printf("\nscaled to %dx%d\n", width/3, height/3);
+    printf("%16s %10s %10s %10s  (images/s)\n", "", "nearest", "bilinear", "area");
+    for (int i=0; i<n; i++) {
+        runScaled(formats[i]);
+    }
+    return 0;
+}
@@ -8,6 +8,7 @@
 #include "BayerCarrier.h"
 
 #include <yarp/sig/ImageDraw.h>
+#include <yarp/sig/impl/Demosaic.h>
 #include <cstring>
 #include <cstdlib>
 
@@ -21,6 +22,7 @@ extern "C" {
 
 using namespace yarp::os;
 using namespace yarp::sig;
+using yarp::sig::impl::Demosaic;
 
 // can't seem to do ipl/opencv/yarp style end-of-row padding
 void setDcImage(yarp::sig::Image& yimg, dc1394video_frame_t *dc,
@@ -96,6 +98,7 @@ yarp::os::ConnectionReader& BayerCarrier::modifyIncomingData(yarp::os::Connectio
     have_result = false;
     if (need_reset) {
         int m = DC1394_BAYER_METHOD_BILINEAR;
+        int native = Demosaic::DEMOSAIC_BILINEAR;
         Searchable& config = reader.getConnectionModifiers();
         half = false;
         if (config.check("size")) {
@@ -106,13 +109,16 @@ yarp::os::ConnectionReader& BayerCarrier::modifyIncomingData(yarp::os::Connectio
         if (config.check("method")) {
             ConstString method = config.find("method").asString();
             bayer_method_set = true;
+            native = -1;
             if (method=="ahd") {
                 m = DC1394_BAYER_METHOD_AHD;
             } else if (method=="bilinear") {
-                m = DC1394_BAYER_METHOD_BILINEAR;
+                native = Demosaic::DEMOSAIC_BILINEAR;
             } else if (method=="downsample") {
-                m = DC1394_BAYER_METHOD_DOWNSAMPLE;
+                native = Demosaic::DEMOSAIC_HALF;
                 half = true;
+            } else if (method=="malvar") {
+                native = Demosaic::DEMOSAIC_MALVAR;
             } else if (method=="edgesense") {
                 m = DC1394_BAYER_METHOD_EDGESENSE;
             } else if (method=="hqlinear") {
@@ -125,7 +131,7 @@ yarp::os::ConnectionReader& BayerCarrier::modifyIncomingData(yarp::os::Connectio
                 m = DC1394_BAYER_METHOD_VNG;
             } else {
                 if (!warned) {
-                    fprintf(stderr,"bayer method %s not recognized, try: ahd bilinear downsample edgesense hqlinear nearest simple vng\n", method.c_str());
+                    fprintf(stderr,"bayer method %s not recognized, try: ahd bilinear downsample edgesense hqlinear malvar nearest simple vng\n", method.c_str());
                     warned = true;
                 }
                 happy = false;
@@ -138,6 +144,7 @@ yarp::os::ConnectionReader& BayerCarrier::modifyIncomingData(yarp::os::Connectio
         header_in.setFromImage(in);
         //printf("Need reset.\n");
         bayer_method = m;
+        native_method = native;
         need_reset = false;
         processBuffered();
     }
@@ -150,6 +157,10 @@ yarp::os::ConnectionReader& BayerCarrier::modifyIncomingData(yarp::os::Connectio
 
 bool BayerCarrier::debayerHalf(yarp::sig::ImageOf<PixelMono>& src,
                                yarp::sig::ImageOf<PixelRgb>& dest) {
+    if (Demosaic::convert(src,bayer_code,dest,Demosaic::DEMOSAIC_HALF)) {
+        return true;
+    }
+
     // dc1394 doesn't seem safe for arbitrary data widths
     if (src.width()%8==0) {
         dc1394video_frame_t dc_src;
@@ -193,6 +204,11 @@ bool BayerCarrier::debayerHalf(yarp::sig::ImageOf<PixelMono>& src,
 
 bool BayerCarrier::debayerFull(yarp::sig::ImageOf<PixelMono>& src,
                                yarp::sig::ImageOf<PixelRgb>& dest) {
+    if (native_method>=0 &&
+            Demosaic::convert(src,bayer_code,dest,(Demosaic::Method)native_method)) {
+        return true;
+    }
+
     // dc1394 doesn't seem safe for arbitrary data widths
     if (src.width()%8==0) {
         dc1394video_frame_t dc_src;
@@ -368,12 +384,16 @@ bool BayerCarrier::setFormat(const char *fmt) {
     roff = (f[0]=='r'||f[0]=='R'||f[1]=='r'||f[1]=='R')?0:1;
     if (goff==0&&roff==0) {
         dcformat = DC1394_COLOR_FILTER_GRBG;
+        bayer_code = VOCAB_PIXEL_ENCODING_BAYER_GRBG8;
     } else if (goff==0&&roff==1) {
         dcformat = DC1394_COLOR_FILTER_GBRG;
+        bayer_code = VOCAB_PIXEL_ENCODING_BAYER_GBRG8;
     } else if (goff==1&&roff==0) {
         dcformat = DC1394_COLOR_FILTER_RGGB;
+        bayer_code = VOCAB_PIXEL_ENCODING_BAYER_RGGB8;
     } else if (goff==1&&roff==1) {
         dcformat = DC1394_COLOR_FILTER_BGGR;
+        bayer_code = VOCAB_PIXEL_ENCODING_BAYER_BGGR8;
     }
     return true;
 }
@@ -28,6 +28,11 @@ namespace yarp {
  *   tcp+recv.bayer
  *   tcp+recv.bayer+size.half
  *   tcp+recv.bayer+size.half+order.bggr
+ *   tcp+recv.bayer+method.malvar
+ *
+ * The bilinear (default), malvar and downsample methods are implemented
+ * by yarp::sig::impl::Demosaic; the other methods of libdc1394 (ahd,
+ * edgesense, hqlinear, nearest, simple, vng) are still available.
  *
  */
 class yarp::os::BayerCarrier : public yarp::os::ModifyingCarrier,
@@ -52,11 +57,13 @@ private:
     bool bayer_method_set;
 
     int bayer_method;
+    int native_method; // a yarp::sig::impl::Demosaic::Method, -1 for dc1394
 
     // format offsets
     int goff; // x offset to green on even rows
     int roff; // y offset to red on even columns
     int dcformat;
+    int bayer_code;
 
     bool setFormat(const char *fmt);
 public:
@@ -77,9 +84,11 @@ public:
         warned(false),
         bayer_method_set(false),
         bayer_method(-1),
+        native_method(-1),
         goff(0),
         roff(1),
-        dcformat(-1)
+        dcformat(-1),
+        bayer_code(VOCAB_PIXEL_ENCODING_BAYER_GRBG8)
     {}
 
     ~BayerCarrier() {
@@ -7,39 +7,7 @@
 
 
 #include <cstdio>
-
-
-/*
-  On Windows, libjpeg does some slightly odd-ball stuff, including
-  unconditionally defining INT32 to be "long".  This needs to
-  be worked around.  Work around begins...
- */
-#if defined(_WIN32)
-#define INT32 long  // jpeg's definition
-#define QGLOBAL_H 1
-#endif
-
-#ifdef _MSC_VER
-#pragma warning (push)
-#pragma warning (disable : 4091)
-#endif
-
-extern "C" {
-#include <jpeglib.h>
-}
-
-#ifdef _MSC_VER
-#pragma warning (pop)
-#endif
-
-#if defined(_WIN32)
-#undef INT32
-#undef QGLOBAL_H
-#endif
-/*
-  work around ends.
- */
-
+#include <cstdlib>
 
 #include "MjpegCarrier.h"
 
@@ -55,17 +23,7 @@ using namespace yarp::sig;
 
 #define dbg_printf if (0) printf
 
-typedef struct {
-    struct jpeg_destination_mgr pub;
-
-    JOCTET *buffer;
-    int bufsize;
-    JOCTET cache[1000000];  // need to make this variable...
-} net_destination_mgr;
-
-typedef net_destination_mgr *net_destination_ptr;
-
-void send_net_data(JOCTET *data, int len, void *client) {
+void send_net_data(const char *data, int len, void *client) {
     dbg_printf("Send %d bytes\n", len);
     ConnectionState *p = (ConnectionState *)client;
     char hdr[1000];
@@ -97,90 +55,19 @@ Content-Length: %d%s%s", brk, len, brk, brk);
 
 }
 
-static void init_net_destination(j_compress_ptr cinfo) {
-    //printf("Initializing destination\n");
-    net_destination_ptr dest = (net_destination_ptr)cinfo->dest;
-    dest->buffer = &(dest->cache[0]);
-    dest->bufsize = sizeof(dest->cache);
-    dest->pub.next_output_byte = dest->buffer;
-    dest->pub.free_in_buffer = dest->bufsize;
-}
-
-static boolean empty_net_output_buffer(j_compress_ptr cinfo) {
-    net_destination_ptr dest = (net_destination_ptr)cinfo->dest;
-    printf("Empty buffer - PROBLEM\n");
-    send_net_data(dest->buffer,dest->bufsize-dest->pub.free_in_buffer,
-                  cinfo->client_data);
-    dest->pub.next_output_byte = dest->buffer;
-    dest->pub.free_in_buffer = dest->bufsize;
-    return TRUE;
-}
-
-static void term_net_destination(j_compress_ptr cinfo) {
-    net_destination_ptr dest = (net_destination_ptr)cinfo->dest;
-    //printf("Terminating net %d %d\n", dest->bufsize,dest->pub.free_in_buffer);
-    send_net_data(dest->buffer,dest->bufsize-dest->pub.free_in_buffer,
-                  cinfo->client_data);
-}
-
-void jpeg_net_dest(j_compress_ptr cinfo) {
-    net_destination_ptr dest;
-
-      //ERREXIT(cinfo, JERR_BUFFER_SIZE);
-
-    /* The destination object is made permanent so that multiple JPEG images
-     * can be written to the same buffer without re-executing jpeg_net_dest.
-     */
-    if (cinfo->dest == NULL) {    /* first time for this JPEG object? */
-        cinfo->dest = (struct jpeg_destination_mgr *)
-            (*cinfo->mem->alloc_large) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
-                                        sizeof(net_destination_mgr));
-    }
-
-    dest = (net_destination_ptr) cinfo->dest;
-    dest->pub.init_destination = init_net_destination;
-    dest->pub.empty_output_buffer = empty_net_output_buffer;
-    dest->pub.term_destination = term_net_destination;
-}
-
 bool MjpegCarrier::write(ConnectionState& proto, SizedWriter& writer) {
     WireImage rep;
     FlexImage *img = rep.checkForImage(writer);
 
     if (img==NULL) return false;
-    int w = img->width();
-    int h = img->height();
-    int row_stride = img->getRowSize();
-    JOCTET *data = (JOCTET*)img->getRawImage();
-
-    JSAMPROW row_pointer[1];
-
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    cinfo.client_data = &proto;
-    jpeg_create_compress(&cinfo);
-    jpeg_net_dest(&cinfo);
-    cinfo.image_width = w;
-    cinfo.image_height = h;
-    cinfo.input_components = 3;
-    cinfo.in_color_space = JCS_RGB;
-    jpeg_set_defaults(&cinfo);
-    //jpeg_set_quality(&cinfo, 85, TRUE);
+
+    Bytes jpeg;
     dbg_printf("Starting to compress...\n");
-    jpeg_start_compress(&cinfo, TRUE);
-    if(!envelope.empty()) {
-        jpeg_write_marker(&cinfo, JPEG_COM, reinterpret_cast<const JOCTET*>(envelope.c_str()), envelope.length() + 1);
-        envelope.clear();
-    }
-    dbg_printf("Done compressing (height %d)\n", cinfo.image_height);
-    while (cinfo.next_scanline < cinfo.image_height) {
-        dbg_printf("Writing row %d...\n", cinfo.next_scanline);
-        row_pointer[0] = data + cinfo.next_scanline * row_stride;
-        jpeg_write_scanlines(&cinfo, row_pointer, 1);
-    }
-    jpeg_finish_compress(&cinfo);
-    jpeg_destroy_compress(&cinfo);
+    bool ok = compression.compress(*img, envelope, jpeg);
+    envelope.clear();
+    if (!ok) return false;
+    dbg_printf("Done compressing (%d bytes)\n", (int)jpeg.length());
+    send_net_data(jpeg.get(), jpeg.length(), &proto);
 
     return true;
 }
@@ -193,10 +80,26 @@ bool MjpegCarrier::reply(ConnectionState& proto, SizedWriter& writer) {
 bool MjpegCarrier::sendHeader(ConnectionState& proto) {
     Name n(proto.getRoute().getCarrierName() + "://test");
     ConstString pathValue = n.getCarrierModifier("path");
-    ConstString target = "GET /?action=stream\n\n";
+    // compression settings of the sender, as in mjpeg+quality.50+subsampling.444
+    ConstString query;
+    const char *params[] = { "quality", "subsampling", "threads" };
+    for (size_t i=0; i<sizeof(params)/sizeof(params[0]); i++) {
+        ConstString value = n.getCarrierModifier(params[i]);
+        if (value!="") {
+            query += ConstString("&") + params[i] + "=" + value;
+        }
+    }
+    ConstString target = "GET /?action=stream" + query + "\n\n";
     if (pathValue!="") {
         target = "GET /";
         target += pathValue;
+        if (query!="") {
+            // after the query of the path, if any
+            if (pathValue.find('?')==ConstString::npos) {
+                query[0] = '?';
+            }
+            target += query;
+        }
     }
     target += " HTTP/1.1\n";
     Contact host = proto.getRoute().getToContact();
@@ -211,6 +114,43 @@ bool MjpegCarrier::sendHeader(ConnectionState& proto) {
     return true;
 }
 
+bool MjpegCarrier::expectExtraHeader(ConnectionState& proto) {
+    // the rest of the request, as in "tion=stream&quality=50 HTTP/1.1"
+    ConstString request = proto.is().readLine();
+    ConstString txt = request;
+    while (txt!="") {
+        txt = proto.is().readLine();
+    }
+    size_t end = request.find(' ');
+    if (end!=ConstString::npos) {
+        request = request.substr(0, end);
+    }
+    // with a path, the parameters follow it, as in "th?quality=50"
+    size_t at = request.find('?');
+    at = (at!=ConstString::npos) ? at+1 : 0;
+    while (at<request.length()) {
+        size_t next = request.find('&', at);
+        if (next==ConstString::npos) {
+            next = request.length();
+        }
+        ConstString param = request.substr(at, next-at);
+        size_t eq = param.find('=');
+        if (eq!=ConstString::npos) {
+            ConstString key = param.substr(0, eq);
+            int value = atoi(param.substr(eq+1).c_str());
+            if (key=="quality") {
+                compression.setQuality(value);
+            } else if (key=="subsampling") {
+                compression.setSubsampling(value);
+            } else if (key=="threads") {
+                compression.setThreads(value);
+            }
+        }
+        at = next+1;
+    }
+    return true;
+}
+
 bool MjpegCarrier::autoCompression() const {
 #ifdef MJPEG_AUTOCOMPRESS
     return true;
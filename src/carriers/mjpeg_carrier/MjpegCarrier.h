@@ -11,6 +11,7 @@
 #include <yarp/os/Carrier.h>
 #include <yarp/os/NetType.h>
 #include "MjpegStream.h"
+#include "MjpegCompression.h"
 
 #include <cstring>
 
@@ -38,12 +39,21 @@ namespace yarp {
  * You can also view yarp image ports from a browser.  Do a "yarp name query /portname" to find their port number NNN, then go to:
  *   http://localhost:NNN/?output=stream
  *
+ * The compression can be tuned for each connection, with the quality
+ * (1-100, default 75), the chroma subsampling (444, 422 or 420, the
+ * default) and the threads compressing large images (default one per
+ * core, up to 4):
+ *   yarp connect /grabber /view mjpeg+quality.50+subsampling.444
+ * or from a browser:
+ *   http://localhost:NNN/?action=stream&quality=50&subsampling=444
+ *
  */
 class yarp::os::MjpegCarrier : public Carrier {
 private:
     bool firstRound;
     bool sender;
     yarp::os::ConstString envelope;
+    yarp::mjpeg::MjpegCompression compression;
 public:
     MjpegCarrier() {
         firstRound = true;
@@ -143,13 +153,7 @@ public:
         return true;
     }
 
-    virtual bool expectExtraHeader(ConnectionState& proto) override {
-        ConstString txt;
-        do {
-            txt = proto.is().readLine();
-        } while (txt!="");
-        return true;
-    }
+    virtual bool expectExtraHeader(ConnectionState& proto) override;
 
     bool respondToHeader(ConnectionState& proto) override {
         ConstString target = "HTTP/1.0 200 OK\r\n\
@@ -0,0 +1,447 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include "MjpegCompression.h"
+
+#include <yarp/os/Log.h>
+#include <yarp/sig/Image.h>
+#include <yarp/sig/impl/ParallelBands.h>
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef MJPEG_USE_TURBOJPEG
+
+#include <turbojpeg.h>
+
+#else // MJPEG_USE_TURBOJPEG
+
+#if defined(_WIN32)
+#define INT32 long  // jpeg's definition
+#define QGLOBAL_H 1
+#endif
+
+#ifdef _MSC_VER
+#pragma warning (push)
+#pragma warning (disable : 4091)
+#endif
+
+extern "C" {
+#include <jpeglib.h>
+}
+
+#ifdef _MSC_VER
+#pragma warning (pop)
+#endif
+
+#if defined(_WIN32)
+#undef INT32
+#undef QGLOBAL_H
+#endif
+
+#endif // MJPEG_USE_TURBOJPEG
+
+
+using namespace yarp::os;
+using namespace yarp::sig;
+using namespace yarp::mjpeg;
+using yarp::sig::impl::ParallelBands;
+
+
+/*
+ * Where the frame header, the scan header and the entropy-coded data of
+ * a JPEG image start.
+ */
+struct JpegLayout {
+    size_t sof;
+    size_t sos;
+    size_t data;
+    bool restart;
+};
+
+static bool parseJpeg(const unsigned char *jpeg, size_t len, JpegLayout& layout)
+{
+    if (len<4 || jpeg[0]!=0xFF || jpeg[1]!=0xD8) {
+        return false;
+    }
+    layout.sof = 0;
+    layout.restart = false;
+    size_t at = 2;
+    while (at+4<=len) {
+        if (jpeg[at]!=0xFF) {
+            return false;
+        }
+        unsigned char marker = jpeg[at+1];
+        size_t segment = (jpeg[at+2]<<8) | jpeg[at+3];
+        if (marker>=0xC0 && marker<=0xC2) {
+            layout.sof = at;
+        }
+        if (marker==0xDD) {
+            layout.restart = true;
+        }
+        if (marker==0xDA) {
+            layout.sos = at;
+            layout.data = at+2+segment;
+            return layout.sof!=0 && layout.data+2<=len &&
+                jpeg[len-2]==0xFF && jpeg[len-1]==0xD9;
+        }
+        at += 2+segment;
+    }
+    return false;
+}
+
+
+#ifndef MJPEG_USE_TURBOJPEG
+
+struct band_error_mgr {
+    struct jpeg_error_mgr pub;
+    jmp_buf setjmp_buffer;
+};
+
+static void band_error_exit(j_common_ptr cinfo) {
+    band_error_mgr *err = (band_error_mgr *)cinfo->err;
+    (*cinfo->err->output_message)(cinfo);
+    longjmp(err->setjmp_buffer, 1);
+}
+
+struct band_destination_mgr {
+    struct jpeg_destination_mgr pub;
+    std::vector<JOCTET> *buffer;
+    size_t *length;
+};
+
+static void init_band_destination(j_compress_ptr cinfo) {
+    band_destination_mgr *dest = (band_destination_mgr *)cinfo->dest;
+    if (dest->buffer->size()<65536) {
+        dest->buffer->resize(65536);
+    }
+    dest->pub.next_output_byte = &(*dest->buffer)[0];
+    dest->pub.free_in_buffer = dest->buffer->size();
+}
+
+static boolean empty_band_output_buffer(j_compress_ptr cinfo) {
+    // the buffer is kept, so it grows only until it fits the largest frame
+    band_destination_mgr *dest = (band_destination_mgr *)cinfo->dest;
+    size_t used = dest->buffer->size();
+    dest->buffer->resize(used*2);
+    dest->pub.next_output_byte = &(*dest->buffer)[used];
+    dest->pub.free_in_buffer = dest->buffer->size()-used;
+    return TRUE;
+}
+
+static void term_band_destination(j_compress_ptr cinfo) {
+    band_destination_mgr *dest = (band_destination_mgr *)cinfo->dest;
+    *dest->length = dest->buffer->size()-dest->pub.free_in_buffer;
+}
+
+#endif // MJPEG_USE_TURBOJPEG
+
+
+/*
+ * A band of rows compressed as a JPEG image of its own.
+ */
+class CompressionBand {
+public:
+    const unsigned char *pixels;
+    int rowSize;
+    int width;
+    int height;
+    bool gray;
+    int quality;
+    int subsampling;
+    bool ok;
+
+#ifdef MJPEG_USE_TURBOJPEG
+    tjhandle handle;
+    unsigned char *buffer;
+    unsigned long capacity;
+    unsigned long length;
+
+    CompressionBand() :
+            pixels(YARP_NULLPTR), rowSize(0), width(0), height(0),
+            gray(false), quality(75), subsampling(420), ok(false),
+            buffer(YARP_NULLPTR), capacity(0), length(0)
+    {
+        handle = tjInitCompress();
+    }
+
+    ~CompressionBand() {
+        if (buffer!=YARP_NULLPTR) {
+            tjFree(buffer);
+        }
+        if (handle!=YARP_NULLPTR) {
+            tjDestroy(handle);
+        }
+    }
+
+    const unsigned char *data() const { return buffer; }
+    size_t size() const { return length; }
+
+    void compress() {
+        int samp = TJSAMP_420;
+        if (gray) {
+            samp = TJSAMP_GRAY;
+        } else if (subsampling==444) {
+            samp = TJSAMP_444;
+        } else if (subsampling==422) {
+            samp = TJSAMP_422;
+        }
+        unsigned long needed = tjBufSize(width, height, samp);
+        if (needed>capacity) {
+            if (buffer!=YARP_NULLPTR) {
+                tjFree(buffer);
+            }
+            buffer = tjAlloc((int)needed);
+            capacity = (buffer!=YARP_NULLPTR) ? needed : 0;
+        }
+        length = capacity;
+        ok = handle!=YARP_NULLPTR && buffer!=YARP_NULLPTR &&
+            tjCompress2(handle, (unsigned char *)pixels, width, rowSize, height,
+                        gray ? TJPF_GRAY : TJPF_RGB, &buffer, &length, samp,
+                        quality, TJFLAG_NOREALLOC)==0;
+        if (!ok) {
+            fprintf(stderr, "JPEG compression failed: %s\n", tjGetErrorStr());
+        }
+    }
+#else
+    struct jpeg_compress_struct cinfo;
+    struct band_error_mgr jerr;
+    struct band_destination_mgr dest;
+    std::vector<JOCTET> buffer;
+    std::vector<JSAMPROW> rows;
+    size_t length;
+
+    CompressionBand() :
+            pixels(YARP_NULLPTR), rowSize(0), width(0), height(0),
+            gray(false), quality(75), subsampling(420), ok(false),
+            length(0)
+    {
+        memset(&cinfo, 0, sizeof(cinfo));
+        memset(&jerr, 0, sizeof(jerr));
+        cinfo.err = jpeg_std_error(&jerr.pub);
+        jerr.pub.error_exit = band_error_exit;
+        jpeg_create_compress(&cinfo);
+        dest.pub.init_destination = init_band_destination;
+        dest.pub.empty_output_buffer = empty_band_output_buffer;
+        dest.pub.term_destination = term_band_destination;
+        dest.buffer = &buffer;
+        dest.length = &length;
+        cinfo.dest = &dest.pub;
+    }
+
+    ~CompressionBand() {
+        jpeg_destroy_compress(&cinfo);
+    }
+
+    const unsigned char *data() const { return &buffer[0]; }
+    size_t size() const { return length; }
+
+    void compress() {
+        ok = false;
+        if (setjmp(jerr.setjmp_buffer)) {
+            jpeg_abort_compress(&cinfo);
+            return;
+        }
+        cinfo.image_width = width;
+        cinfo.image_height = height;
+        cinfo.input_components = gray ? 1 : 3;
+        cinfo.in_color_space = gray ? JCS_GRAYSCALE : JCS_RGB;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, quality, TRUE);
+        if (!gray) {
+            cinfo.comp_info[0].h_samp_factor = (subsampling==444) ? 1 : 2;
+            cinfo.comp_info[0].v_samp_factor = (subsampling==420) ? 2 : 1;
+        }
+        rows.resize(height);
+        for (int y=0; y<height; y++) {
+            rows[y] = (JSAMPROW)(pixels+y*rowSize);
+        }
+        jpeg_start_compress(&cinfo, TRUE);
+        while (cinfo.next_scanline<cinfo.image_height) {
+            jpeg_write_scanlines(&cinfo, &rows[cinfo.next_scanline],
+                                 cinfo.image_height-cinfo.next_scanline);
+        }
+        jpeg_finish_compress(&cinfo);
+        ok = true;
+    }
+#endif
+};
+
+
+class MjpegCompressionHelper {
+public:
+    int quality;
+    int subsampling;
+    int threads;
+    std::vector<CompressionBand*> bands;
+    std::vector<unsigned char> output;
+    ImageOf<PixelRgb> rgb;
+
+    MjpegCompressionHelper() :
+            quality(75),
+            subsampling(420),
+            threads(0)
+    {
+    }
+
+    ~MjpegCompressionHelper() {
+        for (size_t i=0; i<bands.size(); i++) {
+            delete bands[i];
+        }
+    }
+
+    /*
+     * Join the bands in a single image: the headers of the first band,
+     * with the height of the whole image and the restart interval of the
+     * bands, then the data of each band separated by restart markers.
+     */
+    bool join(int count, int height, int restartInterval,
+              const ConstString& comment) {
+        const unsigned char *jpeg = bands[0]->data();
+        JpegLayout first;
+        if (!bands[0]->ok || !parseJpeg(jpeg, bands[0]->size(), first) ||
+            first.restart) {
+            return false;
+        }
+        output.clear();
+        output.insert(output.end(), jpeg, jpeg+first.sos);
+        output[first.sof+5] = (unsigned char)(height>>8);
+        output[first.sof+6] = (unsigned char)(height&0xFF);
+        // the marker length counts itself and the terminator of the text
+        size_t commentLength = comment.length()+1+2;
+        if (!comment.empty() && commentLength<=0xFFFF) {
+            output.push_back(0xFF);
+            output.push_back(0xFE);
+            output.push_back((unsigned char)(commentLength>>8));
+            output.push_back((unsigned char)(commentLength&0xFF));
+            output.insert(output.end(), comment.c_str(),
+                          comment.c_str()+comment.length()+1);
+        }
+        if (count>1) {
+            output.push_back(0xFF);
+            output.push_back(0xDD);
+            output.push_back(0);
+            output.push_back(4);
+            output.push_back((unsigned char)(restartInterval>>8));
+            output.push_back((unsigned char)(restartInterval&0xFF));
+        }
+        output.insert(output.end(), jpeg+first.sos, jpeg+first.data);
+        for (int i=0; i<count; i++) {
+            const unsigned char *band = bands[i]->data();
+            size_t length = bands[i]->size();
+            JpegLayout layout = first;
+            if (i>0) {
+                // the tables must be the ones of the first band
+                if (!bands[i]->ok || !parseJpeg(band, length, layout) ||
+                    layout.restart || layout.sof!=first.sof ||
+                    layout.data!=first.data ||
+                    memcmp(band, jpeg, first.sof+5)!=0 ||
+                    memcmp(band+first.sof+7, jpeg+first.sof+7,
+                           first.data-first.sof-7)!=0) {
+                    return false;
+                }
+                output.push_back(0xFF);
+                output.push_back((unsigned char)(0xD0+(i-1)%8));
+            }
+            output.insert(output.end(), band+layout.data, band+length-2);
+        }
+        output.push_back(0xFF);
+        output.push_back(0xD9);
+        return true;
+    }
+
+    bool compress(const Image& image, const ConstString& comment, Bytes& jpeg) {
+        const Image *src = &image;
+        bool gray = image.getPixelCode()==VOCAB_PIXEL_MONO;
+        if (!gray && image.getPixelCode()!=VOCAB_PIXEL_RGB) {
+            rgb.copy(image);
+            src = &rgb;
+        }
+        int w = src->width();
+        int h = src->height();
+        if (w==0 || h==0) {
+            return false;
+        }
+
+        // bands are made of whole MCUs, restarting the DC prediction
+        int mcuWidth = (gray || subsampling==444) ? 8 : 16;
+        int mcuHeight = (gray || subsampling!=420) ? 8 : 16;
+        int mcuColumns = (w+mcuWidth-1)/mcuWidth;
+        int mcuRows = (h+mcuHeight-1)/mcuHeight;
+        int count = ParallelBands::getBandCount((long)src->getRawImageSize(), threads, mcuRows);
+        int bandRows = (mcuRows+count-1)/count;
+        if ((long)bandRows*mcuColumns>0xFFFF) {
+            bandRows = mcuRows;
+        }
+        count = (mcuRows+bandRows-1)/bandRows;
+
+        while ((int)bands.size()<count) {
+            bands.push_back(new CompressionBand);
+        }
+        for (int i=0; i<count; i++) {
+            CompressionBand& band = *bands[i];
+            int y = i*bandRows*mcuHeight;
+            band.pixels = src->getRow(y);
+            band.rowSize = src->getRowSize();
+            band.width = w;
+            band.height = std::min(bandRows*mcuHeight, h-y);
+            band.gray = gray;
+            band.quality = quality;
+            band.subsampling = subsampling;
+        }
+
+        ParallelBands::run(count, [this](int i) { bands[i]->compress(); });
+
+        bool ok = join(count, h, bandRows*mcuColumns, comment);
+        if (!ok && count>1) {
+            // the bands did not share their tables, compress in one go
+            bands[0]->height = h;
+            bands[0]->compress();
+            ok = join(1, h, 0, comment);
+        }
+        if (!ok) {
+            return false;
+        }
+        jpeg = Bytes((char*)&output[0], output.size());
+        return true;
+    }
+};
+
+#define HELPER(x) (*((MjpegCompressionHelper*)(x)))
+
+MjpegCompression::MjpegCompression() {
+    system_resource = new MjpegCompressionHelper;
+    yAssert(system_resource!=YARP_NULLPTR);
+}
+
+MjpegCompression::~MjpegCompression() {
+    if (system_resource!=YARP_NULLPTR) {
+        delete &HELPER(system_resource);
+        system_resource = YARP_NULLPTR;
+    }
+}
+
+void MjpegCompression::setQuality(int quality) {
+    HELPER(system_resource).quality = std::max(1, std::min(quality, 100));
+}
+
+void MjpegCompression::setSubsampling(int subsampling) {
+    if (subsampling==444 || subsampling==422 || subsampling==420) {
+        HELPER(system_resource).subsampling = subsampling;
+    }
+}
+
+void MjpegCompression::setThreads(int threads) {
+    HELPER(system_resource).threads = std::max(0, threads);
+}
+
+bool MjpegCompression::compress(const Image& image,
+                                const ConstString& comment,
+                                Bytes& jpeg) {
+    return HELPER(system_resource).compress(image, comment, jpeg);
+}
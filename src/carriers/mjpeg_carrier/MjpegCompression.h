@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP2_MJPEGCOMPRESSION_INC
+#define YARP2_MJPEGCOMPRESSION_INC
+
+#include <yarp/os/Bytes.h>
+#include <yarp/os/ConstString.h>
+#include <yarp/sig/Image.h>
+
+namespace yarp {
+    namespace mjpeg {
+        class MjpegCompression;
+    }
+}
+
+/**
+ * JPEG encoder of the mjpeg carrier.
+ *
+ * The compressor and the output buffer are kept from one frame to the
+ * next.  Large images are split in bands of whole MCU rows compressed by
+ * different threads, then joined in a single JPEG image with a restart
+ * marker between each band, which any decoder reads.  The TurboJPEG API
+ * of libjpeg-turbo is used when available, libjpeg otherwise.
+ */
+class yarp::mjpeg::MjpegCompression {
+private:
+    void *system_resource;
+public:
+    MjpegCompression();
+
+    virtual ~MjpegCompression();
+
+    /**
+     * Set the JPEG quality, from 1 to 100 (75 by default).
+     */
+    void setQuality(int quality);
+
+    /**
+     * Set the chroma subsampling: 444, 422 or 420 (the default).
+     */
+    void setSubsampling(int subsampling);
+
+    /**
+     * Set the number of threads compressing an image, 0 (the default)
+     * for one per core, up to 4, on images larger than 1MB.
+     */
+    void setThreads(int threads);
+
+    /**
+     * Compress an image.  RGB and MONO images are compressed as they are,
+     * the other formats are converted to RGB first.
+     *
+     * @param image the image to compress
+     * @param comment text stored in a COM marker, if not empty
+     * @param jpeg set to the compressed image, valid until the next call
+     * @return false if the image could not be compressed
+     */
+    bool compress(const yarp::sig::Image& image,
+                  const yarp::os::ConstString& comment,
+                  yarp::os::Bytes& jpeg);
+};
+
+#endif
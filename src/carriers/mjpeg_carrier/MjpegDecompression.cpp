@@ -13,6 +13,13 @@
 #include <csetjmp>
 #include <cstdio>
 #include <cstring>
+#include <vector>
+
+#ifdef MJPEG_USE_TURBOJPEG
+
+#include <turbojpeg.h>
+
+#else // MJPEG_USE_TURBOJPEG
 
 #if defined(_WIN32)
 #define INT32 long  // jpeg's definition
@@ -37,11 +44,94 @@ extern "C" {
 #undef QGLOBAL_H
 #endif
 
+#endif // MJPEG_USE_TURBOJPEG
+
 
 using namespace yarp::os;
 using namespace yarp::sig;
 using namespace yarp::mjpeg;
 
+
+#ifdef MJPEG_USE_TURBOJPEG
+
+/*
+ * Find the first COM marker of a JPEG image, before its scan.
+ */
+static bool findComment(const unsigned char *jpeg, size_t len, Bytes& comment) {
+    size_t at = 2;
+    while (at+4<=len && jpeg[at]==0xFF && jpeg[at+1]!=0xDA) {
+        size_t segment = (jpeg[at+2]<<8) | jpeg[at+3];
+        if (jpeg[at+1]==0xFE && segment>2 && at+2+segment<=len) {
+            comment = Bytes((char*)(jpeg+at+4), segment-2);
+            return true;
+        }
+        at += 2+segment;
+    }
+    return false;
+}
+
+class MjpegDecompressionHelper {
+public:
+    tjhandle handle;
+    yarp::os::InputStream::readEnvelopeCallbackType readEnvelopeCallback;
+    void* readEnvelopeCallbackData;
+
+    MjpegDecompressionHelper() :
+            handle(YARP_NULLPTR),
+            readEnvelopeCallback(YARP_NULLPTR),
+            readEnvelopeCallbackData(YARP_NULLPTR)
+    {
+    }
+
+    bool setReadEnvelopeCallback(yarp::os::InputStream::readEnvelopeCallbackType callback,
+                                 void* data)
+    {
+        readEnvelopeCallback = callback;
+        readEnvelopeCallbackData = data;
+        return true;
+    }
+
+    bool decompress(const Bytes& cimg, ImageOf<PixelRgb>& img) {
+        if (handle==YARP_NULLPTR) {
+            handle = tjInitDecompress();
+            if (handle==YARP_NULLPTR) {
+                return false;
+            }
+        }
+        unsigned char *jpeg = (unsigned char*)cimg.get();
+        unsigned long len = cimg.length();
+        int width = 0;
+        int height = 0;
+        int subsampling = 0;
+        int colorspace = 0;
+        if (tjDecompressHeader3(handle, jpeg, len, &width, &height,
+                                &subsampling, &colorspace)!=0) {
+            fprintf(stderr, "%s\n", tjGetErrorStr());
+            return false;
+        }
+        img.resize(width,height);
+        if (tjDecompress2(handle, jpeg, len, img.getRawImage(), width,
+                          img.getRowSize(), height, TJPF_RGB, 0)!=0) {
+            fprintf(stderr, "%s\n", tjGetErrorStr());
+            return false;
+        }
+        Bytes envelope;
+        if (readEnvelopeCallback && findComment(jpeg, len, envelope)) {
+            readEnvelopeCallback(readEnvelopeCallbackData, envelope);
+        }
+        return true;
+    }
+
+    ~MjpegDecompressionHelper() {
+        if (handle!=YARP_NULLPTR) {
+            tjDestroy(handle);
+            handle = YARP_NULLPTR;
+        }
+    }
+};
+
+#else // MJPEG_USE_TURBOJPEG
+
 struct net_error_mgr {
     struct jpeg_error_mgr pub;
     jmp_buf setjmp_buffer;
@@ -118,6 +208,7 @@ public:
     struct jpeg_decompress_struct cinfo;
     struct net_error_mgr jerr;
     JOCTET error_buffer[4];
+    std::vector<JSAMPROW> rows;
     yarp::os::InputStream::readEnvelopeCallbackType readEnvelopeCallback;
     void* readEnvelopeCallbackData;
 
@@ -154,7 +245,7 @@ public:
         jerr.pub.error_exit = net_error_exit;
 
         if (setjmp(jerr.setjmp_buffer)) {
-            jpeg_finish_decompress(&cinfo);
+            jpeg_abort_decompress(&cinfo);
             return false;
         }
 
@@ -167,12 +258,22 @@ public:
         jpeg_start_decompress(&cinfo);
         //int row_stride = cinfo.output_width * cinfo.output_components;
 
-        int at = 0;
+        rows.resize(cinfo.output_height);
+        for (size_t y=0; y<rows.size(); y++) {
+            rows[y] = (JSAMPROW)img.getRow(y);
+        }
         while (cinfo.output_scanline < cinfo.output_height) {
-            JSAMPLE *lines[1];
-            lines[0] = (JSAMPLE*)(&img.pixel(0,at));
-            jpeg_read_scanlines(&cinfo, lines, 1);
-            at++;
+            jpeg_read_scanlines(&cinfo, &rows[cinfo.output_scanline],
+                                cinfo.output_height-cinfo.output_scanline);
+        }
+        if (cinfo.output_components==1) {
+            // grayscale images are expanded in place, from the right
+            for (size_t y=0; y<rows.size(); y++) {
+                JSAMPROW row = rows[y];
+                for (int x=(int)cinfo.output_width-1; x>=0; x--) {
+                    row[3*x] = row[3*x+1] = row[3*x+2] = row[x];
+                }
+            }
         }
         if(readEnvelopeCallback && cinfo.marker_list && cinfo.marker_list->data_length > 0) {
             Bytes envelope(reinterpret_cast<char*>(cinfo.marker_list->data), cinfo.marker_list->data_length);
@@ -195,6 +296,8 @@ public:
     }
 };
 
+#endif // MJPEG_USE_TURBOJPEG
+
 #define HELPER(x) (*((MjpegDecompressionHelper*)(x)))
 
 MjpegDecompression::MjpegDecompression() {
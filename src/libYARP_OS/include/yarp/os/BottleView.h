@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_OS_BOTTLEVIEW_H
+#define YARP_OS_BOTTLEVIEW_H
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/ConstString.h>
+#include <yarp/os/Portable.h>
+#include <yarp/os/Value.h>
+
+namespace yarp {
+    namespace os {
+        class BottleView;
+    }
+}
+
+/**
+ * \ingroup comm_class
+ *
+ * \brief A read-only view on the binary form of a Bottle.
+ *
+ * A BottleView reads the same data as a Bottle, but keeps the bytes as
+ * they arrived and only decodes the elements that are asked for.  It
+ * suits readers that look at a few fields of large messages, for
+ * example a BufferedPort<BottleView> monitoring a robot state port:
+ *
+ * \code
+ * BottleView *state = port.read();
+ * double t = state->getDouble(0);
+ * BottleView joints = state->getList(3);  // no copy
+ * \endcode
+ *
+ * Nested lists are returned as views on the bytes of the view they come
+ * from; they stay valid for as long as that view is neither destroyed
+ * nor read into again.  Copying a view that holds its own bytes copies
+ * the bytes.  Use toBottle() to get a regular, modifiable Bottle.
+ *
+ * A BottleView is not safe to use from several threads at once, even
+ * for reading, since elements are located on demand.
+ */
+class YARP_OS_API yarp::os::BottleView : public Portable
+{
+public:
+    /**
+     * Constructor.  The view is initially empty.
+     */
+    BottleView();
+
+    /**
+     * Copy constructor.
+     *
+     * @param alt the view to copy
+     */
+    BottleView(const BottleView& alt);
+
+    /**
+     * Assignment operator.
+     *
+     * @param alt the view to copy
+     * @return the view itself
+     */
+    BottleView& operator=(const BottleView& alt);
+
+    /**
+     * Destructor.
+     */
+    virtual ~BottleView();
+
+    /**
+     * @return the number of elements in the view
+     */
+    int size() const;
+
+    /**
+     * @param index the element to check
+     * @return the type of the element as one of the BOTTLE_TAG_* codes,
+     * or 0 if there is no such element
+     */
+    int getCode(int index) const;
+
+    /**
+     * @return true if the element is an integer or a vocabulary item
+     */
+    bool isInt(int index) const;
+
+    /**
+     * @return true if the element is a floating point number
+     */
+    bool isDouble(int index) const;
+
+    /**
+     * @return true if the element is a string
+     */
+    bool isString(int index) const;
+
+    /**
+     * @return true if the element is a list
+     */
+    bool isList(int index) const;
+
+    /**
+     * @return true if the element is a dictionary
+     */
+    bool isDict(int index) const;
+
+    /**
+     * Read an element as an integer, converting numbers as Value::asInt
+     * does.
+     *
+     * @return the integer, or 0 if the element is not a number
+     */
+    int getInt(int index) const;
+
+    /**
+     * Read an element as a 64 bit integer.
+     *
+     * @return the integer, or 0 if the element is not a number
+     */
+    YARP_INT64 getInt64(int index) const;
+
+    /**
+     * Read an element as a floating point number.
+     *
+     * @return the number, or 0 if the element is not a number
+     */
+    double getDouble(int index) const;
+
+    /**
+     * Read a string or a blob.
+     *
+     * @return the string, or an empty string if the element is neither
+     */
+    ConstString getString(int index) const;
+
+    /**
+     * Get a view on a nested list or dictionary, without copying it.
+     *
+     * @return the view, empty if the element is not a list or dictionary
+     */
+    BottleView getList(int index) const;
+
+    /**
+     * Decode an element.
+     *
+     * @return a copy of the element, or a null value if there is no such
+     * element
+     */
+    Value get(int index) const;
+
+    /**
+     * Decode the whole view into a bottle.
+     *
+     * @param bottle the bottle to fill
+     * @return true on success
+     */
+    bool toBottle(Bottle& bottle) const;
+
+    /**
+     * @return the textual form of the view, as Bottle::toString
+     */
+    ConstString toString() const;
+
+    /**
+     * Set the view from the binary form of a bottle, as produced by
+     * Bottle::toBinary.  The bytes are copied.
+     *
+     * @return true if the data is a well-formed bottle
+     */
+    bool fromBinary(const char *data, size_t len);
+
+    /**
+     * Empty the view.
+     */
+    void clear();
+
+    // Documented in Portable
+    virtual bool read(ConnectionReader& reader) override;
+
+    // Documented in Portable
+    virtual bool write(ConnectionWriter& writer) override;
+
+private:
+    class Private;
+    Private *mPriv;
+};
+
+#endif // YARP_OS_BOTTLEVIEW_H
@@ -43,8 +43,12 @@ namespace yarp {
  * inside the BufferedPort and delivered to the reader. Pay attention that in this case a slow reader
  * may cause increasing latency and memory use.
  * 
+ * If only the most recent message matters, BufferedPort::setLatestOnly() keeps
+ * just that one, in a mailbox that incoming data never waits on.
+ *
  * Methods that can be useful to monitor the status of read and write operations are: 
- * yarp::os::BufferedPort::getPendingReads() and yarp::os::BufferedPort::isWriting(). 
+ * yarp::os::BufferedPort::getPendingReads(), yarp::os::BufferedPort::getDroppedCount()
+ * and yarp::os::BufferedPort::isWriting(). 
  *
  * For examples and help, see:
  * \li \ref what_is_a_port
@@ -242,6 +246,31 @@ public:
         reader.setStrict(strict);
     }
 
+    /**
+     *
+     * Keep only the newest message received, replacing any message
+     * that has not been read yet.  Incoming data is then handed over
+     * without the port's input threads ever waiting on the reader,
+     * which suits loops that poll the latest value of a signal at a
+     * fixed rate.  Call this before the port is connected.
+     * See PortReaderBuffer::setLatestOnly().
+     *
+     */
+    void setLatestOnly(bool flag=true) {
+        attachIfNeeded();
+        reader.setLatestOnly(flag);
+    }
+
+    /**
+     *
+     * @return the number of messages received and then dropped
+     * because a newer one arrived before they were read
+     *
+     */
+    long getDroppedCount() {
+        return reader.getDroppedCount();
+    }
+
     /**
      *
      * Read a message from the port.  Waits by default.
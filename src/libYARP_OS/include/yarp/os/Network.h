@@ -14,6 +14,9 @@
 #include <yarp/os/Property.h>
 #include <yarp/os/NameStore.h>
 #include <yarp/os/QosStyle.h>
+#include <yarp/os/Route.h>
+
+#include <vector>
 
 //protects against some dangerous ACE macros
 #ifdef main
@@ -110,6 +113,29 @@ public:
     static bool disconnect(const ConstString& src, const ConstString& dest,
                            const ContactStyle& style);
 
+    /**
+     * Request that several output ports connect to input ports.
+     * The ports are looked up together, and routes leaving different
+     * ports are set up in parallel, which is much quicker than calling
+     * connect() for each of them when there are many.
+     * @param routes the connections to make; the carrier of a route,
+     * if any, takes precedence over the carrier in the style
+     * @param style options for the connections
+     * @return one flag per route, true if the connection was made
+     */
+    static std::vector<bool> connectMany(const std::vector<Route>& routes,
+                                         const ContactStyle& style);
+
+    /**
+     * Request that several output ports disconnect from input ports.
+     * See connectMany().
+     * @param routes the connections to remove
+     * @param style options for network communication
+     * @return one flag per route, true if the connection was removed
+     */
+    static std::vector<bool> disconnectMany(const std::vector<Route>& routes,
+                                            const ContactStyle& style);
+
     /**
      * Check if a connection exists between two ports.
      * @param src the name of an output port
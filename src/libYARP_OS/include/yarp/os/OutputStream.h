@@ -64,6 +64,24 @@ public:
      */
     virtual void write(const yarp::os::Bytes& b) = 0;
 
+    /**
+     *
+     * Write several blocks of bytes to the stream, in order.  By
+     * default, this calls write(const Bytes& b) for each block.
+     * Streams that can send a list of blocks with a single operation
+     * (e.g. a gather write on a socket) should override this.
+     * The blocks need to stay valid only until this method returns.
+     *
+     * @param blocks the blocks to write
+     * @param count the number of blocks
+     *
+     */
+    virtual void writeBlocks(const yarp::os::Bytes *blocks, size_t count) {
+        for (size_t i=0; i<count; i++) {
+            write(blocks[i]);
+        }
+    }
+
     /**
      *
      * Terminate the stream.
@@ -231,6 +231,12 @@ public:
 
     void setTargetPeriod(double period);
 
+    void setLatestOnly(bool flag = true);
+
+    bool isLatestOnly();
+
+    long getDroppedCount();
+
     yarp::os::ConstString getName() const;
 
     unsigned int getMaxBuffer();
@@ -384,6 +390,37 @@ public:
         implementation.setPrune(autoDiscard);
     }
 
+    /**
+     * Keep only the newest message received, in a mailbox that the
+     * port's input threads can fill without ever waiting on the reader.
+     * Each new message replaces the previous one if it has not been
+     * read yet, and read() returns the newest message available.
+     * This trades the buffering policy set with setStrict() for a
+     * bounded and steady latency, for readers that only care about
+     * the current value of a signal (e.g. a control loop reading a
+     * sensor).  Call this before the port is connected.
+     * @param flag true to keep only the newest message
+     */
+    void setLatestOnly(bool flag = true) {
+        implementation.setLatestOnly(flag);
+    }
+
+    /**
+     * @return true if only the newest message is kept
+     * (see setLatestOnly())
+     */
+    bool isLatestOnly() {
+        return implementation.isLatestOnly();
+    }
+
+    /**
+     * @return the number of messages received and then dropped
+     * because a newer one arrived before they were read
+     */
+    long getDroppedCount() {
+        return implementation.getDroppedCount();
+    }
+
     /**
      * Check if data is available.
      * @return true iff data is available (i.e. a call to read() will return
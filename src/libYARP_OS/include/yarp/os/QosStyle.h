@@ -139,6 +139,25 @@ public:
     }
 
 
+    /**
+     * @brief sets the batching of small messages on the connection.
+     *
+     * Messages that expect no reply are held back by the sender and
+     * sent together once \a bytes bytes have been collected, or once
+     * the oldest of them has waited \a delay seconds.  This trades a
+     * little latency for far fewer writes when many small messages are
+     * sent at a high rate.  Only the sending side of a connection is
+     * concerned.
+     *
+     * @param bytes the size of a batch, 0 to send each message at once
+     * @param delay the longest time a message may be held back, in
+     * seconds (a default is used if not positive)
+     */
+    void setMessageBatching(int bytes, double delay = 0) {
+        batchSize = bytes;
+        batchDelay = delay;
+    }
+
     /**
      * @brief returns the packet TOS value
      * @return the TOS
@@ -180,6 +199,22 @@ public:
     }
 
 
+    /**
+     * @brief returns the size of a batch of messages
+     * @return the size in bytes, 0 if not batching, -1 if not set
+     */
+    int getMessageBatchSize() const {
+        return batchSize;
+    }
+
+    /**
+     * @brief returns the longest time a message may be held back in a batch
+     * @return the delay in seconds
+     */
+    double getMessageBatchDelay() const {
+        return batchDelay;
+    }
+
     /**
      * @brief returns the IPV4/6 DSCP value given as DSCP code
      * @param vocab a DSCP code (e.g., CS0)
@@ -200,6 +235,8 @@ private:
     int threadPriority;
     int threadPolicy;
     int packetPriority;
+    int batchSize;
+    double batchDelay;
 
 };
 
@@ -20,6 +20,14 @@ namespace yarp {
  * \ingroup key_class
  *
  * An abstraction for a periodic thread.
+ *
+ * By default each RateThread runs on a thread of its own.  If the
+ * YARP_RATETHREAD_POOL environment variable is set to a number of
+ * threads, the RateThreads of the process share that many threads
+ * instead, which wake each one up at fixed deadlines.  In that case
+ * threadInit(), run() and threadRelease() are called from one of the
+ * shared threads, and setPriority() does not apply (see
+ * YARP_RATETHREAD_POOL_PRIORITY).
  */
 class YARP_OS_API yarp::os::RateThread {
 public:
@@ -158,6 +166,47 @@ public:
      */
     void getEstUsed(double &av, double &std);
 
+    /**
+     * Return the number of iterations since last reset whose run()
+     * took longer than the period.
+     */
+    unsigned int getOverruns();
+
+    /**
+     * Return how much the time between successive iterations deviated
+     * from the period since last reset [ms].
+     * @param av average deviation
+     * @param max largest deviation
+     */
+    void getEstJitter(double &av, double &max);
+
+    /**
+     * Set the bins of the period and jitter histograms, and clear them.
+     * Bin i counts the values in [i*binWidth, (i+1)*binWidth), the last
+     * one also all the larger values.  By default there are 50 bins of
+     * 1 ms.
+     * @param binWidth width of each bin [ms]
+     * @param bins number of bins
+     */
+    void setHistogram(double binWidth, int bins);
+
+    /**
+     * Return how many times between successive iterations since last
+     * reset fell in each bin (see setHistogram()).
+     * @param counts filled with the count of each bin
+     * @param bins size of counts, bins beyond the histogram are set to 0
+     */
+    void getPeriodHistogram(unsigned int *counts, int bins);
+
+    /**
+     * Return how many deviations of the time between successive
+     * iterations from the period since last reset fell in each bin
+     * (see setHistogram()), as reported by getEstJitter().
+     * @param counts filled with the count of each bin
+     * @param bins size of counts, bins beyond the histogram are set to 0
+     */
+    void getJitterHistogram(unsigned int *counts, int bins);
+
     /**
      * Called just before a new thread starts. This method is executed
      * by the same thread that calls start().
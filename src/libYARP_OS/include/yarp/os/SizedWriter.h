@@ -43,9 +43,21 @@ public:
     virtual Portable *getReference() = 0;
 
     virtual void write(OutputStream& os) {
+        // Hand blocks over in groups, so streams that can do so send
+        // them with a single operation.
+        const size_t group = 32;
+        Bytes blocks[group];
+        size_t n = 0;
         for (size_t i=0; i<length(); i++) {
-            Bytes b((char*)data(i), length(i));
-            os.write(b);
+            blocks[n] = Bytes((char*)data(i), length(i));
+            n++;
+            if (n==group) {
+                os.writeBlocks(blocks, n);
+                n = 0;
+            }
+        }
+        if (n>0) {
+            os.writeBlocks(blocks, n);
         }
     }
 
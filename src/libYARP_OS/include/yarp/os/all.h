@@ -18,6 +18,7 @@
 #include <yarp/os/NetUint64.h>
 #include <yarp/os/BinPortable.h>
 #include <yarp/os/Bottle.h>
+#include <yarp/os/BottleView.h>
 #include <yarp/os/BufferedPort.h>
 #include <yarp/os/ConnectionReader.h>
 #include <yarp/os/ConnectionWriter.h>
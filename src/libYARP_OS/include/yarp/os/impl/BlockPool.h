@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_OS_IMPL_BLOCKPOOL_H
+#define YARP_OS_IMPL_BLOCKPOOL_H
+
+#include <yarp/os/api.h>
+#include <yarp/os/Bytes.h>
+#include <yarp/os/ManagedBytes.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/impl/PlatformVector.h>
+
+namespace yarp {
+    namespace os {
+        class Property;
+        namespace impl {
+            class BlockPool;
+        }
+    }
+}
+
+/**
+ * Number of size classes kept by a BlockPool.
+ */
+#define BLOCK_POOL_CLASSES (6)
+
+/**
+ * Maximum number of free blocks cached for each size class of a BlockPool.
+ */
+#define BLOCK_POOL_MAX_FREE_BLOCKS (64)
+
+/**
+ *
+ * A cache of memory blocks used to store serialized messages.
+ *
+ * A BufferedConnectionWriter creates and destroys a few ManagedBytes
+ * blocks for every message it serializes.  When it is given a BlockPool
+ * (see BufferedConnectionWriter::setBlockPool), blocks are taken from
+ * the pool and given back to it instead, so that the steady state of a
+ * port sending messages allocates no memory.
+ *
+ * Blocks that own their memory are sorted in size classes: small
+ * classes fit message headers and Bottles of a few elements, large
+ * classes fit the pool buffers a BufferedConnectionWriter grows for
+ * big payloads.  Blocks that merely refer to external memory (e.g. the
+ * pixels of an image) are cached separately.  Blocks larger than the
+ * largest class are never cached.
+ *
+ * The pool can be shared by several threads.
+ *
+ */
+class YARP_OS_impl_API yarp::os::impl::BlockPool
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param maxFreeBlocks how many free blocks to keep, at most,
+     * for each size class.
+     */
+    BlockPool(size_t maxFreeBlocks = BLOCK_POOL_MAX_FREE_BLOCKS);
+
+    /**
+     * Destructor.  Any cached block is freed.  Blocks still in use are
+     * not affected, and are freed normally when given back.
+     */
+    virtual ~BlockPool();
+
+    /**
+     * Get a block owning at least `len` bytes of memory.
+     *
+     * @param len the minimum length of the block
+     * @return a block, with its "used" length set to `len`
+     */
+    yarp::os::ManagedBytes *get(size_t len);
+
+    /**
+     * Get a block referring to external memory, without copying it.
+     *
+     * @param data the memory to refer to
+     * @return a block not owning its memory
+     */
+    yarp::os::ManagedBytes *getReference(const yarp::os::Bytes& data);
+
+    /**
+     * Give a block back to the pool.  The block may be cached for reuse,
+     * or deleted.  It must not be used anymore by the caller.
+     *
+     * @param block the block, possibly YARP_NULLPTR
+     */
+    void release(yarp::os::ManagedBytes *block);
+
+    /**
+     * Free all cached blocks.
+     */
+    void clear();
+
+    /**
+     * @return how many requests were served from cached blocks
+     */
+    size_t getHits();
+
+    /**
+     * @return how many requests needed a memory allocation
+     */
+    size_t getMisses();
+
+    /**
+     * @return total size in bytes of the blocks currently cached
+     */
+    size_t getCachedBytes();
+
+    /**
+     * Reset hit/miss counters.
+     */
+    void resetCounters();
+
+    /**
+     * Describe the state of the pool, for reporting through the port
+     * administrative interface.
+     *
+     * @param prop where to store "hits", "misses", "cached_blocks",
+     * "cached_bytes" and per-class hit/miss counters.
+     */
+    void getStats(yarp::os::Property& prop);
+
+    /**
+     * @return the block length used for requests of `len` bytes, or 0 if
+     * such blocks are not cached.
+     */
+    static size_t classSize(size_t len);
+
+private:
+    int classIndex(size_t len) const;
+
+    yarp::os::Mutex mutex;
+    size_t maxFreeBlocks;
+    PlatformVector<yarp::os::ManagedBytes *> owned[BLOCK_POOL_CLASSES];
+    PlatformVector<yarp::os::ManagedBytes *> references;
+    size_t hits[BLOCK_POOL_CLASSES+1];   ///< per class, references last
+    size_t misses[BLOCK_POOL_CLASSES+1]; ///< per class, references last
+    size_t unpooled;                     ///< requests too big to be cached
+};
+
+#endif // YARP_OS_IMPL_BLOCKPOOL_H
@@ -19,6 +19,9 @@
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/PlatformVector.h>
 
+#include <atomic>
+#include <mutex>
+
 namespace yarp {
     namespace os {
         namespace impl {
@@ -431,6 +434,14 @@ public:
  * A flexible data format for holding a bunch of numbers and strings.
  * Handy to use until you work out how to make your own more
  * efficient formats for transmission.
+ *
+ * Elements are kept in their network representation, one after the
+ * other in a single buffer, with an index of where each one starts.
+ * Reading a bottle, adding numbers and strings to it and serializing
+ * it again therefore costs no allocation per element.  A Storable is
+ * only created for an element the first time it is accessed through
+ * get(); primitive Storables are placed in an arena owned by the
+ * bottle, which is reused when the bottle is cleared.
  */
 class YARP_OS_impl_API yarp::os::impl::BottleImpl : public yarp::os::Portable
 {
@@ -456,14 +467,11 @@ public:
 
     yarp::os::Bottle* getList(int index);
 
-    void addInt(int x) { add(new StoreInt(x)); }
-    void addInt64(const YARP_INT64& x) { add(new StoreInt64(x)); }
-    void addVocab(int x) { add(new StoreVocab(x)); }
-    void addDouble(double x) { add(new StoreDouble(x)); }
-    void addString(const yarp::os::ConstString& text)
-    {
-        add(new StoreString(text));
-    }
+    void addInt(int x);
+    void addInt64(const YARP_INT64& x);
+    void addVocab(int x);
+    void addDouble(double x);
+    void addString(const yarp::os::ConstString& text);
 
     yarp::os::Bottle& addList();
 
@@ -534,7 +542,10 @@ public:
     // check if a piece of text is a completed bottle
     static bool isComplete(const char* txt);
 
-    void hasChanged() { dirty = true; }
+    void hasChanged()
+    {
+        changed();
+    }
     static void fini()
     {
         if (storeNull) {
@@ -551,18 +562,138 @@ public:
     Value& findGroupBit(const ConstString& key) const;
     Value& findBit(const ConstString& key) const;
 
+    /**
+     * Choose whether new bottles keep their elements in a flat buffer
+     * (the default) or create a Storable per element straight away, as
+     * older versions did.  Only meant for benchmarking and debugging.
+     */
+    static void setFlatStorage(bool flat);
+
+    /**
+     * @return true if elements are kept in a flat buffer.
+     */
+    static bool getFlatStorage();
+
+    /**
+     * Copy the binary form of a complete bottle from a connection,
+     * checking its structure but without decoding any element.
+     *
+     * @param reader the connection to read from
+     * @param data filled with the bytes read, starting with the top code
+     * @return true if a well-formed bottle was read
+     */
+    static bool readBinary(ConnectionReader& reader, PlatformVector<char>& data);
+
+    /**
+     * @return the number of bytes taken by an element of type code (not
+     * including the code itself) at the start of data, or 0 if data is
+     * too short or malformed
+     */
+    static size_t elementSize(int code, const char* data, size_t length);
+
+    /**
+     * @return the number of bytes taken by a list whose elements are all
+     * of type subCode (0 if each element carries its own code), starting
+     * with its element count, or 0 if data is too short or malformed
+     */
+    static size_t listSize(int subCode, const char* data, size_t length);
+
+    /**
+     * Create a storable on the heap from the binary form of an element.
+     *
+     * @param code the type of the element
+     * @param raw the element, without its type code
+     * @param length the number of bytes in raw
+     */
+    static Storable* createStorable(int code, const char* raw, size_t length);
+
 private:
-    static StoreNull* storeNull;
+    class Source;
+
+    /**
+     * An element of the bottle.  The network representation of the
+     * element (without its type code) lives in the flat buffer at
+     * [offset, offset+length).  The storable is created on demand.
+     */
+    class Item
+    {
+    public:
+        Item() :
+                code(0),
+                offset(0),
+                length(0),
+                pooled(false),
+                storable(YARP_NULLPTR)
+        {
+        }
 
-    PlatformVector<Storable*> content;
-    PlatformVector<char> data;
+        Item(int code, size_t offset, size_t length, Storable* storable) :
+                code(code),
+                offset(offset),
+                length(length),
+                pooled(false),
+                storable(storable)
+        {
+        }
+
+        Item(const Item& alt) :
+                code(alt.code),
+                offset(alt.offset),
+                length(alt.length),
+                pooled(alt.pooled),
+                storable(alt.storable.load())
+        {
+        }
+
+        Item& operator=(const Item& alt)
+        {
+            code = alt.code;
+            offset = alt.offset;
+            length = alt.length;
+            pooled = alt.pooled;
+            storable.store(alt.storable.load());
+            return *this;
+        }
+
+        int code;       ///< type code, valid while storable is not set
+        size_t offset;  ///< start of the raw element in the flat buffer
+        size_t length;  ///< length of the raw element
+        bool pooled;    ///< storable lives in the arena
+        std::atomic<Storable*> storable; ///< element, once created
+    };
+
+    static StoreNull* storeNull;
+    static bool flatStorage;
+
+    mutable PlatformVector<Item> content;
+    PlatformVector<char> flat;  ///< raw elements
+    PlatformVector<char> data;  ///< serialized bottle, when not in flat
+    mutable PlatformVector<char*> arena; ///< blocks for small storables
+    mutable size_t arenaBlock;  ///< block currently being filled
+    mutable size_t arenaUsed;   ///< bytes used in that block
+    mutable std::mutex mutex;   ///< guards the storables created and the flags below
     int speciality;
     bool nested;
     bool dirty;
+    bool wire;                  ///< flat holds exactly the serialized bottle
 
     void add(Storable* s);
+    void addRaw(int code, const char* head, size_t headLength,
+                const char* tail = YARP_NULLPTR, size_t tailLength = 0);
     void smartAdd(const ConstString& str);
 
+    int codeAt(size_t index) const;
+    Storable& materialize(size_t index) const;
+    Storable* decode(const Item& item, bool& pooled) const;
+    static Storable* decode(int code, const char* raw, size_t length,
+                            const BottleImpl* owner, bool& pooled);
+    void* arenaAlloc(size_t size) const;
+    Storable* release(size_t index);
+    bool scan(Source& source);
+    void materializeAll();
+    void changed();
+    bool elementsUnchanged() const;
+
     void synch();
 };
 
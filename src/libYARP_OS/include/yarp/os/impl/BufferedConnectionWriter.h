@@ -19,6 +19,7 @@
 #include <yarp/os/NetInt64.h>
 
 #include <yarp/os/impl/PlatformVector.h>
+#include <yarp/os/impl/BlockPool.h>
 #include <cstdlib>
 
 namespace yarp {
@@ -87,6 +88,7 @@ public:
         convertTextModePending = false;
         lst_used = 0;
         header_used = 0;
+        blockPool = YARP_NULLPTR;
     }
 
     /**
@@ -135,11 +137,11 @@ public:
 
         size_t i;
         for (i=0; i<lst.size(); i++) {
-            delete lst[i];
+            releaseBlock(lst[i]);
         }
         lst.clear();
         for (i=0; i<header.size(); i++) {
-            delete header[i];
+            releaseBlock(header[i]);
         }
         header.clear();
         stopPool();
@@ -330,7 +332,7 @@ public:
             yarp::os::ManagedBytes& b = *(header[index]);
             return b.used();
         }
-        yarp::os::ManagedBytes& b = *(lst[index-header.size()]);
+        yarp::os::ManagedBytes& b = *(lst[index-header_used]);
         return b.used();
     }
 
@@ -340,7 +342,7 @@ public:
             yarp::os::ManagedBytes& b = *(header[index]);
             return (const char *)b.get();
         }
-        yarp::os::ManagedBytes& b = *(lst[index-header.size()]);
+        yarp::os::ManagedBytes& b = *(lst[index-header_used]);
         return (const char *)b.get();
     }
 
@@ -475,6 +477,28 @@ public:
         initialPoolSize = size;
     }
 
+    /**
+     *
+     * Draw memory blocks from a shared pool, and give them back to it
+     * once they are no longer needed, rather than allocating and
+     * freeing them.  The pool must outlive this writer.
+     * @param pool the pool to use, or YARP_NULLPTR to go back to plain
+     * allocation
+     *
+     */
+    void setBlockPool(BlockPool *pool) {
+        blockPool = pool;
+    }
+
+    /**
+     *
+     * @return the pool memory blocks are drawn from, if any
+     *
+     */
+    BlockPool *getBlockPool() const {
+        return blockPool;
+    }
+
 private:
     /**
      *
@@ -488,6 +512,28 @@ private:
      */
     bool applyConvertTextMode();
 
+    /**
+     *
+     * Get a block owning at least `len` bytes, with `len` bytes in use.
+     *
+     */
+    yarp::os::ManagedBytes *acquireBlock(size_t len);
+
+    /**
+     *
+     * Get a block holding a copy of (if `copy` is set) or a reference to
+     * the specified data.
+     *
+     */
+    yarp::os::ManagedBytes *acquireBlock(const yarp::os::Bytes& data, bool copy);
+
+    /**
+     *
+     * Dispose of a block obtained through acquireBlock().
+     *
+     */
+    void releaseBlock(yarp::os::ManagedBytes *bytes);
+
 
     PlatformVector<yarp::os::ManagedBytes *> lst;    ///< buffers in payload
     PlatformVector<yarp::os::ManagedBytes *> header; ///< buffers in header
@@ -506,6 +552,7 @@ private:
     size_t header_used;///< how many header buffers are in use for the current message
     size_t *target_used;///< points to lst_used of header_used
     size_t initialPoolSize; ///< size of new pool buffers
+    BlockPool *blockPool; ///< where to get memory blocks from, if anywhere
 };
 
 
@@ -28,7 +28,9 @@ namespace yarp {
 
 /**
  * A stream abstraction for datagram communication.  It supports UDP and
- * MCAST.  This class is not concerned with making the stream reliable.
+ * MCAST.  By default this class is not concerned with making the stream
+ * reliable: a message is dropped as soon as one of its datagrams is
+ * lost.  See setRecovery() for a framing that can survive losses.
  */
 class YARP_OS_impl_API yarp::os::impl::DgramTwoWayStream : public TwoWayStream, public InputStream, public OutputStream
 {
@@ -43,7 +45,8 @@ public:
                           mutex(1), readAt(0), readAvail(0),
                           writeAvail(0), pct(0), happy(true),
                           bufferAlertNeeded(false), bufferAlerted(false),
-                          multiMode(false), errCount(0), lastReportTime(0)
+                          multiMode(false), errCount(0), lastReportTime(0),
+                          recovery(YARP_NULLPTR)
     {
 
     }
@@ -141,7 +144,37 @@ public:
 
     virtual void onMonitorOutput() {}
 
+    /**
+     * Send messages as numbered fragments, so that the reader can put
+     * them back together when datagrams are lost or reordered.  The
+     * reader recognizes this framing by itself.
+     *
+     * @param parityGroup if positive, follow every parityGroup data
+     * datagrams (and the end of each message) with an XOR parity
+     * datagram, from which the reader can rebuild any single lost
+     * datagram of the group
+     * @param retransmitWindow if positive, the reader asks the writer
+     * for missing datagrams and waits at most this long (in seconds)
+     * for them before dropping the message; the writer keeps recently
+     * sent datagrams, and answers requests from a thread of its own
+     * until the stream is closed
+     */
+    void setRecovery(int parityGroup, double retransmitWindow);
+
+    /**
+     * Call setRecovery() as requested by the carrier modifiers
+     * "+fec.N" (a parity datagram every N datagrams) and "+nack.MS"
+     * (retransmission requests, waiting at most MS milliseconds), if
+     * present.  Retransmission requests are only available for
+     * unicast streams.
+     *
+     * @param carrierName the carrier name, with modifiers
+     */
+    void configureRecovery(const ConstString& carrierName);
+
 private:
+    class Recovery;
+
     yarp::os::ManagedBytes monitor;
     bool closed, interrupting, reader;
 #ifdef YARP_HAS_ACE
@@ -165,10 +198,29 @@ private:
     bool multiMode;
     int errCount;
     double lastReportTime;
+    Recovery *recovery;
 
     void allocate(int readSize=0, int writeSize=0);
 
     void configureSystemBuffers();
+
+    YARP_SSIZE_T headerSize() const;
+    YARP_SSIZE_T sendDatagram(const char *data, size_t len);
+    YARP_SSIZE_T sendToPeer(const char *data, size_t len);
+    YARP_SSIZE_T receiveDatagram(char *data, size_t len, double timeout);
+
+    void holdFragment();
+    void sendFragment(bool last);
+    void sendParity();
+    void answerRequests();
+    void serveRequests();
+    void stopServing();
+    void serviceRequests(double timeout);
+    bool nextFragment();
+    int acceptFragment(const char *data, size_t len);
+    bool takeFragment();
+    bool recoverFragment(int seq);
+    void requestFragments();
 };
 
 #endif // YARP_OS_IMPL_DGRAMTWOWAYSTREAM_H
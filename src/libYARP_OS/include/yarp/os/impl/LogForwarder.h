@@ -11,7 +11,6 @@
 #include <yarp/os/api.h>
 #include <yarp/os/BufferedPort.h>
 #include <yarp/os/Network.h>
-#include <yarp/os/Semaphore.h>
 #include <string>
 
 namespace yarp {
@@ -19,23 +18,43 @@ namespace os {
 
 #define MAX_STRING_SIZE 255
 
+/**
+ * Forwards log messages to the yarplogger, when YARP_FORWARD_LOG_ENABLE
+ * is set.
+ *
+ * forward() never touches the network: messages are queued in a
+ * bounded lock-free ring, and a background thread sends them, several
+ * per Bottle when they pile up.  When the ring is full, the
+ * YARP_FORWARD_LOG_OVERFLOW environment variable decides whether the
+ * oldest queued message is dropped ("drop-oldest", the default), the new
+ * one is dropped ("drop-newest"), or the caller waits for room
+ * ("block").  The size of the ring is set with YARP_FORWARD_LOG_QUEUE.
+ */
 class YARP_OS_API LogForwarder
 {
     public:
         static LogForwarder* getInstance();
         static void clearInstance();
         void forward (const std::string& message);
+
+        /**
+         * @return the number of messages dropped because the queue
+         * was full
+         */
+        long getDroppedCount();
     protected:
         LogForwarder();
         ~LogForwarder();
     private:
-        static yarp::os::Semaphore *sem;
+        class Private;
+        Private * const mPriv;
         char logPortName[MAX_STRING_SIZE];
         yarp::os::BufferedPort<yarp::os::Bottle>* outputPort;
     private:
-        LogForwarder(LogForwarder const&){};
+        LogForwarder(LogForwarder const&) : mPriv(YARP_NULLPTR) {};
         LogForwarder& operator=(LogForwarder const&){return *this;}; //@@@checkme
         static LogForwarder* instance;
+        friend class Private;
 };
 
 } // namespace os
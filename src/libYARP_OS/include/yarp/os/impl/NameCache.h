@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_OS_IMPL_NAMECACHE_H
+#define YARP_OS_IMPL_NAMECACHE_H
+
+#include <yarp/os/api.h>
+#include <yarp/os/Contact.h>
+#include <yarp/os/ConstString.h>
+
+namespace yarp {
+    namespace os {
+        namespace impl {
+            class NameCache;
+        }
+    }
+}
+
+/**
+ * Remembers, for a while, the addresses of ports found through the name
+ * server, so that a process connecting the same ports over and over
+ * does not ask the name server each time.
+ *
+ * An address is forgotten when its time to live expires, when the port
+ * is registered or unregistered by this process, or when a connection
+ * to it fails.  While the cache is in use, the process also listens to
+ * the events published by the name server on its own port, and forgets
+ * a port as soon as it is registered or unregistered by anybody.  Name
+ * servers that do not publish events just leave the expiry time as the
+ * bound on how long a stale address can be used.
+ *
+ * The cache is off by default.  It is turned on for a process by setting
+ * the YARP_NAME_CACHE_TTL environment variable to the number of seconds
+ * addresses are kept for, or by calling setTtl().
+ */
+class YARP_OS_impl_API yarp::os::impl::NameCache
+{
+public:
+    /**
+     * Look up a port in the cache.
+     *
+     * @param name the name of the port
+     * @param contact set to the address of the port, if known
+     * @return true if the address of the port is known
+     */
+    static bool lookup(const yarp::os::ConstString& name,
+                       yarp::os::Contact& contact);
+
+    /**
+     * Remember the address of a port, as given by the name server.
+     * Does nothing if the cache is off.
+     */
+    static void store(const yarp::os::ConstString& name,
+                      const yarp::os::Contact& contact);
+
+    /**
+     * Forget the address of a port.
+     */
+    static void invalidate(const yarp::os::ConstString& name);
+
+    /**
+     * Forget the address of all ports.
+     */
+    static void clear();
+
+    /**
+     * Choose how long addresses are kept for.
+     *
+     * @param ttl time to live, in seconds, 0 to turn the cache off
+     */
+    static void setTtl(double ttl);
+
+    /**
+     * @return how long addresses are kept for, in seconds, 0 if the
+     * cache is off
+     */
+    static double getTtl();
+
+    /**
+     * Stop listening to the name server and forget all addresses.
+     */
+    static void fini();
+
+private:
+    class Listener;
+
+    static void listen();
+};
+
+#endif // YARP_OS_IMPL_NAMECACHE_H
@@ -17,6 +17,8 @@
 #include <yarp/os/Nodes.h>
 #include <yarp/os/Network.h>
 
+#include <vector>
+
 namespace yarp {
     namespace os {
         namespace impl {
@@ -103,6 +105,15 @@ public:
      */
     Contact queryName(const ConstString& name);
 
+    /**
+     * Look up the addresses of several ports, asking the name server
+     * for all of them in one go.
+     * @param names the names of the ports
+     * @return the addresses associated with the ports, in the same
+     * order, invalid for ports that are not registered
+     */
+    std::vector<Contact> queryNames(const std::vector<ConstString>& names);
+
     /**
      * Register a port with a given name.
      * @param name the name of the port
@@ -453,6 +453,17 @@ public:
         return interrupted;
     }
 
+    /**
+     *
+     * @return the pool of memory blocks used to serialize messages
+     * sent by this port.
+     *
+     */
+    BlockPool& getBlockPool()
+    {
+        return blockPool;
+    }
+
 public:
 
     // documented in PortManager
@@ -622,6 +633,7 @@ private:
     int verbosity;  ///< threshold on what warnings or debug messages are shown
     bool logNeeded; ///< port needs to monitor message content
     PortCorePackets packets; ///< a pool for tracking messages currently being sent
+    BlockPool blockPool; ///< memory blocks for serializing outgoing messages
     ConstString envelope;///< user-defined wrapping data
     float timeout;  ///< a timeout to apply to all network operations
     int counter;    ///< port-unique ids for connections
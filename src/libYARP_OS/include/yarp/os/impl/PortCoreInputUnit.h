@@ -7,6 +7,7 @@
 #ifndef YARP_OS_IMPL_PORTCOREINPUTUNIT_H
 #define YARP_OS_IMPL_PORTCOREINPUTUNIT_H
 
+#include <yarp/os/impl/PortCommand.h>
 #include <yarp/os/impl/PortCore.h>
 #include <yarp/os/impl/PortCoreUnit.h>
 #include <yarp/os/impl/Logger.h>
@@ -16,6 +17,7 @@ namespace yarp {
     namespace os {
         namespace impl {
             class PortCoreInputUnit;
+            class PortCoreReactor;
         }
     }
 }
@@ -23,6 +25,10 @@ namespace yarp {
 /**
  * Manager for a single input to a port.  Associated
  * with a PortCore object.
+ *
+ * Each input normally has a thread of its own.  When the process uses a
+ * PortCoreReactor, tcp inputs are instead served by the reactor's
+ * threads one message at a time.
  */
 class yarp::os::impl::PortCoreInputUnit : public PortCoreUnit
 {
@@ -50,7 +56,12 @@ public:
             running(false),
             name(owner.getName()),
             localReader(YARP_NULLPTR),
-            reversed(reversed)
+            reversed(reversed),
+            reactor(YARP_NULLPTR),
+            opened(false),
+            handOff(false),
+            wasNoticed(false),
+            posted(false)
     {
         yAssert(ip!=YARP_NULLPTR);
 
@@ -134,6 +145,20 @@ public:
 
     virtual bool isBusy() override;
 
+    /**
+     * Serve this input from a PortCoreReactor thread, when data is
+     * waiting: complete the connection if needed, or read one message.
+     *
+     * @return true if the reactor should keep watching this input
+     */
+    bool serve();
+
+    /**
+     * Called once the PortCoreReactor no longer watches this input,
+     * either to wrap it up or to give it a thread of its own.
+     */
+    void release();
+
 private:
     InputProtocol *ip;
     SemaphoreImpl phase, access;
@@ -142,11 +167,59 @@ private:
     yarp::os::PortReader *localReader;
     Route officialRoute;
     bool reversed;
+    PortCoreReactor *reactor;
+    bool opened;
+    bool handOff;
+    Route route;
+    bool wasNoticed;
+    bool posted;
+    PortCommand cmd;
 
     void closeMain();
 
+    /**
+     * Complete the connection and announce it.
+     *
+     * @return false if there is nothing more to read
+     */
+    bool openInput();
+
+    /**
+     * Read and act on one message.
+     *
+     * @return false if there is nothing more to read
+     */
+    bool readInput();
+
+    /**
+     * Close the connection and announce its end.
+     */
+    void closeInput();
+
+    /**
+     * @return the socket descriptor of a connection that can be served by
+     * a PortCoreReactor, or -1
+     */
+    int getReactorHandle();
+
     bool skipIncomingData(yarp::os::ConnectionReader& reader);
 
+    /**
+     * Pass a data message on to the port's owner, through any
+     * modifiers in place.
+     */
+    void readData(yarp::os::ConnectionReader& reader, void *id,
+                  yarp::os::OutputStream *os);
+
+    /**
+     * Unpack a batch of data messages ("b" command) and pass each of
+     * them on to the port's owner.
+     *
+     * @return false if the batch is malformed
+     */
+    bool readBatch(yarp::os::ConnectionReader& reader, void *id,
+                   yarp::os::OutputStream *os);
+
     static void envelopeReadCallback(void* data, const Bytes& envelope);
 };
 
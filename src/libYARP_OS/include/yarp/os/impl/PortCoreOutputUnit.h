@@ -9,6 +9,7 @@
 
 #include <yarp/os/impl/PortCore.h>
 #include <yarp/os/impl/PortCoreUnit.h>
+#include <yarp/os/impl/BufferedConnectionWriter.h>
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/OutputProtocol.h>
 
@@ -49,7 +50,14 @@ public:
             cachedWriter(YARP_NULLPTR),
             cachedReader(YARP_NULLPTR),
             cachedCallback(YARP_NULLPTR),
-            cachedTracker(YARP_NULLPTR)
+            cachedTracker(YARP_NULLPTR),
+            queued(false),
+            batchBytes(0),
+            batchDelay(0),
+            batchCount(0),
+            batchSize(0),
+            batchStart(0),
+            batchMutex(1)
     {
         yAssert(op!=YARP_NULLPTR);
     }
@@ -115,6 +123,9 @@ public:
     // documented in PortCoreUnit
     virtual bool isBusy() override;
 
+    // documented in PortCoreUnit
+    virtual bool canShareContent() override;
+
     // documented in PortCoreUnit
     void setCarrierParams(const yarp::os::Property& params) override
     {
@@ -135,6 +146,38 @@ public:
         return op;
     }
 
+    /**
+     * Coalesce small data messages sent on this connection.  Messages
+     * that expect no reply are held back and sent together, as a single
+     * framed write, once maxBytes bytes have been collected or the
+     * oldest of them has waited maxDelay seconds.  The receiving port
+     * hands them on one by one, each with its own envelope.
+     *
+     * Batching can also be requested with the carrier modifiers
+     * "+batch.BYTES+batchdelay.SECONDS", e.g. "tcp+batch.4096".
+     *
+     * @param maxBytes size of a batch, 0 to send each message at once
+     * @param maxDelay longest time a message may be held back, in seconds
+     * (a default is used if not positive)
+     */
+    void setBatching(size_t maxBytes, double maxDelay);
+
+    /**
+     * @return the size of a batch, 0 if messages are not batched
+     */
+    size_t getBatchBytes() const
+    {
+        return batchBytes;
+    }
+
+    /**
+     * @return the longest time a message may be held back in a batch
+     */
+    double getBatchDelay() const
+    {
+        return batchDelay;
+    }
+
 private:
     OutputProtocol *op; ///< protocol object for writing/reading
     bool closing;       ///< should this connection close
@@ -151,12 +194,49 @@ private:
                                           ///< completion events
     void *cachedTracker;        ///< memory tracker for current message
     ConstString cachedEnvelope;      ///< some text to pass along with the message
+    bool queued;                ///< a message is waiting for the sending thread
+    size_t batchBytes;          ///< send a batch at this size, 0 if not batching
+    double batchDelay;          ///< send a batch when its first message is this old
+    BufferedConnectionWriter batch; ///< messages waiting to be sent together
+    int batchCount;             ///< number of messages in the batch
+    size_t batchSize;           ///< bytes in the batch
+    double batchStart;          ///< when the first message joined the batch
+    SemaphoreImpl batchMutex;   ///< serialize writes to the connection
+                                ///< while batching may be going on
 
     /**
      * The core logic for sending a message.
      */
     bool sendHelper();
 
+    /**
+     * Wait for the next message to send.
+     *
+     * @return false if there is a batch due for sending instead
+     */
+    bool waitForActivity();
+
+    /**
+     * Add the message in buf to the batch, sending the batch if it
+     * is full.  Call with batchMutex held.
+     *
+     * @return false if the connection failed
+     */
+    bool addToBatch(BufferedConnectionWriter& buf);
+
+    /**
+     * Send the messages collected so far as a single batch.  Call with
+     * batchMutex held.
+     *
+     * @return false if the connection failed
+     */
+    bool writeBatch();
+
+    /**
+     * Send the batch if it has waited long enough.
+     */
+    void flushBatch();
+
     /**
      * Try to close the connection, but not very hard.
      */
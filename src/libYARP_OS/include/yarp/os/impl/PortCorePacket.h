@@ -9,6 +9,7 @@
 
 #include <yarp/os/PortWriter.h>
 #include <yarp/os/NetType.h>
+#include <yarp/os/impl/PortCoreSharedContent.h>
 
 namespace yarp {
     namespace os {
@@ -33,6 +34,8 @@ public:
     bool owned;            ///< should we memory-manage the content object
     bool ownedCallback;    ///< should we memory-manage the callback object
     bool completed;        ///< has a notification of completion been sent
+    PortCoreSharedContent shared; ///< content serialized once for all
+                                  ///< connections able to share it
 
     /**
      * Constructor.
@@ -117,6 +120,25 @@ public:
         this->owned = owned;
         this->ownedCallback = ownedCallback;
         completed = false;
+        shared.reset();
+    }
+
+    /**
+     * Serialize the content once, so that it can be sent on several
+     * connections without being serialized again for each of them.
+     *
+     * @return a writer that replays the serialized content, or
+     * YARP_NULLPTR if the content could not be serialized in a
+     * connection-independent way.
+     */
+    yarp::os::PortWriter *getSharedContent()
+    {
+        if (!shared.isValid()) {
+            if (content == YARP_NULLPTR || !shared.serialize(*content)) {
+                return YARP_NULLPTR;
+            }
+        }
+        return &shared;
     }
 
     /**
@@ -124,6 +146,7 @@ public:
      */
     void reset()
     {
+        shared.reset();
         if (owned) {
             delete content;
         }
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_OS_IMPL_PORTCOREREACTOR_H
+#define YARP_OS_IMPL_PORTCOREREACTOR_H
+
+#include <yarp/os/api.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/impl/PlatformVector.h>
+#include <yarp/os/impl/SemaphoreImpl.h>
+
+#include <map>
+
+namespace yarp {
+    namespace os {
+        namespace impl {
+            class PortCoreReactor;
+            class PortCoreInputUnit;
+        }
+    }
+}
+
+/**
+ * Serves the tcp input connections of all the ports of a process from a
+ * small pool of threads, instead of one thread per connection.
+ *
+ * The threads wait together on the sockets of all idle connections.
+ * When data arrives on one of them, a thread reads that connection's
+ * next message and hands it to the port as its own thread would, then
+ * goes back to waiting.  Connections that do not end up on a plain tcp
+ * socket (udp, shared memory, text mode, ...) are given a thread of
+ * their own as usual once their carrier is known.
+ *
+ * The reactor is off by default.  It is turned on for a process by
+ * setting the YARP_PORT_REACTOR environment variable to the number of
+ * threads to use, or by calling setThreadCount() before ports are
+ * opened.  It is only available on Linux (epoll); elsewhere every
+ * connection keeps its own thread.
+ *
+ * Reading a message still blocks the thread serving it, so the pool
+ * should be large enough to cover the ports whose readers are slow to
+ * accept data (for example a plain Port that is read from seldom).
+ */
+class YARP_OS_impl_API yarp::os::impl::PortCoreReactor
+{
+public:
+    /**
+     * @return the reactor, started on first use, or YARP_NULLPTR if
+     * connections should have threads of their own
+     */
+    static PortCoreReactor *get();
+
+    /**
+     * Choose how many threads serve input connections.  Takes effect
+     * for connections made after the call.  Once started, the reactor
+     * keeps its threads until fini(), but no new connection is given
+     * to it if the count is set to 0.
+     *
+     * @param threads number of threads, 0 for a thread per connection
+     */
+    static void setThreadCount(int threads);
+
+    /**
+     * @return the number of threads requested for serving input
+     * connections, 0 if the reactor is off
+     */
+    static int getThreadCount();
+
+    /**
+     * Stop the reactor threads.  All ports should be closed by now.
+     */
+    static void fini();
+
+    /**
+     * Start watching a connection.
+     *
+     * @param unit the connection, which is then served by the reactor
+     * until it finishes or is given a thread of its own
+     * @param handle the socket descriptor of the connection
+     * @return true if the connection is being watched
+     */
+    bool add(PortCoreInputUnit *unit, int handle);
+
+    /**
+     * Stop watching a connection, ahead of interrupting it.
+     * The socket must not be closed while it is watched.
+     */
+    void detach(PortCoreInputUnit *unit);
+
+    /**
+     * Forget a connection, waiting for any thread serving it to finish.
+     *
+     * @return true if the connection was idle and should be wrapped up
+     * by the caller, false if it was already wrapped up or given a
+     * thread of its own
+     */
+    bool remove(PortCoreInputUnit *unit);
+
+private:
+    class Worker;
+
+    struct Entry
+    {
+        PortCoreInputUnit *unit;
+        int handle;
+        bool registered;    // the socket is in the epoll set
+        bool busy;          // a worker is serving the connection
+        bool cancel;        // do not watch the connection again
+        SemaphoreImpl *waiter;
+    };
+
+    PortCoreReactor();
+    ~PortCoreReactor();
+
+    bool open(int threads);
+    void close();
+    void work();
+    void release(unsigned long key, bool keep);
+    bool watch(Entry& entry, unsigned long key, bool first);
+    void unwatch(Entry& entry);
+
+    int pollHandle;
+    int stopHandle;
+    unsigned long nextKey;
+    std::map<unsigned long, Entry> entries;
+    std::map<PortCoreInputUnit*, unsigned long> keys;
+    yarp::os::Mutex mutex;
+    PlatformVector<Worker *> workers;
+
+    friend class Worker;
+};
+
+#endif // YARP_OS_IMPL_PORTCOREREACTOR_H
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_OS_IMPL_PORTCORESHAREDCONTENT_H
+#define YARP_OS_IMPL_PORTCORESHAREDCONTENT_H
+
+#include <yarp/os/PortWriter.h>
+#include <yarp/os/impl/BufferedConnectionWriter.h>
+
+namespace yarp {
+    namespace os {
+        namespace impl {
+            class PortCoreSharedContent;
+        }
+    }
+}
+
+/**
+ * A message serialized once on behalf of several output connections.
+ *
+ * The original PortWriter is run a single time into an internal
+ * BufferedConnectionWriter.  This object can then be handed to each
+ * output connection in place of the original writer: writing it simply
+ * appends references to the already serialized blocks, so no
+ * serialization work or copying is repeated per connection.
+ *
+ * Only connections that send the standard binary representation of a
+ * message unchanged (no text/bare mode, no carrier modifying outgoing
+ * data, no local shortcut) may use it; see
+ * PortCoreUnit::canShareContent().
+ *
+ * The buffers are kept when the object is reset, so a port sending
+ * messages of similar structure does not allocate in steady state.
+ */
+class yarp::os::impl::PortCoreSharedContent : public yarp::os::PortWriter
+{
+public:
+    /**
+     * Constructor.
+     */
+    PortCoreSharedContent() :
+            valid(false)
+    {
+    }
+
+    /**
+     * Serialize a message, replacing anything previously stored.
+     *
+     * @param writer the message to serialize
+     * @return true if the message was serialized and can be shared
+     */
+    bool serialize(yarp::os::PortWriter& writer)
+    {
+        buffer.restart();
+        valid = writer.write(buffer);
+        if (buffer.dropRequested() || buffer.getReference() != YARP_NULLPTR) {
+            // The writer expects something per-connection from us, don't
+            // pretend we can stand in for it.
+            buffer.reset(false);
+            valid = false;
+        }
+        if (valid) {
+            buffer.stopWrite();
+        }
+        return valid;
+    }
+
+    /**
+     * @return true if a message is currently stored.
+     */
+    bool isValid() const
+    {
+        return valid;
+    }
+
+    /**
+     * Forget the stored message, keeping buffers for reuse.
+     */
+    void reset()
+    {
+        buffer.restart();
+        valid = false;
+    }
+
+    /**
+     * @return the size of the stored message, in bytes.
+     */
+    size_t dataSize()
+    {
+        return buffer.dataSize();
+    }
+
+    // documented in PortWriter
+    virtual bool write(yarp::os::ConnectionWriter& connection) override
+    {
+        if (!valid) {
+            return false;
+        }
+        for (size_t i=0; i<buffer.length(); i++) {
+            connection.appendExternalBlock(buffer.data(i), buffer.length(i));
+        }
+        return !connection.isError();
+    }
+
+private:
+    BufferedConnectionWriter buffer; ///< the serialized message
+    bool valid;                      ///< is there a message in the buffer
+};
+
+#endif // YARP_OS_IMPL_PORTCORESHAREDCONTENT_H
@@ -161,6 +161,17 @@ public:
         return false;
     }
 
+    /**
+     * @return true if the connection sends the standard binary
+     * serialization of a message, unmodified.  Such connections can be
+     * handed a message serialized once on behalf of several connections
+     * (see PortCoreSharedContent) instead of the original writer.
+     */
+    virtual bool canShareContent()
+    {
+        return false;
+    }
+
     /**
      * Interrupt the connection.
      *
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_OS_IMPL_RATETHREADEXECUTOR_H
+#define YARP_OS_IMPL_RATETHREADEXECUTOR_H
+
+#include <yarp/os/api.h>
+#include <yarp/os/ConstString.h>
+#include <yarp/os/impl/PlatformVector.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace yarp {
+    namespace os {
+        namespace impl {
+            class RateThreadExecutor;
+        }
+    }
+}
+
+/**
+ * Runs the RateThreads of a process on a small pool of threads,
+ * instead of one thread each.
+ *
+ * Each periodic task is kept in a queue ordered by the time of its next
+ * iteration.  A worker sleeps until the earliest of these deadlines,
+ * runs that iteration, and schedules the next one a period after the
+ * deadline it just served, so that tasks do not drift however late the
+ * worker woke up.  A task whose iteration overran its period is
+ * rescheduled for immediate execution, skipping the iterations it missed.
+ *
+ * The executor is off by default.  It is turned on for a process by
+ * setting the YARP_RATETHREAD_POOL environment variable to the number of
+ * worker threads, or by calling setThreadCount() before the RateThreads
+ * are started.  The workers can be given a real-time priority
+ * (YARP_RATETHREAD_POOL_PRIORITY, or setScheduling()) and, on Linux, be
+ * pinned to a set of cpus (YARP_RATETHREAD_POOL_CPUS, or setAffinity()).
+ *
+ * A pooled task blocks the worker running it, so the pool should have
+ * at least as many workers as the tasks that may be busy at once.
+ */
+class YARP_OS_impl_API yarp::os::impl::RateThreadExecutor
+{
+public:
+    /**
+     * A periodic task, as seen by the executor.
+     */
+    class Task
+    {
+    public:
+        virtual ~Task();
+
+        /**
+         * Run the next iteration of the task, on a worker thread.
+         * @return false if the task is over and should be forgotten
+         */
+        virtual bool runTask() = 0;
+
+        /**
+         * @return the period of the task, in seconds
+         */
+        virtual double getTaskPeriod() = 0;
+    };
+
+    /**
+     * @return the executor, started on first use, or YARP_NULLPTR if
+     * RateThreads should have threads of their own
+     */
+    static RateThreadExecutor *get();
+
+    /**
+     * Choose how many threads run RateThreads.  Takes effect for
+     * threads started after the call; once started, the executor keeps
+     * its workers until fini().
+     *
+     * @param threads number of workers, 0 for a thread per RateThread
+     */
+    static void setThreadCount(int threads);
+
+    /**
+     * @return the number of workers requested, 0 if the executor is off
+     */
+    static int getThreadCount();
+
+    /**
+     * Set the priority and scheduling policy of the workers, with the
+     * same meaning as in RateThread::setPriority().  Takes effect when
+     * the executor is started.
+     */
+    static void setScheduling(int priority, int policy);
+
+    /**
+     * Pin the workers to some cpus (Linux only).  Takes effect when the
+     * executor is started.
+     *
+     * @param cpus comma-separated list of cpu indexes, e.g. "2,3"
+     */
+    static void setAffinity(const yarp::os::ConstString& cpus);
+
+    /**
+     * Stop the workers.  All RateThreads should be stopped by now.
+     */
+    static void fini();
+
+    /**
+     * @return true if called from one of the workers, e.g. by a
+     * RateThread starting or stopping another one from its run()
+     */
+    static bool isWorker();
+
+    /**
+     * Start running a task.  Its first iteration runs as soon as a
+     * worker is free.
+     */
+    void add(Task *task);
+
+    /**
+     * Run the next iteration of a task as soon as possible, instead of
+     * waiting for its deadline (e.g. when it is asked to stop).
+     */
+    void expedite(Task *task);
+
+    /**
+     * Forget a task waiting for its next iteration.
+     *
+     * @return false if the task is not waiting, because it is running
+     * on a worker right now or it is over
+     */
+    bool remove(Task *task);
+
+private:
+    class Worker;
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry
+    {
+        Clock::time_point deadline;
+        Task *task;
+    };
+
+    struct Later
+    {
+        bool operator()(const Entry& a, const Entry& b) const
+        {
+            return a.deadline > b.deadline;
+        }
+    };
+
+    RateThreadExecutor();
+    ~RateThreadExecutor();
+
+    bool open(int threads, int priority, int policy);
+    void close();
+    void work();
+    void schedule(const Entry& entry);
+
+    std::vector<Entry> queue;   // heap, earliest deadline first
+    std::mutex mutex;
+    std::condition_variable timer;  // wakes the worker waiting on the deadline
+    std::condition_variable idle;   // wakes the other workers
+    bool timing;
+    bool stopping;
+    PlatformVector<Worker *> workers;
+
+    friend class Worker;
+};
+
+#endif // YARP_OS_IMPL_RATETHREADEXECUTOR_H
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_OS_IMPL_SHMRING_H
+#define YARP_OS_IMPL_SHMRING_H
+
+#include <yarp/os/api.h>
+#include <yarp/os/ConstString.h>
+#include <yarp/conf/numeric.h>
+
+#include <cstddef>
+
+namespace yarp {
+    namespace os {
+        namespace impl {
+            class ShmRing;
+        }
+    }
+}
+
+/**
+ * Default number of slots in a ShmRing.
+ */
+#define SHM_RING_DEFAULT_SLOTS 4
+
+/**
+ * Default size of each ShmRing slot, in bytes.  Chosen so that a typical
+ * camera frame (640x480 RGB, or a compressed HD frame) fits in one slot.
+ */
+#define SHM_RING_DEFAULT_SLOT_SIZE (2*1024*1024)
+
+/**
+ * Maximum number of slots in a ShmRing.
+ */
+#define SHM_RING_MAX_SLOTS 256
+
+/**
+ * A single-producer/single-consumer byte ring in POSIX shared memory.
+ *
+ * The writer creates the segment with create() and passes getName() to
+ * the reader, who maps it with attach().  Bytes written are copied into
+ * fixed size slots; a slot is published to the reader when it is full or
+ * when flush() is called.  Head and tail counters are lock-free atomics,
+ * so in steady state neither side makes a system call unless it has to
+ * wait for the other, in which case it sleeps on a futex (Linux) or polls.
+ *
+ * Messages larger than a slot simply span several slots, so the slot size
+ * only affects how often the two sides synchronize, not what can be sent.
+ *
+ * Either side can close the ring, which wakes up a peer blocked on it.
+ * A peer process that dies without closing is detected too.
+ */
+class YARP_OS_impl_API yarp::os::impl::ShmRing
+{
+public:
+    /**
+     * Constructor.
+     */
+    ShmRing();
+
+    /**
+     * Destructor.  Unmaps the segment.
+     */
+    ~ShmRing();
+
+    /**
+     * Create a new segment and become its writer.
+     *
+     * @param slotCount number of slots (at most SHM_RING_MAX_SLOTS)
+     * @param slotSize size of each slot in bytes (rounded up to a page)
+     * @return true on success
+     */
+    bool create(size_t slotCount, size_t slotSize);
+
+    /**
+     * Map an existing segment and become its reader.
+     *
+     * @param name the name reported by getName() on the writer side
+     * @return true on success
+     */
+    bool attach(const ConstString& name);
+
+    /**
+     * Remove the segment name from the system.  Mappings stay valid;
+     * call this as soon as the reader has attached.
+     */
+    void unlink();
+
+    /**
+     * Mark the ring as closed and wake up the peer.  The memory stays
+     * mapped until destruction, so a thread still blocked in read() or
+     * write() returns safely.
+     */
+    void close();
+
+    /**
+     * @return true if the ring is mapped and neither side closed it.
+     */
+    bool isOk() const;
+
+    /**
+     * @return the name of the segment.
+     */
+    const ConstString& getName() const;
+
+    /**
+     * @return the number of slots in the ring.
+     */
+    size_t getSlotCount() const;
+
+    /**
+     * @return the size of a slot, in bytes.
+     */
+    size_t getSlotSize() const;
+
+    /**
+     * Append bytes, publishing each slot as it fills up.  Blocks while
+     * the ring is full.  A timeout closes the ring, since the reader
+     * could not tell where the next message starts.
+     *
+     * @return false if the ring was closed
+     */
+    bool write(const char *data, size_t len);
+
+    /**
+     * Publish the partially filled slot, if any.
+     *
+     * @return false if the ring was closed
+     */
+    bool flush();
+
+    /**
+     * Read at most len bytes.  Blocks until at least one byte is
+     * available.
+     *
+     * @return the number of bytes read, or -1 on close or timeout
+     */
+    YARP_SSIZE_T read(char *data, size_t len);
+
+    /**
+     * Set a timeout for read() and for waiting on a full ring.
+     *
+     * @param timeout timeout in seconds, 0 or less to wait forever
+     */
+    void setTimeout(double timeout);
+
+private:
+    struct Header;
+
+    bool map(int fd, size_t size);
+    bool waitForSpace();
+    bool waitForData();
+    void publish();
+    bool peerAlive() const;
+    char *slot(unsigned int index) const;
+
+    Header *header;        ///< start of the mapping
+    size_t mappedSize;     ///< size of the mapping
+    ConstString name;      ///< name of the segment
+    bool writer;           ///< are we the writer side
+    bool linked;           ///< does the name still exist
+    uint32_t slotCount;    ///< number of slots, as checked when mapped
+    size_t slotSize;       ///< size of a slot, as checked when mapped
+    unsigned int cursor;   ///< slot being filled / drained
+    size_t offset;         ///< bytes filled / drained in that slot
+    double timeout;        ///< wait timeout, in seconds
+};
+
+#endif // YARP_OS_IMPL_SHMRING_H
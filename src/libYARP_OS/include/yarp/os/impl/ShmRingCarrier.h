@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_OS_IMPL_SHMRINGCARRIER_H
+#define YARP_OS_IMPL_SHMRINGCARRIER_H
+
+#include <yarp/os/AbstractCarrier.h>
+
+namespace yarp {
+    namespace os {
+        namespace impl {
+            class ShmRingCarrier;
+        }
+    }
+}
+
+/**
+ * Communicating between two ports on the same machine via a POSIX
+ * shared memory ring (see ShmRing).
+ *
+ * The connection is set up over tcp.  The sender then creates a shared
+ * memory segment and sends its name; once the receiver has mapped it,
+ * all data from sender to receiver goes through the ring, while
+ * acknowledgements and replies still use the tcp socket.
+ *
+ * The ring can be sized with carrier modifiers, e.g.
+ * "shm+slots.8+size.4194304" for 8 slots of 4MB each.  A message larger
+ * than a slot is split over several slots, but frames that fit in one
+ * slot are handed over with a single synchronization.
+ *
+ * This is a transport through a shared memory ring buffer, not a zero-copy
+ * one: the payload is copied once into the ring by the sender and once
+ * out of it by the receiver, into the message read (e.g. an Image).
+ */
+class yarp::os::impl::ShmRingCarrier : public AbstractCarrier
+{
+public:
+    virtual Carrier *create() override;
+
+    virtual ConstString getName() override;
+
+    // not in AbstractCarrier, so nothing to override
+    int getSpecifierCode();
+
+    virtual bool checkHeader(const yarp::os::Bytes& header) override;
+    virtual void getHeader(const yarp::os::Bytes& header) override;
+    virtual void setParameters(const yarp::os::Bytes& header) override;
+    virtual bool requireAck() override;
+    virtual bool isConnectionless() override;
+    virtual bool respondToHeader(yarp::os::ConnectionState& proto) override;
+    virtual bool expectReplyToHeader(yarp::os::ConnectionState& proto) override;
+};
+
+#endif // YARP_OS_IMPL_SHMRINGCARRIER_H
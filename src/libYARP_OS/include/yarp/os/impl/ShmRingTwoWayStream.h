@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_OS_IMPL_SHMRINGTWOWAYSTREAM_H
+#define YARP_OS_IMPL_SHMRINGTWOWAYSTREAM_H
+
+#include <yarp/os/InputStream.h>
+#include <yarp/os/OutputStream.h>
+#include <yarp/os/TwoWayStream.h>
+#include <yarp/os/impl/ShmRing.h>
+
+namespace yarp {
+    namespace os {
+        namespace impl {
+            class ShmRingTwoWayStream;
+        }
+    }
+}
+
+/**
+ * A stream that carries data from sender to receiver through a ShmRing,
+ * while replies and acknowledgements keep going the other way over the
+ * stream the connection was set up on.
+ *
+ * The stream takes ownership of both the ring and the original stream.
+ */
+class yarp::os::impl::ShmRingTwoWayStream : public TwoWayStream,
+                                            public InputStream,
+                                            public OutputStream
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param delegate the stream the connection was set up on
+     * @param ring a ring created (sender) or attached (receiver)
+     * @param sender true on the side writing to the ring
+     */
+    ShmRingTwoWayStream(TwoWayStream *delegate, ShmRing *ring, bool sender) :
+            delegate(delegate),
+            ring(ring),
+            sender(sender)
+    {
+    }
+
+    virtual ~ShmRingTwoWayStream()
+    {
+        close();
+        delete ring;
+        delete delegate;
+    }
+
+    virtual InputStream& getInputStream() override
+    {
+        return *this;
+    }
+
+    virtual OutputStream& getOutputStream() override
+    {
+        return *this;
+    }
+
+    virtual const Contact& getLocalAddress() override
+    {
+        return delegate->getLocalAddress();
+    }
+
+    virtual const Contact& getRemoteAddress() override
+    {
+        return delegate->getRemoteAddress();
+    }
+
+    virtual bool isOk() override
+    {
+        return ring->isOk() && delegate->isOk();
+    }
+
+    virtual void reset() override
+    {
+        delegate->reset();
+    }
+
+    virtual void close() override
+    {
+        ring->close();
+        delegate->close();
+    }
+
+    virtual void interrupt() override
+    {
+        ring->close();
+        delegate->getInputStream().interrupt();
+    }
+
+    virtual void beginPacket() override
+    {
+        delegate->beginPacket();
+    }
+
+    virtual void endPacket() override
+    {
+        if (sender) {
+            ring->flush();
+        }
+        delegate->endPacket();
+    }
+
+    using yarp::os::InputStream::read;
+    virtual YARP_SSIZE_T read(const Bytes& b) override
+    {
+        if (sender) {
+            return delegate->getInputStream().read(b);
+        }
+        return ring->read(b.get(), b.length());
+    }
+
+    virtual bool setReadTimeout(double timeout) override
+    {
+        if (sender) {
+            return delegate->getInputStream().setReadTimeout(timeout);
+        }
+        ring->setTimeout(timeout);
+        return true;
+    }
+
+    using yarp::os::OutputStream::write;
+    virtual void write(const Bytes& b) override
+    {
+        if (!sender) {
+            delegate->getOutputStream().write(b);
+            return;
+        }
+        ring->write(b.get(), b.length());
+    }
+
+    virtual void writeBlocks(const Bytes *blocks, size_t count) override
+    {
+        if (!sender) {
+            delegate->getOutputStream().writeBlocks(blocks, count);
+            return;
+        }
+        for (size_t i=0; i<count; i++) {
+            if (!ring->write(blocks[i].get(), blocks[i].length())) {
+                return;
+            }
+        }
+    }
+
+    virtual void flush() override
+    {
+        if (sender) {
+            ring->flush();
+        } else {
+            delegate->getOutputStream().flush();
+        }
+    }
+
+    virtual bool setWriteTimeout(double timeout) override
+    {
+        if (!sender) {
+            return delegate->getOutputStream().setWriteTimeout(timeout);
+        }
+        ring->setTimeout(timeout);
+        return true;
+    }
+
+private:
+    TwoWayStream *delegate; ///< stream the connection was set up on
+    ShmRing *ring;          ///< shared memory carrying data to the receiver
+    bool sender;            ///< are we writing to the ring
+};
+
+#endif // YARP_OS_IMPL_SHMRINGTWOWAYSTREAM_H
@@ -9,6 +9,7 @@
 
 #include <yarp/conf/system.h>
 #include <yarp/os/TwoWayStream.h>
+#include <yarp/os/ManagedBytes.h>
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/PlatformTime.h>
 
@@ -34,8 +35,25 @@ namespace yarp {
     }
 }
 
+/**
+ * Writes smaller than this made while a packet is in progress are held
+ * back and sent together with what follows.
+ */
+#define SOCKET_TWO_WAY_STREAM_COALESCE_SIZE (1024)
+
+/**
+ * Capacity of the buffer holding back small writes.
+ */
+#define SOCKET_TWO_WAY_STREAM_PENDING_SIZE (8192)
+
 /**
  * A stream abstraction for socket communication.  It supports TCP.
+ *
+ * Between beginPacket() and endPacket(), small writes (such as message
+ * indexes and headers) are held back and sent along with the next large
+ * block, or when the packet ends, using a single gather write.  Lists of
+ * blocks passed to writeBlocks() are sent the same way, so a whole
+ * message usually costs one system call.
  */
 class yarp::os::impl::SocketTwoWayStream : public TwoWayStream,
                                            public InputStream,
@@ -45,7 +63,9 @@ public:
     SocketTwoWayStream() :
             haveWriteTimeout(false),
             haveReadTimeout(false),
-            happy(false)
+            happy(false),
+            inPacket(false),
+            pendingLength(0)
     {
     }
 
@@ -96,12 +116,16 @@ public:
     {
         stream.close();
         happy = false;
+        inPacket = false;
+        pendingLength = 0;
     }
 
     using yarp::os::InputStream::read;
     virtual YARP_SSIZE_T read(const Bytes& b) override
     {
         if (!isOk()) { return -1; }
+        // Never wait for a peer that may be waiting for us.
+        flushPending();
         YARP_SSIZE_T result;
         if (haveReadTimeout) {
             result = stream.recv_n(b.get(), b.length(), &readTimeout);
@@ -119,6 +143,7 @@ public:
     virtual YARP_SSIZE_T partialRead(const Bytes& b) override
     {
         if (!isOk()) { return -1; }
+        flushPending();
         YARP_SSIZE_T result;
         if (haveReadTimeout) {
             result = stream.recv(b.get(), b.length(), &readTimeout);
@@ -137,6 +162,15 @@ public:
     virtual void write(const Bytes& b) override
     {
         if (!isOk()) { return; }
+        if (inPacket && b.length()<SOCKET_TWO_WAY_STREAM_COALESCE_SIZE &&
+            pendingLength+b.length()<=SOCKET_TWO_WAY_STREAM_PENDING_SIZE) {
+            hold(b);
+            return;
+        }
+        if (pendingLength>0) {
+            writeBlocks(&b, 1);
+            return;
+        }
         YARP_SSIZE_T result;
         if (haveWriteTimeout) {
             result = stream.send_n(b.get(), b.length(), &writeTimeout);
@@ -149,9 +183,11 @@ public:
         }
     }
 
+    virtual void writeBlocks(const Bytes *blocks, size_t count) override;
+
     virtual void flush() override
     {
-        //stream.flush();
+        flushPending();
     }
 
     virtual bool isOk() override
@@ -165,10 +201,13 @@ public:
 
     virtual void beginPacket() override
     {
+        inPacket = true;
     }
 
     virtual void endPacket() override
     {
+        inPacket = false;
+        flushPending();
     }
 
     virtual bool setWriteTimeout(double timeout) override
@@ -196,6 +235,26 @@ public:
     virtual bool setTypeOfService(int tos) override;
     virtual int getTypeOfService() override;
 
+    /**
+     * Send messages of at least `threshold` bytes without copying them
+     * into the kernel, where supported (Linux MSG_ZEROCOPY, builds
+     * without ACE).  Worthwhile only for large payloads such as images.
+     * This is enabled at connection time for all sockets of a process by
+     * setting the YARP_TCP_ZEROCOPY environment variable to a threshold.
+     * @param threshold minimum message size in bytes, 0 to disable
+     * @return true if the request could be honored
+     */
+    bool setZeroCopyThreshold(size_t threshold);
+
+    /**
+     * @return the socket descriptor, so that it can be waited on
+     * together with other sockets; -1 if the stream is closed
+     */
+    int getHandle()
+    {
+        return happy ? (int)stream.get_handle() : -1;
+    }
+
 private:
     ACE_SOCK_Stream stream;
     bool haveWriteTimeout;
@@ -204,7 +263,26 @@ private:
     ACE_Time_Value readTimeout;
     Contact localAddress, remoteAddress;
     bool happy;
+    bool inPacket;              ///< are we between beginPacket and endPacket
+    ManagedBytes pending;       ///< small writes held back
+    size_t pendingLength;       ///< bytes of pending in use
     void updateAddresses();
+    void configureZeroCopy();
+
+    /**
+     * Copy a small block to the pending buffer.
+     */
+    void hold(const Bytes& b);
+
+    /**
+     * Send any small writes held back.
+     */
+    void flushPending()
+    {
+        if (pendingLength>0) {
+            writeBlocks(YARP_NULLPTR, 0);
+        }
+    }
 };
 
 #endif // YARP_OS_IMPL_SOCKETTWOWAYSTREAM_H
@@ -28,6 +28,7 @@
 // General files
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -96,6 +97,28 @@ public:
         return ::send(sd, buf, n, 0);
     }
 
+    /**
+     * Send a list of blocks with as few system calls as possible
+     * (usually one), retrying on partial writes.
+     * @return the number of bytes sent, or -1 on failure
+     */
+    ssize_t sendv_n (const iovec iov[], int n);
+
+    ssize_t sendv_n (const iovec iov[], int n, struct timeval *tv)
+    {
+        setsockopt(sd, SOL_SOCKET, SO_SNDTIMEO, (char *)tv, sizeof (*tv));
+        return sendv_n(iov, n);
+    }
+
+    /**
+     * Ask for messages of at least `threshold` bytes sent by sendv_n() to
+     * avoid being copied into the kernel (MSG_ZEROCOPY, Linux only).
+     * Memory is still guaranteed not to be in use once sendv_n() returns.
+     * @param threshold minimum message size, 0 to disable
+     * @return true if zero-copy sending is available
+     */
+    bool set_zerocopy_threshold(size_t threshold);
+
     // No idea what this should do...
     void flush() { }
 
@@ -147,6 +170,15 @@ public:
 private:
     // stream descriptor
     int sd;
+
+    // minimum message size for zero-copy sends, 0 if disabled
+    size_t zerocopyThreshold;
+
+    // number of zero-copy sends issued so far
+    unsigned int zerocopySent;
+
+    // wait for the kernel to release memory of zero-copy sends
+    bool wait_zerocopy();
 };
 
 #endif // YARP_OS_IMPL_TCPSTREAM_H
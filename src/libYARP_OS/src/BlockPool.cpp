@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/os/impl/BlockPool.h>
+#include <yarp/os/LockGuard.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/Property.h>
+
+#include <cstdio>
+
+using namespace yarp::os::impl;
+using namespace yarp::os;
+
+namespace {
+// Headers and small Bottles land in the first classes, the pool buffers
+// grown by BufferedConnectionWriter (1k doubling up to 64k) in the others.
+const size_t block_pool_class_size[BLOCK_POOL_CLASSES] = {
+    64, 256, 1024, 4096, 16384, 65536
+};
+}
+
+BlockPool::BlockPool(size_t maxFreeBlocks) :
+        maxFreeBlocks(maxFreeBlocks),
+        unpooled(0) {
+    for (int i=0; i<=BLOCK_POOL_CLASSES; i++) {
+        hits[i] = 0;
+        misses[i] = 0;
+    }
+}
+
+BlockPool::~BlockPool() {
+    clear();
+}
+
+size_t BlockPool::classSize(size_t len) {
+    for (int i=0; i<BLOCK_POOL_CLASSES; i++) {
+        if (len<=block_pool_class_size[i]) {
+            return block_pool_class_size[i];
+        }
+    }
+    return 0;
+}
+
+int BlockPool::classIndex(size_t len) const {
+    for (int i=0; i<BLOCK_POOL_CLASSES; i++) {
+        if (len<=block_pool_class_size[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+ManagedBytes *BlockPool::get(size_t len) {
+    int idx = classIndex(len);
+    if (idx<0) {
+        {
+            LockGuard guard(mutex);
+            unpooled++;
+        }
+        ManagedBytes *block = new ManagedBytes(len);
+        block->setUsed(len);
+        return block;
+    }
+    ManagedBytes *block = YARP_NULLPTR;
+    {
+        LockGuard guard(mutex);
+        PlatformVector<ManagedBytes *>& lst = owned[idx];
+        if (lst.size()>0) {
+            block = lst[lst.size()-1];
+            lst.pop_back();
+            hits[idx]++;
+        } else {
+            misses[idx]++;
+        }
+    }
+    if (block == YARP_NULLPTR) {
+        block = new ManagedBytes(block_pool_class_size[idx]);
+    }
+    block->setUsed(len);
+    return block;
+}
+
+ManagedBytes *BlockPool::getReference(const Bytes& data) {
+    ManagedBytes *block = YARP_NULLPTR;
+    {
+        LockGuard guard(mutex);
+        if (references.size()>0) {
+            block = references[references.size()-1];
+            references.pop_back();
+            hits[BLOCK_POOL_CLASSES]++;
+        } else {
+            misses[BLOCK_POOL_CLASSES]++;
+        }
+    }
+    if (block == YARP_NULLPTR) {
+        return new ManagedBytes(data, false);
+    }
+    *block = ManagedBytes(data, false);
+    return block;
+}
+
+void BlockPool::release(ManagedBytes *block) {
+    if (block == YARP_NULLPTR) {
+        return;
+    }
+    PlatformVector<ManagedBytes *> *lst = YARP_NULLPTR;
+    if (!block->isOwner()) {
+        block->clear();
+        lst = &references;
+    } else {
+        int idx = classIndex(block->length());
+        if (idx>=0 && block_pool_class_size[idx]==block->length()) {
+            block->resetUsed();
+            lst = &owned[idx];
+        }
+    }
+    if (lst != YARP_NULLPTR) {
+        LockGuard guard(mutex);
+        if (lst->size()<maxFreeBlocks) {
+            lst->push_back(block);
+            return;
+        }
+    }
+    delete block;
+}
+
+void BlockPool::clear() {
+    LockGuard guard(mutex);
+    for (int i=0; i<BLOCK_POOL_CLASSES; i++) {
+        for (size_t j=0; j<owned[i].size(); j++) {
+            delete owned[i][j];
+        }
+        owned[i].clear();
+    }
+    for (size_t j=0; j<references.size(); j++) {
+        delete references[j];
+    }
+    references.clear();
+}
+
+size_t BlockPool::getHits() {
+    LockGuard guard(mutex);
+    size_t total = 0;
+    for (int i=0; i<=BLOCK_POOL_CLASSES; i++) {
+        total += hits[i];
+    }
+    return total;
+}
+
+size_t BlockPool::getMisses() {
+    LockGuard guard(mutex);
+    size_t total = unpooled;
+    for (int i=0; i<=BLOCK_POOL_CLASSES; i++) {
+        total += misses[i];
+    }
+    return total;
+}
+
+size_t BlockPool::getCachedBytes() {
+    LockGuard guard(mutex);
+    size_t total = 0;
+    for (int i=0; i<BLOCK_POOL_CLASSES; i++) {
+        total += owned[i].size()*block_pool_class_size[i];
+    }
+    return total;
+}
+
+void BlockPool::resetCounters() {
+    LockGuard guard(mutex);
+    for (int i=0; i<=BLOCK_POOL_CLASSES; i++) {
+        hits[i] = 0;
+        misses[i] = 0;
+    }
+    unpooled = 0;
+}
+
+void BlockPool::getStats(Property& prop) {
+    prop.put("hits", (int)getHits());
+    prop.put("misses", (int)getMisses());
+    prop.put("cached_bytes", (int)getCachedBytes());
+    LockGuard guard(mutex);
+    int blocks = (int)references.size();
+    for (int i=0; i<BLOCK_POOL_CLASSES; i++) {
+        char name[64];
+        sprintf(name, "class_%d", (int)block_pool_class_size[i]);
+        Bottle b;
+        b.addInt((int)hits[i]);
+        b.addInt((int)misses[i]);
+        b.addInt((int)owned[i].size());
+        prop.put(name, Value::makeList(b.toString().c_str()));
+        blocks += (int)owned[i].size();
+    }
+    Bottle b;
+    b.addInt((int)hits[BLOCK_POOL_CLASSES]);
+    b.addInt((int)misses[BLOCK_POOL_CLASSES]);
+    b.addInt((int)references.size());
+    prop.put("class_reference", Value::makeList(b.toString().c_str()));
+    prop.put("unpooled", (int)unpooled);
+    prop.put("cached_blocks", blocks);
+}
@@ -10,6 +10,8 @@
 
 #include <yarp/os/ConstString.h>
 #include <yarp/os/NetFloat64.h>
+#include <yarp/os/NetInt32.h>
+#include <yarp/os/NetInt64.h>
 #include <yarp/os/StringInputStream.h>
 #include <yarp/os/StringOutputStream.h>
 #include <yarp/os/Vocab.h>
@@ -23,6 +25,7 @@
 #include <cstring>
 #include <cstdlib>
 #include <cfloat>
+#include <new>
 
 using yarp::os::impl::StoreInt;
 using yarp::os::impl::StoreVocab;
@@ -41,6 +44,9 @@ using yarp::os::Bottle;
 using yarp::os::ConstString;
 using yarp::os::Searchable;
 using yarp::os::Value;
+using yarp::os::NetInt32;
+using yarp::os::NetInt64;
+using yarp::os::NetFloat64;
 
 #define YARP_STRINIT(len) ((size_t)(len)), 0
 
@@ -91,20 +97,197 @@ const int StoreInt64::code = BOTTLE_TAG_INT64;
 #define GROUP_MASK (BOTTLE_TAG_LIST | BOTTLE_TAG_DICT)
 
 
+// Size of the blocks storables are created in, and how many of them a
+// bottle keeps around for reuse once it is cleared.
+#define BOTTLE_ARENA_BLOCK_SIZE 4096
+#define BOTTLE_ARENA_KEEP_BLOCKS 4
+
+static int rawInt(const char* at)
+{
+    NetInt32 x;
+    memcpy(&x, at, sizeof(x));
+    return x;
+}
+
+static void putInt(char*& at, int x)
+{
+    NetInt32 nx = x;
+    memcpy(at, &nx, sizeof(nx));
+    at += sizeof(nx);
+}
+
+// Size of a raw element of the given type, if fixed.
+static size_t fixedSize(int code)
+{
+    switch (code) {
+    case BOTTLE_TAG_INT:
+    case BOTTLE_TAG_VOCAB:
+        return sizeof(NetInt32);
+    case BOTTLE_TAG_INT64:
+        return sizeof(NetInt64);
+    case BOTTLE_TAG_DOUBLE:
+        return sizeof(NetFloat64);
+    }
+    return 0;
+}
+
+
+/**
+ * Source of raw bytes when filling a bottle, either a connection or a
+ * buffer.  Bytes taken from a connection are appended to the flat buffer
+ * of the bottle; a buffer is expected to already be that flat buffer.
+ */
+class BottleImpl::Source
+{
+public:
+    Source(ConnectionReader& reader, PlatformVector<char>& flat) :
+            reader(&reader),
+            flat(&flat),
+            base(YARP_NULLPTR),
+            length(0),
+            at(0)
+    {
+    }
+
+    Source(const char* base, size_t length) :
+            reader(YARP_NULLPTR),
+            flat(YARP_NULLPTR),
+            base(base),
+            length(length),
+            at(0)
+    {
+    }
+
+    /**
+     * @return the position of the next byte in the flat buffer.
+     */
+    size_t pos() const
+    {
+        return (reader != YARP_NULLPTR) ? flat->size() : at;
+    }
+
+    /**
+     * Consume len bytes.
+     *
+     * @return the bytes, or YARP_NULLPTR if they are not available.
+     */
+    const char* take(size_t len)
+    {
+        if (len == 0) {
+            return "";
+        }
+        if (reader != YARP_NULLPTR) {
+            size_t start = flat->size();
+            flat->resize(start + len, 0);
+            char* result = &((*flat)[start]);
+            reader->expectBlock(result, len);
+            return reader->isError() ? YARP_NULLPTR : result;
+        }
+        if (len > length - at) {
+            return YARP_NULLPTR;
+        }
+        const char* result = base + at;
+        at += len;
+        return result;
+    }
+
+    bool takeInt(int& x)
+    {
+        const char* raw = take(sizeof(NetInt32));
+        if (raw == YARP_NULLPTR) {
+            return false;
+        }
+        x = rawInt(raw);
+        return true;
+    }
+
+    /**
+     * Consume a raw element of the given type.
+     */
+    bool skip(int code)
+    {
+        size_t fixed = fixedSize(code);
+        if (fixed != 0) {
+            return take(fixed) != YARP_NULLPTR;
+        }
+        if (code == StoreString::code || code == StoreBlob::code) {
+            int len = 0;
+            if (!takeInt(len) || len < 0) {
+                return false;
+            }
+            return take(len) != YARP_NULLPTR;
+        }
+        if ((code & GROUP_MASK) == 0) {
+            return false;
+        }
+        if ((code & BOTTLE_TAG_DICT) != 0) {
+            // a dictionary is sent as a complete bottle
+            int top = 0;
+            if (!takeInt(top)) {
+                return false;
+            }
+            return skipList(top & UNIT_MASK);
+        }
+        return skipList(code & UNIT_MASK);
+    }
+
+    /**
+     * Consume the raw elements of a list.
+     */
+    bool skipList(int subCode)
+    {
+        int len = 0;
+        if (!takeInt(len) || len < 0) {
+            return false;
+        }
+        size_t fixed = fixedSize(subCode);
+        if (fixed != 0) {
+            return take(fixed*len) != YARP_NULLPTR;
+        }
+        for (int i = 0; i < len; i++) {
+            int code = subCode;
+            if (code == 0 && !takeInt(code)) {
+                return false;
+            }
+            if (!skip(code)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    ConnectionReader* reader;
+    PlatformVector<char>* flat;
+    const char* base;
+    size_t length;
+    size_t at;
+};
+
+
 yarp::os::impl::StoreNull* BottleImpl::storeNull = YARP_NULLPTR;
+bool BottleImpl::flatStorage = true;
 
-BottleImpl::BottleImpl() : parent(YARP_NULLPTR)
+BottleImpl::BottleImpl() :
+        parent(YARP_NULLPTR),
+        arenaBlock(0),
+        arenaUsed(0)
 {
     dirty = true;
+    wire = false;
     nested = false;
     speciality = 0;
     invalid = false;
     ro = false;
 }
 
-BottleImpl::BottleImpl(Searchable* parent) : parent(parent)
+BottleImpl::BottleImpl(Searchable* parent) :
+        parent(parent),
+        arenaBlock(0),
+        arenaUsed(0)
 {
     dirty = true;
+    wire = false;
     nested = false;
     speciality = 0;
     invalid = false;
@@ -115,23 +298,139 @@ BottleImpl::BottleImpl(Searchable* parent) : parent(parent)
 BottleImpl::~BottleImpl()
 {
     clear();
+    for (size_t i = 0; i < arena.size(); i++) {
+        delete[] arena[i];
+    }
+}
+
+
+void BottleImpl::setFlatStorage(bool flat)
+{
+    flatStorage = flat;
+}
+
+bool BottleImpl::getFlatStorage()
+{
+    return flatStorage;
 }
 
 
 void BottleImpl::add(Storable* s)
 {
-    content.push_back(s);
-    dirty = true;
+    content.push_back(Item(0, 0, 0, s));
+    changed();
+}
+
+
+void BottleImpl::addRaw(int code,
+                        const char* head,
+                        size_t headLength,
+                        const char* tail,
+                        size_t tailLength)
+{
+    size_t offset = flat.size();
+    flat.resize(offset + headLength + tailLength, 0);
+    memcpy(&flat[offset], head, headLength);
+    if (tailLength > 0) {
+        memcpy(&flat[offset + headLength], tail, tailLength);
+    }
+    content.push_back(Item(code, offset, headLength + tailLength, YARP_NULLPTR));
+    changed();
+}
+
+
+void BottleImpl::addInt(int x)
+{
+    if (!flatStorage) {
+        add(new StoreInt(x));
+        return;
+    }
+    NetInt32 nx = x;
+    addRaw(StoreInt::code, reinterpret_cast<char*>(&nx), sizeof(nx));
+}
+
+void BottleImpl::addInt64(const YARP_INT64& x)
+{
+    if (!flatStorage) {
+        add(new StoreInt64(x));
+        return;
+    }
+    NetInt64 nx = x;
+    addRaw(StoreInt64::code, reinterpret_cast<char*>(&nx), sizeof(nx));
+}
+
+void BottleImpl::addVocab(int x)
+{
+    if (!flatStorage) {
+        add(new StoreVocab(x));
+        return;
+    }
+    NetInt32 nx = x;
+    addRaw(StoreVocab::code, reinterpret_cast<char*>(&nx), sizeof(nx));
+}
+
+void BottleImpl::addDouble(double x)
+{
+    if (!flatStorage) {
+        add(new StoreDouble(x));
+        return;
+    }
+    NetFloat64 nx = x;
+    addRaw(StoreDouble::code, reinterpret_cast<char*>(&nx), sizeof(nx));
+}
+
+void BottleImpl::addString(const ConstString& text)
+{
+    if (!flatStorage) {
+        add(new StoreString(text));
+        return;
+    }
+    NetInt32 len = static_cast<int>(text.length());
+    addRaw(StoreString::code,
+           reinterpret_cast<char*>(&len), sizeof(len),
+           text.c_str(), text.length());
 }
 
 
 void BottleImpl::clear()
 {
-    for (unsigned int i = 0; i < content.size(); i++) {
-        delete content[i];
+    for (size_t i = 0; i < content.size(); i++) {
+        Storable* s = content[i].storable.load();
+        if (s != YARP_NULLPTR) {
+            if (content[i].pooled) {
+                s->~Storable();
+            } else {
+                delete s;
+            }
+        }
     }
     content.clear();
-    dirty = true;
+    flat.clear();
+    while (arena.size() > BOTTLE_ARENA_KEEP_BLOCKS) {
+        delete[] arena[arena.size() - 1];
+        arena.pop_back();
+    }
+    arenaBlock = 0;
+    arenaUsed = 0;
+    changed();
+}
+
+
+void* BottleImpl::arenaAlloc(size_t size) const
+{
+    size = (size + 15) & ~static_cast<size_t>(15);
+    if (arenaBlock >= arena.size() || arenaUsed + size > BOTTLE_ARENA_BLOCK_SIZE) {
+        if (arenaBlock < arena.size()) {
+            arenaBlock++;
+        }
+        arenaUsed = 0;
+        if (arenaBlock >= arena.size()) {
+            arena.push_back(new char[BOTTLE_ARENA_BLOCK_SIZE]);
+        }
+    }
+    void* result = arena[arenaBlock] + arenaUsed;
+    arenaUsed += size;
+    return result;
 }
 
 void BottleImpl::smartAdd(const ConstString& str)
@@ -233,7 +532,6 @@ void BottleImpl::smartAdd(const ConstString& str)
 void BottleImpl::fromString(const ConstString& line)
 {
     clear();
-    dirty = true;
     ConstString arg = "";
     bool quoted = false;
     bool back = false;
@@ -361,8 +659,7 @@ ConstString BottleImpl::toString()
         if (i > 0) {
             result += " ";
         }
-        Storable& s = *content[i];
-        result += s.toStringNested();
+        result += get(i).toStringNested();
     }
     return result;
 }
@@ -429,80 +726,149 @@ bool BottleImpl::fromBytes(ConnectionReader& reader)
     if (reader.isError()) {
         return false;
     }
+    Source source(reader, flat);
     int id = speciality;
     YMSG(("READING, nest flag is %d\n", nested));
     if (id == 0) {
-        id = reader.expectInt();
+        if (!source.takeInt(id)) {
+            return false;
+        }
         YMSG(("READ subcode %d\n", id));
     } else {
         YMSG(("READ skipped subcode %d\n", speciality));
     }
-    Storable* storable = Storable::createByCode(id);
-    if (storable == YARP_NULLPTR) {
+    size_t offset = source.pos();
+    if (!source.skip(id)) {
         YARP_SPRINTF1(Logger::get(), error,
                       "BottleImpl reader failed, unrecognized object code %d",
                       id);
         return false;
     }
-    storable->readRaw(reader);
-    add(storable);
+    content.push_back(Item(id, offset, source.pos() - offset, YARP_NULLPTR));
+    changed();
+    if (!flatStorage) {
+        get(static_cast<int>(content.size()) - 1);
+    }
     return true;
 }
 
 
-void BottleImpl::fromBinary(const char* text, int len)
-{
-    ConstString wrapper(text, len);
-    StringInputStream sis;
-    sis.add(wrapper);
-    StreamConnectionReader reader;
-    Route route;
-    reader.reset(sis, YARP_NULLPTR, route, len, false);
-    read(reader);
-}
-
-
-bool BottleImpl::fromBytes(const Bytes& data)
+bool BottleImpl::scan(Source& source)
 {
-    ConstString wrapper(data.get(), data.length());
-    StringInputStream sis;
-    sis.add(wrapper);
-    StreamConnectionReader reader;
-    Route route;
-    reader.reset(sis, YARP_NULLPTR, route, data.length(), false);
-
-    clear();
-    dirty = true; // for clarity
-
+    int top = 0;
     if (!nested) {
-        clear();
         specialize(0);
-
-        int code = reader.expectInt();
-        if (reader.isError()) {
+        if (!source.takeInt(top)) {
             return false;
         }
-        YMSG(("READ got top level code %d\n", code));
-        code = code & UNIT_MASK;
-        if (code != 0) {
-            specialize(code);
+        YMSG(("READ got top level code %d\n", top));
+        if ((top & UNIT_MASK) != 0) {
+            specialize(top & UNIT_MASK);
         }
     }
-    int len = reader.expectInt();
-    if (reader.isError()) {
+    int len = 0;
+    if (!source.takeInt(len) || len < 0) {
         return false;
     }
     YMSG(("READ bottle length %d\n", len));
-    for (int i = 0; i < len; i++) {
-        bool ok = fromBytes(reader);
-        if (!ok) {
+    size_t fixed = fixedSize(speciality);
+    if (fixed != 0) {
+        // homogeneous list of numbers, all in one go
+        size_t offset = source.pos();
+        if (source.take(fixed*len) == YARP_NULLPTR) {
             return false;
         }
+        for (int i = 0; i < len; i++) {
+            content.push_back(Item(speciality, offset + i*fixed, fixed, YARP_NULLPTR));
+        }
+    } else {
+        for (int i = 0; i < len; i++) {
+            int code = speciality;
+            if (code == 0 && !source.takeInt(code)) {
+                return false;
+            }
+            size_t offset = source.pos();
+            if (!source.skip(code)) {
+                YARP_SPRINTF1(Logger::get(), error,
+                              "BottleImpl reader failed, unrecognized object code %d",
+                              code);
+                return false;
+            }
+            content.push_back(Item(code, offset, source.pos() - offset, YARP_NULLPTR));
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        dirty = true;
+        // If what we got is exactly what we would send, keep it for sending.
+        wire = (nested || top == StoreList::code + speciality) &&
+               source.pos() == flat.size();
+    }
+    if (!flatStorage) {
+        materializeAll();
     }
-
     return true;
 }
 
+
+void BottleImpl::materializeAll()
+{
+    for (size_t i = 0; i < content.size(); i++) {
+        get(static_cast<int>(i));
+    }
+}
+
+
+bool BottleImpl::readBinary(ConnectionReader& reader, PlatformVector<char>& data)
+{
+    data.clear();
+    Source source(reader, data);
+    int top = 0;
+    if (!source.takeInt(top) || (top & BOTTLE_TAG_LIST) == 0) {
+        return false;
+    }
+    return source.skipList(top & UNIT_MASK);
+}
+
+
+size_t BottleImpl::elementSize(int code, const char* data, size_t length)
+{
+    Source source(data, length);
+    if (!source.skip(code)) {
+        return 0;
+    }
+    return source.pos();
+}
+
+
+size_t BottleImpl::listSize(int subCode, const char* data, size_t length)
+{
+    Source source(data, length);
+    if (!source.skipList(subCode)) {
+        return 0;
+    }
+    return source.pos();
+}
+
+
+void BottleImpl::fromBinary(const char* text, int len)
+{
+    fromBytes(Bytes(const_cast<char*>(text), len));
+}
+
+
+bool BottleImpl::fromBytes(const Bytes& data)
+{
+    clear();
+    if (data.length() == 0) {
+        return false;
+    }
+    flat.resize(data.length(), 0);
+    memcpy(&flat[0], data.get(), data.length());
+    Source source(&flat[0], flat.size());
+    return scan(source);
+}
+
 void BottleImpl::toBytes(const Bytes& data)
 {
     synch();
@@ -515,13 +881,15 @@ const char* BottleImpl::getBytes()
 {
     YMSG(("am I nested? %d\n", nested));
     synch();
-    return &data[0];
+    std::lock_guard<std::mutex> guard(mutex);
+    return wire ? &flat[0] : &data[0];
 }
 
 size_t BottleImpl::byteCount()
 {
     synch();
-    return data.size();
+    std::lock_guard<std::mutex> guard(mutex);
+    return wire ? flat.size() : data.size();
 }
 
 void BottleImpl::onCommencement()
@@ -607,41 +975,10 @@ bool BottleImpl::read(ConnectionReader& reader)
             ConstString name = buf.c_str();
         }
 #endif
-        if (!nested) {
-            // no byte length any more to facilitate nesting
-            // reader.expectInt(); // the bottle byte ct; ignored
-
-            clear();
-            specialize(0);
-
-            int code = reader.expectInt();
-            if (reader.isError()) {
-                return false;
-            }
-            YMSG(("READ got top level code %d\n", code));
-            code = code & UNIT_MASK;
-            if (code != 0) {
-                specialize(code);
-            }
-        }
-
-        result = true;
+        // no byte length any more to facilitate nesting
         clear();
-        dirty = true; // for clarity
-
-        int len = 0;
-        int i = 0;
-        len = reader.expectInt();
-        if (reader.isError()) {
-            return false;
-        }
-        YMSG(("READ got length %d\n", len));
-        for (i = 0; i < len; i++) {
-            bool ok = fromBytes(reader);
-            if (!ok) {
-                return false;
-            }
-        }
+        Source source(reader, flat);
+        result = scan(source);
     }
     return result;
 }
@@ -649,47 +986,133 @@ bool BottleImpl::read(ConnectionReader& reader)
 
 void BottleImpl::synch()
 {
-    if (dirty) {
-        if (!nested) {
-            subCode();
-            YMSG(("bottle code %d\n", StoreList::code + subCode()));
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (!dirty) {
+            return;
         }
-        data.clear();
-        BufferedConnectionWriter writer;
+    }
+    if (!nested) {
+        // may change the specialization, and the flags with it
+        subCode();
+        YMSG(("bottle code %d\n", StoreList::code + speciality));
+    }
+    std::lock_guard<std::mutex> guard(mutex);
+    if (wire && elementsUnchanged()) {
+        // the bytes we received are still valid, send them as they are
+        dirty = false;
+        return;
+    }
+    wire = false;
+    bool raw = true;
+    for (size_t i = 0; i < content.size() && raw; i++) {
+        raw = (content[i].storable.load() == YARP_NULLPTR);
+    }
+    data.clear();
+    if (raw) {
+        // every element is still in network representation
+        size_t total = (nested ? 0 : sizeof(NetInt32)) + sizeof(NetInt32);
+        for (size_t i = 0; i < content.size(); i++) {
+            total += content[i].length + ((speciality == 0) ? sizeof(NetInt32) : 0);
+        }
+        data.resize(total, 0);
+        char* at = &data[0];
         if (!nested) {
-            writer.appendInt(StoreList::code + speciality);
-            YMSG(("wrote bottle code %d\n", StoreList::code + speciality));
+            putInt(at, StoreList::code + speciality);
         }
-        YMSG(("bottle length %d\n", size()));
-        writer.appendInt(static_cast<int>(size()));
-        for (unsigned int i = 0; i < content.size(); i++) {
-            Storable* s = content[i];
+        putInt(at, static_cast<int>(size()));
+        for (size_t i = 0; i < content.size(); i++) {
+            const Item& item = content[i];
             if (speciality == 0) {
-                YMSG(("subcode %d\n", s->getCode()));
-                writer.appendInt(s->getCode());
+                putInt(at, item.code);
             } else {
-                YMSG(("skipped subcode %d\n", s->getCode()));
-                yAssert(speciality == s->getCode());
-            }
-            if (s->isList()) {
-                s->asList()->implementation->setNested(true);
+                yAssert(speciality == item.code);
             }
-            s->writeRaw(writer);
+            memcpy(at, &flat[item.offset], item.length);
+            at += item.length;
         }
-        data.resize(writer.dataSize(), ' ');
-        MemoryOutputStream m(&data[0]);
-        writer.write(m);
         dirty = false;
+        return;
+    }
+    BufferedConnectionWriter writer;
+    if (!nested) {
+        writer.appendInt(StoreList::code + speciality);
+        YMSG(("wrote bottle code %d\n", StoreList::code + speciality));
+    }
+    YMSG(("bottle length %d\n", size()));
+    writer.appendInt(static_cast<int>(size()));
+    for (size_t i = 0; i < content.size(); i++) {
+        const Item& item = content[i];
+        Storable* s = item.storable.load();
+        int code = (s != YARP_NULLPTR) ? s->getCode() : item.code;
+        if (speciality == 0) {
+            YMSG(("subcode %d\n", code));
+            writer.appendInt(code);
+        } else {
+            YMSG(("skipped subcode %d\n", code));
+            yAssert(speciality == code);
+        }
+        if (s == YARP_NULLPTR) {
+            writer.appendBlock(&flat[item.offset], item.length);
+            continue;
+        }
+        if (s->isList()) {
+            s->asList()->implementation->setNested(true);
+        }
+        s->writeRaw(writer);
     }
+    data.resize(writer.dataSize(), ' ');
+    MemoryOutputStream m(&data[0]);
+    writer.write(m);
+    dirty = false;
+}
+
+
+bool BottleImpl::elementsUnchanged() const
+{
+    // elements handed out by get() may have been modified in place
+    for (size_t i = 0; i < content.size(); i++) {
+        const Item& item = content[i];
+        Storable* s = item.storable.load();
+        if (s == YARP_NULLPTR) {
+            continue;
+        }
+        if (s->getCode() != item.code) {
+            return false;
+        }
+        if (s->isList()) {
+            s->asList()->implementation->setNested(true);
+        }
+        BufferedConnectionWriter writer;
+        s->writeRaw(writer);
+        ConstString raw = writer.toString();
+        if (raw.length() != item.length ||
+                memcmp(raw.c_str(), &flat[item.offset], item.length) != 0) {
+            return false;
+        }
+    }
+    return true;
 }
 
 
 void BottleImpl::specialize(int subCode)
 {
+    if (speciality != subCode) {
+        // the serialized form changes
+        changed();
+    }
     speciality = subCode;
 }
 
 
+void BottleImpl::changed()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    dirty = true;
+    wire = false;
+}
+
+
 int BottleImpl::getSpecialization()
 {
     return speciality;
@@ -697,6 +1120,9 @@ int BottleImpl::getSpecialization()
 
 void BottleImpl::setNested(bool nested)
 {
+    if (this->nested != nested) {
+        changed();
+    }
     this->nested = nested;
 }
 
@@ -1119,33 +1545,9 @@ bool StoreList::writeRaw(ConnectionWriter& writer)
     return true;
 }
 
-template <class T>
-int subCoder(T& content)
-{
-    int c = -1;
-    bool ok = false;
-    for (unsigned int i = 0; i < content.size(); ++i) {
-        int sc = content.get(i).getCode();
-        if (c == -1) {
-            c = sc;
-            ok = true;
-        }
-        if (sc != c) {
-            ok = false;
-        }
-    }
-    // just optimize primitive types
-    if ((c & GROUP_MASK) != 0) {
-        ok = false;
-    }
-    c = ok ? c : 0;
-    content.specialize(c);
-    return c;
-}
-
 int StoreList::subCode() const
 {
-    return subCoder(*(content.implementation));
+    return content.implementation->subCode();
 }
 
 
@@ -1196,15 +1598,40 @@ bool StoreDict::writeRaw(ConnectionWriter& writer)
 // BottleImpl
 
 
+int BottleImpl::codeAt(size_t index) const
+{
+    const Item& item = content[index];
+    Storable* s = item.storable.load(std::memory_order_acquire);
+    return (s != YARP_NULLPTR) ? s->getCode() : item.code;
+}
+
 int BottleImpl::subCode()
 {
-    return subCoder(*this);
+    int c = -1;
+    bool ok = false;
+    for (size_t i = 0; i < content.size(); ++i) {
+        int sc = codeAt(i);
+        if (c == -1) {
+            c = sc;
+            ok = true;
+        }
+        if (sc != c) {
+            ok = false;
+        }
+    }
+    // just optimize primitive types
+    if ((c & GROUP_MASK) != 0) {
+        ok = false;
+    }
+    c = ok ? c : 0;
+    specialize(c);
+    return c;
 }
 
 bool BottleImpl::isInt(int index)
 {
     if (index >= 0 && index < static_cast<int>(size())) {
-        return content[index]->getCode() == StoreInt::code;
+        return codeAt(index) == StoreInt::code;
     }
     return false;
 }
@@ -1213,7 +1640,7 @@ bool BottleImpl::isInt(int index)
 bool BottleImpl::isString(int index)
 {
     if (index >= 0 && index < static_cast<int>(size())) {
-        return content[index]->getCode() == StoreString::code;
+        return codeAt(index) == StoreString::code;
     }
     return false;
 }
@@ -1221,7 +1648,7 @@ bool BottleImpl::isString(int index)
 bool BottleImpl::isDouble(int index)
 {
     if (index >= 0 && index < static_cast<int>(size())) {
-        return content[index]->getCode() == StoreDouble::code;
+        return codeAt(index) == StoreDouble::code;
     }
     return false;
 }
@@ -1230,20 +1657,34 @@ bool BottleImpl::isDouble(int index)
 bool BottleImpl::isList(int index)
 {
     if (index >= 0 && index < static_cast<int>(size())) {
-        return content[index]->isList();
+        int code = codeAt(index);
+        return (code & BOTTLE_TAG_LIST) != 0 && (code & BOTTLE_TAG_DICT) == 0;
     }
     return false;
 }
 
+Storable* BottleImpl::release(size_t index)
+{
+    Storable* s = &get(static_cast<int>(index));
+    if (content[index].pooled) {
+        Storable* copy = s->cloneStorable();
+        s->~Storable();
+        s = copy;
+    }
+    content[index].storable.store(YARP_NULLPTR);
+    content[index].pooled = false;
+    return s;
+}
+
 Storable* BottleImpl::pop()
 {
     Storable* stb = YARP_NULLPTR;
     if (size() == 0) {
         stb = new StoreNull();
     } else {
-        stb = content[size() - 1];
+        stb = release(size() - 1);
         content.pop_back();
-        dirty = true;
+        changed();
     }
     yAssert(stb != YARP_NULLPTR);
     return stb;
@@ -1252,17 +1693,104 @@ Storable* BottleImpl::pop()
 Storable& BottleImpl::get(int index) const
 {
     if (index >= 0 && index < static_cast<int>(size())) {
-        return *(content[index]);
+        Storable* s = content[index].storable.load(std::memory_order_acquire);
+        if (s != YARP_NULLPTR) {
+            return *s;
+        }
+        return materialize(index);
     }
     return getNull();
 }
 
+Storable& BottleImpl::materialize(size_t index) const
+{
+    // get() is const, so several threads may be reading the bottle;
+    // make sure only one of them creates the storable.  The bytes
+    // received stay valid; synch() checks whether the element changed.
+    std::lock_guard<std::mutex> guard(mutex);
+    Item& item = content[index];
+    Storable* s = item.storable.load(std::memory_order_relaxed);
+    if (s == YARP_NULLPTR) {
+        bool pooled = false;
+        s = decode(item, pooled);
+        item.pooled = pooled;
+        item.storable.store(s, std::memory_order_release);
+    }
+    return *s;
+}
+
+// Create a storable either in the arena of owner or on the heap.
+#define BOTTLE_NEW_STORABLE(T, args) \
+    (owner != YARP_NULLPTR ? new (owner->arenaAlloc(sizeof(T))) T args : new T args)
+
+Storable* BottleImpl::decode(const Item& item, bool& pooled) const
+{
+    return decode(item.code, &flat[item.offset], item.length,
+                  flatStorage ? this : YARP_NULLPTR, pooled);
+}
+
+Storable* BottleImpl::createStorable(int code, const char* raw, size_t length)
+{
+    bool pooled = false;
+    return decode(code, raw, length, YARP_NULLPTR, pooled);
+}
+
+Storable* BottleImpl::decode(int code, const char* raw, size_t length,
+                             const BottleImpl* owner, bool& pooled)
+{
+    pooled = (owner != YARP_NULLPTR);
+    switch (code) {
+    case StoreInt::code:
+        return BOTTLE_NEW_STORABLE(StoreInt, (rawInt(raw)));
+    case StoreVocab::code:
+        return BOTTLE_NEW_STORABLE(StoreVocab, (rawInt(raw)));
+    case StoreInt64::code: {
+        NetInt64 x;
+        memcpy(&x, raw, sizeof(x));
+        return BOTTLE_NEW_STORABLE(StoreInt64, (x));
+    }
+    case StoreDouble::code: {
+        NetFloat64 x;
+        memcpy(&x, raw, sizeof(x));
+        return BOTTLE_NEW_STORABLE(StoreDouble, (x));
+    }
+    case StoreString::code: {
+        int len = rawInt(raw);
+        // This is needed for compatiblity with versions of yarp before March 2015
+        if (len > 0 && raw[sizeof(NetInt32) + len - 1] == '\0') {
+            len--;
+        }
+        return BOTTLE_NEW_STORABLE(StoreString, (ConstString(raw + sizeof(NetInt32), len)));
+    }
+    case StoreBlob::code:
+        return BOTTLE_NEW_STORABLE(StoreBlob, (ConstString(raw + sizeof(NetInt32), rawInt(raw))));
+    }
+
+    pooled = false;
+    Storable* s = Storable::createByCode(code);
+    yAssert(s != YARP_NULLPTR);
+    if (s->isList()) {
+        s->asList()->implementation->fromBytes(Bytes(const_cast<char*>(raw), length));
+    } else {
+        ConstString wrapper(raw, length);
+        StringInputStream sis;
+        sis.add(wrapper);
+        StreamConnectionReader reader;
+        Route route;
+        reader.reset(sis, YARP_NULLPTR, route, length, false);
+        s->readRaw(reader);
+    }
+    return s;
+}
+
+#undef BOTTLE_NEW_STORABLE
+
 int BottleImpl::getInt(int index)
 {
     if (!isInt(index)) {
         return 0;
     }
-    return content[index]->asInt();
+    return get(index).asInt();
 }
 
 yarp::os::ConstString BottleImpl::getString(int index)
@@ -1270,7 +1798,7 @@ yarp::os::ConstString BottleImpl::getString(int index)
     if (!isString(index)) {
         return "";
     }
-    return content[index]->asString();
+    return get(index).asString();
 }
 
 double BottleImpl::getDouble(int index)
@@ -1278,7 +1806,7 @@ double BottleImpl::getDouble(int index)
     if (!isDouble(index)) {
         return 0;
     }
-    return content[index]->asDouble();
+    return get(index).asDouble();
 }
 
 yarp::os::Bottle* BottleImpl::getList(int index)
@@ -1286,7 +1814,7 @@ yarp::os::Bottle* BottleImpl::getList(int index)
     if (!isList(index)) {
         return YARP_NULLPTR;
     }
-    return &((dynamic_cast<StoreList*>(content[index]))->internal());
+    return &((dynamic_cast<StoreList&>(get(index))).internal());
 }
 
 yarp::os::Bottle& BottleImpl::addList()
@@ -1338,7 +1866,12 @@ void BottleImpl::copyRange(const BottleImpl* alt, int first, int len)
 
     if (last >= 0) {
         for (int i = first; i <= last; i++) {
-            add(src->get(i).cloneStorable());
+            const Item& item = src->content[i];
+            if (flatStorage && item.storable.load() == YARP_NULLPTR) {
+                addRaw(item.code, &(src->flat[item.offset]), item.length);
+            } else {
+                add(src->get(i).cloneStorable());
+            }
         }
     }
 }
@@ -0,0 +1,468 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/os/BottleView.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/ConnectionWriter.h>
+#include <yarp/os/NetFloat64.h>
+#include <yarp/os/NetInt32.h>
+#include <yarp/os/NetInt64.h>
+
+#include <yarp/os/impl/BottleImpl.h>
+#include <yarp/os/impl/PlatformVector.h>
+
+#include <cstring>
+
+using yarp::os::Bottle;
+using yarp::os::BottleView;
+using yarp::os::ConnectionReader;
+using yarp::os::ConnectionWriter;
+using yarp::os::ConstString;
+using yarp::os::NetFloat64;
+using yarp::os::NetInt32;
+using yarp::os::NetInt64;
+using yarp::os::Value;
+using yarp::os::impl::BottleImpl;
+using yarp::os::impl::Storable;
+
+#define UNIT_MASK                                            \
+    (BOTTLE_TAG_INT | BOTTLE_TAG_VOCAB | BOTTLE_TAG_DOUBLE | \
+     BOTTLE_TAG_STRING | BOTTLE_TAG_BLOB | BOTTLE_TAG_INT64)
+
+static int rawInt(const char* at)
+{
+    NetInt32 x;
+    memcpy(&x, at, sizeof(x));
+    return x;
+}
+
+static YARP_INT64 rawInt64(const char* at)
+{
+    NetInt64 x;
+    memcpy(&x, at, sizeof(x));
+    return x;
+}
+
+static double rawDouble(const char* at)
+{
+    NetFloat64 x;
+    memcpy(&x, at, sizeof(x));
+    return x;
+}
+
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+class BottleView::Private
+{
+public:
+    /**
+     * Where an element is, relative to the start of the list.
+     */
+    class Entry
+    {
+    public:
+        Entry() : code(0), offset(0), length(0) {}
+        Entry(int code, size_t offset, size_t length) :
+                code(code),
+                offset(offset),
+                length(length)
+        {
+        }
+
+        int code;
+        size_t offset;
+        size_t length;
+    };
+
+    Private() :
+            base(YARP_NULLPTR),
+            length(0),
+            subCode(0),
+            count(0),
+            fixed(0),
+            next(0)
+    {
+    }
+
+    void assign(const Private& alt)
+    {
+        if (alt.ownsData()) {
+            owned = alt.owned;
+            base = &owned[0] + (alt.base - &alt.owned[0]);
+        } else {
+            owned.clear();
+            base = alt.base;
+        }
+        length = alt.length;
+        subCode = alt.subCode;
+        count = alt.count;
+        fixed = alt.fixed;
+        entries = alt.entries;
+        next = alt.next;
+    }
+
+    bool ownsData() const
+    {
+        return owned.size() > 0 && base == &owned[0] + sizeof(NetInt32);
+    }
+
+    void clear()
+    {
+        owned.clear();
+        base = YARP_NULLPTR;
+        length = 0;
+        subCode = 0;
+        count = 0;
+        fixed = 0;
+        entries.clear();
+        next = 0;
+    }
+
+    /**
+     * Look at a list, starting from its element count.  The structure
+     * of the list must already have been checked.
+     */
+    void setList(const char* base, size_t length, int subCode)
+    {
+        this->base = base;
+        this->length = length;
+        this->subCode = subCode;
+        count = rawInt(base);
+        fixed = 0;
+        if (subCode == BOTTLE_TAG_INT || subCode == BOTTLE_TAG_VOCAB ||
+                subCode == BOTTLE_TAG_INT64 || subCode == BOTTLE_TAG_DOUBLE) {
+            fixed = BottleImpl::elementSize(subCode, base, length);
+        }
+        entries.clear();
+        next = sizeof(NetInt32);
+    }
+
+    /**
+     * Look at the bottle held in owned, starting from its top code.
+     */
+    void setOwned()
+    {
+        int top = rawInt(&owned[0]);
+        setList(&owned[0] + sizeof(NetInt32),
+                owned.size() - sizeof(NetInt32),
+                top & UNIT_MASK);
+    }
+
+    /**
+     * Find an element, indexing the elements before it if needed.
+     */
+    bool locate(int index, int& code, const char*& raw, size_t& len) const
+    {
+        if (index < 0 || index >= count) {
+            return false;
+        }
+        if (fixed != 0) {
+            code = subCode;
+            raw = base + sizeof(NetInt32) + index*fixed;
+            len = fixed;
+            return true;
+        }
+        while (static_cast<int>(entries.size()) <= index) {
+            size_t at = next;
+            int c = subCode;
+            if (c == 0) {
+                c = rawInt(base + at);
+                at += sizeof(NetInt32);
+            }
+            size_t n = BottleImpl::elementSize(c, base + at, length - at);
+            if (n == 0) {
+                return false;
+            }
+            entries.push_back(Entry(c, at, n));
+            next = at + n;
+        }
+        const Entry& entry = entries[index];
+        code = entry.code;
+        raw = base + entry.offset;
+        len = entry.length;
+        return true;
+    }
+
+    PlatformVector<char> owned;     ///< bytes of a view that holds its data
+    const char* base;               ///< start of the list, at its count
+    size_t length;                  ///< bytes in the list
+    int subCode;                    ///< type shared by all elements, or 0
+    int count;                      ///< number of elements
+    size_t fixed;                   ///< size of each element, if known
+    mutable PlatformVector<Entry> entries; ///< elements located so far
+    mutable size_t next;            ///< where the next element to locate is
+};
+
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+
+BottleView::BottleView() :
+        Portable(),
+        mPriv(new Private())
+{
+}
+
+BottleView::BottleView(const BottleView& alt) :
+        Portable(),
+        mPriv(new Private())
+{
+    mPriv->assign(*(alt.mPriv));
+}
+
+BottleView& BottleView::operator=(const BottleView& alt)
+{
+    if (&alt != this) {
+        mPriv->assign(*(alt.mPriv));
+    }
+    return *this;
+}
+
+BottleView::~BottleView()
+{
+    delete mPriv;
+}
+
+int BottleView::size() const
+{
+    return mPriv->count;
+}
+
+int BottleView::getCode(int index) const
+{
+    int code = 0;
+    const char* raw = YARP_NULLPTR;
+    size_t len = 0;
+    if (!mPriv->locate(index, code, raw, len)) {
+        return 0;
+    }
+    return code;
+}
+
+bool BottleView::isInt(int index) const
+{
+    int code = getCode(index);
+    return code == BOTTLE_TAG_INT || code == BOTTLE_TAG_VOCAB;
+}
+
+bool BottleView::isDouble(int index) const
+{
+    return getCode(index) == BOTTLE_TAG_DOUBLE;
+}
+
+bool BottleView::isString(int index) const
+{
+    return getCode(index) == BOTTLE_TAG_STRING;
+}
+
+bool BottleView::isList(int index) const
+{
+    int code = getCode(index);
+    return (code & BOTTLE_TAG_LIST) != 0 && (code & BOTTLE_TAG_DICT) == 0;
+}
+
+bool BottleView::isDict(int index) const
+{
+    return (getCode(index) & BOTTLE_TAG_DICT) != 0;
+}
+
+int BottleView::getInt(int index) const
+{
+    int code = 0;
+    const char* raw = YARP_NULLPTR;
+    size_t len = 0;
+    if (!mPriv->locate(index, code, raw, len)) {
+        return 0;
+    }
+    switch (code) {
+    case BOTTLE_TAG_INT:
+    case BOTTLE_TAG_VOCAB:
+        return rawInt(raw);
+    case BOTTLE_TAG_INT64:
+        return (int)rawInt64(raw);
+    case BOTTLE_TAG_DOUBLE:
+        return (int)rawDouble(raw);
+    }
+    return 0;
+}
+
+YARP_INT64 BottleView::getInt64(int index) const
+{
+    int code = 0;
+    const char* raw = YARP_NULLPTR;
+    size_t len = 0;
+    if (!mPriv->locate(index, code, raw, len)) {
+        return 0;
+    }
+    switch (code) {
+    case BOTTLE_TAG_INT:
+    case BOTTLE_TAG_VOCAB:
+        return rawInt(raw);
+    case BOTTLE_TAG_INT64:
+        return rawInt64(raw);
+    case BOTTLE_TAG_DOUBLE:
+        return (YARP_INT64)rawDouble(raw);
+    }
+    return 0;
+}
+
+double BottleView::getDouble(int index) const
+{
+    int code = 0;
+    const char* raw = YARP_NULLPTR;
+    size_t len = 0;
+    if (!mPriv->locate(index, code, raw, len)) {
+        return 0;
+    }
+    switch (code) {
+    case BOTTLE_TAG_INT:
+    case BOTTLE_TAG_VOCAB:
+        return rawInt(raw);
+    case BOTTLE_TAG_INT64:
+        return (double)rawInt64(raw);
+    case BOTTLE_TAG_DOUBLE:
+        return rawDouble(raw);
+    }
+    return 0;
+}
+
+ConstString BottleView::getString(int index) const
+{
+    int code = 0;
+    const char* raw = YARP_NULLPTR;
+    size_t len = 0;
+    if (!mPriv->locate(index, code, raw, len)) {
+        return ConstString();
+    }
+    if (code != BOTTLE_TAG_STRING && code != BOTTLE_TAG_BLOB) {
+        return ConstString();
+    }
+    int strLen = rawInt(raw);
+    // This is needed for compatiblity with versions of yarp before March 2015
+    if (code == BOTTLE_TAG_STRING && strLen > 0 &&
+            raw[sizeof(NetInt32) + strLen - 1] == '\0') {
+        strLen--;
+    }
+    return ConstString(raw + sizeof(NetInt32), strLen);
+}
+
+BottleView BottleView::getList(int index) const
+{
+    BottleView result;
+    int code = 0;
+    const char* raw = YARP_NULLPTR;
+    size_t len = 0;
+    if (!mPriv->locate(index, code, raw, len)) {
+        return result;
+    }
+    if ((code & BOTTLE_TAG_DICT) != 0) {
+        // a dictionary is sent as a complete bottle
+        int top = rawInt(raw);
+        result.mPriv->setList(raw + sizeof(NetInt32), len - sizeof(NetInt32),
+                              top & UNIT_MASK);
+    } else if ((code & BOTTLE_TAG_LIST) != 0) {
+        result.mPriv->setList(raw, len, code & UNIT_MASK);
+    }
+    return result;
+}
+
+Value BottleView::get(int index) const
+{
+    int code = 0;
+    const char* raw = YARP_NULLPTR;
+    size_t len = 0;
+    if (!mPriv->locate(index, code, raw, len)) {
+        return Value::getNullValue();
+    }
+    Storable* s = BottleImpl::createStorable(code, raw, len);
+    Value result(*s);
+    delete s;
+    return result;
+}
+
+bool BottleView::toBottle(Bottle& bottle) const
+{
+    if (mPriv->base == YARP_NULLPTR) {
+        bottle.clear();
+        return true;
+    }
+    if (mPriv->ownsData()) {
+        bottle.fromBinary(&mPriv->owned[0], (int)mPriv->owned.size());
+    } else {
+        PlatformVector<char> buf;
+        buf.resize(sizeof(NetInt32) + mPriv->length, 0);
+        NetInt32 top = BOTTLE_TAG_LIST + mPriv->subCode;
+        memcpy(&buf[0], &top, sizeof(top));
+        memcpy(&buf[0] + sizeof(top), mPriv->base, mPriv->length);
+        bottle.fromBinary(&buf[0], (int)buf.size());
+    }
+    return bottle.size() == size();
+}
+
+ConstString BottleView::toString() const
+{
+    Bottle bottle;
+    toBottle(bottle);
+    return bottle.toString();
+}
+
+bool BottleView::fromBinary(const char *data, size_t len)
+{
+    clear();
+    if (len < 2*sizeof(NetInt32)) {
+        return false;
+    }
+    int top = rawInt(data);
+    if ((top & BOTTLE_TAG_LIST) == 0 || (top & BOTTLE_TAG_DICT) != 0) {
+        return false;
+    }
+    size_t listLen = len - sizeof(NetInt32);
+    if (BottleImpl::listSize(top & UNIT_MASK, data + sizeof(NetInt32), listLen) != listLen) {
+        return false;
+    }
+    mPriv->owned.resize(len, 0);
+    memcpy(&mPriv->owned[0], data, len);
+    mPriv->setOwned();
+    return true;
+}
+
+void BottleView::clear()
+{
+    mPriv->clear();
+}
+
+bool BottleView::read(ConnectionReader& reader)
+{
+    clear();
+    if (reader.isTextMode()) {
+        Bottle bottle;
+        if (!bottle.read(reader)) {
+            return false;
+        }
+        size_t len = 0;
+        const char* data = bottle.toBinary(&len);
+        return fromBinary(data, len);
+    }
+    if (!BottleImpl::readBinary(reader, mPriv->owned)) {
+        clear();
+        return false;
+    }
+    mPriv->setOwned();
+    return true;
+}
+
+bool BottleView::write(ConnectionWriter& writer)
+{
+    if (writer.isTextMode()) {
+        writer.appendString(toString().c_str(), '\n');
+    } else if (mPriv->base == YARP_NULLPTR) {
+        writer.appendInt(BOTTLE_TAG_LIST);
+        writer.appendInt(0);
+    } else {
+        writer.appendInt(BOTTLE_TAG_LIST + mPriv->subCode);
+        writer.appendBlock(mPriv->base, mPriv->length);
+    }
+    return !writer.isError();
+}
@@ -28,7 +28,7 @@ bool BufferedConnectionWriter::applyConvertTextMode() {
         b.fromBinary(str.c_str(), str.length());
         ConstString replacement = b.toString() + "\n";
         for (size_t i=0; i<lst.size(); i++) {
-            delete lst[i];
+            releaseBlock(lst[i]);
         }
         lst_used = 0;
         target = &lst;
@@ -79,15 +79,15 @@ bool BufferedConnectionWriter::addPool(const yarp::os::Bytes& data) {
         if (*target_used < target->size()) {
             yarp::os::ManagedBytes*&bytes = (*target)[*target_used];
             if (bytes->length()<poolLength) {
-                delete bytes;
-                bytes = new yarp::os::ManagedBytes(poolLength);
+                releaseBlock(bytes);
+                bytes = acquireBlock(poolLength);
             }
             pool = bytes;
             if (pool == YARP_NULLPTR) {
                 return false;
             }
         } else {
-            pool = new yarp::os::ManagedBytes(poolLength);
+            pool = acquireBlock(poolLength);
             if (pool == YARP_NULLPTR) {
                 return false;
             }
@@ -120,9 +120,8 @@ void BufferedConnectionWriter::push(const Bytes& data, bool copy) {
     if (*target_used < target->size()) {
         yarp::os::ManagedBytes*&bytes = (*target)[*target_used];
         if (bytes->isOwner()!=copy||bytes->length()<data.length()) {
-            delete bytes;
-            bytes = new yarp::os::ManagedBytes(data, false);
-            if (copy) bytes->copy();
+            releaseBlock(bytes);
+            bytes = acquireBlock(data, copy);
             (*target_used)++;
             return;
         }
@@ -130,8 +129,7 @@ void BufferedConnectionWriter::push(const Bytes& data, bool copy) {
         bytes->setUsed(data.length());
     }
     if (buf == YARP_NULLPTR) {
-        buf = new yarp::os::ManagedBytes(data, false);
-        if (copy) buf->copy();
+        buf = acquireBlock(data, copy);
         target->push_back(buf);
     } else {
         if (copy) {
@@ -144,6 +142,36 @@ void BufferedConnectionWriter::push(const Bytes& data, bool copy) {
     (*target_used)++;
 }
 
+yarp::os::ManagedBytes *BufferedConnectionWriter::acquireBlock(size_t len) {
+    if (blockPool != YARP_NULLPTR) {
+        return blockPool->get(len);
+    }
+    return new yarp::os::ManagedBytes(len);
+}
+
+yarp::os::ManagedBytes *BufferedConnectionWriter::acquireBlock(const Bytes& data,
+                                                               bool copy) {
+    if (blockPool == YARP_NULLPTR) {
+        yarp::os::ManagedBytes *bytes = new yarp::os::ManagedBytes(data, false);
+        if (copy) bytes->copy();
+        return bytes;
+    }
+    if (!copy) {
+        return blockPool->getReference(data);
+    }
+    yarp::os::ManagedBytes *bytes = blockPool->get(data.length());
+    memcpy(bytes->get(), data.get(), data.length());
+    return bytes;
+}
+
+void BufferedConnectionWriter::releaseBlock(yarp::os::ManagedBytes *bytes) {
+    if (blockPool != YARP_NULLPTR) {
+        blockPool->release(bytes);
+    } else {
+        delete bytes;
+    }
+}
+
 void BufferedConnectionWriter::restart() {
     lst_used = 0;
     header_used = 0;
@@ -158,13 +186,24 @@ void BufferedConnectionWriter::restart() {
 
 void BufferedConnectionWriter::write(OutputStream& os) {
     stopWrite();
-    for (size_t i=0; i<header_used; i++) {
-        yarp::os::ManagedBytes& b = *(header[i]);
-        os.write(b.usedBytes());
+    // Blocks are passed on in groups, so that streams supporting it can
+    // send header and payload with a single gather operation.
+    const size_t group = 32;
+    Bytes blocks[group];
+    size_t n = 0;
+    size_t total = header_used + lst_used;
+    for (size_t i=0; i<total; i++) {
+        yarp::os::ManagedBytes& b = (i<header_used) ? *(header[i]) :
+                                                      *(lst[i-header_used]);
+        blocks[n] = b.usedBytes();
+        n++;
+        if (n==group) {
+            os.writeBlocks(blocks, n);
+            n = 0;
+        }
     }
-    for (size_t i=0; i<lst_used; i++) {
-        yarp::os::ManagedBytes& b = *(lst[i]);
-        os.write(b.usedBytes());
+    if (n>0) {
+        os.writeBlocks(blocks, n);
     }
 }
 
@@ -18,6 +18,9 @@
 #endif
 
 #include <yarp/os/impl/UdpCarrier.h>
+#ifdef YARP_HAS_SYS_MMAN_H
+#  include <yarp/os/impl/ShmRingCarrier.h>
+#endif
 #include <yarp/os/impl/LocalCarrier.h>
 #include <yarp/os/impl/NameserCarrier.h>
 #include <yarp/os/impl/HttpCarrier.h>
@@ -213,6 +216,9 @@ Carriers::Carriers() :
 #ifdef YARP_HAS_ACE
     //mPriv->delegates.push_back(new ShmemCarrier(1));
     mPriv->delegates.push_back(new ShmemCarrier(2)); // new Alessandro version
+#endif
+#ifdef YARP_HAS_SYS_MMAN_H
+    mPriv->delegates.push_back(new ShmRingCarrier());
 #endif
     mPriv->delegates.push_back(new TcpCarrier());
     mPriv->delegates.push_back(new TcpCarrier(false));
@@ -10,6 +10,8 @@
 #include <yarp/os/impl/DgramTwoWayStream.h>
 
 #include <yarp/os/impl/Logger.h>
+#include <yarp/os/Name.h>
+#include <yarp/os/SystemClock.h>
 #include <yarp/os/Time.h>
 #include <yarp/os/NetType.h>
 
@@ -28,11 +30,17 @@
 #  include <netinet/in.h>
 #  include <sys/types.h>
 #  include <sys/socket.h>
+#  include <poll.h>
 #  include <unistd.h>
 #endif
 
+#include <atomic>
 #include <cerrno>
 #include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
@@ -40,6 +48,29 @@ using namespace yarp::os;
 #define CRC_SIZE 8
 #define UDP_MAX_DATAGRAM_SIZE 65507 - CRC_SIZE
 
+// Framing used once recovery is enabled.  Each datagram starts with a
+// checksum, a kind (negative, so it is never taken for the packet
+// counter of the plain framing), a message number and a fragment number.
+#define FRAGMENT_HEADER_SIZE 16
+#define FRAGMENT_KIND_DATA (-2)
+#define FRAGMENT_KIND_LAST (-3)
+#define FRAGMENT_KIND_PARITY (-4)
+#define FRAGMENT_KIND_NACK (-5)
+
+// A parity datagram carries the number of fragments in its group, the
+// XOR of their lengths and the index of the last fragment of the message
+// (-1 if not in this group), followed by the XOR of the fragments.
+#define PARITY_HEADER_SIZE 12
+
+// Most fragments a reader holds on to for one message.
+#define FRAGMENT_MAX_COUNT 65536
+// Most fragments named in one retransmission request.
+#define FRAGMENT_MAX_REQUEST 256
+// How many bytes of sent fragments a writer keeps for retransmission.
+#define FRAGMENT_HISTORY_BYTES (8*1024*1024)
+// How long the writer waits for requests before checking it is closing.
+#define FRAGMENT_SERVICE_SLICE 0.05
+
 
 static bool checkCrc(char *buf, YARP_SSIZE_T length, YARP_SSIZE_T crcLength, int pct,
                      int *store_altPct = YARP_NULLPTR) {
@@ -77,6 +108,158 @@ static void addCrc(char *buf, YARP_SSIZE_T length, YARP_SSIZE_T crcLength, int p
 }
 
 
+static int getFragmentInt(const char *buf, size_t offset) {
+    return NetType::netInt(Bytes((char*)buf+offset, 4));
+}
+
+
+static void putFragmentInt(char *buf, size_t offset, int x) {
+    Bytes b(buf+offset, 4);
+    NetType::netInt((NetInt32)x, b);
+}
+
+
+static void sealFragment(char *buf, size_t length, int kind, int msg, int seq) {
+    putFragmentInt(buf, 4, kind);
+    putFragmentInt(buf, 8, msg);
+    putFragmentInt(buf, 12, seq);
+    putFragmentInt(buf, 0, (int)NetType::getCrc(buf+4, length-4));
+}
+
+
+static bool isFragment(const char *buf, size_t length) {
+    if (length<FRAGMENT_HEADER_SIZE) {
+        return false;
+    }
+    int kind = getFragmentInt(buf, 4);
+    return kind<=FRAGMENT_KIND_DATA && kind>=FRAGMENT_KIND_NACK;
+}
+
+
+static bool openFragment(const char *buf, size_t length,
+                         int& kind, int& msg, int& seq) {
+    if (!isFragment(buf, length)) {
+        return false;
+    }
+    if (getFragmentInt(buf, 0)!=(int)NetType::getCrc((char*)buf+4, length-4)) {
+        YARP_DEBUG(Logger::get(), "crc mismatch");
+        return false;
+    }
+    kind = getFragmentInt(buf, 4);
+    msg = getFragmentInt(buf, 8);
+    seq = getFragmentInt(buf, 12);
+    return true;
+}
+
+
+// how far message a is ahead of message b, allowing for wrap-around
+static int messageDistance(int a, int b) {
+    return (int)((unsigned int)a-(unsigned int)b);
+}
+
+
+/**
+ * State for sending and receiving messages as numbered fragments.
+ */
+class DgramTwoWayStream::Recovery {
+public:
+    Recovery() :
+            parityGroup(0), window(0), framing(false), receiving(false),
+            msg(0), seq(0), heldLen(0), holding(false),
+            parityCount(0), parityFirst(0), parityLen(0), parityLenXor(0),
+            parityLast(-1), historyBytes(0), serving(false),
+            active(false), haveLast(false), curMsg(0), lastMsg(0),
+            want(0), lastSeq(-1), highest(-1),
+            hasPending(false), hasPeer(false)
+    {
+    }
+
+    int parityGroup;
+    double window;
+    bool framing;       // write fragments
+    bool receiving;     // fragments have been seen on input
+
+    // writer side
+    int msg;
+    int seq;
+    ManagedBytes held;  // the latest fragment, sent once we know if it is the last
+    size_t heldLen;
+    bool holding;
+    ManagedBytes parity;
+    int parityCount;
+    int parityFirst;
+    size_t parityLen;
+    int parityLenXor;
+    int parityLast;
+    struct Sent {
+        int msg;
+        int seq;
+        ConstString data;
+    };
+    std::deque<Sent> history;
+    size_t historyBytes;
+    std::mutex historyMutex;    // shared with the thread answering requests
+    std::thread server;         // answers requests, between messages too
+    std::atomic<bool> serving;
+    ManagedBytes request;
+
+    // reader side
+    bool active;
+    bool haveLast;
+    int curMsg;
+    int lastMsg;
+    int want;
+    int lastSeq;
+    int highest;
+    std::map<int, ConstString> fragments;
+    std::map<int, ConstString> parities;
+    ManagedBytes scratch;
+    ConstString pending;
+    bool hasPending;
+
+    bool hasPeer;
+#if defined(YARP_HAS_ACE)
+    ACE_INET_Addr peer;
+#else
+    struct sockaddr_in peer;
+#endif
+
+    void startMessage(int m) {
+        active = true;
+        curMsg = m;
+        want = 0;
+        lastSeq = -1;
+        highest = -1;
+        fragments.clear();
+        parities.clear();
+    }
+
+    void endMessage() {
+        if (active) {
+            active = false;
+            haveLast = true;
+            lastMsg = curMsg;
+            fragments.clear();
+            parities.clear();
+        }
+    }
+
+    void remember(const char *data, size_t len) {
+        std::lock_guard<std::mutex> guard(historyMutex);
+        Sent sent;
+        sent.msg = msg;
+        sent.seq = seq;
+        sent.data = ConstString(data, len);
+        history.push_back(sent);
+        historyBytes += len;
+        while (historyBytes>FRAGMENT_HISTORY_BYTES && history.size()>1) {
+            historyBytes -= history.front().data.length();
+            history.pop_front();
+        }
+    }
+};
+
+
 bool DgramTwoWayStream::open(const Contact& remote) {
 #if defined(YARP_HAS_ACE)
     ACE_INET_Addr anywhere((u_short)0, (ACE_UINT32)INADDR_ANY);
@@ -240,7 +423,7 @@ void DgramTwoWayStream::allocate(int readSize, int writeSize) {
     writeBuffer.allocate(_write_size);
     readAt = 0;
     readAvail = 0;
-    writeAvail = CRC_SIZE;
+    writeAvail = headerSize();
     //happy = true;
     pct = 0;
 }
@@ -621,6 +804,8 @@ bool DgramTwoWayStream::join(const Contact& group, bool sender,
 
 DgramTwoWayStream::~DgramTwoWayStream() {
     closeMain();
+    delete recovery;
+    recovery = YARP_NULLPTR;
 }
 
 void DgramTwoWayStream::interrupt() {
@@ -690,6 +875,7 @@ void DgramTwoWayStream::interrupt() {
 }
 
 void DgramTwoWayStream::closeMain() {
+    stopServing();
     if (dgram != YARP_NULLPTR) {
         //printf("Dgram closing, interrupt state %d\n", interrupting);
         interrupt();
@@ -733,58 +919,24 @@ YARP_SSIZE_T DgramTwoWayStream::read(const Bytes& b) {
             return -1;
         }
 
-        // if nothing is available, try to grab stuff
-        if (readAvail==0) {
+        // with numbered fragments, put the message back together
+        if (readAvail==0 && recovery != YARP_NULLPTR && recovery->receiving) {
             readAt = 0;
-
-
-            //yAssert(dgram != YARP_NULLPTR);
-            //YARP_DEBUG(Logger::get(), "DGRAM Waiting for something!");
-            YARP_SSIZE_T result = -1;
-#if defined(YARP_HAS_ACE)
-            if (dgram && restrictInterfaceIp.isValid()) {
-                /*
-                printf("Consider remote mcast\n");
-                printf("What we know:\n");
-                printf("  %s\n", restrictInterfaceIp.toString().c_str());
-                printf("  %s\n", localAddress.toString().c_str());
-                printf("  %s\n", remoteAddress.toString().c_str());
-                */
-                ACE_INET_Addr iface(restrictInterfaceIp.getPort(),
-                                    restrictInterfaceIp.getHost().c_str());
-                ACE_INET_Addr dummy((u_short)0, (ACE_UINT32)INADDR_ANY);
-                result =
-                    dgram->recv(readBuffer.get(), readBuffer.length(), dummy);
-                YARP_DEBUG(Logger::get(),
-                           ConstString("MCAST Got ") + NetType::toString((int)result) +
-                           " bytes");
-
-            } else
-#endif
-            if (dgram != YARP_NULLPTR) {
-                yAssert(dgram != YARP_NULLPTR);
-#if defined(YARP_HAS_ACE)
-                ACE_INET_Addr dummy((u_short)0, (ACE_UINT32)INADDR_ANY);
-                //YARP_DEBUG(Logger::get(), "DGRAM Waiting for something!");
-                result =
-                    dgram->recv(readBuffer.get(), readBuffer.length(), dummy);
-#else
-                result = recv(dgram_sockfd, readBuffer.get(), readBuffer.length(), 0);
-#endif
-                YARP_DEBUG(Logger::get(),
-                           ConstString("DGRAM Got ") + NetType::toString((int)result) +
-                           " bytes");
-            } else {
-                onMonitorInput();
-                //printf("Monitored input of %d bytes\n", monitor.length());
-                if (monitor.length()>readBuffer.length()) {
-                    printf("Too big!\n");
-                    std::exit(1);
+            if (!nextFragment()) {
+                if (closed) {
+                    happy = false;
                 }
-                memcpy(readBuffer.get(), monitor.get(), monitor.length());
-                result = monitor.length();
+                reset();
+                return -1;
             }
+        }
 
+        // if nothing is available, try to grab stuff
+        if (readAvail==0) {
+            readAt = 0;
+            YARP_SSIZE_T result = receiveDatagram(readBuffer.get(),
+                                                  readBuffer.length(),
+                                                  -1);
 
             /*
               // this message isn't needed anymore
@@ -798,6 +950,16 @@ YARP_SSIZE_T DgramTwoWayStream::read(const Bytes& b) {
                 happy = false;
                 return -1;
             }
+            if (isFragment(readBuffer.get(), result)) {
+                // the writer is sending numbered fragments
+                if (recovery == YARP_NULLPTR) {
+                    recovery = new Recovery;
+                }
+                recovery->receiving = true;
+                recovery->pending = ConstString(readBuffer.get(), result);
+                recovery->hasPending = true;
+                continue;
+            }
             readAvail = result;
 
             // deal with CRC
@@ -878,6 +1040,10 @@ void DgramTwoWayStream::write(const Bytes& b) {
         //YARP_DEBUG(Logger::get(), "DGRAM prep writing");
         YARP_SSIZE_T rem = local.length();
         YARP_SSIZE_T space = writeBuffer.length()-writeAvail;
+        if (recovery != YARP_NULLPTR && recovery->framing) {
+            // leave room for the header of a parity datagram
+            space -= PARITY_HEADER_SIZE;
+        }
         bool shouldFlush = false;
         if (rem>=space) {
             rem = space;
@@ -898,6 +1064,13 @@ void DgramTwoWayStream::flush() {
         return;
     }
 
+    if (recovery != YARP_NULLPTR && recovery->framing) {
+        if (writeAvail>FRAGMENT_HEADER_SIZE) {
+            holdFragment();
+        }
+        return;
+    }
+
     // should set CRC
     if (writeAvail<=CRC_SIZE) {
         return;
@@ -906,61 +1079,7 @@ void DgramTwoWayStream::flush() {
     pct++;
 
     if (writeAvail>0) {
-        //yAssert(dgram != YARP_NULLPTR);
-        YARP_SSIZE_T len = 0;
-
-#if defined(YARP_HAS_ACE)
-        if (mgram != YARP_NULLPTR) {
-            len = mgram->send(writeBuffer.get(), writeAvail);
-            YARP_DEBUG(Logger::get(),
-                       ConstString("MCAST - wrote ") +
-                       NetType::toString((int)len) + " bytes"
-                       );
-        } else
-#endif
-            if (dgram != YARP_NULLPTR) {
-#if defined(YARP_HAS_ACE)
-            len = dgram->send(writeBuffer.get(), writeAvail,
-                              remoteHandle);
-#else
-            len = send(dgram_sockfd, writeBuffer.get(),
-                       writeAvail, 0);
-#endif
-            YARP_DEBUG(Logger::get(),
-                       ConstString("DGRAM - wrote ") +
-                       NetType::toString((int)len) + " bytes to " +
-                       remoteAddress.toString()
-                       );
-        } else {
-            Bytes b(writeBuffer.get(), writeAvail);
-            monitor = ManagedBytes(b, false);
-            monitor.copy();
-            //printf("Monitored output of %d bytes\n", monitor.length());
-            len = monitor.length();
-            onMonitorOutput();
-        }
-        //if (len>WRITE_SIZE*0.75) {
-        if (len>writeBuffer.length()*0.75) {
-            YARP_DEBUG(Logger::get(),
-                       "long dgrams might need a little time");
-
-            // Under heavy loads, packets could get dropped
-            // 640x480x3 images correspond to about 15 datagrams
-            // so there's not much time possible between them
-            // looked at iperf, it just does a busy-waiting delay
-            // there's an implementation below, but commented out -
-            // better solution was to increase recv buffer size
-
-            double first = yarp::os::Time::now();
-            double now;
-            int ct = 0;
-            do {
-                //printf("Busy wait... %d\n", ct);
-                yarp::os::Time::delay(0);
-                now = yarp::os::Time::now();
-                ct++;
-            } while (now-first<0.001);
-        }
+        YARP_SSIZE_T len = sendDatagram(writeBuffer.get(), writeAvail);
 
         if (len < 0) {
             happy = false;
@@ -982,6 +1101,144 @@ void DgramTwoWayStream::flush() {
 }
 
 
+YARP_SSIZE_T DgramTwoWayStream::sendDatagram(const char *data, size_t length) {
+    YARP_SSIZE_T len = 0;
+
+#if defined(YARP_HAS_ACE)
+    if (mgram != YARP_NULLPTR) {
+        len = mgram->send(data, length);
+        YARP_DEBUG(Logger::get(),
+                   ConstString("MCAST - wrote ") +
+                   NetType::toString((int)len) + " bytes"
+                   );
+    } else
+#endif
+        if (dgram != YARP_NULLPTR) {
+#if defined(YARP_HAS_ACE)
+        len = dgram->send(data, length, remoteHandle);
+#else
+        len = send(dgram_sockfd, data, length, 0);
+#endif
+        YARP_DEBUG(Logger::get(),
+                   ConstString("DGRAM - wrote ") +
+                   NetType::toString((int)len) + " bytes to " +
+                   remoteAddress.toString()
+                   );
+    } else {
+        Bytes b((char*)data, length);
+        monitor = ManagedBytes(b, false);
+        monitor.copy();
+        //printf("Monitored output of %d bytes\n", monitor.length());
+        len = monitor.length();
+        onMonitorOutput();
+    }
+    //if (len>WRITE_SIZE*0.75) {
+    if (len>writeBuffer.length()*0.75) {
+        YARP_DEBUG(Logger::get(),
+                   "long dgrams might need a little time");
+
+        // Under heavy loads, packets could get dropped
+        // 640x480x3 images correspond to about 15 datagrams
+        // so there's not much time possible between them
+        // looked at iperf, it just does a busy-waiting delay
+        // there's an implementation below, but commented out -
+        // better solution was to increase recv buffer size
+
+        double first = yarp::os::Time::now();
+        double now;
+        int ct = 0;
+        do {
+            //printf("Busy wait... %d\n", ct);
+            yarp::os::Time::delay(0);
+            now = yarp::os::Time::now();
+            ct++;
+        } while (now-first<0.001);
+    }
+    return len;
+}
+
+
+YARP_SSIZE_T DgramTwoWayStream::sendToPeer(const char *data, size_t length) {
+    if (dgram == YARP_NULLPTR) {
+        return sendDatagram(data, length);
+    }
+    if (recovery == YARP_NULLPTR || !recovery->hasPeer) {
+        return -1;
+    }
+#if defined(YARP_HAS_ACE)
+    return dgram->send(data, length, recovery->peer);
+#else
+    return sendto(dgram_sockfd, data, length, 0,
+                  (struct sockaddr *)&recovery->peer,
+                  sizeof(recovery->peer));
+#endif
+}
+
+
+YARP_SSIZE_T DgramTwoWayStream::receiveDatagram(char *data, size_t length,
+                                                double timeout) {
+    YARP_SSIZE_T result = -1;
+    if (dgram != YARP_NULLPTR) {
+#if defined(YARP_HAS_ACE)
+        ACE_INET_Addr peer((u_short)0, (ACE_UINT32)INADDR_ANY);
+        if (timeout>=0) {
+            ACE_Time_Value tv;
+            tv.set(timeout);
+            result = dgram->recv(data, length, peer, 0, &tv);
+            if (result<0 && errno==ETIME) {
+                return 0;
+            }
+        } else {
+            //YARP_DEBUG(Logger::get(), "DGRAM Waiting for something!");
+            result = dgram->recv(data, length, peer);
+        }
+        if (result>=0 && recovery != YARP_NULLPTR) {
+            recovery->peer = peer;
+            recovery->hasPeer = true;
+        }
+        YARP_DEBUG(Logger::get(),
+                   ConstString(restrictInterfaceIp.isValid() ? "MCAST" : "DGRAM") +
+                   " Got " + NetType::toString((int)result) + " bytes");
+#else
+        if (timeout>=0) {
+            struct pollfd pfd;
+            pfd.fd = dgram_sockfd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            int r = poll(&pfd, 1, (int)(timeout*1000+0.999));
+            if (r==0) {
+                return 0;
+            }
+            if (r<0) {
+                return (errno==EINTR) ? 0 : -1;
+            }
+        }
+        struct sockaddr_in peer;
+        socklen_t peerLen = sizeof(peer);
+        result = recvfrom(dgram_sockfd, data, length, 0,
+                          (struct sockaddr *)&peer, &peerLen);
+        if (result>=0 && recovery != YARP_NULLPTR) {
+            recovery->peer = peer;
+            recovery->hasPeer = true;
+        }
+        YARP_DEBUG(Logger::get(),
+                   ConstString("DGRAM Got ") + NetType::toString((int)result) +
+                   " bytes");
+#endif
+    } else {
+        onMonitorInput();
+        //printf("Monitored input of %d bytes\n", monitor.length());
+        if (monitor.length()>length) {
+            printf("Too big!\n");
+            std::exit(1);
+        }
+        memcpy(data, monitor.get(), monitor.length());
+        result = monitor.length();
+    }
+    return result;
+}
+
+
 bool DgramTwoWayStream::isOk() {
     return happy;
 }
@@ -990,7 +1247,7 @@ bool DgramTwoWayStream::isOk() {
 void DgramTwoWayStream::reset() {
     readAt = 0;
     readAvail = 0;
-    writeAvail = CRC_SIZE;
+    writeAvail = headerSize();
     pct = 0;
 }
 
@@ -998,12 +1255,36 @@ void DgramTwoWayStream::reset() {
 void DgramTwoWayStream::beginPacket() {
     //YARP_ERROR(Logger::get(), ConstString("Packet begins: ")+(reader?"reader":"writer"));
     pct = 0;
+    if (recovery != YARP_NULLPTR) {
+        // whatever is left of the previous message will not be read
+        recovery->endMessage();
+        if (recovery->framing && !reader) {
+            recovery->msg++;
+            recovery->seq = 0;
+            recovery->holding = false;
+            recovery->parityCount = 0;
+        }
+    }
 }
 
 void DgramTwoWayStream::endPacket() {
     //YARP_ERROR(Logger::get(), ConstString("Packet ends: ")+(reader?"reader":"writer"));
     if (!reader) {
         pct = 0;
+        if (recovery != YARP_NULLPTR && recovery->framing) {
+            if (writeAvail>FRAGMENT_HEADER_SIZE) {
+                holdFragment();
+            }
+            if (recovery->holding) {
+                sendFragment(true);
+            }
+            if (recovery->parityCount>0) {
+                sendParity();
+            }
+            if (recovery->window>0) {
+                answerRequests();
+            }
+        }
     }
 }
 
@@ -1045,3 +1326,427 @@ int DgramTwoWayStream::getTypeOfService() {
 #endif
     return tos;
 }
+
+
+YARP_SSIZE_T DgramTwoWayStream::headerSize() const {
+    if (recovery != YARP_NULLPTR && recovery->framing) {
+        return FRAGMENT_HEADER_SIZE;
+    }
+    return CRC_SIZE;
+}
+
+
+void DgramTwoWayStream::setRecovery(int parityGroup, double retransmitWindow) {
+    if (recovery == YARP_NULLPTR) {
+        recovery = new Recovery;
+    }
+    recovery->parityGroup = (parityGroup>0) ? parityGroup : 0;
+    recovery->window = (retransmitWindow>0) ? retransmitWindow : 0;
+    if (!recovery->framing) {
+        recovery->framing = true;
+        writeAvail = headerSize();
+    }
+}
+
+
+void DgramTwoWayStream::configureRecovery(const ConstString& carrierName) {
+    Name name(carrierName + "://test");
+    ConstString fec = name.getCarrierModifier("fec");
+    ConstString nack = name.getCarrierModifier("nack");
+    if (fec=="" && nack=="") {
+        return;
+    }
+    int parityGroup = (fec!="") ? NetType::toInt(fec) : 0;
+    double window = (nack!="") ? NetType::toInt(nack)/1000.0 : 0;
+    if (window>0 && multiMode) {
+        YARP_WARN(Logger::get(), "retransmission requests are not available for multicast, use fec instead");
+        window = 0;
+    }
+    setRecovery(parityGroup, window);
+}
+
+
+void DgramTwoWayStream::holdFragment() {
+    Recovery& r = *recovery;
+    if (r.holding) {
+        sendFragment(false);
+    }
+    // keep this fragment back until we know if it ends the message
+    r.held.allocateOnNeed(writeBuffer.length(), writeBuffer.length());
+    memcpy(r.held.get(), writeBuffer.get(), writeAvail);
+    r.heldLen = writeAvail;
+    r.holding = true;
+    writeAvail = FRAGMENT_HEADER_SIZE;
+    if (r.window>0) {
+        answerRequests();
+    }
+}
+
+
+void DgramTwoWayStream::sendFragment(bool last) {
+    Recovery& r = *recovery;
+    char *buf = r.held.get();
+    sealFragment(buf, r.heldLen,
+                 last ? FRAGMENT_KIND_LAST : FRAGMENT_KIND_DATA, r.msg, r.seq);
+    if (sendDatagram(buf, r.heldLen)<0) {
+        happy = false;
+    }
+    if (r.window>0) {
+        r.remember(buf, r.heldLen);
+    }
+    if (r.parityGroup>0) {
+        if (r.parityCount==0) {
+            r.parity.allocateOnNeed(writeBuffer.length(), writeBuffer.length());
+            memset(r.parity.get(), 0, r.parity.length());
+            r.parityFirst = r.seq;
+            r.parityLen = 0;
+            r.parityLenXor = 0;
+            r.parityLast = -1;
+        }
+        const char *payload = buf + FRAGMENT_HEADER_SIZE;
+        size_t len = r.heldLen - FRAGMENT_HEADER_SIZE;
+        char *acc = r.parity.get() + FRAGMENT_HEADER_SIZE + PARITY_HEADER_SIZE;
+        for (size_t i=0; i<len; i++) {
+            acc[i] ^= payload[i];
+        }
+        if (len>r.parityLen) {
+            r.parityLen = len;
+        }
+        r.parityLenXor ^= (int)len;
+        if (last) {
+            r.parityLast = r.seq;
+        }
+        r.parityCount++;
+    }
+    r.seq++;
+    r.holding = false;
+    if (r.parityGroup>0 && r.parityCount>=r.parityGroup) {
+        sendParity();
+    }
+}
+
+
+void DgramTwoWayStream::sendParity() {
+    Recovery& r = *recovery;
+    char *buf = r.parity.get();
+    putFragmentInt(buf, FRAGMENT_HEADER_SIZE, r.parityCount);
+    putFragmentInt(buf, FRAGMENT_HEADER_SIZE+4, r.parityLenXor);
+    putFragmentInt(buf, FRAGMENT_HEADER_SIZE+8, r.parityLast);
+    size_t len = FRAGMENT_HEADER_SIZE + PARITY_HEADER_SIZE + r.parityLen;
+    sealFragment(buf, len, FRAGMENT_KIND_PARITY, r.msg, r.parityFirst);
+    if (sendDatagram(buf, len)<0) {
+        happy = false;
+    }
+    r.parityCount = 0;
+}
+
+
+void DgramTwoWayStream::answerRequests() {
+    Recovery& r = *recovery;
+    if (dgram == YARP_NULLPTR) {
+        // a monitored stream has no socket to wait on, answer what came in
+        serviceRequests(0);
+        return;
+    }
+    if (!r.server.joinable()) {
+        // the tail of the last message sent may be asked for long after
+        // it went out, so do not wait for the next one to answer
+        r.serving = true;
+        r.server = std::thread(&DgramTwoWayStream::serveRequests, this);
+    }
+}
+
+
+void DgramTwoWayStream::serveRequests() {
+    while (recovery->serving) {
+        serviceRequests(FRAGMENT_SERVICE_SLICE);
+    }
+}
+
+
+void DgramTwoWayStream::stopServing() {
+    if (recovery != YARP_NULLPTR && recovery->server.joinable()) {
+        recovery->serving = false;
+        recovery->server.join();
+    }
+}
+
+
+void DgramTwoWayStream::serviceRequests(double timeout) {
+    Recovery& r = *recovery;
+    size_t size = FRAGMENT_HEADER_SIZE + 4*(FRAGMENT_MAX_REQUEST+1);
+    r.request.allocateOnNeed(size, size);
+    while (true) {
+        YARP_SSIZE_T len = receiveDatagram(r.request.get(), size, timeout);
+        if (len<=0) {
+            break;
+        }
+        timeout = 0;
+        const char *buf = r.request.get();
+        int kind = 0;
+        int msg = 0;
+        int from = 0;
+        if (!openFragment(buf, len, kind, msg, from) ||
+            kind!=FRAGMENT_KIND_NACK ||
+            len<FRAGMENT_HEADER_SIZE+4) {
+            continue;
+        }
+        int count = getFragmentInt(buf, FRAGMENT_HEADER_SIZE);
+        if (count<0 || FRAGMENT_HEADER_SIZE+4*(size_t)(count+1)>(size_t)len) {
+            continue;
+        }
+        YARP_DEBUG(Logger::get(),
+                   ConstString("DGRAM retransmission requested, message ") +
+                   NetType::toString(msg) + " fragment " +
+                   NetType::toString(from));
+        std::lock_guard<std::mutex> guard(r.historyMutex);
+        for (size_t i=0; i<r.history.size(); i++) {
+            Recovery::Sent& sent = r.history[i];
+            if (sent.msg!=msg || sent.seq<from) {
+                continue;
+            }
+            // an empty list asks for everything from the first fragment on
+            bool wanted = (count==0);
+            for (int k=0; k<count && !wanted; k++) {
+                wanted = (getFragmentInt(buf, FRAGMENT_HEADER_SIZE+4*(k+1))==sent.seq);
+            }
+            if (wanted) {
+                sendDatagram(sent.data.c_str(), sent.data.length());
+            }
+        }
+    }
+}
+
+
+bool DgramTwoWayStream::nextFragment() {
+    Recovery& r = *recovery;
+    if (r.scratch.length()<readBuffer.length()) {
+        r.scratch.allocate(readBuffer.length());
+    }
+    double deadline = -1;
+    bool asked = false;
+    while (!closed) {
+        if (r.active) {
+            if (takeFragment()) {
+                return true;
+            }
+            if (r.lastSeq>=0 && r.want>r.lastSeq) {
+                // the message is over
+                return false;
+            }
+        }
+
+        // wait for more, but not forever if we can ask for what is missing
+        double timeout = -1;
+        if (r.active && r.window>0) {
+            double now = SystemClock::nowSystem();
+            if (!asked && r.highest>r.want) {
+                requestFragments();
+                asked = true;
+                deadline = now + r.window;
+            }
+            if (deadline<0) {
+                deadline = now + r.window;
+            }
+            timeout = deadline - now;
+            if (timeout<=0) {
+                if (asked) {
+                    YARP_DEBUG(Logger::get(), "DGRAM gave up waiting for a lost fragment");
+                    return false;
+                }
+                // perhaps the end of the message was lost
+                requestFragments();
+                asked = true;
+                deadline = now + r.window;
+                timeout = r.window;
+            }
+        }
+
+        int status = 0;
+        if (r.hasPending) {
+            ConstString data = r.pending;
+            r.hasPending = false;
+            status = acceptFragment(data.c_str(), data.length());
+        } else {
+            YARP_SSIZE_T len = receiveDatagram(r.scratch.get(),
+                                               r.scratch.length(),
+                                               timeout);
+            if (len<0) {
+                return false;
+            }
+            if (len==0) {
+                if (timeout<0) {
+                    return false;
+                }
+                continue;
+            }
+            status = acceptFragment(r.scratch.get(), len);
+        }
+        if (status<0) {
+            // a later message started, this one is lost
+            return false;
+        }
+        if (!asked) {
+            // the writer is still sending, give it another window
+            deadline = -1;
+        }
+    }
+    return false;
+}
+
+
+int DgramTwoWayStream::acceptFragment(const char *data, size_t len) {
+    Recovery& r = *recovery;
+    int kind = 0;
+    int msg = 0;
+    int seq = 0;
+    if (!openFragment(data, len, kind, msg, seq)) {
+        errCount++;
+        double now = Time::now();
+        if (now-lastReportTime>1) {
+            YARP_ERROR(Logger::get(),
+                       ConstString("*** ") + NetType::toString(errCount) + " datagram packet(s) dropped - checksum error ***");
+            lastReportTime = now;
+            errCount = 0;
+        }
+        return 0;
+    }
+    if (kind==FRAGMENT_KIND_NACK || seq<0 || seq>=FRAGMENT_MAX_COUNT) {
+        return 0;
+    }
+    if (!r.active) {
+        if (r.haveLast && messageDistance(msg, r.lastMsg)<=0) {
+            // left over from a message we are done with
+            return 0;
+        }
+        r.startMessage(msg);
+    } else if (msg!=r.curMsg) {
+        if (messageDistance(msg, r.curMsg)>0) {
+            r.pending = ConstString(data, len);
+            r.hasPending = true;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (kind==FRAGMENT_KIND_PARITY) {
+        if (len<FRAGMENT_HEADER_SIZE+PARITY_HEADER_SIZE) {
+            return 0;
+        }
+        int count = getFragmentInt(data, FRAGMENT_HEADER_SIZE);
+        int last = getFragmentInt(data, FRAGMENT_HEADER_SIZE+8);
+        if (count<=0 || count>FRAGMENT_MAX_COUNT) {
+            return 0;
+        }
+        r.parities[seq] = ConstString(data+FRAGMENT_HEADER_SIZE,
+                                      len-FRAGMENT_HEADER_SIZE);
+        if (last>=0) {
+            r.lastSeq = last;
+        }
+        if (seq+count-1>r.highest) {
+            r.highest = seq+count-1;
+        }
+        return 0;
+    }
+
+    if (r.fragments.find(seq)==r.fragments.end()) {
+        r.fragments[seq] = ConstString(data+FRAGMENT_HEADER_SIZE,
+                                       len-FRAGMENT_HEADER_SIZE);
+    }
+    if (kind==FRAGMENT_KIND_LAST) {
+        r.lastSeq = seq;
+    }
+    if (seq>r.highest) {
+        r.highest = seq;
+    }
+    return 0;
+}
+
+
+bool DgramTwoWayStream::takeFragment() {
+    Recovery& r = *recovery;
+    while (r.lastSeq<0 || r.want<=r.lastSeq) {
+        std::map<int, ConstString>::iterator it = r.fragments.find(r.want);
+        if (it==r.fragments.end()) {
+            if (!recoverFragment(r.want)) {
+                return false;
+            }
+            it = r.fragments.find(r.want);
+        }
+        // fragments are kept until the message ends, in case a parity
+        // datagram needs them
+        const ConstString& data = it->second;
+        r.want++;
+        if (data.length()>0 && data.length()<=readBuffer.length()) {
+            memcpy(readBuffer.get(), data.c_str(), data.length());
+            readAt = 0;
+            readAvail = data.length();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool DgramTwoWayStream::recoverFragment(int seq) {
+    Recovery& r = *recovery;
+    std::map<int, ConstString>::iterator it = r.parities.upper_bound(seq);
+    if (it==r.parities.begin()) {
+        return false;
+    }
+    --it;
+    int first = it->first;
+    const ConstString& parity = it->second;
+    int count = getFragmentInt(parity.c_str(), 0);
+    if (seq>=first+count) {
+        return false;
+    }
+    for (int i=first; i<first+count; i++) {
+        if (i!=seq && r.fragments.find(i)==r.fragments.end()) {
+            return false;
+        }
+    }
+    int len = getFragmentInt(parity.c_str(), 4);
+    ConstString data(parity.c_str()+PARITY_HEADER_SIZE,
+                     parity.length()-PARITY_HEADER_SIZE);
+    char *out = (char*)data.c_str();
+    for (int i=first; i<first+count; i++) {
+        if (i==seq) {
+            continue;
+        }
+        const ConstString& other = r.fragments[i];
+        for (size_t k=0; k<other.length() && k<data.length(); k++) {
+            out[k] ^= other[k];
+        }
+        len ^= (int)other.length();
+    }
+    if (len<0 || (size_t)len>data.length()) {
+        return false;
+    }
+    YARP_DEBUG(Logger::get(),
+               ConstString("DGRAM rebuilt lost fragment ") +
+               NetType::toString(seq) + " from parity");
+    r.fragments[seq] = data.substr(0, len);
+    return true;
+}
+
+
+void DgramTwoWayStream::requestFragments() {
+    Recovery& r = *recovery;
+    ManagedBytes buf(FRAGMENT_HEADER_SIZE + 4*(FRAGMENT_MAX_REQUEST+1));
+    int count = 0;
+    for (int i=r.want; i<=r.highest && count<FRAGMENT_MAX_REQUEST; i++) {
+        if (r.fragments.find(i)==r.fragments.end()) {
+            putFragmentInt(buf.get(), FRAGMENT_HEADER_SIZE+4*(count+1), i);
+            count++;
+        }
+    }
+    // an empty list asks for everything from r.want on
+    putFragmentInt(buf.get(), FRAGMENT_HEADER_SIZE, count);
+    size_t len = FRAGMENT_HEADER_SIZE + 4*(count+1);
+    sealFragment(buf.get(), len, FRAGMENT_KIND_NACK, r.curMsg, r.want);
+    YARP_DEBUG(Logger::get(),
+               ConstString("DGRAM asking for ") + NetType::toString(count) +
+               " lost fragment(s) from " + NetType::toString(r.want));
+    sendToPeer(buf.get(), len);
+}
@@ -7,11 +7,229 @@
 #include <yarp/os/impl/LogForwarder.h>
 #include <yarp/os/Network.h>
 #include <yarp/os/Os.h>
+#include <yarp/os/SystemClock.h>
 #include <yarp/os/Time.h>
 #include <yarp/os/Log.h>
+#include <yarp/os/impl/SemaphoreImpl.h>
+#include <yarp/os/impl/ThreadImpl.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// messages sent to the logger in a single Bottle, at most
+#define MAX_LINES_PER_MESSAGE 64
+
+// default size of the queue of messages waiting to be sent
+#define DEFAULT_QUEUE_SIZE 1024
 
 yarp::os::LogForwarder* yarp::os::LogForwarder::instance = YARP_NULLPTR;
-yarp::os::Semaphore *yarp::os::LogForwarder::sem = YARP_NULLPTR;
+
+
+/**
+ * The queue of messages waiting to be sent, and the thread sending them.
+ *
+ * The queue is a bounded ring where producers and consumers each claim a
+ * cell with a compare-and-swap, then mark it as filled or emptied with
+ * its sequence number (a Vyukov queue).  Cells keep their string, so that
+ * once the ring is warm queuing a message does not allocate memory.
+ */
+class yarp::os::LogForwarder::Private : public yarp::os::impl::ThreadImpl
+{
+public:
+    enum Overflow { DropOldest, DropNewest, Block };
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        std::string line;
+    };
+
+    LogForwarder& owner;
+    Cell *cells;
+    size_t mask;
+    Overflow overflow;
+    std::atomic<size_t> head;       // next cell to fill
+    std::atomic<size_t> tail;       // next cell to empty
+    std::atomic<long> dropped;
+    std::atomic<bool> waiting;      // the sender is (about to be) asleep
+    std::atomic<bool> stopping;
+    yarp::os::impl::SemaphoreImpl wake;
+
+    Private(LogForwarder& owner) :
+            owner(owner),
+            cells(YARP_NULLPTR),
+            mask(0),
+            overflow(DropOldest),
+            head(0),
+            tail(0),
+            dropped(0),
+            waiting(false),
+            stopping(false),
+            wake(0)
+    {
+        size_t size = DEFAULT_QUEUE_SIZE;
+        const char *queue = yarp::os::getenv("YARP_FORWARD_LOG_QUEUE");
+        if (queue && atoi(queue)>0) {
+            size = (size_t)atoi(queue);
+        }
+        size_t capacity = 2;
+        while (capacity<size) {
+            capacity *= 2;
+        }
+        cells = new Cell[capacity];
+        for (size_t i=0; i<capacity; i++) {
+            cells[i].sequence = i;
+        }
+        mask = capacity-1;
+
+        const char *policy = yarp::os::getenv("YARP_FORWARD_LOG_OVERFLOW");
+        if (policy && strcmp(policy, "drop-newest")==0) {
+            overflow = DropNewest;
+        } else if (policy && strcmp(policy, "block")==0) {
+            overflow = Block;
+        }
+    }
+
+    ~Private()
+    {
+        delete[] cells;
+    }
+
+    bool push(const std::string& message)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos&mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            long diff = (long)sequence-(long)pos;
+            if (diff==0) {
+                if (head.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+                    cell.line.assign(message);
+                    cell.sequence.store(pos+1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff<0) {
+                // full
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // take the oldest message, or just discard it if line is null
+    bool pop(std::string *line)
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells[pos&mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            long diff = (long)sequence-(long)(pos+1);
+            if (diff==0) {
+                if (tail.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) {
+                    if (line) {
+                        line->assign(cell.line);
+                    }
+                    cell.sequence.store(pos+mask+1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff<0) {
+                // empty
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void forward(const std::string& message)
+    {
+        Overflow policy = overflow;
+        if (policy==Block && getKeyOfCaller()==getKey()) {
+            // the sender itself is logging, it cannot wait for itself
+            policy = DropNewest;
+        }
+        while (!push(message)) {
+            if (policy==DropNewest) {
+                dropped++;
+                notify();
+                return;
+            }
+            if (policy==DropOldest) {
+                if (pop(YARP_NULLPTR)) {
+                    dropped++;
+                }
+                continue;
+            }
+            notify();
+            yarp::os::SystemClock::delaySystem(0.001);
+        }
+        notify();
+    }
+
+    bool empty()
+    {
+        size_t pos = tail.load();
+        return cells[pos&mask].sequence.load()!=pos+1;
+    }
+
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.exchange(false)) {
+            wake.post();
+        }
+    }
+
+    virtual void run() override
+    {
+        std::string line;
+        long reported = 0;
+        while (true) {
+            long lost = dropped.load();
+            if (lost==reported && empty()) {
+                if (stopping) {
+                    break;
+                }
+                waiting = true;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (empty() && dropped.load()==reported && !stopping) {
+                    wake.wait();
+                }
+                continue;
+            }
+            int lines = 0;
+            Bottle& b = owner.outputPort->prepare();
+            b.clear();
+            std::string port = "["; port+=owner.logPortName; port+="]";
+            b.addString(port);
+            if (lost!=reported) {
+                char warning[MAX_STRING_SIZE];
+                sprintf(warning, "[WARNING] %ld log messages were dropped\n", lost-reported);
+                b.addString(warning);
+                reported = lost;
+                lines++;
+            }
+            while (lines<MAX_LINES_PER_MESSAGE && pop(&line)) {
+                b.addString(line);
+                lines++;
+            }
+            owner.outputPort->write(true);
+            owner.outputPort->waitForWrite();
+        }
+    }
+
+    void stop()
+    {
+        stopping = true;
+        waiting = false;
+        wake.post();
+        join();
+    }
+};
+
 
 yarp::os::LogForwarder* yarp::os::LogForwarder::getInstance()
 {
@@ -27,33 +245,30 @@ void yarp::os::LogForwarder::clearInstance()
     if (instance)
     {
         delete instance;
+        instance = YARP_NULLPTR;
     };
 };
 
 void yarp::os::LogForwarder::forward (const std::string& message)
 {
-    sem->wait();
     if (outputPort)
     {
-        Bottle& b = outputPort->prepare();
-        b.clear();
-        std::string port = "["; port+=logPortName; port+="]";
-        b.addString(port);
-        b.addString(message);
-        outputPort->write(true);
-        outputPort->waitForWrite();
+        mPriv->forward(message);
     }
-    sem->post();
 }
 
-yarp::os::LogForwarder::LogForwarder()
+long yarp::os::LogForwarder::getDroppedCount()
+{
+    return mPriv->dropped.load();
+}
+
+yarp::os::LogForwarder::LogForwarder() :
+        mPriv(new Private(*this))
 {
     // I believe this guy, which is called by a yDebug() or similar, should be always called after
     // yarp::os::Network has already been initialized, therefore calling initMinimum here is not required.
     // It should not harm, but I prefer to avoid it if possible
 //     yarp::os::NetworkBase::initMinimum();
-    sem = new yarp::os::Semaphore(1);
-    yAssert(sem);
     outputPort =YARP_NULLPTR;
     outputPort = new yarp::os::BufferedPort<yarp::os::Bottle>;
     char host_name [MAX_STRING_SIZE]; //unsafe
@@ -71,13 +286,21 @@ yarp::os::LogForwarder::LogForwarder()
         printf("LogForwarder error while connecting port %s\n", logPortName);
     }
     //yarp::os::Network::connect(logPortName, "/test");
+    if (!mPriv->start())
+    {
+        printf("LogForwarder error while starting the thread sending messages\n");
+        outputPort->close();
+        delete outputPort;
+        outputPort=YARP_NULLPTR;
+    }
 };
 
 yarp::os::LogForwarder::~LogForwarder()
 {
-    sem->wait();
     if (outputPort)
     {
+        // send what is still queued
+        mPriv->stop();
         Bottle& b = outputPort->prepare();
         b.clear();
         std::string port = "["; port+=logPortName; port+="]";
@@ -90,8 +313,6 @@ yarp::os::LogForwarder::~LogForwarder()
         delete outputPort;
         outputPort=YARP_NULLPTR;
     }
-    sem->post();
-    delete sem;
-    sem = YARP_NULLPTR;
+    delete mPriv;
 //     yarp::os::NetworkBase::finiMinimum();
 };
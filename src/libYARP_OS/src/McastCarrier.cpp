@@ -200,6 +200,7 @@ bool yarp::os::impl::McastCarrier::becomeMcast(ConnectionState& proto, bool send
         delete stream;
         return false;
     }
+    stream->configureRecovery(proto.getRoute().getCarrierName());
     proto.takeStreams(stream);
     return true;
 }
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/os/impl/NameCache.h>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/LockGuard.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/Port.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/SystemClock.h>
+#include <yarp/os/impl/Logger.h>
+
+#include <cstdlib>
+#include <map>
+
+using namespace yarp::os::impl;
+using namespace yarp::os;
+
+namespace {
+
+struct CacheEntry
+{
+    Contact contact;
+    double expiry;
+};
+
+enum ListenState
+{
+    LISTEN_IDLE,        // not tried yet
+    LISTEN_OPENING,     // being set up, by the first thread storing an address
+    LISTEN_OPEN,        // receiving events from the name server
+    LISTEN_FAILED       // no events, addresses just expire
+};
+
+}
+
+static yarp::os::Mutex cacheMutex;
+static std::map<ConstString, CacheEntry> cacheEntries;
+static double cacheTtl = -1;
+static ListenState listenState = LISTEN_IDLE;
+static Port *listenPort = YARP_NULLPTR;
+
+
+/**
+ * Reads the events published by the name server, of the form
+ * [add] /port or [del] /port.
+ */
+class NameCache::Listener : public PortReader
+{
+public:
+    virtual bool read(ConnectionReader& reader) override
+    {
+        Bottle event;
+        if (!event.read(reader)) {
+            return false;
+        }
+        if (event.size()>=2) {
+            NameCache::invalidate(event.get(1).asString());
+        }
+        return true;
+    }
+};
+
+static PortReader *listenReader = YARP_NULLPTR;
+
+
+static double getConfiguredTtl()
+{
+    if (cacheTtl<0) {
+        ConstString ttl = NetworkBase::getEnvironment("YARP_NAME_CACHE_TTL");
+        cacheTtl = (ttl!="") ? atof(ttl.c_str()) : 0;
+        if (cacheTtl<0) {
+            cacheTtl = 0;
+        }
+    }
+    return cacheTtl;
+}
+
+
+bool NameCache::lookup(const ConstString& name, Contact& contact)
+{
+    LockGuard guard(cacheMutex);
+    std::map<ConstString, CacheEntry>::iterator it = cacheEntries.find(name);
+    if (it==cacheEntries.end()) {
+        return false;
+    }
+    if (it->second.expiry<SystemClock::nowSystem()) {
+        cacheEntries.erase(it);
+        return false;
+    }
+    contact = it->second.contact;
+    return true;
+}
+
+
+void NameCache::store(const ConstString& name, const Contact& contact)
+{
+    {
+        LockGuard guard(cacheMutex);
+        double ttl = getConfiguredTtl();
+        if (ttl<=0) {
+            return;
+        }
+        CacheEntry& entry = cacheEntries[name];
+        entry.contact = contact;
+        entry.expiry = SystemClock::nowSystem() + ttl;
+        if (listenState!=LISTEN_IDLE) {
+            return;
+        }
+        listenState = LISTEN_OPENING;
+    }
+    listen();
+}
+
+
+void NameCache::invalidate(const ConstString& name)
+{
+    LockGuard guard(cacheMutex);
+    cacheEntries.erase(name);
+}
+
+
+void NameCache::clear()
+{
+    LockGuard guard(cacheMutex);
+    cacheEntries.clear();
+}
+
+
+void NameCache::setTtl(double ttl)
+{
+    LockGuard guard(cacheMutex);
+    cacheTtl = (ttl>0) ? ttl : 0;
+    if (cacheTtl==0) {
+        cacheEntries.clear();
+    }
+}
+
+
+double NameCache::getTtl()
+{
+    LockGuard guard(cacheMutex);
+    return getConfiguredTtl();
+}
+
+
+void NameCache::listen()
+{
+    // the name server writes its events to whoever it is connected to
+    Port *port = new Port;
+    Listener *reader = new Listener;
+    port->setVerbosity(-1);
+    port->setReader(*reader);
+    bool ok = port->open("...");
+    if (ok) {
+        ContactStyle style;
+        style.quiet = true;
+        ok = NetworkBase::connect(NetworkBase::getNameServerName(),
+                                  port->getName(),
+                                  style);
+        if (!ok) {
+            port->close();
+        }
+    }
+    LockGuard guard(cacheMutex);
+    if (!ok) {
+        YARP_DEBUG(Logger::get(),
+                   "cannot hear from the name server, cached port addresses will just expire");
+        delete port;
+        delete reader;
+        listenState = LISTEN_FAILED;
+        return;
+    }
+    listenPort = port;
+    listenReader = reader;
+    listenState = LISTEN_OPEN;
+}
+
+
+void NameCache::fini()
+{
+    Port *port = YARP_NULLPTR;
+    PortReader *reader = YARP_NULLPTR;
+    {
+        LockGuard guard(cacheMutex);
+        port = listenPort;
+        reader = listenReader;
+        listenPort = YARP_NULLPTR;
+        listenReader = YARP_NULLPTR;
+        // closing the port looks up names, do not listen again meanwhile
+        listenState = LISTEN_FAILED;
+    }
+    if (port!=YARP_NULLPTR) {
+        port->close();
+        delete port;
+    }
+    delete reader;
+    LockGuard guard(cacheMutex);
+    listenState = LISTEN_IDLE;
+    cacheEntries.clear();
+}
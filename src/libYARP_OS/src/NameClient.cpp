@@ -13,6 +13,7 @@
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/TcpFace.h>
 #include <yarp/os/Carriers.h>
+#include <yarp/os/impl/NameCache.h>
 #include <yarp/os/impl/NameServer.h>
 #include <yarp/os/impl/NameConfig.h>
 #include <yarp/os/impl/PlatformUnistd.h>
@@ -20,6 +21,7 @@
 #  include <yarp/os/impl/FallbackNameClient.h>
 #endif
 #include <cstdio>
+#include <map>
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
@@ -41,6 +43,10 @@ yarp::os::Mutex NameClient::mutex;
 #define MAX_ARG_CT (20)
 #define MAX_ARG_LEN (256)
 
+// names looked up by a single query, kept within what the
+// text-based name server can split
+#define MAX_NAMES_PER_QUERY (16)
+
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
@@ -281,9 +287,98 @@ Contact NameClient::queryName(const ConstString& name) {
         return c;
     }
 
+    // a name server in this process is quicker to ask than the cache
+    bool cached = !isFakeMode() && NetworkBase::getQueryBypass()==YARP_NULLPTR;
+    Contact c;
+    if (cached && NameCache::lookup(np, c)) {
+        return c;
+    }
+
     ConstString q("NAME_SERVER query ");
     q += np;
-    return probe(q);
+    c = probe(q);
+    if (cached && c.isValid() && c.getPort()>0) {
+        NameCache::store(np, c);
+    }
+    return c;
+}
+
+std::vector<Contact> NameClient::queryNames(const std::vector<ConstString>& names) {
+    std::vector<Contact> result(names.size());
+    if (altStore!=YARP_NULLPTR || isFakeMode() ||
+        NetworkBase::getQueryBypass()!=YARP_NULLPTR) {
+        // nothing to save, the name server is in this process
+        for (size_t i=0; i<names.size(); i++) {
+            result[i] = queryName(names[i]);
+        }
+        return result;
+    }
+
+    std::vector<size_t> pending;
+    for (size_t i=0; i<names.size(); i++) {
+        ConstString np = getNamePart(names[i]);
+        if (np.find(':')!=ConstString::npos) {
+            Contact c = Contact::fromString(np.c_str());
+            if (c.isValid()&&c.getPort()>0) {
+                result[i] = c;
+                continue;
+            }
+        }
+        if (!NameCache::lookup(np, result[i])) {
+            pending.push_back(i);
+        }
+    }
+
+    size_t at = 0;
+    while (at<pending.size()) {
+        size_t count = pending.size()-at;
+        if (count>MAX_NAMES_PER_QUERY) {
+            count = MAX_NAMES_PER_QUERY;
+        }
+        if (count==1) {
+            result[pending[at]] = queryName(names[pending[at]]);
+            break;
+        }
+        ConstString q("NAME_SERVER query");
+        for (size_t k=0; k<count; k++) {
+            q += " ";
+            q += getNamePart(names[pending[at+k]]);
+        }
+
+        // one registration line per port that is registered
+        ConstString reply = send(q);
+        std::map<ConstString, Contact> found;
+        size_t start = 0;
+        while (start<reply.length()) {
+            size_t end = reply.find('\n', start);
+            if (end==ConstString::npos) {
+                end = reply.length();
+            }
+            Contact c = extractAddress(reply.substr(start, end-start));
+            if (c.isValid()) {
+                found[c.getRegName()] = c;
+            }
+            start = end+1;
+        }
+
+        for (size_t k=0; k<count; k++) {
+            size_t i = pending[at+k];
+            ConstString np = getNamePart(names[i]);
+            std::map<ConstString, Contact>::iterator it = found.find(np);
+            if (it!=found.end()) {
+                result[i] = it->second;
+                if (result[i].getPort()>0) {
+                    NameCache::store(np, result[i]);
+                }
+            } else {
+                // not registered, or a name server answering for the
+                // first name only
+                result[i] = queryName(names[i]);
+            }
+        }
+        at += count;
+    }
+    return result;
 }
 
 Contact NameClient::registerName(const ConstString& name) {
@@ -292,6 +387,7 @@ Contact NameClient::registerName(const ConstString& name) {
 
 Contact NameClient::registerName(const ConstString& name, const Contact& suggest) {
     ConstString np = getNamePart(name);
+    NameCache::invalidate(np);
     Bottle cmd;
     cmd.addString("register");
     if (np!="") {
@@ -375,6 +471,7 @@ Contact NameClient::registerName(const ConstString& name, const Contact& suggest
 
 Contact NameClient::unregisterName(const ConstString& name) {
     ConstString np = getNamePart(name);
+    NameCache::invalidate(np);
     ConstString q("NAME_SERVER unregister ");
     q += np;
     return probe(q);
@@ -309,9 +309,15 @@ ConstString NameServer::cmdQuery(int argc, char *argv[]) {
     if (argc<1) {
         return "need at least one argument";
     }
-    ConstString portName = STR(argv[0]);
-    Contact address = queryName(portName);
-    return terminate(textify(address));
+    // several ports can be asked for at once, each registered one
+    // gets a line of its own
+    ConstString response = "";
+    for (int i=0; i<argc; i++) {
+        ConstString portName = STR(argv[i]);
+        Contact address = queryName(portName);
+        response += textify(address);
+    }
+    return terminate(response);
 }
 
 ConstString NameServer::cmdUnregister(int argc, char *argv[]) {
@@ -416,7 +422,7 @@ ConstString NameServer::cmdHelp(int argc, char *argv[]) {
     result += ConstString("+ register $portname $carrier $ipAddress $portNumber\n");
     result += ConstString("  (if you want a field set automatically, write '...')\n");
     result += ConstString("+ unregister $portname\n");
-    result += ConstString("+ query $portname\n");
+    result += ConstString("+ query $portname [$portname ...]\n");
     result += ConstString("+ set $portname $property $value\n");
     result += ConstString("+ get $portname $property\n");
     result += ConstString("+ check $portname $property\n");
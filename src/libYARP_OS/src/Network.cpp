@@ -25,12 +25,15 @@
 #include <yarp/os/impl/BufferedConnectionWriter.h>
 #include <yarp/os/impl/Companion.h>
 #include <yarp/os/impl/Logger.h>
+#include <yarp/os/impl/NameCache.h>
 #include <yarp/os/impl/NameClient.h>
 #include <yarp/os/impl/NameConfig.h>
 #include <yarp/os/impl/PlatformSignal.h>
 #include <yarp/os/impl/PlatformStdlib.h>
 #include <yarp/os/impl/PlatformStdio.h>
 #include <yarp/os/impl/PortCommand.h>
+#include <yarp/os/impl/PortCoreReactor.h>
+#include <yarp/os/impl/RateThreadExecutor.h>
 #include <yarp/os/impl/StreamConnectionReader.h>
 #include <yarp/os/impl/ThreadImpl.h>
 
@@ -40,8 +43,13 @@
 # include <ace/String_Base.h>
 #endif
 
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <map>
+
+// threads setting up connections for connectMany(), at most
+#define MAX_CONNECT_THREADS 8
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
@@ -109,6 +117,7 @@ static bool needsLookup(const Contact& contact)
 
 static int noteDud(const Contact& src)
 {
+    NameCache::invalidate(src.getName());
     NameStore *store = getNameSpace().getQueryBypass();
     if (store != YARP_NULLPTR) {
         return store->announce(src.getName().c_str(), 0);
@@ -274,10 +283,23 @@ static int enactConnection(const Contact& src,
 
 */
 
+static Contact lookupName(const ConstString& name,
+                          const std::map<ConstString, Contact> *known)
+{
+    if (known!=YARP_NULLPTR) {
+        std::map<ConstString, Contact>::const_iterator it = known->find(name);
+        if (it!=known->end()) {
+            return it->second;
+        }
+    }
+    return NetworkBase::queryName(name);
+}
+
 static int metaConnect(const ConstString& src,
                        const ConstString& dest,
                        ContactStyle style,
-                       int mode) {
+                       int mode,
+                       const std::map<ConstString, Contact> *known = YARP_NULLPTR) {
     YARP_SPRINTF3(Logger::get(), debug,
                   "working on connection %s to %s (%s)",
                   src.c_str(),
@@ -311,7 +333,7 @@ static int metaConnect(const ConstString& src,
     Contact staticSrc;
     Contact staticDest;
     if (needsLookup(dynamicSrc)&&(topicalNeedsLookup||!topical)) {
-        staticSrc = NetworkBase::queryName(dynamicSrc.getName());
+        staticSrc = lookupName(dynamicSrc.getName(), known);
         if (!staticSrc.isValid()) {
             if (!style.persistent) {
                 if (!style.quiet) {
@@ -334,7 +356,7 @@ static int metaConnect(const ConstString& src,
     }
 
     if (needsLookup(dynamicDest)&&(topicalNeedsLookup||!topical)) {
-        staticDest = NetworkBase::queryName(dynamicDest.getName());
+        staticDest = lookupName(dynamicDest.getName(), known);
         if (!staticDest.isValid()) {
             if (!style.persistent) {
                 if (!style.quiet) {
@@ -561,6 +583,181 @@ bool NetworkBase::disconnect(const ConstString& src,
     return result == 0;
 }
 
+
+/*
+
+   Set up many connections at once.
+
+   All the ports involved are looked up first, in a single query to the
+   name server when possible.  Routes are then grouped by source port,
+   since a port deals with the requests it is sent one at a time, and
+   the groups are shared among a few threads.
+
+*/
+
+namespace {
+
+class ConnectBatch
+{
+public:
+    ConnectBatch(const std::vector<Route>& routes,
+                 const ContactStyle& style,
+                 int mode) :
+            routes(routes),
+            style(style),
+            mode(mode),
+            result(routes.size(), 0),
+            next(0)
+    {
+    }
+
+    void work()
+    {
+        while (true) {
+            size_t index = next++;
+            if (index>=groups.size()) {
+                break;
+            }
+            const std::vector<size_t>& group = groups[index];
+            for (size_t i=0; i<group.size(); i++) {
+                const Route& route = routes[group[i]];
+                ContactStyle routeStyle = style;
+                if (route.getCarrierName()!="") {
+                    routeStyle.carrier = route.getCarrierName();
+                }
+                int code = metaConnect(route.getFromName(),
+                                       route.getToName(),
+                                       routeStyle,
+                                       mode,
+                                       &known);
+                result[group[i]] = (code==0) ? 1 : 0;
+            }
+        }
+    }
+
+    const std::vector<Route>& routes;
+    const ContactStyle& style;
+    int mode;
+    // not a vector<bool>, whose elements share words among threads
+    std::vector<char> result;
+    std::map<ConstString, Contact> known;
+    std::vector<std::vector<size_t> > groups;
+    std::atomic<size_t> next;
+};
+
+class ConnectWorker : public ThreadImpl
+{
+public:
+    ConnectWorker(ConnectBatch& batch) : batch(batch)
+    {
+    }
+
+    virtual void run() override
+    {
+        batch.work();
+    }
+
+private:
+    ConnectBatch& batch;
+};
+
+} // namespace
+
+
+static bool canQueryInBulk()
+{
+    // the name client should be talking to the same name server as
+    // the name space, and that name server should be remote
+    NameSpace& ns = getNameSpace();
+    if (ns.localOnly() || NetworkBase::getQueryBypass()!=YARP_NULLPTR) {
+        return false;
+    }
+    NameClient& nic = NameClient::getNameClient();
+    if (nic.isFakeMode()) {
+        return false;
+    }
+    Contact server = ns.getNameServerContact();
+    Contact address = nic.getAddress();
+    return server.isValid() &&
+        server.getHost()==address.getHost() &&
+        server.getPort()==address.getPort();
+}
+
+
+static std::vector<bool> metaConnectMany(const std::vector<Route>& routes,
+                                         const ContactStyle& style,
+                                         int mode)
+{
+    ConnectBatch batch(routes, style, mode);
+
+    // look up each port once
+    std::vector<ConstString> names;
+    std::map<ConstString, size_t> sources;
+    for (size_t i=0; i<routes.size(); i++) {
+        Contact ends[2] = { Contact::fromString(routes[i].getFromName()),
+                            Contact::fromString(routes[i].getToName()) };
+        for (int k=0; k<2; k++) {
+            ConstString name = ends[k].getName();
+            if (!needsLookup(ends[k]) || name=="" ||
+                name==NetworkBase::getNameServerName()) {
+                continue;
+            }
+            if (batch.known.find(name)==batch.known.end()) {
+                batch.known[name] = Contact();
+                names.push_back(name);
+            }
+        }
+        ConstString source = ends[0].getName();
+        std::map<ConstString, size_t>::iterator it = sources.find(source);
+        if (it==sources.end()) {
+            sources[source] = batch.groups.size();
+            batch.groups.push_back(std::vector<size_t>(1, i));
+        } else {
+            batch.groups[it->second].push_back(i);
+        }
+    }
+    if (canQueryInBulk()) {
+        std::vector<Contact> contacts = NameClient::getNameClient().queryNames(names);
+        for (size_t i=0; i<names.size(); i++) {
+            batch.known[names[i]] = contacts[i];
+        }
+    } else {
+        for (size_t i=0; i<names.size(); i++) {
+            batch.known[names[i]] = NetworkBase::queryName(names[i]);
+        }
+    }
+
+    size_t threads = batch.groups.size();
+    if (threads>MAX_CONNECT_THREADS) {
+        threads = MAX_CONNECT_THREADS;
+    }
+    std::vector<ConnectWorker *> workers;
+    for (size_t i=1; i<threads; i++) {
+        ConnectWorker *worker = new ConnectWorker(batch);
+        if (!worker->start()) {
+            delete worker;
+            break;
+        }
+        workers.push_back(worker);
+    }
+    batch.work();
+    for (size_t i=0; i<workers.size(); i++) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    return std::vector<bool>(batch.result.begin(), batch.result.end());
+}
+
+std::vector<bool> NetworkBase::connectMany(const std::vector<Route>& routes,
+                                           const ContactStyle& style) {
+    return metaConnectMany(routes, style, YARP_ENACT_CONNECT);
+}
+
+std::vector<bool> NetworkBase::disconnectMany(const std::vector<Route>& routes,
+                                              const ContactStyle& style) {
+    return metaConnectMany(routes, style, YARP_ENACT_DISCONNECT);
+}
+
 bool NetworkBase::isConnected(const ConstString& src,
                               const ConstString& dest,
                               bool quiet) {
@@ -674,6 +871,9 @@ void NetworkBase::initMinimum() {
 void NetworkBase::finiMinimum() {
     if (__yarp_is_initialized==1) {
         Time::useSystemClock();
+        NameCache::fini();
+        PortCoreReactor::fini();
+        RateThreadExecutor::fini();
         Carriers::removeInstance();
         NameClient::removeNameClient();
         removeNameSpace();
@@ -766,23 +966,36 @@ bool NetworkBase::setConnectionQos(const ConstString& src, const ConstString& de
                                    bool quiet) {
 
     //e.g.,  prop set /portname (sched ((priority 30) (policy 1))) (qos ((tos 0)))
+    //       prop set /portname (batch ((bytes 4096) (delay 0.005)))
     yarp::os::Bottle cmd, reply;
 
     // ignore if everything left as default
-    if (srcStyle.getPacketPriorityAsTOS()!=-1 || srcStyle.getThreadPolicy() !=-1) {
+    bool srcSched = (srcStyle.getPacketPriorityAsTOS()!=-1 || srcStyle.getThreadPolicy() !=-1);
+    bool srcBatch = (srcStyle.getMessageBatchSize()!=-1);
+    if (srcSched || srcBatch) {
         // set the source Qos
         cmd.addString("prop");
         cmd.addString("set");
         cmd.addString(dest.c_str());
-        Bottle& sched = cmd.addList();
-        sched.addString("sched");
-        Property& sched_prop = sched.addDict();
-        sched_prop.put("priority", srcStyle.getThreadPriority());
-        sched_prop.put("policy", srcStyle.getThreadPolicy());
-        Bottle& qos = cmd.addList();
-        qos.addString("qos");
-        Property& qos_prop = qos.addDict();
-        qos_prop.put("tos", srcStyle.getPacketPriorityAsTOS());
+        if (srcSched) {
+            Bottle& sched = cmd.addList();
+            sched.addString("sched");
+            Property& sched_prop = sched.addDict();
+            sched_prop.put("priority", srcStyle.getThreadPriority());
+            sched_prop.put("policy", srcStyle.getThreadPolicy());
+            Bottle& qos = cmd.addList();
+            qos.addString("qos");
+            Property& qos_prop = qos.addDict();
+            qos_prop.put("tos", srcStyle.getPacketPriorityAsTOS());
+        }
+        if (srcBatch) {
+            // batching only concerns the sending side
+            Bottle& batch = cmd.addList();
+            batch.addString("batch");
+            Property& batch_prop = batch.addDict();
+            batch_prop.put("bytes", srcStyle.getMessageBatchSize());
+            batch_prop.put("delay", srcStyle.getMessageBatchDelay());
+        }
         Contact srcCon = Contact::fromString(src);
         bool ret = write(srcCon, cmd, reply, true, true, 2.0);
         if (!ret) {
@@ -863,6 +1076,12 @@ static bool getPortQos(const ConstString& port, const ConstString& unit,
     Bottle& qos = reply.findGroup("qos");
     Bottle* qos_prop = qos.find("qos").asList();
     style.setPacketPrioritybyTOS(qos_prop->find("tos").asInt());
+    Bottle& batch = reply.findGroup("batch");
+    if (!batch.isNull()) {
+        Bottle* batch_prop = batch.find("batch").asList();
+        style.setMessageBatching(batch_prop->find("bytes").asInt(),
+                                 batch_prop->find("delay").asDouble());
+    }
 
     return true;
 }
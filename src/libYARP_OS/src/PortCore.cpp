@@ -1274,10 +1274,12 @@ bool PortCore::sendHelper(PortWriter& writer,
     int logCount = 0;
     ConstString envelopeString = envelope;
 
-    // Pass a message to all output units for sending on.  We could
-    // be doing more here to cache the serialization of the message
-    // and reuse it across output connections.  However, one key
-    // optimization is present: external blocks written by
+    // Pass a message to all output units for sending on.  When several
+    // output units send the plain binary form of the message, it is
+    // serialized only once (see PortCoreSharedContent) and the result
+    // is shared between them.  Units whose carrier modifies or reformats
+    // outgoing data serialize the original writer themselves.  In both
+    // cases, external blocks written by
     // yarp::os::ConnectionWriter::appendExternalBlock are never
     // copied.  So for example the core image array in a yarp::sig::Image
     // is untouched by the port communications code.
@@ -1311,6 +1313,25 @@ bool PortCore::sendHelper(PortWriter& writer,
     packet->setContent(&writer, false, callback);
     packetMutex.post();
 
+    // Check whether it is worth serializing the message just once.
+    int shareCount = 0;
+    for (unsigned int i=0; i<units.size(); i++) {
+        PortCoreUnit *unit = units[i];
+        if (unit==YARP_NULLPTR) continue;
+        if (unit->isOutput() && !unit->isFinished()) {
+            bool log = (unit->getMode()!="");
+            bool ok = (mode==PORTCORE_SEND_NORMAL)?(!log):(log);
+            if (ok && unit->canShareContent()) {
+                shareCount++;
+            }
+        }
+    }
+    PortWriter *sharedWriter = YARP_NULLPTR;
+    if (shareCount>1) {
+        // The packet is not yet visible to any unit, no need to lock.
+        sharedWriter = packet->getSharedContent();
+    }
+
     // Scan connections, placing message everyhere we can.
     for (unsigned int i=0; i<units.size(); i++) {
         PortCoreUnit *unit = units[i];
@@ -1323,6 +1344,9 @@ bool PortCore::sendHelper(PortWriter& writer,
             }
             bool ok = (mode==PORTCORE_SEND_NORMAL)?(!log):(log);
             if (!ok) continue;
+            PortWriter& unitWriter =
+                (sharedWriter!=YARP_NULLPTR && unit->canShareContent()) ?
+                (*sharedWriter) : writer;
             bool waiter = waitAfterSend||(mode==PORTCORE_SEND_LOG);
             YMSG(("------- -- inc\n"));
             packetMutex.wait();
@@ -1331,7 +1355,7 @@ bool PortCore::sendHelper(PortWriter& writer,
             YMSG(("------- -- presend\n"));
             bool gotReplyOne = false;
             // Send the message off on this connection.
-            void *out = unit->send(writer,
+            void *out = unit->send(unitWriter,
                                    reader,
                                    (callback!=YARP_NULLPTR)?callback:(&writer),
                                    (void *)packet,
@@ -1574,7 +1598,7 @@ bool PortCore::adminBlock(ConnectionReader& reader, void *id,
         result.addString("[prop] [set] $prop $val # set a user-defined port property (prop, val)");
         result.addString("[prop] [get] $portname  # get Qos properties of a connection to/from a port");
         result.addString("[prop] [set] $portname  # set Qos properties of a connection to/from a port");
-        result.addString("[prop] [get] $cur_port  # get information about current process (e.g., scheduling priority, pid)");
+        result.addString("[prop] [get] $cur_port  # get information about current process (e.g., scheduling priority, pid, memory pool usage)");
         result.addString("[prop] [set] $cur_port  # set properties of the current process (e.g., scheduling priority, pid)");
         result.addString("[atch] [out] $prop      # attach a portmonitor plug-in to the port's output");
         result.addString("[atch] [in]  $prop      # attach a portmonitor plug-in to the port's input");
@@ -2199,6 +2223,11 @@ bool PortCore::adminBlock(ConnectionReader& reader, void *id,
                                     port_prop.put("is_output", is_output);
                                     port_prop.put("is_rpc", is_rpc);
                                     port_prop.put("type", getType().getName());
+
+                                    Bottle& pool = result.addList();
+                                    pool.addString("pool");
+                                    Property& pool_prop = pool.addDict();
+                                    blockPool.getStats(pool_prop);
                                 }
                                 else {
                                     for (unsigned int i=0; i<units.size(); i++) {
@@ -2223,6 +2252,14 @@ bool PortCore::adminBlock(ConnectionReader& reader, void *id,
                                                 qos.addString("qos");
                                                 Property& qos_prop = qos.addDict();
                                                 qos_prop.put("tos", tos);
+                                                if (unit->isOutput()) {
+                                                    PortCoreOutputUnit* out = dynamic_cast<PortCoreOutputUnit*>(unit);
+                                                    Bottle& batch = result.addList();
+                                                    batch.addString("batch");
+                                                    Property& batch_prop = batch.addDict();
+                                                    batch_prop.put("bytes", (int)out->getBatchBytes());
+                                                    batch_prop.put("delay", out->getBatchDelay());
+                                                }
                                             }
                                         } // end isFinished()
                                     } // end for loop
@@ -2375,6 +2412,36 @@ bool PortCore::adminBlock(ConnectionReader& reader, void *id,
                                 }
                             }
                         }
+
+                        // check if we need to batch small messages sent
+                        // on an output connection
+                        // e.g., "prop set /portname (batch ((bytes 4096) (delay 0.005)))"
+                        Bottle& batch = cmd.findGroup("batch");
+                        if (!batch.isNull())
+                        {
+                            if ((cmd.get(2).asString().size() > 0) && (cmd.get(2).asString()[0] == '/')) {
+                                bOk = false;
+                                for (unsigned int i=0; i<units.size(); i++) {
+                                    PortCoreUnit *unit = units[i];
+                                    if (unit && !unit->isFinished() && unit->isOutput()) {
+                                        Route route = unit->getRoute();
+                                        if (route.getToName() == cmd.get(2).asString()) {
+                                            Bottle* batch_prop = batch.find("batch").asList();
+                                            if (batch_prop != YARP_NULLPTR) {
+                                                int bytes = batch_prop->find("bytes").asInt();
+                                                double delay = batch_prop->find("delay").asDouble();
+                                                if (bytes >= 0) {
+                                                    PortCoreOutputUnit* out = dynamic_cast<PortCoreOutputUnit*>(unit);
+                                                    out->setBatching((size_t)bytes, delay);
+                                                    bOk = true;
+                                                }
+                                            }
+                                            break;
+                                        }
+                                    }
+                                }
+                            }
+                        }
                     }
                     releaseProperties(p);
                     result.addVocab((bOk) ? Vocab::encode("ok") : Vocab::encode("fail"));
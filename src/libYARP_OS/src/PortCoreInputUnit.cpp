@@ -9,12 +9,17 @@
 #include <yarp/os/Name.h>
 #include <yarp/os/PortReport.h>
 #include <yarp/os/PortInfo.h>
+#include <yarp/os/ShiftStream.h>
+#include <yarp/os/StringInputStream.h>
 #include <yarp/os/Time.h>
 
 #include <yarp/os/impl/BufferedConnectionWriter.h>
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/PlatformSignal.h>
 #include <yarp/os/impl/PortCommand.h>
+#include <yarp/os/impl/PortCoreReactor.h>
+#include <yarp/os/impl/SocketTwoWayStream.h>
+#include <yarp/os/impl/StreamConnectionReader.h>
 
 #include <cstdio>
 
@@ -39,6 +44,20 @@ bool PortCoreInputUnit::start() {
     }
     */
 
+    if (!reversed) {
+        reactor = PortCoreReactor::get();
+        if (reactor!=YARP_NULLPTR) {
+            // the reactor completes the connection once its header arrives
+            int handle = getReactorHandle();
+            if (handle>=0 && reactor->add(this, handle)) {
+                YARP_DEBUG(Logger::get(), ConstString("new input connection to ")+
+                           getOwner().getName()+ " served by the port reactor");
+                return true;
+            }
+            reactor = YARP_NULLPTR;
+        }
+    }
+
     phase.wait();
 
     bool result = PortCoreUnit::start();
@@ -62,16 +81,23 @@ void PortCoreInputUnit::run() {
     running = true;
     phase.post();
 
-    Route route;
-    bool wasNoticed = false;
-    bool posted = false;
+    bool done = false;
+    if (!opened) {
+        done = !openInput();
+    }
+    while (!done) {
+        done = !readInput();
+    }
+    closeInput();
+}
+
 
+bool PortCoreInputUnit::openInput() {
+    opened = true;
     bool done = false;
 
     yAssert(ip!=YARP_NULLPTR);
 
-    PortCommand cmd;
-
     bool ok = true;
     if (!reversed) {
         ip->open(getName().c_str());
@@ -150,118 +176,116 @@ void PortCoreInputUnit::run() {
         done = true;
     }
 
-    void *id = (void *)this;
-
     if (ip!=YARP_NULLPTR && !ip->getConnection().canEscape()) {
         InputStream *is = &ip->getInputStream();
         is->setReadEnvelopeCallback(envelopeReadCallback, this);
     }
 
-    while (!done) {
-        if(!ip) break;
-        ConnectionReader& br = ip->beginRead();
-
-        if (br.getReference()!=YARP_NULLPTR) {
-            //printf("HAVE A REFERENCE\n");
-            if (localReader!=YARP_NULLPTR) {
-                bool ok = localReader->read(br);
-                if (!br.isActive()) { break; }
-                if (!ok) continue;
-            } else {
-                PortManager& man = getOwner();
-                bool ok = man.readBlock(br, id, YARP_NULLPTR);
-                if (!br.isActive()) { break; }
-                if (!ok) continue;
-            }
-            //printf("DONE WITH A REFERENCE\n");
-            if (ip!=YARP_NULLPTR) {
-                ip->endRead();
-            }
-            continue;
-        }
+    return !done;
+}
+
 
-        if (ip->getConnection().canEscape()) {
-            bool ok = cmd.read(br);
-            if (!br.isActive()) { break; }
-            if (!ok) continue;
+bool PortCoreInputUnit::readInput() {
+    if (!ip) {
+        return false;
+    }
+    bool done = false;
+    void *id = (void *)this;
+    ConnectionReader& br = ip->beginRead();
+
+    if (br.getReference()!=YARP_NULLPTR) {
+        //printf("HAVE A REFERENCE\n");
+        if (localReader!=YARP_NULLPTR) {
+            bool ok = localReader->read(br);
+            if (!br.isActive()) { return false; }
+            if (!ok) { return true; }
         } else {
-            cmd = PortCommand('d', "");
-            if (!ip->isOk()) { break; }
+            PortManager& man = getOwner();
+            bool ok = man.readBlock(br, id, YARP_NULLPTR);
+            if (!br.isActive()) { return false; }
+            if (!ok) { return true; }
         }
-
-        if (closing||isDoomed()) {
-            break;
+        //printf("DONE WITH A REFERENCE\n");
+        if (ip!=YARP_NULLPTR) {
+            ip->endRead();
         }
-        char key = cmd.getKey();
-        //printf("Port command is [%c:%d/%s]\n",
-        //         (key>=32)?key:'?', key, cmd.getText().c_str());
+        return true;
+    }
 
-        PortManager& man = getOwner();
-        OutputStream *os = YARP_NULLPTR;
-        if (br.isTextMode()) {
-            os = &(ip->getOutputStream());
-        }
+    if (ip->getConnection().canEscape()) {
+        bool ok = cmd.read(br);
+        if (!br.isActive()) { return false; }
+        if (!ok) { return true; }
+    } else {
+        cmd = PortCommand('d', "");
+        if (!ip->isOk()) { return false; }
+    }
 
-        switch (key) {
-        case '/':
-            YARP_SPRINTF3(Logger::get(),
-                          debug,
-                          "Port command (%s): %s should add connection: %s",
-                          route.toString().c_str(),
-                          getOwner().getName().c_str(),
-                          cmd.getText().c_str());
-            man.addOutput(cmd.getText(), id, os);
-            break;
-        case '!':
-            YARP_SPRINTF3(Logger::get(),
-                          debug,
-                          "Port command (%s): %s should remove output: %s",
-                          route.toString().c_str(),
-                          getOwner().getName().c_str(),
-                          cmd.getText().c_str());
-            man.removeOutput(cmd.getText().substr(1, ConstString::npos), id, os);
-            break;
-        case '~':
-            YARP_SPRINTF3(Logger::get(),
-                          debug,
-                          "Port command (%s): %s should remove input: %s",
-                          route.toString().c_str(),
-                          getOwner().getName().c_str(),
-                          cmd.getText().c_str());
-            man.removeInput(cmd.getText().substr(1, ConstString::npos), id, os);
-            break;
-        case '*':
-            man.describe(id, os);
-            break;
-        case 'D':
-        case 'd':
-            {
-                if (key=='D') {
-                    ip->suppressReply();
-                }
+    if (closing||isDoomed()) {
+        return false;
+    }
+
+    char key = cmd.getKey();
+    //printf("Port command is [%c:%d/%s]\n",
+    //         (key>=32)?key:'?', key, cmd.getText().c_str());
+
+    PortManager& man = getOwner();
+    OutputStream *os = YARP_NULLPTR;
+    if (br.isTextMode()) {
+        os = &(ip->getOutputStream());
+    }
 
-                ConstString env = cmd.getText();
+    switch (key) {
+    case '/':
+        YARP_SPRINTF3(Logger::get(),
+                      debug,
+                      "Port command (%s): %s should add connection: %s",
+                      route.toString().c_str(),
+                      getOwner().getName().c_str(),
+                      cmd.getText().c_str());
+        man.addOutput(cmd.getText(), id, os);
+        break;
+    case '!':
+        YARP_SPRINTF3(Logger::get(),
+                      debug,
+                      "Port command (%s): %s should remove output: %s",
+                      route.toString().c_str(),
+                      getOwner().getName().c_str(),
+                      cmd.getText().c_str());
+        man.removeOutput(cmd.getText().substr(1, ConstString::npos), id, os);
+        break;
+    case '~':
+        YARP_SPRINTF3(Logger::get(),
+                      debug,
+                      "Port command (%s): %s should remove input: %s",
+                      route.toString().c_str(),
+                      getOwner().getName().c_str(),
+                      cmd.getText().c_str());
+        man.removeInput(cmd.getText().substr(1, ConstString::npos), id, os);
+        break;
+    case '*':
+        man.describe(id, os);
+        break;
+    case 'D':
+    case 'd':
+        {
+            if (key=='D') {
+                ip->suppressReply();
+            }
+
+            ConstString env = cmd.getText();
 #ifndef YARP_NO_DEPRECATED // since YARP 2.3.68
-                bool suppressed = false;
-                if (env.length()>1) {
-                    if (!suppressed) {
-                        // This is the backwards-compatible
-                        // method for signalling replies are
-                        // not expected.  To be used until
-                        // YARP 2.1.2 is a "long time ago".
-                        if (env[1]=='o') {
-                            ip->suppressReply();
-                        }
-                    }
-                    if (env.length()>2) {
-                        //YARP_ERROR(Logger::get(),
-                        //"***** received an envelope! [%s]", env.c_str());
-                        ConstString env2 = env.substr(2, env.length());
-                        man.setEnvelope(env2);
-                        ip->setEnvelope(env2);
+            bool suppressed = false;
+            if (env.length()>1) {
+                if (!suppressed) {
+                    // This is the backwards-compatible
+                    // method for signalling replies are
+                    // not expected.  To be used until
+                    // YARP 2.1.2 is a "long time ago".
+                    if (env[1]=='o') {
+                        ip->suppressReply();
                     }
                 }
-#else // YARP_NO_DEPRECATED
                 if (env.length()>2) {
                     //YARP_ERROR(Logger::get(),
                     //"***** received an envelope! [%s]", env.c_str());
@@ -269,114 +293,127 @@ void PortCoreInputUnit::run() {
                     man.setEnvelope(env2);
                     ip->setEnvelope(env2);
                 }
-#endif // YARP_NO_DEPRECATED
-                if (localReader) {
-                    localReader->read(br);
-                    if (!br.isActive()) { done = true; break; }
-                } else {
-                    if (ip->getReceiver().acceptIncomingData(br)) {
-                        ConnectionReader* cr = &(ip->getReceiver().modifyIncomingData(br));
-                        yarp::os::impl::PortDataModifier& modifier = getOwner().getPortModifier();
-                        modifier.inputMutex.lock();
-                        if (modifier.inputModifier) {
-                            if (modifier.inputModifier->acceptIncomingData(*cr)) {
-                                cr = &(modifier.inputModifier->modifyIncomingData(*cr));
-                                modifier.inputMutex.unlock();
-                                man.readBlock(*cr, id, os);
-                            }
-                            else {
-                                modifier.inputMutex.unlock();
-                                skipIncomingData(*cr);
-                            }
-                        }
-                        else {
-                            modifier.inputMutex.unlock();
-                            man.readBlock(*cr, id, os);
-                        }
-                    }
-                    else
-                        skipIncomingData(br);
-                    if (!br.isActive()) { done = true; break; }
-                }
             }
-            break;
-        case 'a':
-            {
-                man.adminBlock(br, id, os);
+#else // YARP_NO_DEPRECATED
+            if (env.length()>2) {
+                //YARP_ERROR(Logger::get(),
+                //"***** received an envelope! [%s]", env.c_str());
+                ConstString env2 = env.substr(2, env.length());
+                man.setEnvelope(env2);
+                ip->setEnvelope(env2);
             }
-            break;
-        case 'r':
-            /*
-              In YARP implementation, OP=IP.
-              (This information is used rarely, and when used
-              is tagged with OP=IP keyword)
-              If it were not true, memory alloc would need to
-              reorganized here
-            */
-            {
-                OutputProtocol *op = &(ip->getOutput());
-                ip->endRead();
-                Route r = op->getRoute();
-                // reverse route
-                r.swapNames();
-                op->rename(r);
-
-                getOwner().addOutput(op);
-                ip = YARP_NULLPTR;
-                done = true;
+#endif // YARP_NO_DEPRECATED
+            readData(br, id, os);
+            if (!br.isActive()) { done = true; break; }
+        }
+        break;
+    case 'b':
+        {
+            ip->suppressReply();
+            if (!readBatch(br, id, os)) {
+                YARP_SPRINTF1(Logger::get(),
+                              error,
+                              "Port command (%s): malformed batch of messages",
+                              route.toString().c_str());
+                skipIncomingData(br);
             }
-            break;
-        case 'q':
+            if (!br.isActive()) { done = true; break; }
+        }
+        break;
+    case 'a':
+        {
+            man.adminBlock(br, id, os);
+        }
+        break;
+    case 'r':
+        /*
+          In YARP implementation, OP=IP.
+          (This information is used rarely, and when used
+          is tagged with OP=IP keyword)
+          If it were not true, memory alloc would need to
+          reorganized here
+        */
+        {
+            OutputProtocol *op = &(ip->getOutput());
+            ip->endRead();
+            Route r = op->getRoute();
+            // reverse route
+            r.swapNames();
+            op->rename(r);
+
+            getOwner().addOutput(op);
+            ip = YARP_NULLPTR;
             done = true;
-            break;
+        }
+        break;
+    case 'q':
+        done = true;
+        break;
 #if !defined(NDEBUG)
-        case 'i':
-            printf("Interrupt requested\n");
-            //yarp::os::impl::kill(0, 2); // SIGINT
-            //yarp::os::impl::kill(Logger::get().getPid(), 2); // SIGINT
-            yarp::os::impl::kill(Logger::get().getPid(), 15); // SIGTERM
-            break;
+    case 'i':
+        printf("Interrupt requested\n");
+        //yarp::os::impl::kill(0, 2); // SIGINT
+        //yarp::os::impl::kill(Logger::get().getPid(), 2); // SIGINT
+        yarp::os::impl::kill(Logger::get().getPid(), 15); // SIGTERM
+        break;
 #endif
-        case '?':
-        case 'h':
-            if (os!=YARP_NULLPTR) {
-                BufferedConnectionWriter bw(true);
-                bw.appendLine("This is a YARP port.  Here are the commands it responds to:");
-                bw.appendLine("*       Gives a description of this port");
-                bw.appendLine("d       Signals the beginning of input for the port's owner");
-                bw.appendLine("do      The same as \"d\" except replies should be suppressed (\"data-only\")");
-                bw.appendLine("q       Disconnects");
+    case '?':
+    case 'h':
+        if (os!=YARP_NULLPTR) {
+            BufferedConnectionWriter bw(true);
+            bw.appendLine("This is a YARP port.  Here are the commands it responds to:");
+            bw.appendLine("*       Gives a description of this port");
+            bw.appendLine("d       Signals the beginning of input for the port's owner");
+            bw.appendLine("do      The same as \"d\" except replies should be suppressed (\"data-only\")");
+            bw.appendLine("b       Signals a batch of data messages, sent together");
+            bw.appendLine("q       Disconnects");
 #if !defined(NDEBUG)
-                bw.appendLine("i       Interrupt parent process (unix only)");
+            bw.appendLine("i       Interrupt parent process (unix only)");
 #endif
-                bw.appendLine("r       Reverse connection type to be a reader");
-                bw.appendLine("/port   Requests to send output to /port");
-                bw.appendLine("!/port  Requests to stop sending output to /port");
-                bw.appendLine("~/port  Requests to stop receiving input from /port");
-                bw.appendLine("a       Signals the beginning of an administrative message");
-                bw.appendLine("?       Gives this help");
-                bw.write(*os);
-            }
-            break;
-        default:
-            if (os!=YARP_NULLPTR) {
-                BufferedConnectionWriter bw(true);
-                bw.appendLine("Port command not understood.");
-                bw.appendLine("Type d to send data to the port's owner.");
-                bw.appendLine("Type ? for help.");
-                bw.write(*os);
-            }
-            break;
+            bw.appendLine("r       Reverse connection type to be a reader");
+            bw.appendLine("/port   Requests to send output to /port");
+            bw.appendLine("!/port  Requests to stop sending output to /port");
+            bw.appendLine("~/port  Requests to stop receiving input from /port");
+            bw.appendLine("a       Signals the beginning of an administrative message");
+            bw.appendLine("?       Gives this help");
+            bw.write(*os);
         }
-        if (ip!=YARP_NULLPTR) {
-            ip->endRead();
-        }
-        if (ip==YARP_NULLPTR) {
-            break;
+        break;
+    default:
+        if (os!=YARP_NULLPTR) {
+            BufferedConnectionWriter bw(true);
+            bw.appendLine("Port command not understood.");
+            bw.appendLine("Type d to send data to the port's owner.");
+            bw.appendLine("Type ? for help.");
+            bw.write(*os);
         }
-        if (closing||isDoomed()||(!ip->isOk())) {
-            break;
+        break;
+    }
+    if (ip!=YARP_NULLPTR) {
+        ip->endRead();
+    }
+    if (ip==YARP_NULLPTR) {
+        return false;
+    }
+    if (closing||isDoomed()||(!ip->isOk())) {
+        return false;
+    }
+    return !done;
+}
+
+
+void PortCoreInputUnit::closeInput() {
+    if (!opened) {
+        // never got as far as being announced
+        setDoomed();
+        access.wait();
+        if (ip!=YARP_NULLPTR) {
+            ip->close();
         }
+        access.post();
+        running = false;
+        finished = true;
+        return;
     }
 
     setDoomed();
@@ -437,6 +474,11 @@ bool PortCoreInputUnit::interrupt() {
     // give a kick (unfortunately unavoidable)
     access.wait();
     if (!closing) {
+        if (reactor!=YARP_NULLPTR) {
+            // the socket has to leave the reactor before it is closed
+            reactor->detach(this);
+            setDoomed();
+        }
         if (ip!=YARP_NULLPTR) {
             ip->interrupt();
         }
@@ -455,6 +497,17 @@ void PortCoreInputUnit::closeMain() {
 
     YARP_DEBUG(log, "PortCoreInputUnit closing");
 
+    if (reactor!=YARP_NULLPTR) {
+        if (!finished) {
+            interrupt();
+        }
+        if (reactor->remove(this)) {
+            // no reactor thread was serving this input, wrap it up here
+            closeInput();
+        }
+        reactor = YARP_NULLPTR;
+    }
+
     if (running) {
         YARP_DEBUG(log, "PortCoreInputUnit joining");
         interrupt();
@@ -472,6 +525,70 @@ void PortCoreInputUnit::closeMain() {
 }
 
 
+bool PortCoreInputUnit::serve() {
+    if (!opened) {
+        if (!openInput()) {
+            return false;
+        }
+        if (getReactorHandle()<0) {
+            // not a plain tcp connection after all
+            handOff = true;
+            return false;
+        }
+        return true;
+    }
+    return readInput();
+}
+
+
+void PortCoreInputUnit::release() {
+    if (handOff && !closing) {
+        handOff = false;
+        YARP_DEBUG(Logger::get(), ConstString("input connection to ")+
+                   getOwner().getName()+ " moving to a thread of its own");
+        running = true;
+        if (PortCoreUnit::start()) {
+            return;
+        }
+        running = false;
+    }
+    closeInput();
+}
+
+
+int PortCoreInputUnit::getReactorHandle() {
+    if (ip==YARP_NULLPTR) {
+        return -1;
+    }
+    if (opened) {
+        // only binary tcp carriers, which read exactly one message at a
+        // time from the socket
+        Connection& con = ip->getConnection();
+        if (!con.isPush() || con.isTextMode()) {
+            return -1;
+        }
+        ConstString carrier = con.getName();
+        if (carrier!="tcp" && carrier!="fast_tcp") {
+            return -1;
+        }
+    }
+    ConnectionState *state = dynamic_cast<ConnectionState*>(ip);
+    if (state==YARP_NULLPTR) {
+        return -1;
+    }
+    TwoWayStream *stream = &state->getStreams();
+    ShiftStream *shift = dynamic_cast<ShiftStream*>(stream);
+    if (shift!=YARP_NULLPTR) {
+        stream = shift->getStream();
+    }
+    SocketTwoWayStream *socket = dynamic_cast<SocketTwoWayStream*>(stream);
+    if (socket==YARP_NULLPTR) {
+        return -1;
+    }
+    return socket->getHandle();
+}
+
+
 Route PortCoreInputUnit::getRoute() {
     return officialRoute;
 }
@@ -492,6 +609,83 @@ bool PortCoreInputUnit::skipIncomingData(yarp::os::ConnectionReader& reader) {
 }
 
 
+void PortCoreInputUnit::readData(yarp::os::ConnectionReader& reader,
+                                 void *id,
+                                 yarp::os::OutputStream *os) {
+    if (localReader) {
+        localReader->read(reader);
+        return;
+    }
+    if (!ip->getReceiver().acceptIncomingData(reader)) {
+        skipIncomingData(reader);
+        return;
+    }
+    PortManager& man = getOwner();
+    ConnectionReader* cr = &(ip->getReceiver().modifyIncomingData(reader));
+    yarp::os::impl::PortDataModifier& modifier = getOwner().getPortModifier();
+    modifier.inputMutex.lock();
+    if (modifier.inputModifier) {
+        if (modifier.inputModifier->acceptIncomingData(*cr)) {
+            cr = &(modifier.inputModifier->modifyIncomingData(*cr));
+            modifier.inputMutex.unlock();
+            man.readBlock(*cr, id, os);
+        }
+        else {
+            modifier.inputMutex.unlock();
+            skipIncomingData(*cr);
+        }
+    }
+    else {
+        modifier.inputMutex.unlock();
+        man.readBlock(*cr, id, os);
+    }
+}
+
+
+bool PortCoreInputUnit::readBatch(yarp::os::ConnectionReader& reader,
+                                  void *id,
+                                  yarp::os::OutputStream *os) {
+    // the batch is a count, then for each message the length of its
+    // envelope, the envelope, the length of its data, and the data
+    PortManager& man = getOwner();
+    int count = reader.expectInt();
+    if (count<0 || reader.isError()) {
+        return false;
+    }
+    for (int i=0; i<count; i++) {
+        int envLen = reader.expectInt();
+        if (envLen<0 || (size_t)envLen>reader.getSize()) {
+            return false;
+        }
+        ConstString env(envLen, 0);
+        if (envLen>0 && !reader.expectBlock((char*)env.c_str(), envLen)) {
+            return false;
+        }
+        man.setEnvelope(env);
+        ip->setEnvelope(env);
+
+        int len = reader.expectInt();
+        if (len<0 || (size_t)len>reader.getSize()) {
+            return false;
+        }
+        ConstString data(len, 0);
+        if (len>0 && !reader.expectBlock((char*)data.c_str(), len)) {
+            return false;
+        }
+        StringInputStream sis;
+        sis.add(data);
+        StreamConnectionReader sub;
+        sub.reset(sis, YARP_NULLPTR, ip->getRoute(), len, false);
+        sub.setParentConnectionReader(&reader);
+        readData(sub, id, os);
+        if (!reader.isActive()) {
+            break;
+        }
+    }
+    return true;
+}
+
+
 bool PortCoreInputUnit::isBusy() {
     bool busy = false;
     access.wait();
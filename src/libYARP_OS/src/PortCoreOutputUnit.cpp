@@ -6,9 +6,11 @@
 
 
 #include <yarp/os/Time.h>
+#include <yarp/os/NetType.h>
 #include <yarp/os/Portable.h>
 #include <yarp/os/PortReport.h>
 #include <yarp/os/PortInfo.h>
+#include <yarp/os/SystemClock.h>
 #include <yarp/os/impl/PortCoreOutputUnit.h>
 #include <yarp/os/impl/PortCommand.h>
 #include <yarp/os/impl/Logger.h>
@@ -16,10 +18,15 @@
 #include <yarp/os/Name.h>
 #include <yarp/os/impl/Companion.h>
 
+#include <cstdlib>
+
 
 #define YMSG(x) printf x;
 #define YTRACE(x) YMSG(("at %s\n", x))
 
+// How long a message may be held back in a batch, unless set otherwise.
+#define PORTCORE_BATCH_DEFAULT_DELAY 0.005
+
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
@@ -63,10 +70,17 @@ void PortCoreOutputUnit::run() {
         Logger log(r.toString().c_str(), Logger::get());
         while (!closing) {
             YARP_DEBUG(log, "PortCoreOutputUnit waiting");
-            activate.wait();
+            if (!waitForActivity()) {
+                flushBatch();
+                continue;
+            }
             YARP_DEBUG(log, "PortCoreOutputUnit woken");
             if (!closing) {
-                if (sending) {
+                trackerMutex.wait();
+                bool work = sending && queued;
+                queued = false;
+                trackerMutex.post();
+                if (work) {
                     YARP_DEBUG(log, "write something in background");
                     sendHelper();
                     YARP_DEBUG(log, "wrote something in background");
@@ -97,6 +111,15 @@ void PortCoreOutputUnit::runSingleThreaded() {
     if (op != YARP_NULLPTR) {
         Route route = op->getRoute();
         setMode();
+
+        Name name(route.getCarrierName() + "://test");
+        ConstString batchValue = name.getCarrierModifier("batch");
+        if (batchValue!="") {
+            ConstString delayValue = name.getCarrierModifier("batchdelay");
+            setBatching((size_t)NetType::toInt(batchValue),
+                        (delayValue!="") ? atof(delayValue.c_str()) : 0);
+        }
+
         getOwner().reportUnit(this, true);
 
         ConstString msg = ConstString("Sending output from ") +
@@ -130,6 +153,11 @@ void PortCoreOutputUnit::runSingleThreaded() {
 void PortCoreOutputUnit::closeBasic() {
     bool waitForOther = false;
     if (op != YARP_NULLPTR) {
+        batchMutex.wait();
+        if (batchCount>0) {
+            writeBatch();
+        }
+        batchMutex.post();
         op->getConnection().prepareDisconnect();
         Route route = op->getRoute();
         if (op->getConnection().isConnectionless()||
@@ -144,6 +172,7 @@ void PortCoreOutputUnit::closeBasic() {
             if (op->getConnection().canEscape()) {
                 BufferedConnectionWriter buf(op->getConnection().isTextMode(),
                                              op->getConnection().isBareMode());
+                buf.setBlockPool(&getOwner().getBlockPool());
                 PortCommand pc('\0', ConstString("q"));
                 pc.write(buf);
                 //printf("Asked for %s to close...\n",
@@ -199,6 +228,14 @@ void PortCoreOutputUnit::closeMain() {
     YARP_DEBUG(Logger::get(), "PortCoreOutputUnit closing");
 
     if (running) {
+        // send anything held back, unless a write is stuck
+        if (batchMutex.check()) {
+            if (batchCount>0) {
+                writeBatch();
+            }
+            batchMutex.post();
+        }
+
         // give a kick (unfortunately unavoidable)
 
         if (op != YARP_NULLPTR) {
@@ -235,8 +272,10 @@ bool PortCoreOutputUnit::sendHelper() {
     bool replied = false;
     if (op != YARP_NULLPTR) {
         bool done = false;
+        bool batched = false;
         BufferedConnectionWriter buf(op->getConnection().isTextMode(),
                                      op->getConnection().isBareMode());
+        buf.setBlockPool(&getOwner().getBlockPool());
         if (cachedReader != YARP_NULLPTR) {
             buf.setReplyHandler(*cachedReader);
         }
@@ -268,6 +307,11 @@ bool PortCoreOutputUnit::sendHelper() {
                     if (cachedEnvelope!="") {
                         op->getConnection().handleEnvelope(cachedEnvelope);
                     }
+                } else if (batchBytes>0 && suppressReply &&
+                           cachedEnvelope!="__ADMIN" &&
+                           !buf.isTextMode() && !buf.isBareMode()) {
+                    // no header, this message goes in a batch
+                    batched = true;
                 } else {
                     buf.addToHeader();
 
@@ -288,12 +332,22 @@ bool PortCoreOutputUnit::sendHelper() {
         }
 
         if (!done) {
-            if (op->getConnection().isActive()) {
+            batchMutex.wait();
+            if (batched) {
+                if (!addToBatch(buf)) {
+                    done = true;
+                }
+            } else if (op->getConnection().isActive()) {
+                // keep messages in order
+                if (batchCount>0) {
+                    writeBatch();
+                }
                 replied = op->write(buf);
                 if (replied && op->getSender().modifiesReply() && cachedReader != YARP_NULLPTR) {
                     cachedReader = &op->getSender().modifyReply(*cachedReader);
                 }
             }
+            batchMutex.post();
             if (!op->isOk()) {
                 done = true;
             }
@@ -330,7 +384,7 @@ void *PortCoreOutputUnit::send(yarp::os::PortWriter& writer,
         }
     }
 
-    if (!waitBefore || !waitAfter) {
+    if (!waitBefore || !waitAfter || batchBytes>0) {
         if (running == false) {
             // we must have a thread if we're going to be skipping waits
             threaded = true;
@@ -358,6 +412,7 @@ void *PortCoreOutputUnit::send(yarp::os::PortWriter& writer,
             void *nextTracker = tracker;
             tracker = cachedTracker;
             cachedTracker = nextTracker;
+            queued = true;
             activate.post();
             trackerMutex.post();
         }
@@ -391,3 +446,107 @@ void *PortCoreOutputUnit::takeTracker() {
 bool PortCoreOutputUnit::isBusy() {
     return sending;
 }
+
+bool PortCoreOutputUnit::canShareContent() {
+    if (op == YARP_NULLPTR) {
+        return false;
+    }
+    Connection& con = op->getConnection();
+    return con.canEscape() &&
+        !con.isLocal() &&
+        !con.isTextMode() &&
+        !con.isBareMode() &&
+        !op->getSender().modifiesOutgoingData();
+}
+
+void PortCoreOutputUnit::setBatching(size_t maxBytes, double maxDelay) {
+    batchMutex.wait();
+    if (batchCount>0) {
+        writeBatch();
+    }
+    batch.setBlockPool(&getOwner().getBlockPool());
+    batchBytes = maxBytes;
+    batchDelay = (maxDelay>0) ? maxDelay : PORTCORE_BATCH_DEFAULT_DELAY;
+    batchMutex.post();
+}
+
+bool PortCoreOutputUnit::waitForActivity() {
+    batchMutex.wait();
+    bool pending = (batchCount>0);
+    double left = batchStart + batchDelay - SystemClock::nowSystem();
+    batchMutex.post();
+    if (!pending) {
+        activate.wait();
+        return true;
+    }
+    if (left<=0) {
+        return false;
+    }
+    return activate.waitWithTimeout(left);
+}
+
+bool PortCoreOutputUnit::addToBatch(BufferedConnectionWriter& buf) {
+    // each message is framed as: envelope length, envelope, data
+    // length, data; the data is copied since the writer may change
+    // as soon as we return
+    batch.appendInt((int)cachedEnvelope.length());
+    if (cachedEnvelope.length()>0) {
+        batch.appendBlockCopy(Bytes((char*)cachedEnvelope.c_str(),
+                                    cachedEnvelope.length()));
+    }
+    size_t len = buf.dataSize();
+    batch.appendInt((int)len);
+    for (size_t i=0; i<buf.length(); i++) {
+        if (buf.length(i)>0) {
+            batch.appendBlockCopy(Bytes((char*)buf.data(i), buf.length(i)));
+        }
+    }
+    batchSize += 2*sizeof(NetInt32) + cachedEnvelope.length() + len;
+    batchCount++;
+    if (batchCount==1) {
+        batchStart = SystemClock::nowSystem();
+        if (running) {
+            // let the sending thread know when to flush
+            activate.post();
+        }
+    }
+    if (batchSize>=batchBytes) {
+        return writeBatch();
+    }
+    return true;
+}
+
+bool PortCoreOutputUnit::writeBatch() {
+    BufferedConnectionWriter out;
+    out.setBlockPool(&getOwner().getBlockPool());
+    out.appendInt(batchCount);
+    for (size_t i=0; i<batch.length(); i++) {
+        if (batch.length(i)>0) {
+            out.appendBlock(Bytes((char*)batch.data(i), batch.length(i)));
+        }
+    }
+    out.addToHeader();
+    PortCommand pc('b', "");
+    pc.write(out);
+    if (op->getConnection().isActive()) {
+        op->write(out);
+    }
+    batch.restart();
+    batchCount = 0;
+    batchSize = 0;
+    return op->isOk();
+}
+
+void PortCoreOutputUnit::flushBatch() {
+    bool ok = true;
+    batchMutex.wait();
+    if (batchCount>0 && op != YARP_NULLPTR &&
+        SystemClock::nowSystem()>=batchStart+batchDelay) {
+        ok = writeBatch();
+    }
+    batchMutex.post();
+    if (!ok) {
+        closing = true;
+        setDoomed();
+    }
+}
@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/os/impl/PortCoreReactor.h>
+
+#include <yarp/os/LockGuard.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/NetType.h>
+#include <yarp/os/impl/Logger.h>
+#include <yarp/os/impl/PortCoreInputUnit.h>
+#include <yarp/os/impl/ThreadImpl.h>
+
+#if defined(__linux__)
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#  include <unistd.h>
+#  include <cerrno>
+#endif
+
+using namespace yarp::os::impl;
+using namespace yarp::os;
+
+// epoll key of the descriptor used to stop the workers
+#define REACTOR_STOP_KEY 0
+
+static yarp::os::Mutex reactorMutex;
+static PortCoreReactor *reactorInstance = YARP_NULLPTR;
+static int reactorThreads = -1;
+
+
+class PortCoreReactor::Worker : public ThreadImpl
+{
+public:
+    Worker(PortCoreReactor& owner) : owner(owner)
+    {
+    }
+
+    virtual void run() override
+    {
+        owner.work();
+    }
+
+private:
+    PortCoreReactor& owner;
+};
+
+
+static int getConfiguredThreads()
+{
+    if (reactorThreads<0) {
+        ConstString threads = NetworkBase::getEnvironment("YARP_PORT_REACTOR");
+        reactorThreads = (threads!="") ? NetType::toInt(threads) : 0;
+        if (reactorThreads<0) {
+            reactorThreads = 0;
+        }
+    }
+    return reactorThreads;
+}
+
+
+PortCoreReactor *PortCoreReactor::get()
+{
+#if defined(__linux__)
+    LockGuard guard(reactorMutex);
+    int threads = getConfiguredThreads();
+    if (threads<=0) {
+        return YARP_NULLPTR;
+    }
+    if (reactorInstance==YARP_NULLPTR) {
+        PortCoreReactor *reactor = new PortCoreReactor();
+        if (!reactor->open(threads)) {
+            YARP_ERROR(Logger::get(),
+                       "could not start the port reactor, input connections will have threads of their own");
+            delete reactor;
+            reactorThreads = 0;
+            return YARP_NULLPTR;
+        }
+        YARP_DEBUG(Logger::get(),
+                   ConstString("port reactor started with ") +
+                   NetType::toString(threads) + " thread(s)");
+        reactorInstance = reactor;
+    }
+    return reactorInstance;
+#else
+    return YARP_NULLPTR;
+#endif
+}
+
+
+void PortCoreReactor::setThreadCount(int threads)
+{
+    LockGuard guard(reactorMutex);
+    reactorThreads = (threads>0) ? threads : 0;
+}
+
+
+int PortCoreReactor::getThreadCount()
+{
+    LockGuard guard(reactorMutex);
+    return getConfiguredThreads();
+}
+
+
+void PortCoreReactor::fini()
+{
+    LockGuard guard(reactorMutex);
+    if (reactorInstance!=YARP_NULLPTR) {
+        delete reactorInstance;
+        reactorInstance = YARP_NULLPTR;
+    }
+}
+
+
+PortCoreReactor::PortCoreReactor() :
+        pollHandle(-1),
+        stopHandle(-1),
+        nextKey(REACTOR_STOP_KEY+1)
+{
+}
+
+
+PortCoreReactor::~PortCoreReactor()
+{
+    close();
+}
+
+
+bool PortCoreReactor::open(int threads)
+{
+#if defined(__linux__)
+    pollHandle = epoll_create1(EPOLL_CLOEXEC);
+    if (pollHandle<0) {
+        return false;
+    }
+    stopHandle = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+    if (stopHandle<0) {
+        close();
+        return false;
+    }
+    // level-triggered, so that every worker sees it
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = REACTOR_STOP_KEY;
+    if (epoll_ctl(pollHandle, EPOLL_CTL_ADD, stopHandle, &ev)<0) {
+        close();
+        return false;
+    }
+    for (int i=0; i<threads; i++) {
+        Worker *worker = new Worker(*this);
+        if (!worker->start()) {
+            delete worker;
+            break;
+        }
+        workers.push_back(worker);
+    }
+    if (workers.size()==0) {
+        close();
+        return false;
+    }
+    return true;
+#else
+    YARP_UNUSED(threads);
+    return false;
+#endif
+}
+
+
+void PortCoreReactor::close()
+{
+#if defined(__linux__)
+    if (stopHandle>=0) {
+        uint64_t one = 1;
+        if (write(stopHandle, &one, sizeof(one))<0) {
+            YARP_ERROR(Logger::get(), "could not stop the port reactor");
+        }
+    }
+    for (size_t i=0; i<workers.size(); i++) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    workers.clear();
+    if (stopHandle>=0) {
+        ::close(stopHandle);
+        stopHandle = -1;
+    }
+    if (pollHandle>=0) {
+        ::close(pollHandle);
+        pollHandle = -1;
+    }
+#endif
+    if (entries.size()>0) {
+        YARP_ERROR(Logger::get(),
+                   ConstString("port reactor stopped with ") +
+                   NetType::toString((int)entries.size()) +
+                   " connection(s) still open");
+    }
+}
+
+
+bool PortCoreReactor::watch(Entry& entry, unsigned long key, bool first)
+{
+#if defined(__linux__)
+    // one shot, so that only one worker at a time serves a connection
+    struct epoll_event ev;
+    ev.events = EPOLLIN|EPOLLRDHUP|EPOLLONESHOT;
+    ev.data.u64 = key;
+    int op = first ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (epoll_ctl(pollHandle, op, entry.handle, &ev)<0) {
+        entry.registered = false;
+        return false;
+    }
+    entry.registered = true;
+    return true;
+#else
+    YARP_UNUSED(entry);
+    YARP_UNUSED(key);
+    YARP_UNUSED(first);
+    return false;
+#endif
+}
+
+
+void PortCoreReactor::unwatch(Entry& entry)
+{
+#if defined(__linux__)
+    // this must happen before the socket is closed, since its
+    // descriptor may then be reused by another connection
+    if (entry.registered) {
+        struct epoll_event ev;
+        epoll_ctl(pollHandle, EPOLL_CTL_DEL, entry.handle, &ev);
+        entry.registered = false;
+    }
+#else
+    YARP_UNUSED(entry);
+#endif
+}
+
+
+bool PortCoreReactor::add(PortCoreInputUnit *unit, int handle)
+{
+    LockGuard guard(mutex);
+    unsigned long key = nextKey++;
+    if (nextKey==REACTOR_STOP_KEY) {
+        nextKey++;
+    }
+    Entry& entry = entries[key];
+    entry.unit = unit;
+    entry.handle = handle;
+    entry.registered = false;
+    entry.busy = false;
+    entry.cancel = false;
+    entry.waiter = YARP_NULLPTR;
+    if (!watch(entry, key, true)) {
+        entries.erase(key);
+        return false;
+    }
+    keys[unit] = key;
+    return true;
+}
+
+
+void PortCoreReactor::detach(PortCoreInputUnit *unit)
+{
+    LockGuard guard(mutex);
+    std::map<PortCoreInputUnit*, unsigned long>::iterator it = keys.find(unit);
+    if (it==keys.end()) {
+        return;
+    }
+    Entry& entry = entries[it->second];
+    unwatch(entry);
+    entry.cancel = true;
+}
+
+
+bool PortCoreReactor::remove(PortCoreInputUnit *unit)
+{
+    mutex.lock();
+    std::map<PortCoreInputUnit*, unsigned long>::iterator it = keys.find(unit);
+    if (it==keys.end()) {
+        mutex.unlock();
+        return false;
+    }
+    unsigned long key = it->second;
+    Entry& entry = entries[key];
+    if (entry.busy) {
+        // the worker serving the connection will wrap it up
+        SemaphoreImpl done(0);
+        entry.waiter = &done;
+        entry.cancel = true;
+        mutex.unlock();
+        done.wait();
+        return false;
+    }
+    unwatch(entry);
+    keys.erase(it);
+    entries.erase(key);
+    mutex.unlock();
+    return true;
+}
+
+
+void PortCoreReactor::work()
+{
+#if defined(__linux__)
+    while (true) {
+        struct epoll_event ev;
+        int result = epoll_wait(pollHandle, &ev, 1, -1);
+        if (result<0) {
+            if (errno==EINTR) {
+                continue;
+            }
+            YARP_ERROR(Logger::get(), "port reactor could not wait for input");
+            break;
+        }
+        if (result==0) {
+            continue;
+        }
+        unsigned long key = (unsigned long)ev.data.u64;
+        if (key==REACTOR_STOP_KEY) {
+            break;
+        }
+        mutex.lock();
+        std::map<unsigned long, Entry>::iterator it = entries.find(key);
+        if (it==entries.end() || !it->second.registered || it->second.busy) {
+            // forgotten since the event was raised
+            mutex.unlock();
+            continue;
+        }
+        it->second.busy = true;
+        PortCoreInputUnit *unit = it->second.unit;
+        mutex.unlock();
+
+        release(key, unit->serve());
+    }
+#endif
+}
+
+
+void PortCoreReactor::release(unsigned long key, bool keep)
+{
+    mutex.lock();
+    Entry& entry = entries[key];
+    if (keep && !entry.cancel && watch(entry, key, false)) {
+        entry.busy = false;
+        mutex.unlock();
+        return;
+    }
+    unwatch(entry);
+    PortCoreInputUnit *unit = entry.unit;
+    mutex.unlock();
+
+    // the connection either ended or needs a thread of its own
+    unit->release();
+
+    mutex.lock();
+    SemaphoreImpl *waiter = entries[key].waiter;
+    keys.erase(unit);
+    entries.erase(key);
+    mutex.unlock();
+    if (waiter!=YARP_NULLPTR) {
+        waiter->post();
+    }
+}
@@ -10,6 +10,8 @@
 #include <yarp/os/Thread.h>
 #include <yarp/os/Time.h>
 #include <yarp/os/Os.h>
+#include <yarp/os/LockGuard.h>
+#include <yarp/os/Mutex.h>
 
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/SemaphoreImpl.h>
@@ -20,6 +22,8 @@
 #include <yarp/os/impl/PlatformList.h>
 #include <yarp/os/impl/PortCorePacket.h>
 
+#include <atomic>
+
 #ifdef YARP_HAS_ACE
 #include <ace/Malloc_Allocator.h>
 #endif
@@ -171,6 +175,133 @@ public:
 
 
 
+// A triple buffer holding the newest message, for readers that only
+// want the latest data.  The writer fills the back packet and swaps it
+// with the middle one; the reader swaps the middle packet with the front
+// one when it is marked as fresh.  Neither ever waits for the other.
+#define MAILBOX_INDEX 3
+#define MAILBOX_FRESH 4
+
+class PortReaderMailbox {
+private:
+    PortReaderPacket *slots[3];
+    std::atomic<int> latest;      // middle slot, plus MAILBOX_FRESH if unread
+    std::atomic<bool> waiting;    // the reader is (about to be) asleep
+    std::atomic<bool> woken;
+    std::atomic<long> dropped;
+    int back;                     // owned by the writer
+    int front;                    // owned by the reader
+    bool current;                 // front holds the last message read
+    SemaphoreImpl wakeSema;
+
+public:
+    Mutex writeMutex;             // serializes writers, never the reader
+
+    PortReaderMailbox() :
+            latest(1),
+            waiting(false),
+            woken(false),
+            dropped(0),
+            back(2),
+            front(0),
+            current(false),
+            wakeSema(0) {
+        for (int i=0; i<3; i++) {
+            slots[i] = new PortReaderPacket();
+        }
+    }
+
+    ~PortReaderMailbox() {
+        for (int i=0; i<3; i++) {
+            delete slots[i];
+        }
+    }
+
+    // writer side, with writeMutex held
+
+    PortReaderPacket *getBack() {
+        return slots[back];
+    }
+
+    void publish() {
+        int prev = latest.exchange(back|MAILBOX_FRESH);
+        back = prev&MAILBOX_INDEX;
+        if (prev&MAILBOX_FRESH) {
+            dropped++;
+        }
+        if (waiting.exchange(false)) {
+            wakeSema.post();
+        }
+    }
+
+    // reader side
+
+    bool check() {
+        return (latest.load()&MAILBOX_FRESH)!=0;
+    }
+
+    bool wait(double timeout = -1) {
+        double deadline = (timeout>=0) ? (Time::now()+timeout) : -1;
+        while (!check()) {
+            waiting = true;
+            if (check()) {
+                break;
+            }
+            if (deadline<0) {
+                wakeSema.wait();
+            } else {
+                double left = deadline-Time::now();
+                if (left<=0 || !wakeSema.waitWithTimeout(left)) {
+                    return check();
+                }
+            }
+            if (woken.exchange(false)) {
+                return check();
+            }
+        }
+        return true;
+    }
+
+    void wake() {
+        woken = true;
+        wakeSema.post();
+    }
+
+    PortReaderPacket *take() {
+        current = false;
+        if (!check()) {
+            return YARP_NULLPTR;
+        }
+        front = latest.exchange(front)&MAILBOX_INDEX;
+        current = true;
+        return slots[front];
+    }
+
+    PortReaderPacket *getCurrent() {
+        return current ? slots[front] : YARP_NULLPTR;
+    }
+
+    void *acquire() {
+        PortReaderPacket *result = getCurrent();
+        if (result!=YARP_NULLPTR) {
+            // the writer creates a new object for the slot when it gets it
+            slots[front] = new PortReaderPacket();
+            current = false;
+        }
+        return result;
+    }
+
+    long getDropped() {
+        return dropped.load();
+    }
+
+    void clear() {
+        current = false;
+        latest &= MAILBOX_INDEX;
+    }
+};
+
+
 class PortReaderBufferBaseHelper {
 private:
 
@@ -182,16 +313,22 @@ public:
     PortReaderPool pool;
 
     int ct;
+    long dropped;
     Port *port;
     SemaphoreImpl contentSema;
     SemaphoreImpl consumeSema;
     SemaphoreImpl stateSema;
+    PortReaderMailbox *mailbox;
+    bool latestOnly;
 
     PortReaderBufferBaseHelper(PortReaderBufferBase& owner) :
         owner(owner), contentSema(0), consumeSema(0), stateSema(1) {
         prev = YARP_NULLPTR;
         port = YARP_NULLPTR;
         ct = 0;
+        dropped = 0;
+        mailbox = YARP_NULLPTR;
+        latestOnly = false;
     }
 
     virtual ~PortReaderBufferBaseHelper() {
@@ -206,6 +343,10 @@ public:
         }
         stateSema.wait();
         clear();
+        if (mailbox!=YARP_NULLPTR) {
+            delete mailbox;
+            mailbox = YARP_NULLPTR;
+        }
         //stateSema.post();  // never give back mutex
     }
 
@@ -216,6 +357,9 @@ public:
         }
         pool.reset();
         ct = 0;
+        if (mailbox!=YARP_NULLPTR) {
+            mailbox->clear();
+        }
     }
 
 
@@ -250,6 +394,40 @@ public:
         return pool.getCount();
     }
 
+    void waitContent() {
+        if (latestOnly) {
+            mailbox->wait();
+        } else {
+            contentSema.wait();
+        }
+    }
+
+    bool waitContent(double timeout) {
+        if (latestOnly) {
+            return mailbox->wait(timeout);
+        }
+        return contentSema.waitWithTimeout(timeout);
+    }
+
+    bool checkWaitContent() {
+        if (latestOnly) {
+            return mailbox->check();
+        }
+        bool ok = contentSema.check();
+        if (ok) {
+            contentSema.wait();
+        }
+        return ok;
+    }
+
+    void wakeContent() {
+        if (latestOnly) {
+            mailbox->wake();
+        } else {
+            contentSema.post();
+        }
+    }
+
     PortReaderPacket *getContent() {
         if (prev!=YARP_NULLPTR) {
             pool.addInactivePacket(prev);
@@ -264,11 +442,12 @@ public:
 
 
     bool getEnvelope(PortReader& envelope) {
-        if (prev==YARP_NULLPTR) {
+        PortReaderPacket *packet = latestOnly ? mailbox->getCurrent() : prev;
+        if (packet==YARP_NULLPTR) {
             return false;
         }
         StringInputStream sis;
-        sis.add(prev->envelope.c_str());
+        sis.add(packet->envelope.c_str());
         sis.add("\r\n");
         StreamConnectionReader sbr;
         Route route;
@@ -284,6 +463,7 @@ public:
             drop = pool.getActivePacket();
             if (drop!=YARP_NULLPTR) {
                 pool.addInactivePacket(drop);
+                dropped++;
             }
             ct--;
         }
@@ -296,6 +476,9 @@ public:
     }
 
     void *acquire() {
+        if (latestOnly) {
+            return mailbox->acquire();
+        }
         if (prev!=YARP_NULLPTR) {
             void *result = prev;
             prev = YARP_NULLPTR;
@@ -309,6 +492,43 @@ public:
             pool.addInactivePacket((PortReaderPacket*)key);
         }
     }
+
+    // store a message read from a connection, or passed by reference
+    // if obj is set, in the mailbox; never waits for the reader
+    bool readLatest(ConnectionReader *connection,
+                    PortReader *obj,
+                    PortWriter *wrapper) {
+        LockGuard guard(mailbox->writeMutex);
+        PortReaderPacket *packet = mailbox->getBack();
+        if (obj!=YARP_NULLPTR) {
+            packet->setExternal(obj, wrapper);
+            mailbox->publish();
+            return true;
+        }
+        packet->resetExternal();
+        if (packet->getReader()==YARP_NULLPTR) {
+            PortReader *next = owner.create();
+            yAssert(next != YARP_NULLPTR);
+            packet->setReader(next);
+        }
+        bool ok = false;
+        if (connection->isValid()) {
+            ok = packet->getReader()->read(*connection);
+            packet->setEnvelope(connection->readEnvelope());
+        } else {
+            // this is a disconnection
+            // don't talk to this port ever again
+            port = YARP_NULLPTR;
+        }
+        if (ok) {
+            mailbox->publish();
+        } else {
+            // give the reader a chance to notice the port is closing
+            YARP_DEBUG(Logger::get(), "giving PortReaderBuffer chance to close");
+            mailbox->wake();
+        }
+        return ok;
+    }
 };
 
 
@@ -360,6 +580,9 @@ void PortReaderBufferBase::release(PortReader *completed) {
 }
 
 int PortReaderBufferBase::check() {
+    if (HELPER(implementation).latestOnly) {
+        return HELPER(implementation).mailbox->check() ? 1 : 0;
+    }
     HELPER(implementation).stateSema.wait();
     int count = HELPER(implementation).checkContent();
     HELPER(implementation).stateSema.post();
@@ -369,13 +592,13 @@ int PortReaderBufferBase::check() {
 
 void PortReaderBufferBase::interrupt() {
     // give read a chance
-    HELPER(implementation).contentSema.post();
+    HELPER(implementation).wakeContent();
 }
 
 PortReader *PortReaderBufferBase::readBase(bool& missed, bool cleanup) {
     missed = false;
     if (period<0 || cleanup) {
-        HELPER(implementation).contentSema.wait();
+        HELPER(implementation).waitContent();
     } else {
         bool ok = false;
         double now = Time::now();
@@ -385,10 +608,9 @@ PortReader *PortReaderBufferBase::readBase(bool& missed, bool cleanup) {
         }
         double diff = target-now;
         if (diff>0) {
-            ok = HELPER(implementation).contentSema.waitWithTimeout(diff);
+            ok = HELPER(implementation).waitContent(diff);
         } else {
-            ok = HELPER(implementation).contentSema.check();
-            if (ok) HELPER(implementation).contentSema.wait();
+            ok = HELPER(implementation).checkWaitContent();
         }
         if (!ok) {
             missed = true;
@@ -408,6 +630,14 @@ PortReader *PortReaderBufferBase::readBase(bool& missed, bool cleanup) {
             last_recv = target;
         }
     }
+    if (HELPER(implementation).latestOnly) {
+        PortReaderPacket *readerPacket = HELPER(implementation).mailbox->take();
+        if (readerPacket==YARP_NULLPTR) {
+            return YARP_NULLPTR;
+        }
+        PortReader *external = readerPacket->getExternal();
+        return (external!=YARP_NULLPTR) ? external : readerPacket->getReader();
+    }
     HELPER(implementation).stateSema.wait();
     PortReaderPacket *readerPacket = HELPER(implementation).getContent();
     PortReader *reader = YARP_NULLPTR;
@@ -439,6 +669,11 @@ bool PortReaderBufferBase::read(ConnectionReader& connection) {
             return replier->read(connection);
         }
     }
+    if (HELPER(implementation).latestOnly) {
+        return HELPER(implementation).readLatest(&connection,
+                                                 YARP_NULLPTR,
+                                                 YARP_NULLPTR);
+    }
     PortReaderPacket *reader = YARP_NULLPTR;
     while (reader==YARP_NULLPTR) {
         HELPER(implementation).stateSema.wait();
@@ -515,6 +750,29 @@ void PortReaderBufferBase::setTargetPeriod(double period) {
     this->period = period;
 }
 
+void PortReaderBufferBase::setLatestOnly(bool flag) {
+    HELPER(implementation).stateSema.wait();
+    if (flag && HELPER(implementation).mailbox==YARP_NULLPTR) {
+        HELPER(implementation).mailbox = new PortReaderMailbox();
+    }
+    HELPER(implementation).latestOnly = flag;
+    HELPER(implementation).stateSema.post();
+}
+
+bool PortReaderBufferBase::isLatestOnly() {
+    return HELPER(implementation).latestOnly;
+}
+
+long PortReaderBufferBase::getDroppedCount() {
+    HELPER(implementation).stateSema.wait();
+    long dropped = HELPER(implementation).dropped;
+    if (HELPER(implementation).mailbox!=YARP_NULLPTR) {
+        dropped += HELPER(implementation).mailbox->getDropped();
+    }
+    HELPER(implementation).stateSema.post();
+    return dropped;
+}
+
 ConstString PortReaderBufferBase::getName() const {
     return HELPER(implementation).getName();
 }
@@ -554,6 +812,10 @@ bool PortReaderBufferBase::acceptObjectBase(PortReader *obj,
     // receiving from a Port -- except no need to create/read
     // the object
 
+    if (HELPER(implementation).latestOnly) {
+        return HELPER(implementation).readLatest(YARP_NULLPTR, obj, wrapper);
+    }
+
     PortReaderPacket *reader = YARP_NULLPTR;
     while (reader==YARP_NULLPTR) {
         HELPER(implementation).stateSema.wait();
@@ -614,6 +876,11 @@ void *PortReaderBufferBase::acquire() {
 }
 
 void PortReaderBufferBase::release(void *key) {
+    if (HELPER(implementation).latestOnly) {
+        // objects taken from the mailbox are replaced, not recycled
+        delete (PortReaderPacket*)key;
+        return;
+    }
     HELPER(implementation).stateSema.wait();
     HELPER(implementation).release(key);
     HELPER(implementation).stateSema.post();
@@ -14,7 +14,9 @@
 yarp::os::QosStyle::QosStyle() :
         threadPriority(-1),
         threadPolicy(-1),
-        packetPriority(-1) {
+        packetPriority(-1),
+        batchSize(-1),
+        batchDelay(0) {
 }
 
 void yarp::os::QosStyle::setPacketPriorityByDscp(PacketPriorityDSCP dscp) {
@@ -9,11 +9,15 @@
 #include <yarp/os/RateThread.h>
 #include <yarp/os/impl/Logger.h>
 #include <yarp/os/impl/PlatformTime.h>
+#include <yarp/os/impl/RateThreadExecutor.h>
 #include <yarp/os/Semaphore.h>
 
 #include <yarp/os/Time.h>
 
 #include <cmath> //sqrt
+#include <condition_variable>
+#include <mutex>
+#include <vector>
 
 //added threadRelease/threadInit methods and synchronization -nat
 
@@ -22,7 +26,8 @@ using namespace yarp::os;
 
 //const YARP_timeval _timeout_value(20, 0);    // (20 sec) timeout value for the release (20 sec)
 
-class RateThreadCallbackAdapter: public ThreadImpl
+class RateThreadCallbackAdapter: public ThreadImpl,
+                                 public RateThreadExecutor::Task
 {
 private:
     unsigned int period;
@@ -34,8 +39,23 @@ private:
     YARP_timeval previousRunTV;
     YARP_timeval sleep;
     YARP_timeval sleepPeriodTV;
+    YARP_timeval elapsedTV;
     //ACE_High_Res_Timer thread_timer; // timer to estimate thread time
 
+    // state when running on the shared RateThreadExecutor
+    enum TaskState {
+        taskIdle,       // not started yet
+        taskStarting,   // waiting for threadInit()
+        taskRunning,    // iterating
+        taskStopping,   // asked to stop, waiting for threadRelease()
+        taskDone        // released, forgotten by the executor
+    };
+    RateThreadExecutor *executor;
+    bool initResult;
+    TaskState taskState;
+    std::mutex taskMutex;
+    std::condition_variable taskChanged;
+
     bool suspended;
     double totalUsed;      //total time taken iterations
     unsigned int count;    //number of iterations from last reset
@@ -45,6 +65,12 @@ private:
     double sumUsedSq;      //cumulative sum sq of estimated thread tun
     double previousRun;    //time when last iteration started
     double currentRun;     //time when this iteration started
+    unsigned int overruns; //iterations that took longer than the period
+    double totalJitter;    //deviation of dT from the period, accumulated
+    double maxJitter;      //largest deviation of dT from the period
+    double binWidth;       //width of the bins of the histograms [ms]
+    std::vector<unsigned int> periodHist; //dT, by bin
+    std::vector<unsigned int> jitterHist; //deviation of dT, by bin
     bool scheduleReset;
 
     void _resetStat() {
@@ -54,17 +80,68 @@ private:
         totalT=0;
         sumUsedSq=0;
         sumTSq=0;
+        overruns=0;
+        totalJitter=0;
+        maxJitter=0;
+        periodHist.assign(periodHist.size(), 0);
+        jitterHist.assign(jitterHist.size(), 0);
         scheduleReset=false;
     }
 
+    static void addToHistogram(std::vector<unsigned int>& hist, double value, double width) {
+        // the last bin takes everything beyond the others
+        size_t bin=hist.size()-1;
+        if (value<0)
+            bin=0;
+        else if (value<width*bin)
+            bin=(size_t)(value/width);
+        hist[bin]++;
+    }
+
+    static void getHistogram(const std::vector<unsigned int>& hist, unsigned int *counts, int bins) {
+        for (int i=0; i<bins; i++)
+            counts[i]=(i<(int)hist.size()) ? hist[i] : 0;
+    }
+
 public:
 
-    RateThreadCallbackAdapter(RateThread& owner, int p) : owner(owner) {
+    RateThreadCallbackAdapter(RateThread& owner, int p) :
+            owner(owner),
+            executor(YARP_NULLPTR),
+            initResult(false),
+            taskState(taskIdle),
+            binWidth(1.0),
+            periodHist(50, 0),
+            jitterHist(50, 0) {
         period=p;
         suspended = false;
         _resetStat();
     }
 
+    virtual ~RateThreadCallbackAdapter() {
+        if (executor!=YARP_NULLPTR) {
+            close();
+        }
+        if (executor!=YARP_NULLPTR) {
+            // deleted by a pooled task while running on another worker
+            waitForState(taskDone);
+            executor=YARP_NULLPTR;
+        }
+    }
+
+    void setState(TaskState state) {
+        std::lock_guard<std::mutex> guard(taskMutex);
+        taskState=state;
+        taskChanged.notify_all();
+    }
+
+    void waitForState(TaskState state) {
+        std::unique_lock<std::mutex> guard(taskMutex);
+        while (taskState!=state) {
+            taskChanged.wait(guard);
+        }
+    }
+
     void resetStat() {
         scheduleReset=true;
     }
@@ -131,7 +208,49 @@ public:
     }
 
 
-    void singleStep() {
+    unsigned int getOverruns() {
+        lock();
+        unsigned int ret=overruns;
+        unlock();
+        return ret;
+    }
+
+    void getEstJitter(double &av, double &max) {
+        lock();
+        if (estPIt==0) {
+            av=0;
+            max=0;
+        } else {
+            av=totalJitter/estPIt;
+            max=maxJitter;
+        }
+        unlock();
+    }
+
+    void setHistogram(double width, int bins) {
+        if (width<=0 || bins<1)
+            return;
+        lock();
+        binWidth=width;
+        periodHist.assign(bins, 0);
+        jitterHist.assign(bins, 0);
+        unlock();
+    }
+
+    void getPeriodHistogram(unsigned int *counts, int bins) {
+        lock();
+        getHistogram(periodHist, counts, bins);
+        unlock();
+    }
+
+    void getJitterHistogram(unsigned int *counts, int bins) {
+        lock();
+        getHistogram(jitterHist, counts, bins);
+        unlock();
+    }
+
+    // run one iteration and update the statistics
+    void iterate() {
         lock();
         getTime(currentRunTV);
         currentRun=toDouble(currentRunTV);
@@ -144,6 +263,12 @@ public:
             double dT=(currentRun-previousRun)*1000;
             sumTSq+=dT*dT;
             totalT+=dT;
+            double jitter=fabs(dT-adaptedPeriod);
+            totalJitter+=jitter;
+            if (jitter>maxJitter)
+                maxJitter=jitter;
+            addToHistogram(periodHist, dT, binWidth);
+            addToHistogram(jitterHist, jitter, binWidth);
             //double error=(static_cast<double>(period)-dT);
             //adaptedPeriod+=0.0*error; //not available
             if (adaptedPeriod<0)
@@ -163,14 +288,19 @@ public:
         count++;
         lock();
 
-        YARP_timeval elapsedTV;
         getTime(elapsedTV);
         double elapsed=toDouble(elapsedTV)-currentRun;
 
         //save last
         totalUsed+=elapsed*1000;
         sumUsedSq+=elapsed*1000*elapsed*1000;
+        if (adaptedPeriod>0 && elapsed*1000>adaptedPeriod)
+            overruns++;
         unlock();
+    }
+
+    void singleStep() {
+        iterate();
 
         //compute sleep time
         fromDouble(sleepPeriodTV, adaptedPeriod, 1000);
@@ -187,6 +317,161 @@ public:
         }
     }
 
+    bool start() override {
+        // the executor keeps time with the system clock
+        RateThreadExecutor *pool = YARP_NULLPTR;
+        if (Time::isSystemClock()) {
+            pool = RateThreadExecutor::get();
+        }
+        if (pool==YARP_NULLPTR) {
+            return ThreadImpl::start();
+        }
+        if (executor!=YARP_NULLPTR) {
+            std::lock_guard<std::mutex> guard(taskMutex);
+            if (taskState!=taskDone) {
+                // still running
+                return false;
+            }
+            // asked to stop from run(), and done
+        }
+        adaptedPeriod=period;
+        executor=pool;
+        initResult=false;
+        setState(taskStarting);
+        beforeStart();
+        if (RateThreadExecutor::isWorker()) {
+            // started by a pooled task: the workers may all be busy, so
+            // initialize here, on the worker that would wait for another
+            initResult=owner.threadInit();
+            setState(initResult ? taskRunning : taskDone);
+            if (initResult) {
+                executor->add(this);
+            }
+        } else {
+            executor->add(this);
+            std::unique_lock<std::mutex> guard(taskMutex);
+            while (taskState==taskStarting) {
+                taskChanged.wait(guard);
+            }
+        }
+        if (!initResult) {
+            executor=YARP_NULLPTR;
+        }
+        afterStart(initResult);
+        return initResult;
+    }
+
+    void close() override {
+        if (executor==YARP_NULLPTR) {
+            ThreadImpl::close();
+            return;
+        }
+        if (RateThreadExecutor::isWorker()) {
+            // stopped by a pooled task, do not wait for a free worker
+            bool waiting;
+            {
+                std::lock_guard<std::mutex> guard(taskMutex);
+                waiting=(taskState==taskRunning || taskState==taskStopping) &&
+                        executor->remove(this);
+                if (waiting) {
+                    // no worker runs it any more, release it here
+                    taskState=taskStopping;
+                }
+            }
+            if (waiting) {
+                owner.threadRelease();
+                setState(taskDone);
+                executor=YARP_NULLPTR;
+                return;
+            }
+            // running right now, it is released at the end of its
+            // iteration; start() waits for that
+            askToClose();
+            return;
+        }
+        askToClose();
+        waitForState(taskDone);
+        executor=YARP_NULLPTR;
+    }
+
+    int join(double seconds) {
+        if (executor==YARP_NULLPTR) {
+            return ThreadImpl::join(seconds);
+        }
+        std::unique_lock<std::mutex> guard(taskMutex);
+        if (seconds>0) {
+            if (!taskChanged.wait_for(guard, std::chrono::duration<double>(seconds),
+                                      [this] { return taskState==taskDone; })) {
+                return -1;
+            }
+        } else {
+            while (taskState!=taskDone) {
+                taskChanged.wait(guard);
+            }
+        }
+        return 0;
+    }
+
+    void askToClose() {
+        if (executor==YARP_NULLPTR) {
+            ThreadImpl::askToClose();
+            return;
+        }
+        std::lock_guard<std::mutex> guard(taskMutex);
+        if (taskState==taskStarting) {
+            // stops right after threadInit()
+            taskState=taskStopping;
+        } else if (taskState==taskRunning) {
+            taskState=taskStopping;
+            // not once done: the executor may have been shut down already
+            executor->expedite(this);
+        }
+    }
+
+    bool isRunning() {
+        if (executor==YARP_NULLPTR) {
+            return ThreadImpl::isRunning();
+        }
+        std::lock_guard<std::mutex> guard(taskMutex);
+        return taskState==taskRunning || taskState==taskStopping;
+    }
+
+    // called by the executor, in place of run()
+    bool runTask() override {
+        std::unique_lock<std::mutex> guard(taskMutex);
+        // asked to stop before threadInit(), it still runs first
+        if (taskState==taskStarting ||
+            (taskState==taskStopping && !initResult)) {
+            guard.unlock();
+            bool ok=owner.threadInit();
+            guard.lock();
+            initResult=ok;
+            if (!ok) {
+                taskState=taskDone;
+            } else if (taskState==taskStarting) {
+                taskState=taskRunning;
+            }
+            taskChanged.notify_all();
+            return ok;
+        }
+        if (taskState==taskRunning) {
+            guard.unlock();
+            iterate();
+            guard.lock();
+        }
+        if (taskState==taskStopping) {
+            guard.unlock();
+            owner.threadRelease();
+            setState(taskDone);
+            return false;
+        }
+        return true;
+    }
+
+    double getTaskPeriod() override {
+        return adaptedPeriod/1000.0;
+    }
+
     bool threadInit() override {
         return owner.threadInit();
     }
@@ -268,17 +553,17 @@ bool RateThread::isSuspended()
 
 bool RateThread::join(double seconds)
 {
-    return ((ThreadImpl*)implementation)->join(seconds);
+    return ((RateThreadCallbackAdapter*)implementation)->join(seconds);
 }
 
 void RateThread::stop()
 {
-    ((ThreadImpl*)implementation)->close();
+    ((RateThreadCallbackAdapter*)implementation)->close();
 }
 
 void RateThread::askToStop()
 {
-    ((ThreadImpl*)implementation)->askToClose();
+    ((RateThreadCallbackAdapter*)implementation)->askToClose();
 }
 
 bool RateThread::step()
@@ -289,12 +574,12 @@ bool RateThread::step()
 
 bool RateThread::start()
 {
-    return ((ThreadImpl*)implementation)->start();
+    return ((RateThreadCallbackAdapter*)implementation)->start();
 }
 
 bool RateThread::isRunning()
 {
-    return ((ThreadImpl*)implementation)->isRunning();
+    return ((RateThreadCallbackAdapter*)implementation)->isRunning();
 }
 
 void RateThread::suspend()
@@ -332,6 +617,31 @@ void RateThread::getEstUsed(double &av, double &std)
     ((RateThreadCallbackAdapter*)implementation)->getEstUsed(av, std);
 }
 
+unsigned int RateThread::getOverruns()
+{
+    return ((RateThreadCallbackAdapter*)implementation)->getOverruns();
+}
+
+void RateThread::getEstJitter(double &av, double &max)
+{
+    ((RateThreadCallbackAdapter*)implementation)->getEstJitter(av, max);
+}
+
+void RateThread::setHistogram(double binWidth, int bins)
+{
+    ((RateThreadCallbackAdapter*)implementation)->setHistogram(binWidth, bins);
+}
+
+void RateThread::getPeriodHistogram(unsigned int *counts, int bins)
+{
+    ((RateThreadCallbackAdapter*)implementation)->getPeriodHistogram(counts, bins);
+}
+
+void RateThread::getJitterHistogram(unsigned int *counts, int bins)
+{
+    ((RateThreadCallbackAdapter*)implementation)->getJitterHistogram(counts, bins);
+}
+
 void RateThread::resetStat()
 {
     ((RateThreadCallbackAdapter*)implementation)->resetStat();
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/os/impl/RateThreadExecutor.h>
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LockGuard.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/NetType.h>
+#include <yarp/os/impl/Logger.h>
+#include <yarp/os/impl/ThreadImpl.h>
+
+#include <algorithm>
+#include <string>
+
+#if defined(__linux__)
+#  include <pthread.h>
+#  include <sched.h>
+#endif
+
+using namespace yarp::os::impl;
+using namespace yarp::os;
+
+static yarp::os::Mutex executorMutex;
+static RateThreadExecutor *executorInstance = YARP_NULLPTR;
+static int executorThreads = -1;
+static int executorPriority = -1;
+static int executorPolicy = -1;
+static ConstString executorCpus;
+static bool executorConfigured = false;
+
+
+class RateThreadExecutor::Worker : public ThreadImpl
+{
+public:
+    Worker(RateThreadExecutor& owner) : owner(owner)
+    {
+    }
+
+    virtual void run() override
+    {
+#if defined(__linux__)
+        if (executorCpus!="") {
+            std::string list(executorCpus.c_str());
+            std::replace(list.begin(), list.end(), ',', ' ');
+            Bottle cpus(list.c_str());
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int i=0; i<cpus.size(); i++) {
+                CPU_SET(cpus.get(i).asInt(), &set);
+            }
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set)!=0) {
+                YARP_ERROR(Logger::get(),
+                           ConstString("could not pin rate thread workers to cpus ") +
+                           executorCpus);
+            }
+        }
+#endif
+        owner.work();
+    }
+
+private:
+    RateThreadExecutor& owner;
+};
+
+
+RateThreadExecutor::Task::~Task()
+{
+}
+
+
+static void configure()
+{
+    if (executorConfigured) {
+        return;
+    }
+    executorConfigured = true;
+    if (executorThreads<0) {
+        ConstString threads = NetworkBase::getEnvironment("YARP_RATETHREAD_POOL");
+        executorThreads = (threads!="") ? NetType::toInt(threads) : 0;
+        if (executorThreads<0) {
+            executorThreads = 0;
+        }
+    }
+    if (executorPriority<0) {
+        ConstString priority = NetworkBase::getEnvironment("YARP_RATETHREAD_POOL_PRIORITY");
+        if (priority!="") {
+            // a real-time priority, SCHED_FIFO
+            executorPriority = NetType::toInt(priority);
+            executorPolicy = 1;
+        }
+    }
+    if (executorCpus=="") {
+        executorCpus = NetworkBase::getEnvironment("YARP_RATETHREAD_POOL_CPUS");
+    }
+}
+
+
+RateThreadExecutor *RateThreadExecutor::get()
+{
+    LockGuard guard(executorMutex);
+    configure();
+    if (executorThreads<=0) {
+        return YARP_NULLPTR;
+    }
+    if (executorInstance==YARP_NULLPTR) {
+        RateThreadExecutor *executor = new RateThreadExecutor();
+        if (!executor->open(executorThreads, executorPriority, executorPolicy)) {
+            YARP_ERROR(Logger::get(),
+                       "could not start the rate thread pool, rate threads will have threads of their own");
+            delete executor;
+            executorThreads = 0;
+            return YARP_NULLPTR;
+        }
+        YARP_DEBUG(Logger::get(),
+                   ConstString("rate thread pool started with ") +
+                   NetType::toString(executorThreads) + " thread(s)");
+        executorInstance = executor;
+    }
+    return executorInstance;
+}
+
+
+void RateThreadExecutor::setThreadCount(int threads)
+{
+    LockGuard guard(executorMutex);
+    configure();
+    executorThreads = (threads>0) ? threads : 0;
+}
+
+
+int RateThreadExecutor::getThreadCount()
+{
+    LockGuard guard(executorMutex);
+    configure();
+    return executorThreads;
+}
+
+
+void RateThreadExecutor::setScheduling(int priority, int policy)
+{
+    LockGuard guard(executorMutex);
+    configure();
+    executorPriority = priority;
+    executorPolicy = policy;
+}
+
+
+void RateThreadExecutor::setAffinity(const ConstString& cpus)
+{
+    LockGuard guard(executorMutex);
+    configure();
+    executorCpus = cpus;
+}
+
+
+void RateThreadExecutor::fini()
+{
+    LockGuard guard(executorMutex);
+    if (executorInstance!=YARP_NULLPTR) {
+        delete executorInstance;
+        executorInstance = YARP_NULLPTR;
+    }
+}
+
+
+bool RateThreadExecutor::isWorker()
+{
+    LockGuard guard(executorMutex);
+    if (executorInstance==YARP_NULLPTR) {
+        return false;
+    }
+    long int key = ThreadImpl::getKeyOfCaller();
+    for (size_t i=0; i<executorInstance->workers.size(); i++) {
+        if (executorInstance->workers[i]->getKey()==key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+RateThreadExecutor::RateThreadExecutor() :
+        timing(false),
+        stopping(false)
+{
+}
+
+
+RateThreadExecutor::~RateThreadExecutor()
+{
+    close();
+}
+
+
+bool RateThreadExecutor::open(int threads, int priority, int policy)
+{
+    for (int i=0; i<threads; i++) {
+        Worker *worker = new Worker(*this);
+        if (!worker->start()) {
+            delete worker;
+            break;
+        }
+        if (priority>=0 || policy>=0) {
+            if (worker->setPriority(priority, policy)==-1) {
+                YARP_ERROR(Logger::get(),
+                           "could not set the scheduling of rate thread workers");
+            }
+        }
+        workers.push_back(worker);
+    }
+    if (workers.size()==0) {
+        return false;
+    }
+    return true;
+}
+
+
+void RateThreadExecutor::close()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+        timer.notify_all();
+        idle.notify_all();
+    }
+    for (size_t i=0; i<workers.size(); i++) {
+        workers[i]->join();
+        delete workers[i];
+    }
+    workers.clear();
+    if (queue.size()>0) {
+        YARP_ERROR(Logger::get(),
+                   ConstString("rate thread pool stopped with ") +
+                   NetType::toString((int)queue.size()) +
+                   " rate thread(s) still running");
+    }
+}
+
+
+void RateThreadExecutor::schedule(const Entry& entry)
+{
+    // with the mutex held
+    queue.push_back(entry);
+    std::push_heap(queue.begin(), queue.end(), Later());
+    if (timing) {
+        if (queue.front().task==entry.task) {
+            // earlier than what the timing worker waits for
+            timer.notify_one();
+        }
+    } else {
+        idle.notify_one();
+    }
+}
+
+
+void RateThreadExecutor::add(Task *task)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    Entry entry;
+    entry.deadline = Clock::now();
+    entry.task = task;
+    schedule(entry);
+}
+
+
+void RateThreadExecutor::expedite(Task *task)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    for (size_t i=0; i<queue.size(); i++) {
+        if (queue[i].task==task) {
+            Entry entry = queue[i];
+            queue.erase(queue.begin()+i);
+            std::make_heap(queue.begin(), queue.end(), Later());
+            entry.deadline = Clock::now();
+            schedule(entry);
+            return;
+        }
+    }
+    // the task is running right now
+}
+
+
+bool RateThreadExecutor::remove(Task *task)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    for (size_t i=0; i<queue.size(); i++) {
+        if (queue[i].task==task) {
+            queue.erase(queue.begin()+i);
+            std::make_heap(queue.begin(), queue.end(), Later());
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void RateThreadExecutor::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (queue.empty() || timing) {
+            // one worker at a time waits for the next deadline
+            idle.wait(lock);
+            continue;
+        }
+        Clock::time_point deadline = queue.front().deadline;
+        if (deadline>Clock::now()) {
+            timing = true;
+            timer.wait_until(lock, deadline);
+            timing = false;
+            continue;
+        }
+        std::pop_heap(queue.begin(), queue.end(), Later());
+        Entry entry = queue.back();
+        queue.pop_back();
+        if (!queue.empty()) {
+            // let another worker wait for the next deadline
+            idle.notify_one();
+        }
+        lock.unlock();
+
+        bool keep = entry.task->runTask();
+        double period = keep ? entry.task->getTaskPeriod() : 0;
+
+        lock.lock();
+        if (keep) {
+            Clock::time_point now = Clock::now();
+            entry.deadline += std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(period));
+            if (entry.deadline<now) {
+                // overrun, skip the iterations missed
+                entry.deadline = now;
+            }
+            schedule(entry);
+        }
+    }
+}
@@ -0,0 +1,462 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/conf/system.h>
+#include <yarp/os/impl/ShmRing.h>
+#include <yarp/os/SystemClock.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#ifdef YARP_HAS_SYS_MMAN_H
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <signal.h>
+# ifdef __linux__
+#  include <climits>
+#  include <linux/futex.h>
+#  include <sys/syscall.h>
+# endif
+#endif
+
+using namespace yarp::os;
+using namespace yarp::os::impl;
+
+#define SHM_RING_MAGIC 0x5950524bU   // "YPRK"
+#define SHM_RING_HEADER_SIZE 4096
+#define SHM_RING_PAGE_SIZE 4096
+
+// How long to sleep at most before checking whether the peer went away.
+#define SHM_RING_WAIT_SLICE_MS 100
+
+/**
+ * Layout at the start of the segment.  Counters touched by different
+ * sides live on separate cache lines.
+ */
+struct ShmRing::Header
+{
+    uint32_t magic;
+    uint32_t slotCount;
+    uint64_t slotSize;
+    int32_t writerPid;
+    int32_t readerPid;
+
+    alignas(64) std::atomic<uint32_t> head;          ///< slots published
+    std::atomic<uint32_t> readerWaiting;
+
+    alignas(64) std::atomic<uint32_t> tail;          ///< slots consumed
+    std::atomic<uint32_t> writerWaiting;
+
+    alignas(64) std::atomic<uint32_t> closed;
+
+    alignas(64) uint64_t length[SHM_RING_MAX_SLOTS]; ///< bytes in each slot
+};
+
+
+#ifdef YARP_HAS_SYS_MMAN_H
+
+static void waitOn(std::atomic<uint32_t>& word, uint32_t seen, int ms)
+{
+#ifdef __linux__
+    // Not FUTEX_PRIVATE_FLAG: the word is shared between processes.
+    struct timespec ts;
+    ts.tv_sec = ms/1000;
+    ts.tv_nsec = (ms%1000)*1000000L;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT,
+            seen, &ts, YARP_NULLPTR, 0);
+#else
+    for (int i=0; i<ms && word.load()==seen; i++) {
+        SystemClock::delaySystem(0.001);
+    }
+#endif
+}
+
+static void wake(std::atomic<uint32_t>& word)
+{
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE,
+            INT_MAX, YARP_NULLPTR, YARP_NULLPTR, 0);
+#else
+    YARP_UNUSED(word);
+#endif
+}
+
+#endif // YARP_HAS_SYS_MMAN_H
+
+
+ShmRing::ShmRing() :
+        header(YARP_NULLPTR),
+        mappedSize(0),
+        writer(false),
+        linked(false),
+        slotCount(0),
+        slotSize(0),
+        cursor(0),
+        offset(0),
+        timeout(0)
+{
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                  "atomic counters must be usable as futex words");
+    static_assert(sizeof(Header) <= SHM_RING_HEADER_SIZE,
+                  "ring header must fit before the first slot");
+}
+
+ShmRing::~ShmRing()
+{
+    close();
+    unlink();
+#ifdef YARP_HAS_SYS_MMAN_H
+    if (header != YARP_NULLPTR) {
+        munmap(header, mappedSize);
+    }
+#endif
+    header = YARP_NULLPTR;
+}
+
+bool ShmRing::map(int fd, size_t size)
+{
+#ifdef YARP_HAS_SYS_MMAN_H
+    void *mem = mmap(YARP_NULLPTR, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+    header = static_cast<Header*>(mem);
+    mappedSize = size;
+    return true;
+#else
+    YARP_UNUSED(fd);
+    YARP_UNUSED(size);
+    return false;
+#endif
+}
+
+bool ShmRing::create(size_t slotCount, size_t slotSize)
+{
+#ifdef YARP_HAS_SYS_MMAN_H
+    static std::atomic<unsigned int> counter(0);
+    if (header != YARP_NULLPTR || slotCount < 1 || slotCount > SHM_RING_MAX_SLOTS || slotSize < 1) {
+        return false;
+    }
+    slotSize = ((slotSize+SHM_RING_PAGE_SIZE-1)/SHM_RING_PAGE_SIZE)*SHM_RING_PAGE_SIZE;
+    size_t size = SHM_RING_HEADER_SIZE + slotCount*slotSize;
+
+    int fd = -1;
+    for (int attempt=0; attempt<16 && fd<0; attempt++) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "/yarp-ring-%d-%u",
+                 (int)getpid(), counter++);
+        fd = shm_open(buf, O_RDWR|O_CREAT|O_EXCL, S_IRUSR|S_IWUSR);
+        if (fd >= 0) {
+            name = buf;
+        } else if (errno != EEXIST) {
+            return false;
+        }
+    }
+    if (fd < 0) {
+        return false;
+    }
+    linked = true;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        ::close(fd);
+        unlink();
+        return false;
+    }
+    if (!map(fd, size)) {
+        unlink();
+        return false;
+    }
+    // The segment starts zero-filled, so counters and flags are clear.
+    header->slotCount = (uint32_t)slotCount;
+    header->slotSize = slotSize;
+    header->writerPid = (int32_t)getpid();
+    header->readerPid = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SHM_RING_MAGIC;
+    this->slotCount = (uint32_t)slotCount;
+    this->slotSize = slotSize;
+    writer = true;
+    cursor = 0;
+    offset = 0;
+    return true;
+#else
+    YARP_UNUSED(slotCount);
+    YARP_UNUSED(slotSize);
+    return false;
+#endif
+}
+
+bool ShmRing::attach(const ConstString& name)
+{
+#ifdef YARP_HAS_SYS_MMAN_H
+    if (header != YARP_NULLPTR || name.length() < 2 || name[0] != '/') {
+        return false;
+    }
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < SHM_RING_HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    if (!map(fd, (size_t)st.st_size)) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // the geometry is checked once and kept, the peer could change it later
+    uint32_t count = header->slotCount;
+    uint64_t size = header->slotSize;
+    if (header->magic != SHM_RING_MAGIC ||
+            count < 1 ||
+            count > SHM_RING_MAX_SLOTS ||
+            size < 1 ||
+            size > (mappedSize - SHM_RING_HEADER_SIZE)/count) {
+        munmap(header, mappedSize);
+        header = YARP_NULLPTR;
+        return false;
+    }
+    slotCount = count;
+    slotSize = (size_t)size;
+    header->readerPid = (int32_t)getpid();
+    this->name = name;
+    writer = false;
+    cursor = header->tail.load();
+    offset = 0;
+    return true;
+#else
+    YARP_UNUSED(name);
+    return false;
+#endif
+}
+
+void ShmRing::unlink()
+{
+#ifdef YARP_HAS_SYS_MMAN_H
+    if (linked) {
+        shm_unlink(name.c_str());
+        linked = false;
+    }
+#endif
+}
+
+void ShmRing::close()
+{
+#ifdef YARP_HAS_SYS_MMAN_H
+    if (header != YARP_NULLPTR && header->closed.load() == 0) {
+        header->closed.store(1);
+        wake(header->closed);
+        wake(header->head);
+        wake(header->tail);
+    }
+#endif
+}
+
+bool ShmRing::isOk() const
+{
+    return header != YARP_NULLPTR && header->closed.load() == 0;
+}
+
+const ConstString& ShmRing::getName() const
+{
+    return name;
+}
+
+size_t ShmRing::getSlotCount() const
+{
+    return (header != YARP_NULLPTR) ? slotCount : 0;
+}
+
+size_t ShmRing::getSlotSize() const
+{
+    return (header != YARP_NULLPTR) ? slotSize : 0;
+}
+
+void ShmRing::setTimeout(double timeout)
+{
+    this->timeout = timeout;
+}
+
+char *ShmRing::slot(unsigned int index) const
+{
+    return reinterpret_cast<char*>(header) + SHM_RING_HEADER_SIZE +
+        (index%slotCount)*slotSize;
+}
+
+bool ShmRing::peerAlive() const
+{
+#ifdef YARP_HAS_SYS_MMAN_H
+    int pid = writer ? header->readerPid : header->writerPid;
+    if (pid <= 0) {
+        return true;
+    }
+    return !(kill(pid, 0) != 0 && errno == ESRCH);
+#else
+    return false;
+#endif
+}
+
+bool ShmRing::waitForSpace()
+{
+#ifdef YARP_HAS_SYS_MMAN_H
+    double start = -1;
+    while (true) {
+        if (header->closed.load() != 0) {
+            return false;
+        }
+        uint32_t tail = header->tail.load(std::memory_order_acquire);
+        if (cursor - tail < slotCount) {
+            return true;
+        }
+        header->writerWaiting.store(1);
+        if (header->tail.load() == tail) {
+            waitOn(header->tail, tail, SHM_RING_WAIT_SLICE_MS);
+        }
+        header->writerWaiting.store(0);
+        if (header->tail.load() == tail) {
+            if (!peerAlive()) {
+                close();
+                return false;
+            }
+            if (timeout > 0) {
+                double now = SystemClock::nowSystem();
+                if (start < 0) {
+                    start = now;
+                } else if (now-start >= timeout) {
+                    return false;
+                }
+            }
+        }
+    }
+#else
+    return false;
+#endif
+}
+
+bool ShmRing::waitForData()
+{
+#ifdef YARP_HAS_SYS_MMAN_H
+    double start = -1;
+    while (true) {
+        uint32_t head = header->head.load(std::memory_order_acquire);
+        if (head != cursor) {
+            return true;
+        }
+        // Only give up on a closed ring once everything sent was read.
+        if (header->closed.load() != 0) {
+            return false;
+        }
+        header->readerWaiting.store(1);
+        if (header->head.load() == head) {
+            waitOn(header->head, head, SHM_RING_WAIT_SLICE_MS);
+        }
+        header->readerWaiting.store(0);
+        if (header->head.load() == head) {
+            if (!peerAlive()) {
+                close();
+                return false;
+            }
+            if (timeout > 0) {
+                double now = SystemClock::nowSystem();
+                if (start < 0) {
+                    start = now;
+                } else if (now-start >= timeout) {
+                    return false;
+                }
+            }
+        }
+    }
+#else
+    return false;
+#endif
+}
+
+void ShmRing::publish()
+{
+#ifdef YARP_HAS_SYS_MMAN_H
+    header->length[cursor%slotCount] = offset;
+    cursor++;
+    offset = 0;
+    header->head.store(cursor);
+    if (header->readerWaiting.load() != 0) {
+        wake(header->head);
+    }
+#endif
+}
+
+bool ShmRing::write(const char *data, size_t len)
+{
+    if (header == YARP_NULLPTR || !writer) {
+        return false;
+    }
+    while (len > 0) {
+        if (offset == 0 && !waitForSpace()) {
+            // the reader would take what follows as the rest of a message
+            // already partly sent
+            close();
+            return false;
+        }
+        size_t n = slotSize - offset;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(slot(cursor) + offset, data, n);
+        offset += n;
+        data += n;
+        len -= n;
+        if (offset == slotSize) {
+            publish();
+        }
+    }
+    return isOk();
+}
+
+bool ShmRing::flush()
+{
+    if (header == YARP_NULLPTR || !writer) {
+        return false;
+    }
+    if (offset > 0) {
+        publish();
+    }
+    return isOk();
+}
+
+YARP_SSIZE_T ShmRing::read(char *data, size_t len)
+{
+    if (header == YARP_NULLPTR || writer) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    if (!waitForData()) {
+        return -1;
+    }
+    // the length comes from the other process, do not trust it
+    uint64_t length = header->length[cursor%slotCount];
+    if (length > slotSize || offset > length) {
+        close();
+        return -1;
+    }
+    size_t avail = (size_t)length - offset;
+    size_t n = (len < avail) ? len : avail;
+    memcpy(data, slot(cursor) + offset, n);
+    offset += n;
+    if (n == avail) {
+        cursor++;
+        offset = 0;
+        header->tail.store(cursor);
+        if (header->writerWaiting.load() != 0) {
+            wake(header->tail);
+        }
+    }
+    return (YARP_SSIZE_T)n;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/os/impl/ShmRingCarrier.h>
+#include <yarp/os/impl/ShmRingTwoWayStream.h>
+#include <yarp/os/impl/Logger.h>
+#include <yarp/os/ConnectionState.h>
+#include <yarp/os/ConstString.h>
+#include <yarp/os/Name.h>
+#include <yarp/os/NetType.h>
+#include <yarp/os/Route.h>
+
+using namespace yarp::os;
+using namespace yarp::os::impl;
+
+// Longest segment name accepted from the sender.
+#define SHM_RING_MAX_NAME 255
+
+yarp::os::Carrier *ShmRingCarrier::create()
+{
+    return new ShmRingCarrier();
+}
+
+yarp::os::ConstString ShmRingCarrier::getName()
+{
+    return "shm";
+}
+
+int ShmRingCarrier::getSpecifierCode()
+{
+    return 5;
+}
+
+bool ShmRingCarrier::checkHeader(const Bytes& header)
+{
+    return getSpecifier(header)%16 == getSpecifierCode();
+}
+
+void ShmRingCarrier::getHeader(const Bytes& header)
+{
+    createStandardHeader(getSpecifierCode(), header);
+}
+
+void ShmRingCarrier::setParameters(const Bytes& header)
+{
+    YARP_UNUSED(header);
+}
+
+bool ShmRingCarrier::requireAck()
+{
+    return true;
+}
+
+bool ShmRingCarrier::isConnectionless()
+{
+    return false;
+}
+
+bool ShmRingCarrier::respondToHeader(ConnectionState& proto)
+{
+    // i am the receiver
+    int len = readYarpInt(proto);
+    if (len<=0 || len>SHM_RING_MAX_NAME) {
+        return false;
+    }
+    char buf[SHM_RING_MAX_NAME+1];
+    Bytes b(buf, len);
+    if (proto.is().readFull(b)!=len) {
+        return false;
+    }
+    buf[len] = '\0';
+
+    ShmRing *ring = new ShmRing();
+    bool ok = ring->attach(buf);
+    writeYarpInt(ok?1:0, proto);
+    if (!ok) {
+        YARP_SPRINTF1(Logger::get(), error,
+                      "cannot map shared memory %s, is the sender on another machine?",
+                      buf);
+        delete ring;
+        return false;
+    }
+    proto.os().flush();
+    TwoWayStream *delegate = proto.giveStreams();
+    proto.takeStreams(new ShmRingTwoWayStream(delegate, ring, false));
+    return proto.checkStreams();
+}
+
+bool ShmRingCarrier::expectReplyToHeader(ConnectionState& proto)
+{
+    // i am the sender
+    Name n(proto.getRoute().getCarrierName() + "://test");
+    size_t slots = SHM_RING_DEFAULT_SLOTS;
+    size_t size = SHM_RING_DEFAULT_SLOT_SIZE;
+    ConstString slotsValue = n.getCarrierModifier("slots");
+    if (slotsValue!="") {
+        slots = (size_t)NetType::toInt(slotsValue);
+    }
+    ConstString sizeValue = n.getCarrierModifier("size");
+    if (sizeValue!="") {
+        size = (size_t)NetType::toInt(sizeValue);
+    }
+
+    ShmRing *ring = new ShmRing();
+    if (!ring->create(slots, size)) {
+        YARP_SPRINTF2(Logger::get(), error,
+                      "cannot create shared memory ring (%d slots of %d bytes)",
+                      (int)slots, (int)size);
+        delete ring;
+        return false;
+    }
+    const ConstString& name = ring->getName();
+    writeYarpInt((int)name.length(), proto);
+    proto.os().write(Bytes((char*)name.c_str(), name.length()));
+    proto.os().flush();
+
+    // Once the receiver has mapped the segment, the name is not needed
+    // any more; removing it now means nothing is left behind if either
+    // side dies later.
+    int reply = readYarpInt(proto);
+    ring->unlink();
+    if (reply!=1) {
+        delete ring;
+        return false;
+    }
+    TwoWayStream *delegate = proto.giveStreams();
+    proto.takeStreams(new ShmRingTwoWayStream(delegate, ring, true));
+    return proto.checkStreams();
+}
@@ -7,6 +7,10 @@
 
 #include <yarp/os/impl/SocketTwoWayStream.h>
 #include <yarp/os/impl/NameConfig.h>
+#include <yarp/os/Network.h>
+
+#include <cstdlib>
+#include <cstring>
 
 #ifdef YARP_HAS_ACE
 #  include <ace/INET_Addr.h>
@@ -47,6 +51,7 @@ int SocketTwoWayStream::open(const Contact& address) {
 #endif
     if (result>=0) {
         happy = true;
+        configureZeroCopy();
     } else {
         YARP_SPRINTF2(Logger::get(),
                       debug,
@@ -62,6 +67,7 @@ int SocketTwoWayStream::open(ACE_SOCK_Acceptor& acceptor) {
     int result = acceptor.accept(stream);
     if (result>=0) {
         happy = true;
+        configureZeroCopy();
     }
     updateAddresses();
     return result;
@@ -138,3 +144,72 @@ int SocketTwoWayStream::getTypeOfService() {
                       (int *)&tos, &optlen);
     return tos;
 }
+
+void SocketTwoWayStream::hold(const Bytes& b) {
+    if (pending.length()==0) {
+        pending.allocate(SOCKET_TWO_WAY_STREAM_PENDING_SIZE);
+    }
+    memcpy(pending.get()+pendingLength, b.get(), b.length());
+    pendingLength += b.length();
+}
+
+void SocketTwoWayStream::writeBlocks(const Bytes *blocks, size_t count) {
+    if (!isOk()) {
+        pendingLength = 0;
+        return;
+    }
+    // Anything held back goes first, then the blocks, in as few gather
+    // writes as possible.
+    const int group = 64;
+    iovec iov[group];
+    int n = 0;
+    if (pendingLength>0) {
+        iov[n].iov_base = pending.get();
+        iov[n].iov_len = pendingLength;
+        n++;
+    }
+    size_t i = 0;
+    while (n>0 || i<count) {
+        while (n<group && i<count) {
+            if (blocks[i].length()>0) {
+                iov[n].iov_base = (char*)blocks[i].get();
+                iov[n].iov_len = blocks[i].length();
+                n++;
+            }
+            i++;
+        }
+        if (n==0) {
+            break;
+        }
+        YARP_SSIZE_T result;
+        if (haveWriteTimeout) {
+            result = stream.sendv_n(iov, n, &writeTimeout);
+        } else {
+            result = stream.sendv_n(iov, n);
+        }
+        n = 0;
+        if (result<0) {
+            happy = false;
+            YARP_DEBUG(Logger::get(), "bad socket write");
+            break;
+        }
+    }
+    pendingLength = 0;
+}
+
+bool SocketTwoWayStream::setZeroCopyThreshold(size_t threshold) {
+#ifdef YARP_HAS_ACE
+    return threshold==0;
+#else
+    return stream.set_zerocopy_threshold(threshold);
+#endif
+}
+
+void SocketTwoWayStream::configureZeroCopy() {
+    ConstString threshold = NetworkBase::getEnvironment("YARP_TCP_ZEROCOPY");
+    if (threshold!="") {
+        if (!setZeroCopyThreshold((size_t)atol(threshold.c_str()))) {
+            YARP_DEBUG(Logger::get(), "zero-copy sending is not available");
+        }
+    }
+}
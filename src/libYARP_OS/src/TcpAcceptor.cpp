@@ -34,7 +34,11 @@
 using namespace yarp::os::impl;
 using namespace yarp::os;
 
-#define BACKLOG                1
+// connections waiting to be accepted; when several processes or threads
+// connect to the same port at once (e.g. the name server while many
+// connections are being made), those that do not fit are retried by the
+// kernel only a second later
+#define BACKLOG                SOMAXCONN
 
 /**
  * An error handler that reaps the zombies.
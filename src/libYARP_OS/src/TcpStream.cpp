@@ -27,8 +27,23 @@
 
 // General files
 #include <sys/socket.h>
+#include <poll.h>
+#include <climits>
+#include <cerrno>
 #include <cstdio>
 
+#if defined(__linux__)
+#  include <linux/errqueue.h>
+#endif
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#  define YARP_TCP_ZEROCOPY
+#endif
+
+#ifndef IOV_MAX
+#  define IOV_MAX 16
+#endif
+
 #include <yarp/os/impl/TcpStream.h>
 
 using namespace yarp::os::impl;
@@ -39,6 +54,8 @@ using namespace yarp::os::impl;
 
 TcpStream::TcpStream() {
     sd = -1;
+    zerocopyThreshold = 0;
+    zerocopySent = 0;
 }
 
 TcpStream::~TcpStream() {
@@ -74,4 +91,137 @@ int TcpStream::get_remote_addr (sockaddr & sa) {
 }
 
 
+ssize_t TcpStream::sendv_n(const iovec iov[], int n) {
+    // Work on a copy, since partial writes require adjusting the list.
+    iovec local[IOV_MAX];
+    ssize_t total = 0;
+    size_t size = 0;
+    int at = 0;
+    for (int i=0; i<n; i++) {
+        size += iov[i].iov_len;
+    }
+    int flags = 0;
+#ifdef YARP_TCP_ZEROCOPY
+    bool zerocopy = (zerocopyThreshold>0 && size>=zerocopyThreshold);
+    unsigned int zerocopyStart = zerocopySent;
+#endif
+    while (at<n) {
+        int count = 0;
+        while (at+count<n && count<IOV_MAX) {
+            local[count] = iov[at+count];
+            count++;
+        }
+        int first = 0;
+        while (first<count) {
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = local+first;
+            msg.msg_iovlen = count-first;
+#ifdef YARP_TCP_ZEROCOPY
+            flags = zerocopy ? MSG_ZEROCOPY : 0;
+#endif
+            ssize_t result = ::sendmsg(sd, &msg, flags);
+            if (result<0) {
+                if (errno==EINTR) {
+                    continue;
+                }
+#ifdef YARP_TCP_ZEROCOPY
+                if (zerocopy && errno==ENOBUFS) {
+                    // Out of memory for pinned pages, copy instead.
+                    zerocopy = false;
+                    continue;
+                }
+#endif
+                return -1;
+            }
+#ifdef YARP_TCP_ZEROCOPY
+            if (zerocopy) {
+                zerocopySent++;
+            }
+#endif
+            total += result;
+            size_t done = (size_t)result;
+            while (first<count && done>=local[first].iov_len) {
+                done -= local[first].iov_len;
+                first++;
+            }
+            if (first<count) {
+                local[first].iov_base = (char*)local[first].iov_base + done;
+                local[first].iov_len -= done;
+            }
+        }
+        at += count;
+    }
+#ifdef YARP_TCP_ZEROCOPY
+    if (zerocopySent!=zerocopyStart) {
+        // The caller may reuse its memory as soon as we return.
+        if (!wait_zerocopy()) {
+            return -1;
+        }
+    }
+#endif
+    return total;
+}
+
+bool TcpStream::set_zerocopy_threshold(size_t threshold) {
+#ifdef YARP_TCP_ZEROCOPY
+    if (threshold>0) {
+        int one = 1;
+        if (setsockopt(sd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one))!=0) {
+            zerocopyThreshold = 0;
+            return false;
+        }
+    }
+    zerocopyThreshold = threshold;
+    return true;
+#else
+    zerocopyThreshold = 0;
+    return threshold==0;
+#endif
+}
+
+bool TcpStream::wait_zerocopy() {
+#ifdef YARP_TCP_ZEROCOPY
+    // Completions are reported on the socket error queue as ranges of
+    // send call numbers; wait until the last call we made is covered.
+    unsigned int last = zerocopySent-1;
+    while (true) {
+        char control[128];
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t result = ::recvmsg(sd, &msg, MSG_ERRQUEUE);
+        if (result<0) {
+            if (errno==EAGAIN || errno==EWOULDBLOCK || errno==EINTR) {
+                pollfd pfd;
+                pfd.fd = sd;
+                pfd.events = 0; // POLLERR is always reported
+                pfd.revents = 0;
+                if (::poll(&pfd, 1, -1)<0 && errno!=EINTR) {
+                    return false;
+                }
+                if (pfd.revents & (POLLHUP|POLLNVAL)) {
+                    return false;
+                }
+                continue;
+            }
+            return false;
+        }
+        for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            sock_extended_err *err = (sock_extended_err *)CMSG_DATA(cm);
+            if (err->ee_errno!=0 || err->ee_origin!=SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            // ee_data is the last call number of the completed range.
+            if ((int)(err->ee_data-last)>=0) {
+                return true;
+            }
+        }
+    }
+#else
+    return true;
+#endif
+}
+
 #endif
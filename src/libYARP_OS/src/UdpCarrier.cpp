@@ -59,6 +59,8 @@ bool yarp::os::impl::UdpCarrier::respondToHeader(ConnectionState& proto) {
         return false;
     }
 
+    stream->configureRecovery(proto.getRoute().getCarrierName());
+
     int myPort = stream->getLocalAddress().getPort();
     writeYarpInt(myPort, proto);
     proto.takeStreams(stream);
@@ -88,6 +90,7 @@ bool yarp::os::impl::UdpCarrier::expectReplyToHeader(ConnectionState& proto) {
         delete stream;
         return false;
     }
+    stream->configureRecovery(proto.getRoute().getCarrierName());
     proto.takeStreams(stream);
     return true;
 }
@@ -30,6 +30,7 @@
 #include <yarp/dev/IMotorEncoders.h>
 #include <yarp/dev/IMotor.h>
 #include <yarp/dev/IRemoteVariables.h>
+#include <yarp/dev/IRpcBatch.h>
 
 namespace yarp {
     namespace dev {
@@ -757,4 +758,10 @@ public:
 // protocol version
 #define VOCAB_PROTOCOL_VERSION VOCAB('p', 'r', 'o', 't')
 
+// several rpc commands in a single message, see IRpcBatch
+#define VOCAB_BATCH VOCAB4('b','t','c','h')
+
+// fields of the state streamed to a reader of the stateCompact:o port
+#define VOCAB_STATE_FIELDS VOCAB4('s','t','f','s')
+
 #endif // YARP_DEV_CONTROLBOARDINTERFACES_H
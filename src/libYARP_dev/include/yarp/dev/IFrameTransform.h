@@ -91,6 +91,26 @@ public:
     */
     virtual bool     getTransform (const std::string &target_frame_id, const std::string &source_frame_id, yarp::sig::Matrix &transform) = 0;
 
+    /**
+     Get the transform between two frames, as it was at a given time.
+     The transforms between each frame and its parent are interpolated
+     between the values received just before and just after the time.
+    * @param target_frame_id the name of target reference frame
+    * @param source_frame_id the name of source reference frame
+    * @param time the time, in seconds, as given by yarp::os::Time::now()
+    * @param transform the transformation matrix from source_frame_id to target_frame_id
+    * @return true/false, false also if the time is older than the values kept
+    * @note the default implementation only supports time 0, meaning the
+    * latest transform, and fails on any other time
+    */
+    virtual bool     getTransform (const std::string &target_frame_id, const std::string &source_frame_id, double time, yarp::sig::Matrix &transform)
+    {
+        if (time==0) {
+            return getTransform(target_frame_id, source_frame_id, transform);
+        }
+        return false;
+    }
+
     /**
      Register a transform between two frames.
      * @param target_frame_id the name of target reference frame
@@ -69,6 +69,8 @@ public:
 #define VOCAB_IMAP_SET_MAP            VOCAB3('s','e','t')
 #define VOCAB_IMAP_GET_MAP            VOCAB3('g','e','t')
 #define VOCAB_IMAP_GET_NAMES          VOCAB4('n','a','m','s')
+#define VOCAB_IMAP_GET_TILES          VOCAB4('g','t','i','l')
+#define VOCAB_IMAP_SET_TILES          VOCAB4('s','t','i','l')
 #define VOCAB_IMAP_CLEAR              VOCAB3('c','l','r')
 #define VOCAB_IMAP_REMOVE             VOCAB4('r','e','m','v')
 #define VOCAB_IMAP_LOAD_COLLECTION    VOCAB4('l','d','c','l')
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_DEV_IRPCBATCH_H
+#define YARP_DEV_IRPCBATCH_H
+
+#include <yarp/dev/api.h>
+
+namespace yarp {
+    namespace dev {
+        class IRpcBatch;
+    }
+}
+
+/**
+ * @ingroup dev_iface_motor
+ *
+ * Interface for network clients that can send several queries to the
+ * remote device in a single message, saving a round trip for each of
+ * them.
+ *
+ * Queries made by the calling thread between beginBatch() and endBatch()
+ * are not sent immediately: they return true and their results are
+ * written to the variables passed to them when endBatch() returns.
+ * Anything that is not a query, like a command changing the state of the
+ * device, first sends the queries collected so far and then is executed
+ * as usual.  Other threads are not affected by the batch.
+ *
+ * @code
+ * ibatch->beginBatch();
+ * for (int j=0; j<axes; j++) {
+ *     ilim->getLimits(j, &min[j], &max[j]);
+ *     ipos->getRefSpeed(j, &speed[j]);
+ * }
+ * bool ok = ibatch->endBatch();
+ * @endcode
+ */
+class YARP_dev_API yarp::dev::IRpcBatch
+{
+public:
+    /**
+     * Destructor.
+     */
+    virtual ~IRpcBatch() {}
+
+    /**
+     * Start collecting the queries made by the calling thread.
+     * @return true/false on success/failure, batches cannot be nested
+     */
+    virtual bool beginBatch() = 0;
+
+    /**
+     * Send the queries collected since beginBatch() and wait for all the
+     * replies.
+     * @return true if all the queries succeeded, false otherwise
+     */
+    virtual bool endBatch() = 0;
+};
+
+#endif // YARP_DEV_IRPCBATCH_H
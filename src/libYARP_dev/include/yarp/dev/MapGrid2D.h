@@ -12,6 +12,7 @@
 #include <yarp/sig/Vector.h>
 #include <yarp/math/Vec2D.h>
 #include <yarp/dev/api.h>
+#include <vector>
 
 /**
 * \file MapGrid2D.h contains the definition of a map type
@@ -47,6 +48,11 @@ namespace yarp
                 size_t m_height;
                 std::string m_map_name;
 
+                //distance of each cell from the closest obstacle, in cells, computed on demand
+                mutable std::vector<float> m_clearance;
+                mutable bool m_clearance_valid;
+                mutable double m_enlargement;   //of the enlarged cells around the obstacles, in meters, negative if unknown
+
                 struct
                 {
                     double x;     //in meters
@@ -57,7 +63,8 @@ namespace yarp
                 //std::vector<map_link> links_to_other_maps;
 
             private:
-                void enlargeCell(XYCell cell);
+                void computeClearance() const;
+                void computeDistances(bool enlarged_obstacles, std::vector<float>& distance) const;
                 CellData PixelToCellData(const yarp::sig::PixelRgb& pixin) const;
                 yarp::sig::PixelRgb CellDataToPixel(const CellData& pixin) const;
 
@@ -224,12 +231,58 @@ namespace yarp
                 /**
                 * Performs the obstacle enlargement operation. It's useful to set size to a value equal or larger to the robot bounding box.
                 * In this way a navigation algorithm can easly check obstacle collision by comparing the location of the center of the robot with cell value (free/occupied etc)
+                * The free cells closer than the enlargement to an obstacle (i.e. a wall, a keep-out area etc.) are marked as enlarged obstacles.
                 * @param size the size of the enlargment, in meters. If size>0 the requested enlargement is performed. If the function is called multipled times, the enlargement sums up.
                 If size <= 0 the enlargement stored in the map is cleaned up.
                 * @return true always.
                 */
                 bool   enlargeObstacles(double size);
 
+                /**
+                * Retrieves the euclidean distance of a cell from the closest obstacle (i.e. a wall, a keep-out area etc.), enlarged obstacles excluded.
+                * The distances of all the cells are computed at once, and computed again only after the map has been changed.
+                * @param cell is the cell location, referred to the top-left corner of the map.
+                * @param distance the distance, in meters, 0 if the cell is an obstacle, infinity if the map contains no obstacles.
+                * @return true if cell is valid cell inside the map, false otherwise.
+                */
+                bool   getClearance(XYCell cell, double& distance) const;
+
+                //-------------------------------tiles-------------------------------
+
+                /**
+                * The map is split in square tiles of tile_size cells per side (the tiles on the right and bottom borders may be smaller),
+                * so that only the parts of a map which changed can be copied to another map of the same size, e.g. over the network.
+                */
+                static const size_t tile_size = 32;
+
+                /**
+                * Retrieves the number of tiles along each side of the map.
+                */
+                void   getSize_in_tiles (size_t& x, size_t& y) const;
+
+                /**
+                * Checks if a tile has the same occupancy data and flags in two maps of the same size.
+                * @param x, y the column and row of the tile.
+                * @return true if the tiles are identical, false otherwise.
+                */
+                bool   isTileIdenticalTo(const MapGrid2D& otherMap, size_t x, size_t y) const;
+
+                /**
+                * Retrieves the occupancy data and the flags of a tile, run-length encoded.
+                * @param x, y the column and row of the tile.
+                * @param data the encoded tile.
+                * @return true if the tile is inside the map, false otherwise.
+                */
+                bool   getTileData      (size_t x, size_t y, std::string& data) const;
+
+                /**
+                * Sets the occupancy data and the flags of a tile, as retrieved by getTileData().
+                * @param x, y the column and row of the tile.
+                * @param data the encoded tile.
+                * @return true if the tile is inside the map and data is valid, false otherwise.
+                */
+                bool   setTileData      (size_t x, size_t y, const std::string& data);
+
                 //-------------------------------file access functions-------------------------------
 
                 /**
@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <fstream>
 #include <cmath>
+#include <limits>
 
 using namespace yarp::dev;
 using namespace yarp::sig;
@@ -35,6 +36,44 @@ string extractExtensionFromFile(string full_filename)
     return full_filename.substr(start, 3);
 }
 
+//squared distance of a cell that cannot reach any obstacle
+static const double clearance_inf = 1e20;
+
+//one dimensional squared distance transform of the sampled function f (Felzenszwalb and Huttenlocher, 2012):
+//d[q] = min over p of (q-p)^2 + f[p], computed as the lower envelope of the parabolas rooted in each sample.
+//v and z are work buffers, of size n and n+1.
+static void distanceTransform1D(const double* f, double* d, size_t n, size_t* v, double* z)
+{
+    if (n == 0) return;
+    size_t k = 0;
+    v[0] = 0;
+    z[0] = -std::numeric_limits<double>::infinity();
+    z[1] = +std::numeric_limits<double>::infinity();
+    for (size_t q = 1; q < n; q++)
+    {
+        double dq = double(q);
+        double s;
+        while (true)
+        {
+            double dv = double(v[k]);
+            s = ((f[q] + dq*dq) - (f[v[k]] + dv*dv)) / (2 * dq - 2 * dv);
+            if (s > z[k]) break;
+            k--;
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = +std::numeric_limits<double>::infinity();
+    }
+    k = 0;
+    for (size_t q = 0; q < n; q++)
+    {
+        while (z[k + 1] < double(q)) k++;
+        double dist = double(q) - double(v[k]);
+        d[q] = dist*dist + f[v[k]];
+    }
+}
+
 
 bool MapGrid2D::isIdenticalTo(const MapGrid2D& other) const
 {
@@ -66,6 +105,8 @@ MapGrid2D::MapGrid2D()
     m_map_flags.resize(m_width, m_height);
     m_occupied_thresh = 0.80;
     m_free_thresh = 0.20;
+    m_clearance_valid = false;
+    m_enlargement = 0;
     for (size_t y = 0; y < m_height; y++)
     {  
         for (size_t x = 0; x < m_width; x++)
@@ -166,6 +207,7 @@ bool MapGrid2D::setMapImage(yarp::sig::ImageOf<PixelRgb>& image)
             m_map_flags.safePixel(x, y) = PixelToCellData(image.safePixel(x, y));
         }
     }
+    m_clearance_valid = false;
     return true;
 }
 
@@ -183,56 +225,228 @@ bool MapGrid2D::enlargeObstacles(double size)
                 }
             }
         }
+        m_enlargement = 0;
         return true;
     }
 
-    size_t repeat_num = (size_t)(std::ceil(size*m_resolution));
-    for (size_t repeat = 0; repeat < repeat_num; repeat++)
+    if (!m_clearance_valid) computeClearance();
+    if (m_enlargement >= 0)
     {
-        //contains the cells to be enlarged;
-        std::vector<XYCell> list_of_cells;
+        //enlarged cells are not obstacles, so the distances do not change and the enlargements sum up
+        m_enlargement += size;
         for (size_t y = 0; y < m_height; y++)
         {
             for (size_t x = 0; x < m_width; x++)
             {
-                //this check could be optimized...
-                if (this->m_map_flags.safePixel(x, y) == MAP_CELL_KEEP_OUT ||
-                    this->m_map_flags.safePixel(x, y) == MAP_CELL_ENLARGED_OBSTACLE ||
-                    this->m_map_flags.safePixel(x, y) == MAP_CELL_WALL ||
-                    this->m_map_flags.safePixel(x, y) == MAP_CELL_UNKNOWN ||
-                    this->m_map_flags.safePixel(x, y) == MAP_CELL_TEMPORARY_OBSTACLE)
+                if (this->m_map_flags.safePixel(x, y) == MAP_CELL_FREE &&
+                    m_clearance[y*m_width + x] * m_resolution <= m_enlargement)
                 {
-                    list_of_cells.push_back(XYCell(x, y));
+                    this->m_map_flags.safePixel(x, y) = MAP_CELL_ENLARGED_OBSTACLE;
                 }
             }
         }
+        return true;
+    }
+
+    //enlarged cells of unknown size (e.g. of a map read from a file): enlarge them too
+    std::vector<float> distance;
+    computeDistances(true, distance);
+    for (size_t y = 0; y < m_height; y++)
+    {
+        for (size_t x = 0; x < m_width; x++)
+        {
+            if (this->m_map_flags.safePixel(x, y) == MAP_CELL_FREE &&
+                distance[y*m_width + x] * m_resolution <= size)
+            {
+                this->m_map_flags.safePixel(x, y) = MAP_CELL_ENLARGED_OBSTACLE;
+            }
+        }
+    }
+    return true;
+}
+
+void MapGrid2D::computeClearance() const
+{
+    computeDistances(false, m_clearance);
+    m_clearance_valid = true;
+
+    //the enlarged cells, if any, do not come from the distances just computed
+    m_enlargement = 0;
+    for (size_t y = 0; y < m_height && m_enlargement == 0; y++)
+    {
+        for (size_t x = 0; x < m_width; x++)
+        {
+            if (m_map_flags.safePixel(x, y) == MAP_CELL_ENLARGED_OBSTACLE)
+            {
+                m_enlargement = -1;
+                break;
+            }
+        }
+    }
+}
+
+void MapGrid2D::computeDistances(bool enlarged_obstacles, std::vector<float>& distance) const
+{
+    //exact euclidean distance transform, separable in a pass on the columns followed by a pass on the rows
+    size_t n = m_width*m_height;
+    distance.resize(n);
+    if (n == 0) return;
+    std::vector<double> grid(n);
+    for (size_t y = 0; y < m_height; y++)
+    {
+        for (size_t x = 0; x < m_width; x++)
+        {
+            CellData flag = m_map_flags.safePixel(x, y);
+            bool obstacle = (flag != MAP_CELL_FREE && (enlarged_obstacles || flag != MAP_CELL_ENLARGED_OBSTACLE));
+            grid[y*m_width + x] = obstacle ? 0 : clearance_inf;
+        }
+    }
+
+    size_t line = std::max(m_width, m_height);
+    std::vector<double> f(line);
+    std::vector<double> d(line);
+    std::vector<size_t> v(line);
+    std::vector<double> z(line + 1);
+    for (size_t x = 0; x < m_width; x++)
+    {
+        for (size_t y = 0; y < m_height; y++) f[y] = grid[y*m_width + x];
+        distanceTransform1D(f.data(), d.data(), m_height, v.data(), z.data());
+        for (size_t y = 0; y < m_height; y++) grid[y*m_width + x] = d[y];
+    }
+    for (size_t y = 0; y < m_height; y++)
+    {
+        double* row = &grid[y*m_width];
+        std::copy(row, row + m_width, f.begin());
+        distanceTransform1D(f.data(), row, m_width, v.data(), z.data());
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        distance[i] = (grid[i] < clearance_inf) ? float(std::sqrt(grid[i])) : std::numeric_limits<float>::infinity();
+    }
+}
+
+bool MapGrid2D::getClearance(XYCell cell, double& distance) const
+{
+    if (isInsideMap(cell) == false)
+    {
+        yError() << "Invalid cell requested " << cell.x << " " << cell.y;
+        return false;
+    }
+    if (!m_clearance_valid) computeClearance();
+    distance = m_clearance[cell.y*m_width + cell.x] * m_resolution;
+    return true;
+}
+
+const size_t MapGrid2D::tile_size;
+
+void MapGrid2D::getSize_in_tiles(size_t& x, size_t& y) const
+{
+    x = (m_width + tile_size - 1) / tile_size;
+    y = (m_height + tile_size - 1) / tile_size;
+}
+
+bool MapGrid2D::isTileIdenticalTo(const MapGrid2D& other, size_t x, size_t y) const
+{
+    if (m_width != other.m_width || m_height != other.m_height) return false;
+    size_t x0 = x*tile_size;
+    size_t y0 = y*tile_size;
+    size_t x1 = std::min(x0 + tile_size, m_width);
+    size_t y1 = std::min(y0 + tile_size, m_height);
+    for (size_t yc = y0; yc < y1; yc++) for (size_t xc = x0; xc < x1; xc++)
+        if (m_map_occupancy.safePixel(xc, yc) != other.m_map_occupancy.safePixel(xc, yc)) return false;
+    for (size_t yc = y0; yc < y1; yc++) for (size_t xc = x0; xc < x1; xc++)
+        if (m_map_flags.safePixel(xc, yc) != other.m_map_flags.safePixel(xc, yc)) return false;
+    return true;
+}
 
-        //process each cell of the list and enlarges it
-        for (auto it = list_of_cells.begin(); it != list_of_cells.end(); it++)
+bool MapGrid2D::getTileData(size_t x, size_t y, std::string& data) const
+{
+    size_t x0 = x*tile_size;
+    size_t y0 = y*tile_size;
+    if (x0 >= m_width || y0 >= m_height)
+    {
+        yError() << "Invalid tile requested " << x << " " << y;
+        return false;
+    }
+    size_t x1 = std::min(x0 + tile_size, m_width);
+    size_t y1 = std::min(y0 + tile_size, m_height);
+
+    //the occupancy data followed by the flags, row by row
+    std::vector<unsigned char> cells;
+    cells.reserve(2 * (x1 - x0)*(y1 - y0));
+    for (size_t yc = y0; yc < y1; yc++) for (size_t xc = x0; xc < x1; xc++)
+        cells.push_back(m_map_occupancy.safePixel(xc, yc));
+    for (size_t yc = y0; yc < y1; yc++) for (size_t xc = x0; xc < x1; xc++)
+        cells.push_back(m_map_flags.safePixel(xc, yc));
+
+    //PackBits: a header n<128 is followed by n+1 literal bytes, a header n>128 by a byte repeated 257-n times
+    data.clear();
+    size_t i = 0;
+    while (i < cells.size())
+    {
+        size_t run = 1;
+        while (i + run < cells.size() && run < 128 && cells[i + run] == cells[i]) run++;
+        if (run > 1)
         {
-            enlargeCell(*it);
+            data.push_back(char(257 - run));
+            data.push_back(char(cells[i]));
+            i += run;
+            continue;
         }
+        size_t literal = 1;
+        while (i + literal < cells.size() && literal < 128 &&
+               (i + literal + 1 >= cells.size() || cells[i + literal] != cells[i + literal + 1])) literal++;
+        data.push_back(char(literal - 1));
+        data.append((const char*)&cells[i], literal);
+        i += literal;
     }
     return true;
 }
 
-void MapGrid2D::enlargeCell(XYCell cell)
+bool MapGrid2D::setTileData(size_t x, size_t y, const std::string& data)
 {
-    int i = cell.x;
-    int j = cell.y;
-    int il = cell.x - 1>0 ? cell.x - 1 : 0;
-    int ir = cell.x + 1<(int)(m_width) - 1 ? cell.x + 1 : (int)(m_width)-1;
-    int ju = cell.y - 1>0 ? cell.y - 1 : 0;
-    int jd = cell.y + 1<(int)(m_height) - 1 ? cell.y + 1 : (int)(m_height)-1;
+    size_t x0 = x*tile_size;
+    size_t y0 = y*tile_size;
+    if (x0 >= m_width || y0 >= m_height)
+    {
+        yError() << "Invalid tile requested " << x << " " << y;
+        return false;
+    }
+    size_t x1 = std::min(x0 + tile_size, m_width);
+    size_t y1 = std::min(y0 + tile_size, m_height);
 
-    if (m_map_flags.pixel(il, j) == MAP_CELL_FREE) m_map_flags.pixel(il, j) = MAP_CELL_ENLARGED_OBSTACLE;
-    if (m_map_flags.pixel(ir, j) == MAP_CELL_FREE) m_map_flags.pixel(ir, j) = MAP_CELL_ENLARGED_OBSTACLE;
-    if (m_map_flags.pixel(i, ju) == MAP_CELL_FREE) m_map_flags.pixel(i, ju) = MAP_CELL_ENLARGED_OBSTACLE;
-    if (m_map_flags.pixel(i, jd) == MAP_CELL_FREE) m_map_flags.pixel(i, jd) = MAP_CELL_ENLARGED_OBSTACLE;
-    if (m_map_flags.pixel(il, ju) == MAP_CELL_FREE) m_map_flags.pixel(il, ju) = MAP_CELL_ENLARGED_OBSTACLE;
-    if (m_map_flags.pixel(il, jd) == MAP_CELL_FREE) m_map_flags.pixel(il, jd) = MAP_CELL_ENLARGED_OBSTACLE;
-    if (m_map_flags.pixel(ir, ju) == MAP_CELL_FREE) m_map_flags.pixel(ir, ju) = MAP_CELL_ENLARGED_OBSTACLE;
-    if (m_map_flags.pixel(ir, jd) == MAP_CELL_FREE) m_map_flags.pixel(ir, jd) = MAP_CELL_ENLARGED_OBSTACLE;
+    std::vector<unsigned char> cells;
+    cells.reserve(2 * (x1 - x0)*(y1 - y0));
+    size_t i = 0;
+    while (i < data.size())
+    {
+        size_t n = (unsigned char)data[i++];
+        if (n < 128)
+        {
+            if (i + n + 1 > data.size()) return false;
+            cells.insert(cells.end(), data.begin() + i, data.begin() + i + n + 1);
+            i += n + 1;
+        }
+        else if (n > 128)
+        {
+            if (i >= data.size()) return false;
+            cells.insert(cells.end(), 257 - n, (unsigned char)data[i++]);
+        }
+    }
+    if (cells.size() != 2 * (x1 - x0)*(y1 - y0))
+    {
+        yError() << "Invalid data of tile " << x << " " << y;
+        return false;
+    }
+
+    size_t c = 0;
+    for (size_t yc = y0; yc < y1; yc++) for (size_t xc = x0; xc < x1; xc++)
+        m_map_occupancy.safePixel(xc, yc) = cells[c++];
+    for (size_t yc = y0; yc < y1; yc++) for (size_t xc = x0; xc < x1; xc++)
+        m_map_flags.safePixel(xc, yc) = cells[c++];
+    m_clearance_valid = false;
+    return true;
 }
 
 bool MapGrid2D::loadROSParams(string ros_yaml_filename, string& pgm_occ_filename, double& resolution, double& orig_x, double& orig_y, double& orig_t )
@@ -459,6 +673,7 @@ bool MapGrid2D::loadMapYarpOnly(string yarp_filename)
 
 bool  MapGrid2D::loadFromFile(std::string map_file_with_path)
 {
+    m_clearance_valid = false;
     Property mapfile;
     string path = extractPathFromFile(map_file_with_path);
     if (mapfile.fromConfigFile(map_file_with_path) == false)
@@ -615,6 +830,7 @@ bool MapGrid2D::read(yarp::os::ConnectionReader& connection)
     m_map_name = buff;
     m_map_occupancy.resize(m_width, m_height);
     m_map_flags.resize(m_width, m_height);
+    m_clearance_valid = false;
     bool ok = true;
     unsigned char *mem = 0;
     int            memsize = 0;
@@ -839,6 +1055,7 @@ bool MapGrid2D::setSize_in_cells(size_t x, size_t y)
     m_map_flags.zero();
     m_width = x;
     m_height = y;
+    m_clearance_valid = false;
     return true;
 }
 
@@ -862,6 +1079,7 @@ bool MapGrid2D::setMapFlag(XYCell cell, map_flags flag)
         return false;
     }
     m_map_flags.safePixel(cell.x, cell.y) = flag;
+    m_clearance_valid = false;
     return true;
 }
 
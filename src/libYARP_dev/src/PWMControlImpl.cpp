@@ -25,14 +25,18 @@ bool ImplementPWMControl::initialize(int size, const int *amap, const double* du
     if (helper != 0)
         return false;
 
-    double *dummy = new double[size];
+    double *zeros = new double[size];
     for (int k = 0; k<size; k++)
-        dummy[k] = 0;
+        zeros[k] = 0;
 
-    helper = (void *)(new ControlBoardHelper(size, amap, dummy, dummy, dummy, 0, 0, dutyToPWM));
+    helper = (void *)(new ControlBoardHelper(size, amap, zeros, zeros, zeros, 0, 0, dutyToPWM));
     yAssert(helper != 0);
 
-    delete[] dummy;
+    delete[] zeros;
+
+    // used by the multi-joint methods
+    dummy = new double[size];
+    yAssert(dummy != 0);
     return true;
 }
 
@@ -48,6 +52,7 @@ bool ImplementPWMControl::uninitialize()
         delete castToMapper(helper);
         helper = 0;
     }
+    checkAndDestroy(dummy);
 
     return true;
 }
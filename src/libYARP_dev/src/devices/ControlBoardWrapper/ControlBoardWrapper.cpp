@@ -12,6 +12,7 @@
 #include <yarp/os/Log.h>
 #include <yarp/os/LogStream.h>
 
+#include <algorithm>
 #include <cstring>         // for memset function
 
 using namespace yarp::os;
@@ -37,6 +38,10 @@ ControlBoardWrapper::ControlBoardWrapper() :yarp::os::RateThread(20),
     base = 0;
     top = 0;
     subDeviceOwned = NULL;
+    stateSingle = 0;
+    stateDelta = (1 << StateMessage::ControlMode) | (1 << StateMessage::InteractionMode);
+    stateKeyframe = 50;
+    stateFrames = 0;
     _verb = false;
 
     // init ROS data
@@ -64,6 +69,10 @@ void ControlBoardWrapper::cleanup_yarpPorts()
     extendedOutputStatePort.interrupt();
     extendedOutputStatePort.close();
 
+    compactOutputStatePort.interrupt();
+    compactOutputStatePort.close();
+    stateSubscribers.clear();
+
     rpcData.destroy();
 }
 
@@ -306,6 +315,36 @@ bool ControlBoardWrapper::initialize_ROS()
     return success;
 }
 
+bool ControlBoardWrapper::checkStateParams(yarp::os::Searchable &prop)
+{
+    bool ok = true;
+    if(prop.check("stateSingle"))
+    {
+        stateSingle = StateMessage::parseFields(prop.find("stateSingle"), ok);
+        // only the fields of doubles can be sent as floats
+        stateSingle &= (1 << StateMessage::FirstIntField) - 1;
+    }
+    if(ok && prop.check("stateDelta"))
+    {
+        stateDelta = StateMessage::parseFields(prop.find("stateDelta"), ok);
+    }
+    if(!ok)
+    {
+        yError() << " *** ControlBoardWrapper2: unknown field name in 'stateSingle' or 'stateDelta' parameter *** ";
+        return false;
+    }
+    if(prop.check("stateKeyframe"))
+    {
+        stateKeyframe = prop.find("stateKeyframe").asInt();
+        if(stateKeyframe <= 0)
+        {
+            yError() << " *** ControlBoardWrapper2: 'stateKeyframe' parameter must be a positive integer *** ";
+            return false;
+        }
+    }
+    return true;
+}
+
 bool ControlBoardWrapper::initialize_YARP(yarp::os::Searchable &prop)
 {
     bool success = false;
@@ -374,6 +413,16 @@ bool ControlBoardWrapper::initialize_YARP(yarp::os::Searchable &prop)
                 break;
             }
             extendedOutputState_buffer.attach(extendedOutputStatePort);
+
+            // compact output state port, readers choose the fields through the rpc port
+            if(!compactOutputStatePort.open(rootName+"/stateCompact:o") )
+            {
+                yError() <<"Error opening port "<< rootName+"/stateCompact:o\n";
+                success = false;
+                break;
+            }
+            compactOutputStatePort.setReporter(stateSubscribers);
+            compactOutputState_buffer.attach(compactOutputStatePort);
             success = true;
         } break;
     }  // end switch
@@ -430,6 +479,11 @@ bool ControlBoardWrapper::open(Searchable& config)
         period = 20;
     }
 
+    if(!checkStateParams(prop))
+    {
+        return false;
+    }
+
     // check if we need to create subdevice or if they are
     // passed later on thorugh attachAll()
     if(prop.check("subdevice"))
@@ -610,6 +664,13 @@ bool ControlBoardWrapper::openDeferredAttach(Property& prop)
         yError() <<"Error total number of mapped joints ("<< totalJ <<") does not correspond to part joints (" << controlledJoints << ")";
         return false;
     }
+
+    if (!device.buildCopyPlan())
+    {
+        yError() << "ControlBoardWrapper input configuration for device " << partName << "has a wrong attach map.\n" << \
+                    "Each network must be mapped to a range of joints not overlapping with the others";
+        return false;
+    }
     return true;
 }
 
@@ -677,6 +738,7 @@ bool ControlBoardWrapper::openAndAttachSubDevice(Property& prop)
         device.lut[j].deviceEntry = 0;
         device.lut[j].offset = j;
     }
+    device.buildCopyPlan();
 
 
     if (!device.subdevices[0].attach(subDeviceOwned, subDevName))
@@ -840,15 +902,18 @@ void ControlBoardWrapper::run()
         yWarning() << "number of streaming intput messages to be read is " << inputStreamingPort.getPendingReads() << " and can overflow";
     }
 
-    // Update the time by averaging all timestamps
+    // Read the encoders once for all the state sent,
+    // then update the time by averaging all timestamps
     double joint_timeStamp = 0.0;
+    bool jointEncodersOk = true;
+    bool motorEncodersOk = true;
 
     for (unsigned int k = 0; k < device.subdevices.size(); k++)
     {
         int axes = device.subdevices[k].axes;
 
-        device.subdevices[k].refreshJointEncoders();
-        device.subdevices[k].refreshMotorEncoders();
+        jointEncodersOk = device.subdevices[k].refreshJointEncoders() && jointEncodersOk;
+        motorEncodersOk = device.subdevices[k].refreshMotorEncoders() && motorEncodersOk;
 
         for (int l = 0; l < axes; l++)
         {
@@ -864,51 +929,71 @@ void ControlBoardWrapper::run()
     {
         yarp::sig::Vector& v = outputPositionStatePort.prepare();
         v.resize(controlledJoints);
+        device.copyJointEncoders(v.data());
 
-        double *joint_encoders=v.data();
+        outputPositionStatePort.setEnvelope(time);
+        outputPositionStatePort.write();
+
+        // read only the fields somebody is listening to
+        bool extended = extendedOutputStatePort.getOutputCount() > 0;
+        int fields = extended ? StateMessage::AllFields : 0;
+        if (compactOutputStatePort.getOutputCount() > 0)
+        {
+            fields |= stateSubscribers.getFields();
+        }
+        readState(lastState, fields, jointEncodersOk, motorEncodersOk);
 
-        for (unsigned int k = 0; k < device.subdevices.size(); k++)
+        if (extended)
         {
-            int axes=device.subdevices[k].axes;
+            jointData &yarp_struct = extendedOutputState_buffer.get();
+
+            yarp_struct.jointPosition.resize(controlledJoints);
+            yarp_struct.jointVelocity.resize(controlledJoints);
+            yarp_struct.jointAcceleration.resize(controlledJoints);
+            yarp_struct.motorPosition.resize(controlledJoints);
+            yarp_struct.motorVelocity.resize(controlledJoints);
+            yarp_struct.motorAcceleration.resize(controlledJoints);
+            yarp_struct.torque.resize(controlledJoints);
+            yarp_struct.pwmDutycycle.resize(controlledJoints);
+            yarp_struct.current.resize(controlledJoints);
+            yarp_struct.controlMode.resize(controlledJoints);
+            yarp_struct.interactionMode.resize(controlledJoints);
 
-            for(int l = 0; l < axes; l++)
+            yarp::sig::VectorOf<double>* doubles[StateMessage::FirstIntField] = {
+                &yarp_struct.jointPosition, &yarp_struct.jointVelocity, &yarp_struct.jointAcceleration,
+                &yarp_struct.motorPosition, &yarp_struct.motorVelocity, &yarp_struct.motorAcceleration,
+                &yarp_struct.torque, &yarp_struct.pwmDutycycle, &yarp_struct.current };
+            for (int field = 0; field < StateMessage::FirstIntField; field++)
             {
-                joint_encoders[l]=device.subdevices[k].subDev_joint_encoders[l];
+                const double *data = lastState.getDoubles(field);
+                std::copy(data, data + controlledJoints, doubles[field]->getFirst());
             }
-            joint_encoders+=device.subdevices[k].axes; //jump to next group
-        }
+            const int *modes = lastState.getInts(StateMessage::ControlMode);
+            std::copy(modes, modes + controlledJoints, yarp_struct.controlMode.getFirst());
+            modes = lastState.getInts(StateMessage::InteractionMode);
+            std::copy(modes, modes + controlledJoints, yarp_struct.interactionMode.getFirst());
 
-        outputPositionStatePort.setEnvelope(time);
-        outputPositionStatePort.write();
+            int valid = lastState.valid;
+            yarp_struct.jointPosition_isValid       = (valid & (1 << StateMessage::JointPosition)) != 0;
+            yarp_struct.jointVelocity_isValid       = (valid & (1 << StateMessage::JointVelocity)) != 0;
+            yarp_struct.jointAcceleration_isValid   = (valid & (1 << StateMessage::JointAcceleration)) != 0;
+            yarp_struct.motorPosition_isValid       = (valid & (1 << StateMessage::MotorPosition)) != 0;
+            yarp_struct.motorVelocity_isValid       = (valid & (1 << StateMessage::MotorVelocity)) != 0;
+            yarp_struct.motorAcceleration_isValid   = (valid & (1 << StateMessage::MotorAcceleration)) != 0;
+            yarp_struct.torque_isValid              = (valid & (1 << StateMessage::Torque)) != 0;
+            yarp_struct.pwmDutycycle_isValid        = (valid & (1 << StateMessage::PwmDutycycle)) != 0;
+            yarp_struct.current_isValid             = (valid & (1 << StateMessage::Current)) != 0;
+            yarp_struct.controlMode_isValid         = (valid & (1 << StateMessage::ControlMode)) != 0;
+            yarp_struct.interactionMode_isValid     = (valid & (1 << StateMessage::InteractionMode)) != 0;
+
+            extendedOutputStatePort.setEnvelope(time);
+            extendedOutputState_buffer.write();
+        }
 
-        jointData &yarp_struct = extendedOutputState_buffer.get();
-
-        yarp_struct.jointPosition.resize(controlledJoints);
-        yarp_struct.jointVelocity.resize(controlledJoints);
-        yarp_struct.jointAcceleration.resize(controlledJoints);
-        yarp_struct.motorPosition.resize(controlledJoints);
-        yarp_struct.motorVelocity.resize(controlledJoints);
-        yarp_struct.motorAcceleration.resize(controlledJoints);
-        yarp_struct.torque.resize(controlledJoints);
-        yarp_struct.pwmDutycycle.resize(controlledJoints);
-        yarp_struct.current.resize(controlledJoints);
-        yarp_struct.controlMode.resize(controlledJoints);
-        yarp_struct.interactionMode.resize(controlledJoints);
-
-        yarp_struct.jointPosition_isValid       = getEncoders(yarp_struct.jointPosition.getFirst());
-        yarp_struct.jointVelocity_isValid       = getEncoderSpeeds(yarp_struct.jointVelocity.getFirst());
-        yarp_struct.jointAcceleration_isValid   = getEncoderAccelerations(yarp_struct.jointAcceleration.getFirst());
-        yarp_struct.motorPosition_isValid       = getMotorEncoders(yarp_struct.motorPosition.getFirst());
-        yarp_struct.motorVelocity_isValid       = getMotorEncoderSpeeds(yarp_struct.motorVelocity.getFirst());
-        yarp_struct.motorAcceleration_isValid   = getMotorEncoderAccelerations(yarp_struct.motorAcceleration.getFirst());
-        yarp_struct.torque_isValid              = getTorques(yarp_struct.torque.getFirst());
-        yarp_struct.pwmDutycycle_isValid        = getDutyCycles(yarp_struct.pwmDutycycle.getFirst());
-        yarp_struct.current_isValid             = getCurrents(yarp_struct.current.getFirst());
-        yarp_struct.controlMode_isValid         = getControlModes(yarp_struct.controlMode.getFirst());
-        yarp_struct.interactionMode_isValid     = getInteractionModes((yarp::dev::InteractionModeEnum* ) yarp_struct.interactionMode.getFirst());
-
-        extendedOutputStatePort.setEnvelope(time);
-        extendedOutputState_buffer.write();
+        if (compactOutputStatePort.getOutputCount() > 0)
+        {
+            writeCompactState();
+        }
     }
 
     if(useROS != ROS_disabled)
@@ -920,7 +1005,7 @@ void ControlBoardWrapper::run()
         ros_struct.velocity.resize(controlledJoints);
         ros_struct.effort.resize(controlledJoints);
 
-        getEncoders(ros_struct.position.data());
+        device.copyJointEncoders(ros_struct.position.data());
         getEncoderSpeeds(ros_struct.velocity.data());
         getTorques(ros_struct.effort.data());
 
@@ -944,6 +1029,107 @@ void ControlBoardWrapper::run()
     }
 }
 
+void ControlBoardWrapper::readState(StateMessage& state, int fields, bool jointEncodersOk, bool motorEncodersOk)
+{
+    state.resize(controlledJoints);
+    state.valid = 0;
+    for (int field = 0; field < StateMessage::FieldCount; field++)
+    {
+        if (!(fields & (1 << field)))
+        {
+            continue;
+        }
+        bool ok = false;
+        switch (field)
+        {
+            case StateMessage::JointPosition:
+                device.copyJointEncoders(state.getDoubles(field));
+                ok = jointEncodersOk;
+            break;
+            case StateMessage::JointVelocity:
+                ok = getEncoderSpeeds(state.getDoubles(field));
+            break;
+            case StateMessage::JointAcceleration:
+                ok = getEncoderAccelerations(state.getDoubles(field));
+            break;
+            case StateMessage::MotorPosition:
+                device.copyMotorEncoders(state.getDoubles(field));
+                ok = motorEncodersOk;
+            break;
+            case StateMessage::MotorVelocity:
+                ok = getMotorEncoderSpeeds(state.getDoubles(field));
+            break;
+            case StateMessage::MotorAcceleration:
+                ok = getMotorEncoderAccelerations(state.getDoubles(field));
+            break;
+            case StateMessage::Torque:
+                ok = getTorques(state.getDoubles(field));
+            break;
+            case StateMessage::PwmDutycycle:
+                ok = getDutyCycles(state.getDoubles(field));
+            break;
+            case StateMessage::Current:
+                ok = getCurrents(state.getDoubles(field));
+            break;
+            case StateMessage::ControlMode:
+                ok = getControlModes(state.getInts(field));
+            break;
+            case StateMessage::InteractionMode:
+                ok = getInteractionModes((yarp::dev::InteractionModeEnum*) state.getInts(field));
+            break;
+        }
+        if (ok)
+        {
+            state.valid |= 1 << field;
+        }
+    }
+}
+
+void ControlBoardWrapper::writeCompactState()
+{
+    int fields = stateSubscribers.getFields();
+    bool keyframe = stateSubscribers.takeNewSubscriber() || ++stateFrames >= stateKeyframe;
+    if (keyframe)
+    {
+        stateFrames = 0;
+    }
+    sentState.resize(controlledJoints);
+
+    // in between keyframes, the slowly changing fields are sent only when they change
+    if (!keyframe)
+    {
+        for (int field = 0; field < StateMessage::FieldCount; field++)
+        {
+            int bit = 1 << field;
+            if ((fields & stateDelta & bit) && !lastState.differs(sentState, bit))
+            {
+                fields &= ~bit;
+            }
+        }
+    }
+
+    StateMessage& msg = compactOutputState_buffer.get();
+    msg.resize(controlledJoints);
+    msg.fields = fields;
+    msg.single = stateSingle & fields;
+    msg.valid = 0;
+    msg.copyFields(lastState, fields);
+    sentState.copyFields(lastState, fields);
+
+    compactOutputStatePort.setEnvelope(time);
+    compactOutputState_buffer.write();
+}
+
+bool ControlBoardWrapper::subscribeState(const yarp::os::ConstString& port, int fields)
+{
+    if (port == "" || (fields & ~StateMessage::AllFields) != 0)
+    {
+        return false;
+    }
+    stateSubscribers.subscribe(port, fields);
+    return true;
+}
+
 //
 //  IPid Interface
 //
@@ -1507,26 +1693,7 @@ bool ControlBoardWrapper::getTargetPosition(const int j, double* ref)
 * @return true/false on success/failure.
 */
 bool ControlBoardWrapper::getTargetPositions(double *spds) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-
-        if (!p)
-            return false;
-
-        if (p->pos2)
-        {
-            ret=ret&&p->pos2->getTargetPosition(off+p->base, spds+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::pos2, &IPositionControl2::getTargetPositions, spds);
 }
 
 
@@ -2086,26 +2253,7 @@ bool ControlBoardWrapper::getRefSpeed(int j, double *ref) {
 * @return true/false on success/failure.
 */
 bool ControlBoardWrapper::getRefSpeeds(double *spds) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-
-        if (!p)
-            return false;
-
-        if (p->pos)
-        {
-            ret=ret&&p->pos->getRefSpeed(off+p->base, spds+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::pos, &IPositionControl::getRefSpeeds, spds);
 }
 
 
@@ -2212,26 +2360,7 @@ bool ControlBoardWrapper::getRefAcceleration(int j, double *acc) {
 * @return true/false on success or failure
 */
 bool ControlBoardWrapper::getRefAccelerations(double *accs) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-
-        if (!p)
-            return false;
-
-        if (p->pos)
-        {
-            ret=ret&&p->pos->getRefAcceleration(off+p->base, accs+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::pos, &IPositionControl::getRefAccelerations, accs);
 }
 
 
@@ -2566,47 +2695,11 @@ bool ControlBoardWrapper::getEncoder(int j, double *v) {
 }
 
 bool ControlBoardWrapper::getEncoders(double *encs) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iJntEnc)
-        {
-            ret=ret&&p->iJntEnc->getEncoder(off+p->base, encs+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iJntEnc, &IEncoders::getEncoders, encs);
 }
 
 bool ControlBoardWrapper::getEncodersTimed(double *encs, double *t) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iJntEnc)
-        {
-            ret=ret&&p->iJntEnc->getEncoderTimed(off+p->base, encs+l, t+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iJntEnc, &IEncodersTimed::getEncodersTimed, encs, t);
 }
 
 bool ControlBoardWrapper::getEncoderTimed(int j, double *v, double *t) {
@@ -2642,25 +2735,7 @@ bool ControlBoardWrapper::getEncoderSpeed(int j, double *sp) {
 }
 
 bool ControlBoardWrapper::getEncoderSpeeds(double *spds) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iJntEnc)
-        {
-            ret=ret&&p->iJntEnc->getEncoderSpeed(off+p->base, spds+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iJntEnc, &IEncoders::getEncoderSpeeds, spds);
 }
 
 bool ControlBoardWrapper::getEncoderAcceleration(int j, double *acc) {
@@ -2681,25 +2756,7 @@ bool ControlBoardWrapper::getEncoderAcceleration(int j, double *acc) {
 
 bool ControlBoardWrapper::getEncoderAccelerations(double *accs)
 {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iJntEnc)
-        {
-            ret=ret&&p->iJntEnc->getEncoderAcceleration(off+p->base, accs+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iJntEnc, &IEncoders::getEncoderAccelerations, accs);
 }
 
 /* IMotor */
@@ -2997,47 +3054,11 @@ bool ControlBoardWrapper::getMotorEncoder(int m, double *v) {
 }
 
 bool ControlBoardWrapper::getMotorEncoders(double *encs) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iMotEnc)
-        {
-            ret=ret&&p->iMotEnc->getMotorEncoder(off+p->base, encs+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iMotEnc, &IMotorEncoders::getMotorEncoders, encs, &SubDevice::totalMotors);
 }
 
 bool ControlBoardWrapper::getMotorEncodersTimed(double *encs, double *t) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iMotEnc)
-        {
-            ret=ret&&p->iMotEnc->getMotorEncoderTimed(off+p->base, encs, t);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iMotEnc, &IMotorEncoders::getMotorEncodersTimed, encs, t, &SubDevice::totalMotors);
 }
 
 bool ControlBoardWrapper::getMotorEncoderTimed(int m, double *v, double *t) {
@@ -3073,25 +3094,7 @@ bool ControlBoardWrapper::getMotorEncoderSpeed(int m, double *sp) {
 }
 
 bool ControlBoardWrapper::getMotorEncoderSpeeds(double *spds) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iMotEnc)
-        {
-            ret=ret&&p->iMotEnc->getMotorEncoderSpeed(off+p->base, spds+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iMotEnc, &IMotorEncoders::getMotorEncoderSpeeds, spds, &SubDevice::totalMotors);
 }
 
 bool ControlBoardWrapper::getMotorEncoderAcceleration(int m, double *acc) {
@@ -3112,25 +3115,7 @@ bool ControlBoardWrapper::getMotorEncoderAcceleration(int m, double *acc) {
 
 bool ControlBoardWrapper::getMotorEncoderAccelerations(double *accs)
 {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iMotEnc)
-        {
-            ret=ret&&p->iMotEnc->getMotorEncoderAcceleration(off+p->base, accs+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iMotEnc, &IMotorEncoders::getMotorEncoderAccelerations, accs, &SubDevice::totalMotors);
 }
 
 
@@ -3222,25 +3207,7 @@ bool ControlBoardWrapper::getAmpStatus(int j, int *v)
 
 bool ControlBoardWrapper::getCurrents(double *vals)
 {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->amp)
-        {
-            ret=ret&&p->amp->getCurrent(off+p->base, vals+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::amp, &IAmplifierControl::getCurrents, vals);
 }
 
 bool ControlBoardWrapper::getCurrent(int j, double *val)
@@ -3700,25 +3667,7 @@ bool ControlBoardWrapper::getJointType(int j, yarp::dev::JointTypeEnum& type)
 
 bool ControlBoardWrapper::getRefTorques(double *refs)
 {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iTorque)
-        {
-            ret=ret&&p->iTorque->getRefTorque(off+p->base, refs+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iTorque, &ITorqueControl::getRefTorques, refs);
 }
 
 bool ControlBoardWrapper::getRefTorque(int j, double *t)
@@ -3931,26 +3880,8 @@ bool ControlBoardWrapper::getTorque(int j, double *t)
 
 bool ControlBoardWrapper::getTorques(double *t)
 {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iTorque)
-        {
-            ret=ret&&p->iTorque->getTorque(off+p->base, t+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
- }
+    return device.readAll(&SubDevice::iTorque, &ITorqueControl::getTorques, t);
+}
 
 bool ControlBoardWrapper::getTorqueRange(int j, double *min, double *max)
 {
@@ -4060,25 +3991,7 @@ bool ControlBoardWrapper::getControlMode(int j, int *mode)
 
 bool ControlBoardWrapper::getControlModes(int *modes)
 {
-   bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iMode)
-        {
-            ret=ret&&p->iMode->getControlMode(off+p->base, modes+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iMode, &IControlMode::getControlModes, modes);
 }
 
 // iControlMode2
@@ -4300,26 +4213,7 @@ bool ControlBoardWrapper::getRefPosition(const int j, double* ref)
 }
 
 bool ControlBoardWrapper::getRefPositions(double *spds) {
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-
-        if (!p)
-            return false;
-
-        if (p->posDir)
-        {
-            ret=ret&&p->posDir->getRefPosition(off+p->base, spds+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::posDir, &IPositionDirect::getRefPositions, spds);
 }
 
 
@@ -4453,26 +4347,7 @@ bool ControlBoardWrapper::getRefVelocities(double* vels)
     if(verbose())
         yTrace();
 
-    bool ret=true;
-
-    for(int l=0;l<controlledJoints;l++)
-    {
-        int off=device.lut[l].offset;
-        int subIndex=device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-
-        if (!p)
-            return false;
-
-        if (p->vel2)
-        {
-            ret=ret&&p->vel2->getRefVelocity(off+p->base, vels+l);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::vel2, &IVelocityControl2::getRefVelocities, vels);
 }
 
 bool ControlBoardWrapper::getRefVelocities(const int n_joints, const int* joints, double* vels)
@@ -4604,25 +4479,7 @@ bool ControlBoardWrapper::getInteractionModes(int n_joints, int *joints, yarp::d
 
 bool ControlBoardWrapper::getInteractionModes(yarp::dev::InteractionModeEnum* modes)
 {
-    bool ret = true;
-
-    for(int j=0; j<controlledJoints; j++)
-    {
-        int off; try{off = device.lut.at(j).offset;} catch(...){yError() << "joint number " << j <<  " out of bound [0-"<< controlledJoints << "] for part " << partName; return false; }
-        int subIndex=device.lut[j].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p=device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iInteract)
-        {
-            ret=ret && p->iInteract->getInteractionMode(off+p->base, &modes[j]);
-        }
-        else
-            ret=false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iInteract, &IInteractionMode::getInteractionModes, modes);
 }
 
 bool ControlBoardWrapper::setInteractionMode(int j, yarp::dev::InteractionModeEnum mode)
@@ -4758,25 +4615,7 @@ bool ControlBoardWrapper::getRefDutyCycle(int j, double *v)
 
 bool ControlBoardWrapper::getRefDutyCycles(double *v)
 {
-    bool ret = true;
-
-    for (int l = 0; l<controlledJoints; l++)
-    {
-        int off = device.lut[l].offset;
-        int subIndex = device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p = device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iPWM)
-        {
-            ret = ret&&p->iPWM->getRefDutyCycle(off + p->base, v + l);
-        }
-        else
-            ret = false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iPWM, &IPWMControl::getRefDutyCycles, v);
 }
 
 bool ControlBoardWrapper::getDutyCycle(int j, double *v)
@@ -4798,25 +4637,7 @@ bool ControlBoardWrapper::getDutyCycle(int j, double *v)
 
 bool ControlBoardWrapper::getDutyCycles(double *v)
 {
-    bool ret = true;
-
-    for (int l = 0; l<controlledJoints; l++)
-    {
-        int off = device.lut[l].offset;
-        int subIndex = device.lut[l].deviceEntry;
-
-        yarp::dev::impl::SubDevice *p = device.getSubdevice(subIndex);
-        if (!p)
-            return false;
-
-        if (p->iPWM)
-        {
-            ret = ret&&p->iPWM->getDutyCycle(off + p->base, v + l);
-        }
-        else
-            ret = false;
-    }
-    return ret;
+    return device.readAll(&SubDevice::iPWM, &IPWMControl::getDutyCycles, v);
 }
 
 
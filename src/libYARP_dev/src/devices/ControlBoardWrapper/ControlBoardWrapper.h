@@ -39,6 +39,7 @@
 #include "SubDevice.h"
 #include "StreamingMessagesParser.h"
 #include "RPCMessagesParser.h"
+#include "StateMessage.h"
 
 // ROS state publisher
 #include <yarpRosHelper.h>
@@ -53,7 +54,7 @@
 
 #define PROTOCOL_VERSION_MAJOR 1
 #define PROTOCOL_VERSION_MINOR 9
-#define PROTOCOL_VERSION_TWEAK 0
+#define PROTOCOL_VERSION_TWEAK 2
 
 /*
  * To optimize memory allocation, for group of joints we can have one mem reserver for rpc port
@@ -186,6 +187,17 @@ YARP_DISABLE_DEPRECATED_WARNING
  * |   -            |  ROS_topicName | string  |  -             |   -           |  if ROS group is present    | set the name for ROS topic                                        | must start with a leading '/' |
  * |   -            |  ROS_nodeName  | string  |  -             |   -           |  if ROS group is present    | set the name for ROS node                                         | must start with a leading '/' |
  * |   -            |  jointNames    | string  |  -             |   -           |  deprecated                 | joints names are now got from attached motionControl device       | names order must match with the joint order, from 0 to N |
+ * | stateSingle    |      -         | list    |  -             |   -           | No                          | fields of the stateCompact:o port sent as 32 bit floats           | like (motorPosition current), see below for the names |
+ * | stateDelta     |      -         | list    |  -             | (controlMode interactionMode) | No          | fields of the stateCompact:o port sent only when they change      | - |
+ * | stateKeyframe  |      -         | int     | periods        |   50          | No                          | all the fields of the stateCompact:o port are sent at least once every stateKeyframe periods | - |
+ *
+ * Besides stateExt:o, which always streams the whole jointData structure,
+ * the state is streamed on the stateCompact:o port in a fixed binary layout
+ * carrying only the fields asked for by its readers with the
+ * [set] [stfs] mask portname rpc command.  The field names are
+ * jointPosition, jointVelocity, jointAcceleration, motorPosition,
+ * motorVelocity, motorAcceleration, torque, pwmDutycycle, current,
+ * controlMode and interactionMode.
  *
  * ROS message type used is sensor_msgs/JointState.msg (http://docs.ros.org/api/sensor_msgs/html/msg/JointState.html)
  * Some example of configuration files:
@@ -304,6 +316,17 @@ private:
     yarp::os::PortWriterBuffer<jointData>           extendedOutputState_buffer;
     yarp::os::Port extendedOutputStatePort;         // Port /stateExt:o streaming out the struct with the robot data
 
+    // Port /stateCompact:o streaming out the fields of the state its readers asked for
+    yarp::os::PortWriterBuffer<yarp::dev::impl::StateMessage> compactOutputState_buffer;
+    yarp::os::Port compactOutputStatePort;
+    yarp::dev::impl::StateSubscribers stateSubscribers;   // fields asked for by each reader of stateCompact:o
+    yarp::dev::impl::StateMessage lastState;        // state read in the last period
+    yarp::dev::impl::StateMessage sentState;        // state last sent on stateCompact:o
+    int stateSingle;                                // fields sent as 32 bit floats
+    int stateDelta;                                 // fields sent only when they change
+    int stateKeyframe;                              // periods between messages with all the fields
+    int stateFrames;                                // periods since the last message with all the fields
+
     // ROS state publisher
     ROSTopicUsageType                                   useROS;                     // decide if open ROS topic or not
     std::vector<std::string>                            jointNames;                 // name of the joints
@@ -336,6 +359,9 @@ private:
     bool checkROSParams(yarp::os::Searchable &config);
     bool initialize_ROS();
     bool initialize_YARP(yarp::os::Searchable &prop);
+    bool checkStateParams(yarp::os::Searchable &prop);
+    void readState(yarp::dev::impl::StateMessage& state, int fields, bool jointEncodersOk, bool motorEncodersOk);
+    void writeCompactState();
     void cleanup_yarpPorts();
 
     // Default usage
@@ -364,6 +390,14 @@ public:
     */
     bool verbose() const { return _verb; }
 
+    /**
+    * Choose the fields of the state streamed to a reader of the stateCompact:o port.
+    * @param port the name of the reader
+    * @param fields a mask of StateMessage fields
+    * @return true if the fields are known
+    */
+    bool subscribeState(const yarp::os::ConstString& port, int fields);
+
     /* Return id of this device */
     yarp::os::ConstString getId() { return partName; };
 
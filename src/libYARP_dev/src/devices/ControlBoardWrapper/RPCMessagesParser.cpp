@@ -1673,6 +1673,33 @@ bool RPCMessagesParser::respond(const yarp::os::Bottle& cmd, yarp::os::Bottle& r
 
     int code = cmd.get(0).asVocab();
 
+    if (code == VOCAB_BATCH)
+    {
+        // [btch] (cmd1) (cmd2) ..., one list in the reply for each command
+        for (int i = 1; i < cmd.size(); i++)
+        {
+            Bottle* sub = cmd.get(i).asList();
+            Bottle& subResponse = response.addList();
+            if (sub == YARP_NULLPTR || sub->get(0).asVocab() == VOCAB_BATCH)
+            {
+                subResponse.addVocab(VOCAB_FAILED);
+                continue;
+            }
+            respond(*sub, subResponse);
+        }
+        return true;
+    }
+
+    if (code == VOCAB_SET && cmd.get(1).asVocab() == VOCAB_STATE_FIELDS)
+    {
+        // [set] [stfs] mask portname, the fields streamed to portname by stateCompact:o
+        if (ControlBoardWrapper_p->subscribeState(cmd.get(3).asString(), cmd.get(2).asInt()))
+            response.addVocab(VOCAB_OK);
+        else
+            response.addVocab(VOCAB_FAILED);
+        return true;
+    }
+
     if(cmd.size() < 2)
     {
         ok = false;
@@ -2858,6 +2885,7 @@ bool RPCMessagesParser::initialize()
     addUsage("[set] [adi] $iAxisNumber", "disable (amplifier for) the given axis");
     addUsage("[get] [acu] $iAxisNumber", "get current for the given axis");
     addUsage("[get] [acus]", "get current for all axes");
+    addUsage("[set] [stfs] $iFieldMask $sPortName", "choose the fields streamed to a reader of the stateCompact:o port");
 
     return ok;
 }
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include "StateMessage.h"
+
+#include <yarp/conf/system.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/ConnectionWriter.h>
+#include <yarp/os/LockGuard.h>
+#include <yarp/os/PortInfo.h>
+#include <yarp/os/Vocab.h>
+
+#include <algorithm>
+
+using namespace yarp::os;
+using namespace yarp::dev::impl;
+
+#define VOCAB_STATE_MESSAGE VOCAB4('s','t','a','t')
+
+static const char *fieldNames[StateMessage::FieldCount] = {
+    "jointPosition",
+    "jointVelocity",
+    "jointAcceleration",
+    "motorPosition",
+    "motorVelocity",
+    "motorAcceleration",
+    "torque",
+    "pwmDutycycle",
+    "current",
+    "controlMode",
+    "interactionMode"
+};
+
+YARP_BEGIN_PACK
+class StateMessageHeader
+{
+public:
+    NetInt32 tag;
+    NetInt32 joints;
+    NetInt32 fields;
+    NetInt32 valid;
+    NetInt32 single;
+};
+YARP_END_PACK
+
+
+int StateMessage::parseFields(const Value& names, bool& ok)
+{
+    ok = true;
+    Bottle list;
+    if (names.isList()) {
+        list = *names.asList();
+    } else {
+        list.add(names);
+    }
+    int mask = 0;
+    for (int i = 0; i < list.size(); i++) {
+        ConstString name = list.get(i).asString();
+        int field = 0;
+        while (field < FieldCount && name != fieldNames[field]) {
+            field++;
+        }
+        if (field == FieldCount) {
+            ok = false;
+            continue;
+        }
+        mask |= 1 << field;
+    }
+    return mask;
+}
+
+
+const char *StateMessage::getFieldName(int field)
+{
+    return (field >= 0 && field < FieldCount) ? fieldNames[field] : "";
+}
+
+
+StateMessage::StateMessage() :
+        fields(0),
+        valid(0),
+        single(0),
+        joints(0)
+{
+}
+
+
+void StateMessage::resize(int joints)
+{
+    this->joints = joints;
+    doubleData.resize(FirstIntField * joints);
+    intData.resize((FieldCount - FirstIntField) * joints);
+}
+
+
+void StateMessage::copyFields(const StateMessage& other, int mask)
+{
+    for (int field = 0; field < FieldCount; field++) {
+        if (!(mask & (1 << field))) {
+            continue;
+        }
+        if (field < FirstIntField) {
+            std::copy(other.getDoubles(field), other.getDoubles(field) + joints, getDoubles(field));
+        } else {
+            std::copy(other.getInts(field), other.getInts(field) + joints, getInts(field));
+        }
+    }
+    valid = (valid & ~mask) | (other.valid & mask);
+}
+
+
+bool StateMessage::differs(const StateMessage& other, int mask) const
+{
+    if ((valid ^ other.valid) & mask) {
+        return true;
+    }
+    for (int field = 0; field < FieldCount; field++) {
+        if (!(mask & (1 << field))) {
+            continue;
+        }
+        if (field < FirstIntField) {
+            if (!std::equal(getDoubles(field), getDoubles(field) + joints, other.getDoubles(field))) {
+                return true;
+            }
+        } else {
+            if (!std::equal(getInts(field), getInts(field) + joints, other.getInts(field))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+bool StateMessage::read(ConnectionReader& connection)
+{
+    StateMessageHeader header = {};
+    if (!connection.expectBlock((char*)&header, sizeof(header))) {
+        return false;
+    }
+    // the number of joints comes from the network, check it before
+    // allocating anything
+    if (header.tag != VOCAB_STATE_MESSAGE || header.joints < 0 ||
+            header.joints > MaxJoints || (header.fields & ~AllFields) != 0) {
+        return false;
+    }
+    if (header.joints != joints) {
+        resize(header.joints);
+    }
+    fields = header.fields;
+    valid = header.valid & AllFields;
+    single = header.single & fields;
+
+    for (int field = 0; field < FieldCount; field++) {
+        if (!(fields & (1 << field))) {
+            continue;
+        }
+        bool ok;
+        if (field >= FirstIntField) {
+#ifdef YARP_LITTLE_ENDIAN
+            ok = connection.expectBlock((char*)getInts(field), joints * sizeof(NetInt32));
+#else
+            netInts.resize(joints);
+            ok = connection.expectBlock((char*)netInts.data(), joints * sizeof(NetInt32));
+            std::copy(netInts.begin(), netInts.end(), getInts(field));
+#endif
+        } else if (single & (1 << field)) {
+            singleData.resize(joints);
+            ok = connection.expectBlock((char*)singleData.data(), joints * sizeof(NetFloat32));
+            std::copy(singleData.begin(), singleData.end(), getDoubles(field));
+        } else {
+#ifdef YARP_LITTLE_ENDIAN
+            ok = connection.expectBlock((char*)getDoubles(field), joints * sizeof(NetFloat64));
+#else
+            netDoubles.resize(joints);
+            ok = connection.expectBlock((char*)netDoubles.data(), joints * sizeof(NetFloat64));
+            std::copy(netDoubles.begin(), netDoubles.end(), getDoubles(field));
+#endif
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return !connection.isError();
+}
+
+
+bool StateMessage::write(ConnectionWriter& connection)
+{
+    StateMessageHeader header = {};
+    header.tag = VOCAB_STATE_MESSAGE;
+    header.joints = joints;
+    header.fields = fields;
+    header.valid = valid;
+    header.single = single & fields;
+    connection.appendBlock((char*)&header, sizeof(header));
+
+    // the converted copies have to stay around until the message is sent
+    singleData.resize(FirstIntField * joints);
+#ifndef YARP_LITTLE_ENDIAN
+    netDoubles.resize(FirstIntField * joints);
+    netInts.resize((FieldCount - FirstIntField) * joints);
+#endif
+    for (int field = 0; field < FieldCount; field++) {
+        if (!(fields & (1 << field))) {
+            continue;
+        }
+        if (field >= FirstIntField) {
+#ifdef YARP_LITTLE_ENDIAN
+            connection.appendExternalBlock((char*)getInts(field), joints * sizeof(NetInt32));
+#else
+            NetInt32 *converted = &netInts[(field - FirstIntField) * joints];
+            std::copy(getInts(field), getInts(field) + joints, converted);
+            connection.appendExternalBlock((char*)converted, joints * sizeof(NetInt32));
+#endif
+        } else if (header.single & (1 << field)) {
+            NetFloat32 *converted = &singleData[field * joints];
+            std::copy(getDoubles(field), getDoubles(field) + joints, converted);
+            connection.appendExternalBlock((char*)converted, joints * sizeof(NetFloat32));
+        } else {
+#ifdef YARP_LITTLE_ENDIAN
+            connection.appendExternalBlock((char*)getDoubles(field), joints * sizeof(NetFloat64));
+#else
+            NetFloat64 *converted = &netDoubles[field * joints];
+            std::copy(getDoubles(field), getDoubles(field) + joints, converted);
+            connection.appendExternalBlock((char*)converted, joints * sizeof(NetFloat64));
+#endif
+        }
+    }
+    return !connection.isError();
+}
+
+
+StateSubscribers::StateSubscribers() :
+        fields(0),
+        newSubscriber(false)
+{
+}
+
+
+void StateSubscribers::subscribe(const ConstString& port, int fields)
+{
+    LockGuard guard(mutex);
+    subscribers[port] = fields;
+    updateFields();
+    newSubscriber = true;
+}
+
+
+void StateSubscribers::clear()
+{
+    LockGuard guard(mutex);
+    subscribers.clear();
+    fields = 0;
+    newSubscriber = false;
+}
+
+
+int StateSubscribers::getFields()
+{
+    LockGuard guard(mutex);
+    return fields;
+}
+
+
+bool StateSubscribers::takeNewSubscriber()
+{
+    LockGuard guard(mutex);
+    bool ret = newSubscriber;
+    newSubscriber = false;
+    return ret;
+}
+
+
+void StateSubscribers::report(const PortInfo& info)
+{
+    if (info.tag != PortInfo::PORTINFO_CONNECTION || info.incoming || info.created) {
+        return;
+    }
+    LockGuard guard(mutex);
+    if (subscribers.erase(info.targetName) > 0) {
+        updateFields();
+    }
+}
+
+
+void StateSubscribers::updateFields()
+{
+    // with the mutex held
+    fields = 0;
+    for (std::map<ConstString, int>::iterator it = subscribers.begin(); it != subscribers.end(); ++it) {
+        fields |= it->second;
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_DEV_CONTROLBOARDWRAPPER_STATEMESSAGE_H
+#define YARP_DEV_CONTROLBOARDWRAPPER_STATEMESSAGE_H
+
+#include <yarp/os/ConstString.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/NetFloat32.h>
+#include <yarp/os/NetFloat64.h>
+#include <yarp/os/NetInt32.h>
+#include <yarp/os/Portable.h>
+#include <yarp/os/PortReport.h>
+#include <yarp/os/Value.h>
+
+#include <map>
+#include <vector>
+
+namespace yarp {
+    namespace dev {
+        namespace impl {
+            class StateMessage;
+            class StateSubscribers;
+        }
+    }
+}
+
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+/*
+ * The state of the joints streamed by the ControlBoardWrapper on its
+ * stateCompact:o port, a fixed layout alternative to jointData carrying
+ * only the fields asked for by the readers of the port.
+ *
+ * On the wire: a header with the number of joints and three masks of
+ * fields (the ones carried, the ones read successfully from the device,
+ * the ones carried as 32 bit floats), then an array for each field
+ * carried, in the order of the Field enum.  All values are little
+ * endian (NetInt32, NetFloat64 and NetFloat32), so on little endian
+ * hosts the arrays are sent and received without copies.
+ */
+class yarp::dev::impl::StateMessage : public yarp::os::Portable
+{
+public:
+    enum Field
+    {
+        JointPosition,
+        JointVelocity,
+        JointAcceleration,
+        MotorPosition,
+        MotorVelocity,
+        MotorAcceleration,
+        Torque,
+        PwmDutycycle,
+        Current,
+        ControlMode,        // integer fields from here on
+        InteractionMode,
+        FieldCount
+    };
+
+    static const int FirstIntField = ControlMode;
+    static const int AllFields = (1 << FieldCount) - 1;
+
+    // messages with more joints than this are rejected when read
+    static const int MaxJoints = 1024;
+
+    /**
+     * The mask of the fields named in a list, like (jointPosition torque).
+     * @param ok set to false if some name is not known
+     */
+    static int parseFields(const yarp::os::Value& names, bool& ok);
+
+    static const char *getFieldName(int field);
+
+    StateMessage();
+
+    void resize(int joints);
+    int getJoints() const { return joints; }
+
+    double *getDoubles(int field) { return doubleData.data() + field * joints; }
+    const double *getDoubles(int field) const { return doubleData.data() + field * joints; }
+    int *getInts(int field) { return intData.data() + (field - FirstIntField) * joints; }
+    const int *getInts(int field) const { return intData.data() + (field - FirstIntField) * joints; }
+
+    /**
+     * Copy some fields, and whether they are valid, from another message
+     * with the same number of joints.
+     */
+    void copyFields(const StateMessage& other, int mask);
+
+    /**
+     * @return true if some of the fields differ from the ones of another
+     * message, or are valid in only one of them
+     */
+    bool differs(const StateMessage& other, int mask) const;
+
+    int fields;     // fields carried
+    int valid;      // fields read successfully
+    int single;     // double fields carried as 32 bit floats
+
+    virtual bool read(yarp::os::ConnectionReader& connection) override;
+    virtual bool write(yarp::os::ConnectionWriter& connection) override;
+
+private:
+    int joints;
+    std::vector<double> doubleData;
+    std::vector<int> intData;
+    std::vector<yarp::os::NetFloat32> singleData;
+#ifndef YARP_LITTLE_ENDIAN
+    std::vector<yarp::os::NetFloat64> netDoubles;
+    std::vector<yarp::os::NetInt32> netInts;
+#endif
+};
+
+
+/*
+ * The fields each reader of the stateCompact:o port asked for.  Readers
+ * are forgotten when their connection is closed.
+ */
+class yarp::dev::impl::StateSubscribers : public yarp::os::PortReport
+{
+public:
+    StateSubscribers();
+
+    void subscribe(const yarp::os::ConstString& port, int fields);
+    void clear();
+
+    /**
+     * @return the fields asked for by at least one reader
+     */
+    int getFields();
+
+    /**
+     * @return true once after a reader subscribed, so that it can be
+     * sent all the fields at once
+     */
+    bool takeNewSubscriber();
+
+    virtual void report(const yarp::os::PortInfo& info) override;
+
+private:
+    void updateFields();
+
+    yarp::os::Mutex mutex;
+    std::map<yarp::os::ConstString, int> subscribers;
+    int fields;
+    bool newSubscriber;
+};
+
+#endif // DOXYGEN_SHOULD_SKIP_THIS
+
+#endif // YARP_DEV_CONTROLBOARDWRAPPER_STATEMESSAGE_H
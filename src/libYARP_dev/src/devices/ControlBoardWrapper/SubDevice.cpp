@@ -23,6 +23,9 @@ SubDevice::SubDevice() :
     base(-1),
     top(-1),
     axes(0),
+    totalAxes(0),
+    totalMotors(0),
+    wrapBase(0),
     configuredF(false),
     parent(0),
     subdevice(0),
@@ -114,6 +117,8 @@ void SubDevice::detach()
     iTimed=0;
     iInteract=0;
     iVar = 0;
+    totalAxes=0;
+    totalMotors=0;
     configuredF=false;
     attachedF=false;
 }
@@ -272,6 +277,13 @@ bool SubDevice::attach(yarp::dev::PolyDriver *d, const std::string &k)
         return false;
     }
 
+    if (top>=deviceJoints)
+    {
+        yError("ControlBoarWrapper for part <%s>: check device configuration, attached device has '%d' joints, \
+                cannot map joints %d to %d of %s.", parentName.c_str(), deviceJoints, base, top, k.c_str());
+        return false;
+    }
+
     int subdevAxes;
     if(!pos || !pos->getAxes(&subdevAxes))
     {
@@ -280,6 +292,45 @@ bool SubDevice::attach(yarp::dev::PolyDriver *d, const std::string &k)
                  return false;
     }
 
+    totalAxes=deviceJoints;
+    totalMotors=deviceJoints;
+    if (iMotEnc && (!iMotEnc->getNumberOfMotorEncoders(&totalMotors) || totalMotors<=0))
+    {
+        yWarning("ControlBoardWrapper for part <%s>: cannot read the number of motors of %s, assuming one per joint.", parentName.c_str(), k.c_str());
+        totalMotors=deviceJoints;
+    }
     attachedF=true;
     return true;
 }
+
+bool WrappedDevice::buildCopyPlan()
+{
+    for (unsigned int k=0; k<subdevices.size(); k++)
+        subdevices[k].wrapBase=-1;
+
+    for (unsigned int j=0; j<lut.size(); j++)
+    {
+        SubDevice *p=getSubdevice(lut[j].deviceEntry);
+        if (!p)
+            return false;
+        if (lut[j].offset==0)
+        {
+            if (p->wrapBase!=-1)
+                return false;
+            p->wrapBase=j;
+        }
+    }
+
+    for (unsigned int k=0; k<subdevices.size(); k++)
+    {
+        int first=subdevices[k].wrapBase;
+        if (first<0 || first+subdevices[k].axes>(int)lut.size())
+            return false;
+        for (int l=0; l<subdevices[k].axes; l++)
+        {
+            if (lut[first+l].deviceEntry!=(int)k || lut[first+l].offset!=l)
+                return false;
+        }
+    }
+    return true;
+}
@@ -29,6 +29,7 @@
 #include <yarp/os/Semaphore.h>
 #include <yarp/dev/Wrapper.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -55,6 +56,7 @@ namespace yarp {
         namespace impl {
             class SubDevice;
             class WrappedDevice;
+            template <class T> class AxesBuffer;
         }
     }
 }
@@ -62,6 +64,38 @@ namespace yarp {
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
+// axes of a device read on the stack, devices with more axes use the heap
+#define SUBDEVICE_STACK_AXES 64
+
+/*
+ * Temporary storage for a value per axis of a device, when only some of
+ * the axes are mapped by the wrapper.  Not a member of SubDevice so that
+ * the wrapper can be read from several threads at once.
+ */
+template <class T>
+class yarp::dev::impl::AxesBuffer
+{
+public:
+    explicit AxesBuffer(int n) : ptr(local)
+    {
+        if (n>SUBDEVICE_STACK_AXES)
+        {
+            heap.resize(n);
+            ptr=&heap[0];
+        }
+    }
+
+    inline T *data() { return ptr; }
+
+private:
+    T local[SUBDEVICE_STACK_AXES];
+    std::vector<T> heap;
+    T *ptr;
+
+    AxesBuffer(const AxesBuffer&);
+    AxesBuffer& operator=(const AxesBuffer&);
+};
+
 /*
 * An Helper class for the controlBoardWrapper
 * It maps only a subpart of the underlying device.
@@ -74,6 +108,9 @@ public:
     int base;
     int top;
     int axes;
+    int totalAxes;  // axes of the attached device, base..top may be just some of them
+    int totalMotors;  // motors of the attached device, they may be more than its axes
+    int wrapBase;   // first joint of the wrapper mapped to base
 
     bool configuredF;
 
@@ -117,22 +154,59 @@ public:
 
     bool configure(int base, int top, int axes, const std::string &id, yarp::dev::ControlBoardWrapper *_parent);
 
-    inline void refreshJointEncoders()
+    inline bool refreshJointEncoders()
     {
-        for(int j=base, idx=0; j<(base+axes); j++, idx++)
-        {
-            if(iJntEnc)
-                iJntEnc->getEncoderTimed(j, &subDev_joint_encoders[idx], &jointEncodersTimes[idx]);
-        }
+        return readAxes(iJntEnc, &yarp::dev::IEncodersTimed::getEncodersTimed,
+                        subDev_joint_encoders.data(), jointEncodersTimes.data(), totalAxes);
     }
 
-    inline void refreshMotorEncoders()
+    inline bool refreshMotorEncoders()
     {
-        for(int j=base, idx=0; j<(base+axes); j++, idx++)
-        {
-            if(iMotEnc)
-                iMotEnc->getMotorEncoderTimed(j, &subDev_motor_encoders[idx], &motorEncodersTimes[idx]);
-        }
+        return readAxes(iMotEnc, &yarp::dev::IMotorEncoders::getMotorEncodersTimed,
+                        subDev_motor_encoders.data(), motorEncodersTimes.data(), totalMotors);
+    }
+
+    /*
+     * Read a value for all the axes mapped, with a single call to a
+     * multi-joint method of the device, e.g.
+     *   readAxes(iJntEnc, &IEncoders::getEncoders, encs)
+     * The device fills in all of its axes, the ones mapped are copied out.
+     * The values filled in by the device are count, totalAxes for joint
+     * methods, totalMotors for motor methods.
+     */
+    template <class Interface, class Method, class T>
+    inline bool readAxes(Interface *iface, bool (Method::*get)(T *), T *out, int count)
+    {
+        if (!iface || base+axes>count)
+            return false;
+
+        if (base==0 && axes==count)
+            return (iface->*get)(out);
+
+        yarp::dev::impl::AxesBuffer<T> buffer(count);
+        if (!(iface->*get)(buffer.data()))
+            return false;
+        std::copy(buffer.data()+base, buffer.data()+base+axes, out);
+        return true;
+    }
+
+    // as above, for methods filling in two values per axis (e.g. a value and a timestamp)
+    template <class Interface, class Method, class T>
+    inline bool readAxes(Interface *iface, bool (Method::*get)(T *, T *), T *out1, T *out2, int count)
+    {
+        if (!iface || base+axes>count)
+            return false;
+
+        if (base==0 && axes==count)
+            return (iface->*get)(out1, out2);
+
+        yarp::dev::impl::AxesBuffer<T> buffer1(count);
+        yarp::dev::impl::AxesBuffer<T> buffer2(count);
+        if (!(iface->*get)(buffer1.data(), buffer2.data()))
+            return false;
+        std::copy(buffer1.data()+base, buffer1.data()+base+axes, out1);
+        std::copy(buffer2.data()+base, buffer2.data()+base+axes, out2);
+        return true;
     }
 
 
@@ -167,6 +241,63 @@ public:
 
         return &subdevices[i];
     }
+
+    /*
+     * Find, from the lut, the first joint of the wrapper mapped to each
+     * subdevice, checking that each subdevice is mapped to a contiguous
+     * range of joints.  Then multi-joint calls are forwarded with a single
+     * call per subdevice, see readAll().
+     */
+    bool buildCopyPlan();
+
+    /*
+     * Read a value for all the joints of the wrapper, e.g.
+     *   readAll(&SubDevice::iJntEnc, &IEncoders::getEncoders, encs)
+     * Motor methods fill in a value per motor of each subdevice, e.g.
+     *   readAll(&SubDevice::iMotEnc, &IMotorEncoders::getMotorEncoders, encs, &SubDevice::totalMotors)
+     */
+    template <class Interface, class Method, class T>
+    inline bool readAll(Interface *yarp::dev::impl::SubDevice::*iface, bool (Method::*get)(T *), T *out,
+                        int yarp::dev::impl::SubDevice::*count=&yarp::dev::impl::SubDevice::totalAxes)
+    {
+        bool ret=true;
+        for (unsigned int k=0; k<subdevices.size(); k++)
+        {
+            yarp::dev::impl::SubDevice &p=subdevices[k];
+            ret=p.readAxes(p.*iface, get, out+p.wrapBase, p.*count) && ret;
+        }
+        return ret;
+    }
+
+    template <class Interface, class Method, class T>
+    inline bool readAll(Interface *yarp::dev::impl::SubDevice::*iface, bool (Method::*get)(T *, T *), T *out1, T *out2,
+                        int yarp::dev::impl::SubDevice::*count=&yarp::dev::impl::SubDevice::totalAxes)
+    {
+        bool ret=true;
+        for (unsigned int k=0; k<subdevices.size(); k++)
+        {
+            yarp::dev::impl::SubDevice &p=subdevices[k];
+            ret=p.readAxes(p.*iface, get, out1+p.wrapBase, out2+p.wrapBase, p.*count) && ret;
+        }
+        return ret;
+    }
+
+    // copy the encoders read by the last refresh of the subdevices, in wrapper order
+    inline void copyJointEncoders(double *encs)
+    {
+        for (unsigned int k=0; k<subdevices.size(); k++)
+            std::copy(subdevices[k].subDev_joint_encoders.data(),
+                      subdevices[k].subDev_joint_encoders.data()+subdevices[k].axes,
+                      encs+subdevices[k].wrapBase);
+    }
+
+    inline void copyMotorEncoders(double *encs)
+    {
+        for (unsigned int k=0; k<subdevices.size(); k++)
+            std::copy(subdevices[k].subDev_motor_encoders.data(),
+                      subdevices[k].subDev_motor_encoders.data()+subdevices[k].axes,
+                      encs+subdevices[k].wrapBase);
+    }
 };
 
 #endif // DOXYGEN_SHOULD_SKIP_THIS
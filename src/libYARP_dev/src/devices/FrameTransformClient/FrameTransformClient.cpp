@@ -9,6 +9,9 @@
 #include <yarp/os/LogStream.h>
 #include <yarp/os/LockGuard.h>
 
+#include <algorithm>
+#include <cmath>
+
 /*! \file FrameTransformClient.cpp */
 
 //example: yarpdev --device transformClient --local /transformClient --remote /transformServer
@@ -18,6 +21,47 @@ using namespace yarp::os;
 using namespace yarp::sig;
 using namespace yarp::math;
 
+#define DEFAULT_HISTORY_SIZE 100
+
+// the value of a transform at a time in between two of its values
+static void interpolateTransform(const FrameTransform& a, const FrameTransform& b, double time, FrameTransform& t)
+{
+    double alpha = (time - a.timestamp) / (b.timestamp - a.timestamp);
+    t.src_frame_id = b.src_frame_id;
+    t.dst_frame_id = b.dst_frame_id;
+    t.timestamp = time;
+    t.translation.set(a.translation.tX + alpha * (b.translation.tX - a.translation.tX),
+                      a.translation.tY + alpha * (b.translation.tY - a.translation.tY),
+                      a.translation.tZ + alpha * (b.translation.tZ - a.translation.tZ));
+
+    // spherical linear interpolation, along the shortest arc
+    Quaternion qb = b.rotation;
+    double dot = a.rotation.w() * qb.w() + a.rotation.x() * qb.x() + a.rotation.y() * qb.y() + a.rotation.z() * qb.z();
+    if (dot < 0)
+    {
+        qb = Quaternion(-qb.x(), -qb.y(), -qb.z(), -qb.w());
+        dot = -dot;
+    }
+    double wa = 1 - alpha;
+    double wb = alpha;
+    if (dot < 0.9995)
+    {
+        double theta = acos(dot);
+        wa = sin((1 - alpha) * theta) / sin(theta);
+        wb = sin(alpha * theta) / sin(theta);
+    }
+    t.rotation = Quaternion(wa * a.rotation.x() + wb * qb.x(),
+                            wa * a.rotation.y() + wb * qb.y(),
+                            wa * a.rotation.z() + wb * qb.z(),
+                            wa * a.rotation.w() + wb * qb.w());
+    t.rotation.normalize();
+}
+
+static bool isOlder(double time, const FrameTransform& t)
+{
+    return time < t.timestamp;
+}
+
 
 inline void Transforms_client_storage::resetStat()
 {
@@ -68,7 +112,7 @@ void Transforms_client_storage::onRead(yarp::os::Bottle &b)
     {
         m_state = IFrameTransform::TRANSFORM_OK;
 
-        m_transforms.clear();
+        std::vector<FrameTransform> transforms;
         int bsize= b.size();
         for (int i = 0; i < bsize; i++)
         {
@@ -87,9 +131,17 @@ void Transforms_client_storage::onRead(yarp::os::Bottle &b)
                 t.rotation.x() = bt->get(7).asDouble();
                 t.rotation.y() = bt->get(8).asDouble();
                 t.rotation.z() = bt->get(9).asDouble();
-                m_transforms.push_back(t);
+                transforms.push_back(t);
             }
         }
+
+        bool changed = !sameTopology(transforms);
+        m_transforms.swap(transforms);
+        if (changed)
+        {
+            updateTopology();
+        }
+        updateHistory();
     }
     else
     {
@@ -141,6 +193,153 @@ void Transforms_client_storage::clear()
 {
     RecursiveLockGuard l(m_mutex);
     m_transforms.clear();
+    updateTopology();
+}
+
+bool Transforms_client_storage::sameTopology(const std::vector<FrameTransform>& transforms) const
+{
+    // the server sends the transforms always in the same order
+    if (transforms.size() != m_transforms.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < transforms.size(); i++)
+    {
+        if (transforms[i].src_frame_id != m_transforms[i].src_frame_id ||
+            transforms[i].dst_frame_id != m_transforms[i].dst_frame_id)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Transforms_client_storage::updateTopology()
+{
+    m_index.clear();
+    m_frames.clear();
+    m_chains.clear();
+    for (size_t i = 0; i < m_transforms.size(); i++)
+    {
+        // a frame with two parents keeps the first one, as it always did
+        m_index.insert(std::make_pair(m_transforms[i].dst_frame_id, i));
+        m_frames.insert(m_transforms[i].src_frame_id);
+        m_frames.insert(m_transforms[i].dst_frame_id);
+    }
+
+    // the past values of a transform are forgotten when it goes away or changes parent
+    for (auto it = m_history.begin(); it != m_history.end(); )
+    {
+        auto t = m_index.find(it->first);
+        if (t == m_index.end() || it->second.empty() ||
+            it->second.back().src_frame_id != m_transforms[t->second].src_frame_id)
+        {
+            it = m_history.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void Transforms_client_storage::updateHistory()
+{
+    for (auto it = m_index.begin(); it != m_index.end(); ++it)
+    {
+        const FrameTransform& t = m_transforms[it->second];
+        std::deque<FrameTransform>& h = m_history[it->first];
+        // the server sends each value over and over until the transform is set again
+        if (h.empty() || t.timestamp > h.back().timestamp)
+        {
+            h.push_back(t);
+            while (h.size() > m_history_size)
+            {
+                h.pop_front();
+            }
+        }
+    }
+}
+
+void Transforms_client_storage::setHistorySize(size_t samples)
+{
+    m_history_size = (samples > 0) ? samples : 1;
+    for (auto it = m_history.begin(); it != m_history.end(); ++it)
+    {
+        while (it->second.size() > m_history_size)
+        {
+            it->second.pop_front();
+        }
+    }
+}
+
+bool Transforms_client_storage::frameExists(const std::string& frame_id) const
+{
+    return m_frames.find(frame_id) != m_frames.end();
+}
+
+bool Transforms_client_storage::getParent(const std::string& frame_id, std::string& parent_frame_id) const
+{
+    const FrameTransform* t = getTransformToParent(frame_id);
+    if (t == YARP_NULLPTR)
+    {
+        return false;
+    }
+    parent_frame_id = t->src_frame_id;
+    return true;
+}
+
+const std::vector<std::string>& Transforms_client_storage::getAncestors(const std::string& frame_id)
+{
+    auto it = m_chains.find(frame_id);
+    if (it != m_chains.end())
+    {
+        return it->second;
+    }
+
+    std::vector<std::string>& chain = m_chains[frame_id];
+    std::string child = frame_id;
+    std::string parent;
+    // a loop among the frames would never reach a root
+    while (chain.size() < m_transforms.size() && getParent(child, parent))
+    {
+        chain.push_back(parent);
+        child = parent;
+    }
+    return chain;
+}
+
+const FrameTransform* Transforms_client_storage::getTransformToParent(const std::string& frame_id) const
+{
+    auto it = m_index.find(frame_id);
+    if (it == m_index.end())
+    {
+        return YARP_NULLPTR;
+    }
+    return &m_transforms[it->second];
+}
+
+bool Transforms_client_storage::getTransformToParent(const std::string& frame_id, double time, FrameTransform& t) const
+{
+    auto it = m_history.find(frame_id);
+    if (it == m_history.end() || it->second.empty())
+    {
+        return false;
+    }
+    const std::deque<FrameTransform>& h = it->second;
+    if (time >= h.back().timestamp)
+    {
+        // the last value holds until the transform is set again
+        t = h.back();
+        return true;
+    }
+    if (time < h.front().timestamp)
+    {
+        return false;
+    }
+    auto next = std::upper_bound(h.begin(), h.end(), time, isOlder);
+    interpolateTransform(*(next - 1), *next, time, t);
+    return true;
 }
 
 Transforms_client_storage::Transforms_client_storage(std::string local_streaming_name)
@@ -151,6 +350,7 @@ Transforms_client_storage::Transforms_client_storage(std::string local_streaming
     m_deltaTMin = 1e22;
     m_now = Time::now();
     m_prev = m_now;
+    m_history_size = DEFAULT_HISTORY_SIZE;
 
     if (!this->open(local_streaming_name.c_str()))
     {
@@ -370,6 +570,13 @@ bool yarp::dev::FrameTransformClient::open(yarp::os::Searchable &config)
         yWarning("FrameTransformClient: using default period of %d ms" , m_period);
     }
 
+    int history_size = config.check("history_size", Value(DEFAULT_HISTORY_SIZE), "number of past values kept for each transform").asInt();
+    if (history_size <= 0)
+    {
+        yError("FrameTransformClient::open() error 'history_size' must be positive");
+        return false;
+    }
+
     ConstString local_rpcServer = m_local_name;
     local_rpcServer += "/rpc:o";
     ConstString local_rpcUser = m_local_name;
@@ -394,6 +601,10 @@ bool yarp::dev::FrameTransformClient::open(yarp::os::Searchable &config)
     }
 
     m_transform_storage = new Transforms_client_storage(local_streaming_name);
+    {
+        RecursiveLockGuard l(m_transform_storage->m_mutex);
+        m_transform_storage->setHistorySize(history_size);
+    }
     bool ok = Network::connect(remote_streaming_name.c_str(), local_streaming_name.c_str(), "udp");
     if (!ok)
     {
@@ -437,49 +648,29 @@ bool yarp::dev::FrameTransformClient::allFramesAsString(std::string &all_frames)
 yarp::dev::FrameTransformClient::ConnectionType yarp::dev::FrameTransformClient::getConnectionType(const std::string &target_frame, const std::string &source_frame, std::string* commonAncestor = NULL)
 {
     Transforms_client_storage& tfVec = *m_transform_storage;
-    size_t                     i, j;
-    std::vector<std::string>   tar2root_vec;
-    std::vector<std::string>   src2root_vec;
-    std::string                ancestor, child;
-    child = target_frame;
     RecursiveLockGuard l(tfVec.m_mutex);
-    while(getParent(child, ancestor))
+    const std::vector<std::string>& tar2root_vec = tfVec.getAncestors(target_frame);
+    if (std::find(tar2root_vec.begin(), tar2root_vec.end(), source_frame) != tar2root_vec.end())
     {
-        if(ancestor == source_frame)
-        {
-            return DIRECT;
-        }
-
-        tar2root_vec.push_back(ancestor);
-        child = ancestor;
+        return DIRECT;
     }
-    child = source_frame;
-    while(getParent(child, ancestor))
-    {
-        if(ancestor == target_frame)
-        {
-            return INVERSE;
-        }
 
-        src2root_vec.push_back(ancestor);
-        child = ancestor;
+    const std::vector<std::string>& src2root_vec = tfVec.getAncestors(source_frame);
+    if (std::find(src2root_vec.begin(), src2root_vec.end(), target_frame) != src2root_vec.end())
+    {
+        return INVERSE;
     }
 
-    for(i = 0; i < tar2root_vec.size(); i++)
+    for (size_t i = 0; i < tar2root_vec.size(); i++)
     {
-        std::string a;
-        a = tar2root_vec[i];
-        for(j = 0; j < src2root_vec.size(); j++)
+        if (std::find(src2root_vec.begin(), src2root_vec.end(), tar2root_vec[i]) != src2root_vec.end())
         {
-            if(a == src2root_vec[j])
+            if (commonAncestor)
             {
-                if(commonAncestor)
-                {
-                    *commonAncestor = a;
-                }
-                return UNDIRECT;
+                *commonAncestor = tar2root_vec[i];
             }
-        }    
+            return UNDIRECT;
+        }
     }
 
     return DISCONNECTED;
@@ -517,12 +708,8 @@ bool yarp::dev::FrameTransformClient::clear()
 
 bool yarp::dev::FrameTransformClient::frameExists(const std::string &frame_id)
 {
-    for (size_t i = 0; i < m_transform_storage->size(); i++)
-    {
-        if (((*m_transform_storage)[i].src_frame_id) == frame_id) { return true; }
-        if (((*m_transform_storage)[i].dst_frame_id) == frame_id) { return true; }
-    }
-    return false;
+    RecursiveLockGuard l(m_transform_storage->m_mutex);
+    return m_transform_storage->frameExists(frame_id);
 }
 
 bool yarp::dev::FrameTransformClient::getAllFrameIds(std::vector< std::string > &ids)
@@ -552,95 +739,111 @@ bool yarp::dev::FrameTransformClient::getAllFrameIds(std::vector< std::string >
 
 bool yarp::dev::FrameTransformClient::getParent(const std::string &frame_id, std::string &parent_frame_id)
 {
-    for (size_t i = 0; i < m_transform_storage->size(); i++)
-    {
-        std::string par((*m_transform_storage)[i].dst_frame_id);
-        if (((*m_transform_storage)[i].dst_frame_id == frame_id))
-        {
-
-            parent_frame_id = (*m_transform_storage)[i].src_frame_id;
-            return true;
-        }
-    }
-    return false;
+    RecursiveLockGuard l(m_transform_storage->m_mutex);
+    return m_transform_storage->getParent(frame_id, parent_frame_id);
 }
 
 bool yarp::dev::FrameTransformClient::canExplicitTransform(const std::string& target_frame_id, const std::string& source_frame_id) const
+{
+    RecursiveLockGuard l(m_transform_storage->m_mutex);
+    const FrameTransform* t = m_transform_storage->getTransformToParent(target_frame_id);
+    return t != YARP_NULLPTR && t->src_frame_id == source_frame_id;
+}
+
+bool yarp::dev::FrameTransformClient::getChainedTransform(const std::string& target_frame_id, const std::string& source_frame_id, yarp::sig::Matrix& transform) const
 {
     Transforms_client_storage& tfVec = *m_transform_storage;
-    size_t                     i, tfVec_size;
     RecursiveLockGuard         l(tfVec.m_mutex);
 
-    tfVec_size = tfVec.size();
-    for (i = 0; i < tfVec_size; i++)
+    // walk from the target up to the source
+    yarp::sig::Matrix m = yarp::math::eye(4);
+    std::string frame = target_frame_id;
+    for (size_t steps = 0; frame != source_frame_id; steps++)
     {
-        if (tfVec[i].dst_frame_id == target_frame_id && tfVec[i].src_frame_id == source_frame_id)
+        const FrameTransform* t = tfVec.getTransformToParent(frame);
+        if (t == YARP_NULLPTR || steps >= tfVec.size())
         {
-            return true;
+            return false;
         }
+        m = t->toMatrix() * m;
+        frame = t->src_frame_id;
     }
-    return false;
+    transform = m;
+    return true;
 }
 
-bool yarp::dev::FrameTransformClient::getChainedTransform(const std::string& target_frame_id, const std::string& source_frame_id, yarp::sig::Matrix& transform) const
+bool yarp::dev::FrameTransformClient::getChainedTransform(const std::string& target_frame_id, const std::string& source_frame_id, double time, yarp::sig::Matrix& transform) const
 {
     Transforms_client_storage& tfVec = *m_transform_storage;
-    size_t                     i, tfVec_size;
     RecursiveLockGuard         l(tfVec.m_mutex);
 
-    tfVec_size = tfVec.size();
-    for (i = 0; i < tfVec_size; i++)
+    yarp::sig::Matrix m = yarp::math::eye(4);
+    std::string frame = target_frame_id;
+    FrameTransform t;
+    for (size_t steps = 0; frame != source_frame_id; steps++)
     {
-        if (tfVec[i].dst_frame_id == target_frame_id)
+        if (steps >= tfVec.size() || !tfVec.getTransformToParent(frame, time, t))
         {
-            if (tfVec[i].src_frame_id == source_frame_id)
-            {
-                transform = tfVec[i].toMatrix();
-                return true;
-            }
-            else
-            {
-                yarp::sig::Matrix m;
-                if (getChainedTransform(tfVec[i].src_frame_id, source_frame_id, m))
-                {
-                    transform = m * tfVec[i].toMatrix();
-                    return true;
-                }
-            }
+            return false;
         }
+        m = t.toMatrix() * m;
+        frame = t.src_frame_id;
     }
-    return false;
+    transform = m;
+    return true;
 }
 
-bool yarp::dev::FrameTransformClient::getTransform(const std::string& target_frame_id, const std::string& source_frame_id, yarp::sig::Matrix& transform)
+bool yarp::dev::FrameTransformClient::findTransform(const std::string& target_frame_id, const std::string& source_frame_id, const double* time, yarp::sig::Matrix& transform)
 {
+    // all the transforms of the chain come from the same message
+    RecursiveLockGuard l(m_transform_storage->m_mutex);
     ConnectionType ct;
     std::string    ancestor;
     ct = getConnectionType(target_frame_id, source_frame_id, &ancestor);
     if (ct == DIRECT)
     {
-        return getChainedTransform(target_frame_id, source_frame_id, transform);
+        return time ? getChainedTransform(target_frame_id, source_frame_id, *time, transform) :
+                      getChainedTransform(target_frame_id, source_frame_id, transform);
     }
     else if (ct == INVERSE)
     {
         yarp::sig::Matrix m(4, 4);
-        getChainedTransform(source_frame_id, target_frame_id, m);
-        transform = yarp::math::SE3inv(m);
-        return true;
+        bool ok = time ? getChainedTransform(source_frame_id, target_frame_id, *time, m) :
+                         getChainedTransform(source_frame_id, target_frame_id, m);
+        if (ok)
+        {
+            transform = yarp::math::SE3inv(m);
+        }
+        return ok;
     }
     else if(ct == UNDIRECT)
     {
         yarp::sig::Matrix root2tar(4, 4), root2src(4, 4);
-        getChainedTransform(source_frame_id, ancestor, root2src);
-        getChainedTransform(target_frame_id, ancestor, root2tar);
-        transform = yarp::math::SE3inv(root2src) * root2tar;
-        return true;
+        bool ok = time ? getChainedTransform(source_frame_id, ancestor, *time, root2src) &&
+                         getChainedTransform(target_frame_id, ancestor, *time, root2tar) :
+                         getChainedTransform(source_frame_id, ancestor, root2src) &&
+                         getChainedTransform(target_frame_id, ancestor, root2tar);
+        if (ok)
+        {
+            transform = yarp::math::SE3inv(root2src) * root2tar;
+        }
+        return ok;
     }
 
     yError() << "FrameTransformClient::getTransform() frames not connected";
     return false;
 }
 
+bool yarp::dev::FrameTransformClient::getTransform(const std::string& target_frame_id, const std::string& source_frame_id, yarp::sig::Matrix& transform)
+{
+    return findTransform(target_frame_id, source_frame_id, YARP_NULLPTR, transform);
+}
+
+bool yarp::dev::FrameTransformClient::getTransform(const std::string& target_frame_id, const std::string& source_frame_id, double time, yarp::sig::Matrix& transform)
+{
+    return findTransform(target_frame_id, source_frame_id, &time, transform);
+}
+
 bool yarp::dev::FrameTransformClient::setTransform(const std::string& target_frame_id, const std::string& source_frame_id, const yarp::sig::Matrix& transform)
 {
 
@@ -22,6 +22,10 @@
 #include <yarp/os/RecursiveMutex.h>
 #include <yarp/os/RateThread.h>
 
+#include <deque>
+#include <map>
+#include <set>
+
 namespace yarp {
     namespace dev {
         class FrameTransformClient;
@@ -51,12 +55,32 @@ private:
 
     std::vector <yarp::math::FrameTransform> m_transforms;
 
+    // the transforms are a tree, each frame has at most one parent: the
+    // transform to it is indexed by the child frame id
+    std::map<std::string, size_t>                                   m_index;
+    std::set<std::string>                                           m_frames;
+    std::map<std::string, std::vector<std::string> >                m_chains;   // ancestors of a frame, nearest first, until the topology changes
+    std::map<std::string, std::deque<yarp::math::FrameTransform> >  m_history;  // past values of the transform to a frame, oldest first
+    size_t                                                          m_history_size;
+
+    bool sameTopology(const std::vector <yarp::math::FrameTransform>& transforms) const;
+    void updateTopology();
+    void updateHistory();
+
 public:
     yarp::os::RecursiveMutex  m_mutex;
     size_t   size();
     yarp::math::FrameTransform& operator[]   (std::size_t idx);
     void clear();
 
+    // all the following must be called with m_mutex held
+    void     setHistorySize(size_t samples);
+    bool     frameExists(const std::string& frame_id) const;
+    bool     getParent(const std::string& frame_id, std::string& parent_frame_id) const;
+    const std::vector<std::string>& getAncestors(const std::string& frame_id);
+    const yarp::math::FrameTransform* getTransformToParent(const std::string& frame_id) const;
+    bool     getTransformToParent(const std::string& frame_id, double time, yarp::math::FrameTransform& t) const;
+
 public:
     Transforms_client_storage (std::string port_name);
     ~Transforms_client_storage ( );
@@ -78,6 +102,9 @@ public:
 *
 * The client side of any IBattery capable device.
 * Still single thread! concurrent access is unsafe.
+*
+* The last history_size values of each transform (default 100) are kept,
+* so that transforms can also be looked up at a given time.
 */
 class yarp::dev::FrameTransformClient: public DeviceDriver,
                                   public IFrameTransform,
@@ -92,6 +119,8 @@ private:
     
     bool canExplicitTransform(const std::string& target_frame_id, const std::string& source_frame_id) const;
     bool getChainedTransform(const std::string &target_frame_id, const std::string &source_frame_id, yarp::sig::Matrix &transform) const;
+    bool getChainedTransform(const std::string &target_frame_id, const std::string &source_frame_id, double time, yarp::sig::Matrix &transform) const;
+    bool findTransform(const std::string &target_frame_id, const std::string &source_frame_id, const double* time, yarp::sig::Matrix &transform);
 
 protected:
 
@@ -134,6 +163,7 @@ public:
      bool     getAllFrameIds(std::vector< std::string > &ids) override;
      bool     getParent(const std::string &frame_id, std::string &parent_frame_id) override;
      bool     getTransform(const std::string &target_frame_id, const std::string &source_frame_id, yarp::sig::Matrix &transform) override;
+     bool     getTransform(const std::string &target_frame_id, const std::string &source_frame_id, double time, yarp::sig::Matrix &transform) override;
      bool     setTransform(const std::string &target_frame_id, const std::string &source_frame_id, const yarp::sig::Matrix &transform) override;
      bool     setTransformStatic(const std::string &target_frame_id, const std::string &source_frame_id, const yarp::sig::Matrix &transform) override;
      bool     deleteTransform(const std::string &target_frame_id, const std::string &source_frame_id) override;
@@ -54,14 +54,144 @@ bool yarp::dev::Map2DClient::open(yarp::os::Searchable &config)
         return false;
     }
 
+    if (config.check("updates") && config.find("updates").asBool())
+    {
+        ConstString local_updates = m_local_name + "/updates:i";
+        ConstString remote_updates = m_remote_name + "/updates:o";
+        if (!m_updatesPort.open(local_updates.c_str()))
+        {
+            yError("Map2DClient::open() error could not open port %s, check network", local_updates.c_str());
+            return false;
+        }
+        m_updatesPort.useCallback(*this);
+        if (!Network::connect(remote_updates.c_str(), local_updates.c_str()))
+        {
+            yWarning("Map2DClient::open() could not connect to %s, maps will be updated only when retrieved", remote_updates.c_str());
+        }
+    }
+
     return true;
 }
 
+bool yarp::dev::Map2DClient::applyTiles(cached_map& cached, const Bottle& msg, int first)
+{
+    //epoch since version (name width height resolution origin) (x y data ...), all the tiles are sent if since is 0
+    int since = msg.get(first + 1).asInt();
+    Bottle* header = msg.get(first + 3).asList();
+    Bottle* tiles = msg.get(first + 4).asList();
+    if (header == NULL || tiles == NULL || header->size() < 7)
+    {
+        return false;
+    }
+    size_t width = header->get(1).asInt();
+    size_t height = header->get(2).asInt();
+    if (cached.map.width() != width || cached.map.height() != height)
+    {
+        if (since != 0 || !cached.map.setSize_in_cells(width, height)) return false;
+    }
+    cached.map.setMapName(header->get(0).asString());
+    cached.map.setResolution(header->get(3).asDouble());
+    cached.map.setOrigin(header->get(4).asDouble(), header->get(5).asDouble(), header->get(6).asDouble());
+    for (int i = 0; i + 2 < tiles->size(); i += 3)
+    {
+        const Value& data = tiles->get(i + 2);
+        if (!data.isBlob() ||
+            !cached.map.setTileData(tiles->get(i).asInt(), tiles->get(i + 1).asInt(), std::string(data.asBlob(), data.asBlobLength())))
+        {
+            return false;
+        }
+    }
+    cached.epoch = msg.get(first).asDouble();
+    cached.version = msg.get(first + 2).asInt();
+    return true;
+}
+
+void yarp::dev::Map2DClient::onRead(Bottle& update)
+{
+    //map_name epoch since version ...
+    LockGuard lock(m_cache_mutex);
+    auto it = m_cache.find(update.get(0).asString());
+    if (it == m_cache.end())
+    {
+        return;
+    }
+    double epoch = update.get(1).asDouble();
+    int since = update.get(2).asInt();
+    int version = update.get(3).asInt();
+    if (since != 0 && (epoch != it->second.epoch || since != it->second.version))
+    {
+        //some changes were missed, the tiles will be retrieved with the map
+        return;
+    }
+    if (epoch == it->second.epoch && version <= it->second.version)
+    {
+        return;
+    }
+    if (!applyTiles(it->second, update, 1))
+    {
+        m_cache.erase(it);
+    }
+}
+
 bool yarp::dev::Map2DClient::store_map(const MapGrid2D& map)
 {
     yarp::os::Bottle b;
     yarp::os::Bottle resp;
+    std::string map_name = map.getMapName();
 
+    //if the server has the same version of the map as the cache, only the tiles which changed are sent
+    b.addVocab(VOCAB_IMAP);
+    b.addVocab(VOCAB_IMAP_SET_TILES);
+    b.addString(map_name);
+    bool same_layout = false;
+    {
+        LockGuard lock(m_cache_mutex);
+        auto it = m_cache.find(map_name);
+        if (it != m_cache.end())
+        {
+            const MapGrid2D& cached = it->second.map;
+            double x1, y1, t1, r1, x2, y2, t2, r2;
+            map.getOrigin(x1, y1, t1);
+            map.getResolution(r1);
+            cached.getOrigin(x2, y2, t2);
+            cached.getResolution(r2);
+            same_layout = (map.width() == cached.width() && map.height() == cached.height() &&
+                           x1 == x2 && y1 == y2 && t1 == t2 && r1 == r2);
+            if (same_layout)
+            {
+                b.addDouble(it->second.epoch);
+                b.addInt(it->second.version);
+                yarp::os::Bottle& tiles = b.addList();
+                size_t tiles_x, tiles_y;
+                map.getSize_in_tiles(tiles_x, tiles_y);
+                std::string data;
+                for (size_t y = 0; y < tiles_y; y++)
+                {
+                    for (size_t x = 0; x < tiles_x; x++)
+                    {
+                        if (!map.isTileIdenticalTo(cached, x, y) && map.getTileData(x, y, data))
+                        {
+                            tiles.addInt(x);
+                            tiles.addInt(y);
+                            tiles.add(Value((void*)data.data(), data.size()));
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (same_layout && m_rpcPort.write(b, resp) && resp.get(0).asVocab() == VOCAB_IMAP_OK)
+    {
+        LockGuard lock(m_cache_mutex);
+        cached_map& cached = m_cache[map_name];
+        cached.map = map;
+        cached.epoch = resp.get(1).asDouble();
+        cached.version = resp.get(2).asInt();
+        return true;
+    }
+
+    b.clear();
+    resp.clear();
     b.addVocab(VOCAB_IMAP);
     b.addVocab(VOCAB_IMAP_SET_MAP);
     yarp::os::Bottle& mapbot = b.addList();
@@ -80,6 +210,11 @@ bool yarp::dev::Map2DClient::store_map(const MapGrid2D& map)
             yError() << "Map2DClient::store_map() received error from server";
             return false;
         }
+        LockGuard lock(m_cache_mutex);
+        cached_map& cached = m_cache[map_name];
+        cached.map = map;
+        cached.epoch = resp.get(1).asDouble();
+        cached.version = resp.get(2).asInt();
     }
     else
     {
@@ -91,41 +226,62 @@ bool yarp::dev::Map2DClient::store_map(const MapGrid2D& map)
 
 bool yarp::dev::Map2DClient::get_map(std::string map_name, MapGrid2D& map)
 {
-    yarp::os::Bottle b;
-    yarp::os::Bottle resp;
+    //asks for the tiles which changed since the version in the cache, and for all of them if they cannot be applied to it
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        yarp::os::Bottle b;
+        yarp::os::Bottle resp;
 
-    b.addVocab(VOCAB_IMAP);
-    b.addVocab(VOCAB_IMAP_GET_MAP);
-    b.addString(map_name);
+        b.addVocab(VOCAB_IMAP);
+        b.addVocab(VOCAB_IMAP_GET_TILES);
+        b.addString(map_name);
+        {
+            LockGuard lock(m_cache_mutex);
+            auto it = m_cache.find(map_name);
+            bool cached = (it != m_cache.end() && attempt == 0);
+            b.addDouble(cached ? it->second.epoch : 0.0);
+            b.addInt(cached ? it->second.version : 0);
+        }
 
-    bool ret = m_rpcPort.write(b, resp);
-    if (ret)
-    {
+        bool ret = m_rpcPort.write(b, resp);
+        if (!ret)
+        {
+            yError() << "Map2DClient::get_map() error on writing on rpc port";
+            return false;
+        }
+        LockGuard lock(m_cache_mutex);
         if (resp.get(0).asVocab() != VOCAB_IMAP_OK)
         {
+            m_cache.erase(map_name);
             yError() << "Map2DClient::get_map() received error from server";
             return false;
         }
-        else
+        auto it = m_cache.find(map_name);
+        if (it == m_cache.end())
         {
-            Value& b = resp.get(1);
-            if (Property::copyPortable(b, map))
-            {
-                return true;
-            }
-            else
-            {
-                yError() << "Map2DClient::get_map() failed copyPortable()";
-                return false;
-            }
+            it = m_cache.insert(std::make_pair(map_name, cached_map())).first;
+            it->second.epoch = 0;
+            it->second.version = 0;
         }
+        double epoch = resp.get(1).asDouble();
+        int since = resp.get(2).asInt();
+        int version = resp.get(3).asInt();
+        if (epoch == it->second.epoch && version <= it->second.version)
+        {
+            //the cache was updated meanwhile
+            map = it->second.map;
+            return true;
+        }
+        if ((since == 0 || (epoch == it->second.epoch && since == it->second.version)) &&
+            applyTiles(it->second, resp, 1))
+        {
+            map = it->second.map;
+            return true;
+        }
+        m_cache.erase(it);
     }
-    else
-    {
-        yError() << "Map2DClient::get_map() error on writing on rpc port";
-        return false;
-    }
-    return true;
+    yError() << "Map2DClient::get_map() received invalid tiles from server";
+    return false;
 }
 
 bool yarp::dev::Map2DClient::clear()
@@ -136,6 +292,10 @@ bool yarp::dev::Map2DClient::clear()
     b.addVocab(VOCAB_IMAP);
     b.addVocab(VOCAB_IMAP_CLEAR);
 
+    {
+        LockGuard lock(m_cache_mutex);
+        m_cache.clear();
+    }
     bool ret = m_rpcPort.write(b, resp);
     if (ret)
     {
@@ -195,6 +355,10 @@ bool yarp::dev::Map2DClient::remove_map(std::string map_name)
     b.addVocab(VOCAB_IMAP_REMOVE);
     b.addString(map_name);
 
+    {
+        LockGuard lock(m_cache_mutex);
+        m_cache.erase(map_name);
+    }
     bool ret = m_rpcPort.write(b, resp);
     if (ret)
     {
@@ -214,6 +378,8 @@ bool yarp::dev::Map2DClient::remove_map(std::string map_name)
 
 bool yarp::dev::Map2DClient::close()
 {
+    m_updatesPort.interrupt();
+    m_updatesPort.close();
     return true;
 }
 
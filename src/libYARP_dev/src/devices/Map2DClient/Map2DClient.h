@@ -18,6 +18,8 @@
 #include <yarp/os/Time.h>
 #include <yarp/dev/PolyDriver.h>
 #include <yarp/os/RecursiveMutex.h>
+#include <yarp/os/Mutex.h>
+#include <map>
 
 namespace yarp {
     namespace dev {
@@ -45,10 +47,16 @@ class Map2D_type
  * |:--------------:|:--------------:|:-------:|:--------------:|:-------------:|:-----------: |:-----------------------------------------------------------------:|:-----:|
  * | local          |      -         | string  | -   |   -           | Yes          | Full port name openend by the Map2DClient device.                            |       |
  * | remote         |     -          | string  | -   |   -           | Yes          | Full port name of the port opened by the Map2DServer, to which the Map2DClient connects to.           |  |
+ * | updates        |     -          | bool    | -   |   false       | No           | If true, the changes of the maps are received as soon as they are stored in the server.               |  |
+ *
+ * The device keeps a copy of the maps it stored or retrieved, and exchanges with the server only the tiles of a map
+ * (see MapGrid2D::getTileData()) which changed since then. If updates is true, the copies are also kept up to date by the
+ * changes streamed by the server, so that retrieving a map again usually costs no more than its name and size.
  */
 
 class yarp::dev::Map2DClient : public DeviceDriver,
-                               public IMap2D
+                               public IMap2D,
+                               public yarp::os::TypedReaderCallback<yarp::os::Bottle>
 {
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 protected:
@@ -57,6 +65,18 @@ protected:
     yarp::os::ConstString         m_local_name;
     yarp::os::ConstString         m_remote_name;
 
+    struct cached_map
+    {
+        yarp::dev::MapGrid2D map;
+        double               epoch;     //the run of the server the version refers to
+        int                  version;
+    };
+    std::map<std::string, cached_map>        m_cache;
+    yarp::os::Mutex                          m_cache_mutex;
+    yarp::os::BufferedPort<yarp::os::Bottle> m_updatesPort;
+
+    bool applyTiles(cached_map& cached, const yarp::os::Bottle& msg, int first);
+
 #endif /*DOXYGEN_SHOULD_SKIP_THIS*/
 
 public:
@@ -70,6 +90,9 @@ public:
     virtual bool     store_map  (const yarp::dev::MapGrid2D& map) override;
     virtual bool     get_map    (std::string map_name, yarp::dev::MapGrid2D& map) override;
     virtual bool     get_map_names(std::vector<std::string>& map_names) override;
+
+    using yarp::os::TypedReaderCallback<yarp::os::Bottle>::onRead;
+    virtual void     onRead(yarp::os::Bottle& update) override;
 };
 
 #endif // YARP_DEV_MAP2DCLIENT_H
@@ -11,6 +11,7 @@
 #include <yarp/os/Log.h>
 #include <yarp/os/LogStream.h>
 #include <yarp/os/LockGuard.h>
+#include <yarp/os/SystemClock.h>
 #include <stdlib.h>
 #include <fstream>
 
@@ -35,6 +36,8 @@ Map2DServer::Map2DServer()
     m_enable_publish_ros_tf = false;
     m_enable_subscribe_ros_tf = false;
     m_rosNode = 0;
+    m_last_version = 0;
+    m_epoch = SystemClock::nowSystem();
 }
 
 Map2DServer::~Map2DServer()
@@ -70,16 +73,19 @@ bool Map2DServer::read(yarp::os::ConnectionReader& connection)
                 {
                     //add a new map
                     m_maps_storage[map_name] = the_map;
-                    out.clear();
-                    out.addVocab(VOCAB_IMAP_OK);
+                    updateVersions(map_name, NULL);
                 }
                 else
                 {
                     //the map alreay exists
-                    m_maps_storage[map_name] = the_map;
-                    out.clear();
-                    out.addVocab(VOCAB_IMAP_OK);
+                    MapGrid2D previous = it->second;
+                    it->second = the_map;
+                    updateVersions(map_name, &previous);
                 }
+                out.clear();
+                out.addVocab(VOCAB_IMAP_OK);
+                out.addDouble(m_epoch);
+                out.addInt(m_maps_versions[map_name].version);
             }
             else
             {
@@ -106,6 +112,64 @@ bool Map2DServer::read(yarp::os::ConnectionReader& connection)
                 yError() << "Map" << name << "not found";
             }
         }
+        else if (cmd == VOCAB_IMAP_GET_TILES)
+        {
+            //sends the tiles changed since the version of the map known by the client, all of them if it is not known
+            string name = in.get(2).asString();
+            double epoch = in.get(3).asDouble();
+            int since = in.get(4).asInt();
+            auto it = m_maps_versions.find(name);
+            if (it != m_maps_versions.end())
+            {
+                if (epoch != m_epoch || since > it->second.version) since = 0;
+                out.clear();
+                out.addVocab(VOCAB_IMAP_OK);
+                appendTiles(out, name, since);
+            }
+            else
+            {
+                out.clear();
+                out.addVocab(VOCAB_IMAP_ERROR);
+                yError() << "Map" << name << "not found";
+            }
+        }
+        else if (cmd == VOCAB_IMAP_SET_TILES)
+        {
+            //changes some tiles of a map, if the client knows its last version
+            string name = in.get(2).asString();
+            double epoch = in.get(3).asDouble();
+            int base = in.get(4).asInt();
+            Bottle* tiles = in.get(5).asList();
+            auto it = m_maps_storage.find(name);
+            bool ok = (it != m_maps_storage.end() && tiles != NULL &&
+                       epoch == m_epoch && base == m_maps_versions[name].version);
+            MapGrid2D updated;
+            if (ok)
+            {
+                updated = it->second;
+                for (int i = 0; ok && i + 2 < tiles->size(); i += 3)
+                {
+                    const Value& data = tiles->get(i + 2);
+                    ok = data.isBlob() &&
+                         updated.setTileData(tiles->get(i).asInt(), tiles->get(i + 1).asInt(), string(data.asBlob(), data.asBlobLength()));
+                }
+            }
+            out.clear();
+            if (ok)
+            {
+                MapGrid2D previous = it->second;
+                it->second = updated;
+                updateVersions(name, &previous);
+                out.addVocab(VOCAB_IMAP_OK);
+                out.addDouble(m_epoch);
+                out.addInt(m_maps_versions[name].version);
+            }
+            else
+            {
+                //the client has to send the whole map
+                out.addVocab(VOCAB_IMAP_ERROR);
+            }
+        }
         else if (cmd == VOCAB_IMAP_GET_NAMES)
         {
             out.clear();
@@ -120,6 +184,7 @@ bool Map2DServer::read(yarp::os::ConnectionReader& connection)
         {
             string name = in.get(2).asString();
             size_t rem = m_maps_storage.erase(name);
+            m_maps_versions.erase(name);
             if (rem == 0)
             {
                 yError() << "Map not found";
@@ -135,6 +200,7 @@ bool Map2DServer::read(yarp::os::ConnectionReader& connection)
         else if (cmd == VOCAB_IMAP_CLEAR)
         {
             m_maps_storage.clear();
+            m_maps_versions.clear();
             out.clear();
             out.addVocab(VOCAB_IMAP_OK);
         }
@@ -194,6 +260,80 @@ bool Map2DServer::read(yarp::os::ConnectionReader& connection)
     return true;
 }
 
+void Map2DServer::updateVersions(const std::string& map_name, const MapGrid2D* previous)
+{
+    //gives a new version to the tiles which changed, to all of them if the size of the map changed
+    const MapGrid2D& map = m_maps_storage[map_name];
+    map_versions& versions = m_maps_versions[map_name];
+    size_t tiles_x, tiles_y;
+    map.getSize_in_tiles(tiles_x, tiles_y);
+    int since = versions.version;
+    if (previous == NULL || previous->width() != map.width() || previous->height() != map.height())
+    {
+        previous = NULL;
+        since = 0;
+        versions.tiles.assign(tiles_x*tiles_y, 0);
+    }
+    versions.version = ++m_last_version;
+    for (size_t y = 0; y < tiles_y; y++)
+    {
+        for (size_t x = 0; x < tiles_x; x++)
+        {
+            if (previous == NULL || !map.isTileIdenticalTo(*previous, x, y))
+            {
+                versions.tiles[y*tiles_x + x] = versions.version;
+            }
+        }
+    }
+
+    //streams the changes to the clients
+    if (m_updatesPort.getOutputCount() > 0)
+    {
+        Bottle& update = m_updatesPort.prepare();
+        update.clear();
+        update.addString(map_name);
+        appendTiles(update, map_name, since);
+        m_updatesPort.write();
+    }
+}
+
+void Map2DServer::appendTiles(yarp::os::Bottle& out, const std::string& map_name, int since)
+{
+    //epoch since version (name width height resolution origin) (x y data ...)
+    const MapGrid2D& map = m_maps_storage[map_name];
+    const map_versions& versions = m_maps_versions[map_name];
+    out.addDouble(m_epoch);
+    out.addInt(since);
+    out.addInt(versions.version);
+    Bottle& header = out.addList();
+    double x, y, theta, resolution;
+    map.getOrigin(x, y, theta);
+    map.getResolution(resolution);
+    header.addString(map_name);
+    header.addInt(map.width());
+    header.addInt(map.height());
+    header.addDouble(resolution);
+    header.addDouble(x);
+    header.addDouble(y);
+    header.addDouble(theta);
+    Bottle& tiles = out.addList();
+    size_t tiles_x, tiles_y;
+    map.getSize_in_tiles(tiles_x, tiles_y);
+    string data;
+    for (size_t ty = 0; ty < tiles_y; ty++)
+    {
+        for (size_t tx = 0; tx < tiles_x; tx++)
+        {
+            if (versions.tiles[ty*tiles_x + tx] > since && map.getTileData(tx, ty, data))
+            {
+                tiles.addInt(tx);
+                tiles.addInt(ty);
+                tiles.add(Value((void*)data.data(), data.size()));
+            }
+        }
+    }
+}
+
 bool Map2DServer::saveMaps(std::string mapsfile)
 {
     if (m_maps_storage.size() == 0)
@@ -250,6 +390,7 @@ bool Map2DServer::loadMaps(std::string mapsfile)
                 if (p == m_maps_storage.end())
                 {
                     m_maps_storage[map_name] = map;
+                    updateVersions(map_name, NULL);
                 }
                 else
                 {
@@ -311,6 +452,19 @@ bool Map2DServer::open(yarp::os::Searchable &config)
     }
     m_rpcPort.setReader(*this);
 
+    //open the port streaming the changes of the maps
+    string updatesPortName = m_rpcPortName.c_str();
+    if (updatesPortName.size() >= 4 && updatesPortName.compare(updatesPortName.size() - 4, 4, "/rpc") == 0)
+    {
+        updatesPortName.erase(updatesPortName.size() - 4);
+    }
+    updatesPortName += "/updates:o";
+    if (!m_updatesPort.open(updatesPortName.c_str()))
+    {
+        yError("Map2DServer: failed to open port %s", updatesPortName.c_str());
+        return false;
+    }
+
     //ROS configuration
 #if 0
     if (!config.check("ROS"))
@@ -347,5 +501,7 @@ bool Map2DServer::open(yarp::os::Searchable &config)
 bool Map2DServer::close()
 {
     yTrace("Map2DServer::Close");
+    m_updatesPort.interrupt();
+    m_updatesPort.close();
     return true;
 }
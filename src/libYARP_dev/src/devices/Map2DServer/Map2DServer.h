@@ -59,6 +59,11 @@ namespace yarp
  * | name           |      -         | string  | -              | /mapServer/rpc   | No           | Full name of the rpc port openend by the Map2DServer device .     |       |
  * | mapCollection  |      -         | string  | -              |   -              | No           | The name of .ini file containgin a map collection.                |       |
 
+ * Each map is split in tiles (see MapGrid2D::getTileData()), and each tile is given a new version number whenever it changes.
+ * Map2DClient devices retrieve and store only the tiles changed since the version of the map they already have.
+ * The tiles changed by each update of a map are also streamed on the port <name>/updates:o, where <name> is the name of the rpc port
+ * without the /rpc suffix, so that the clients can keep their copies of the maps up to date.
+ *
  * \section Notes:
  * Integration with ROS map server is currently under development.
  */
@@ -88,11 +93,23 @@ private:
     bool                         m_enable_subscribe_ros_tf;
 
     yarp::os::RpcServer                      m_rpcPort;
+    yarp::os::BufferedPort<yarp::os::Bottle> m_updatesPort;
     yarp::os::Publisher<tf_tfMessage>        m_rosPublisherPort_tf_timed;
     yarp::os::Subscriber<tf_tfMessage>       m_rosSubscriberPort_tf_timed;
 
+    struct map_versions
+    {
+        int              version;   //the version of the last change of the map
+        std::vector<int> tiles;     //the version of the last change of each tile
+    };
+    std::map<std::string, map_versions> m_maps_versions;
+    int                          m_last_version;
+    double                       m_epoch;   //distinguishes the versions of different runs of the server
+
     virtual bool read(yarp::os::ConnectionReader& connection) override;
     inline  void list_response(yarp::os::Bottle& out);
+    void updateVersions(const std::string& map_name, const yarp::dev::MapGrid2D* previous);
+    void appendTiles(yarp::os::Bottle& out, const std::string& map_name, int since);
 
 #endif //DOXYGEN_SHOULD_SKIP_THIS
 };
@@ -16,6 +16,9 @@
 #include <yarp/os/Semaphore.h>
 #include <yarp/os/LogStream.h>
 #include <yarp/os/QosStyle.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/LockGuard.h>
+#include <yarp/os/Thread.h>
 
 #include <yarp/sig/Vector.h>
 
@@ -28,9 +31,13 @@
 
 #include <stateExtendedReader.hpp>
 
+#include <functional>
+#include <map>
+#include <vector>
+
 #define PROTOCOL_VERSION_MAJOR 1
 #define PROTOCOL_VERSION_MINOR 9
-#define PROTOCOL_VERSION_TWEAK 0
+#define PROTOCOL_VERSION_TWEAK 2
 
 using namespace yarp::os;
 using namespace yarp::dev;
@@ -133,7 +140,11 @@ YARP_DISABLE_DEPRECATED_WARNING
 * | remote         |       -        | string  | -     |   -           | Yes          | Prefix of the port to which to connect.  |       |
 * | local          |       -        | string  | -     |   -           | Yes          | Port prefix of the port openend by this device.  |       |
 * | writeStrict    |       -        | string  | -     | See note      | No           |                                   |       |
+* | stateFields    |       -        | list    | -     |   -           | No           | fields of the state to stream, like (jointPosition torque) | read from the stateCompact:o port instead of stateExt:o, the other fields are not available |
 *
+* The names of the fields are the ones of the jointData structure: jointPosition,
+* jointVelocity, jointAcceleration, motorPosition, motorVelocity, motorAcceleration,
+* torque, pwmDutycycle, current, controlMode and interactionMode.
 */
 class yarp::dev::RemoteControlBoard :
     public IPidControl,
@@ -157,7 +168,8 @@ class yarp::dev::RemoteControlBoard :
     public IRemoteCalibrator,
     public IRemoteVariables,
     public IPWMControl,
-    public ICurrentControl
+    public ICurrentControl,
+    public IRpcBatch
 {
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
@@ -176,10 +188,8 @@ protected:
     // from the YARP .thrift file
 //  yarp::os::PortReaderBuffer<jointData>           extendedInputState_buffer;  // Buffer storing new data
     StateExtendedInputPort                          extendedIntputStatePort;  // Buffered port storing new data
-    Semaphore extendedPortMutex;
-    jointData last_singleJoint;     // tmp to store last received data for a particular joint
 //    yarp::os::Port extendedIntputStatePort;         // Port /stateExt:i reading the state of the joints
-    jointData last_wholePart;         // tmp to store last received data for whole part
+    StateCompactInputPort                           compactInputStatePort;    // Port /stateCompact:i, stores into extendedIntputStatePort
 
     ConstString remote;
     ConstString local;
@@ -190,6 +200,104 @@ protected:
 
     ProtocolVersion protocolVersion;
 
+    // reads the results of a query from a successful reply
+    typedef std::function<bool(Bottle&)> ReplyParser;
+
+    // queries collected by beginBatch(), see rpcQuery()
+    struct Batch
+    {
+        bool ok;
+        Bottle commands;    // [btch] (cmd1) (cmd2) ...
+        std::vector<ReplyParser> parsers;
+    };
+
+    // one batch per thread, by key of the thread; each one is used only
+    // by its thread, the mutex guards the map
+    mutable Mutex batchMutex;
+    mutable std::map<long, Batch> batches;
+
+    /**
+     * @return the batch of the calling thread, or YARP_NULLPTR if it is
+     * not collecting one
+     */
+    Batch *callerBatch() const
+    {
+        LockGuard guard(batchMutex);
+        std::map<long, Batch>::iterator it = batches.find(Thread::getKeyOfCaller());
+        return (it!=batches.end()) ? &it->second : YARP_NULLPTR;
+    }
+
+    /**
+     * Send the queries collected so far by the calling thread, all in one
+     * message if the remote device understands it.
+     */
+    void flushBatch(Batch& batch) const
+    {
+        if (batch.parsers.empty()) {
+            return;
+        }
+        std::vector<ReplyParser> parsers;
+        parsers.swap(batch.parsers);
+        Bottle cmd = batch.commands;
+        batch.commands.clear();
+        batch.commands.addVocab(VOCAB_BATCH);
+
+        bool ok = true;
+        if (protocolVersion.minor>9 || (protocolVersion.minor==9 && protocolVersion.tweak>=1)) {
+            Bottle response;
+            bool sent = rpc_p.write(cmd, response);
+            for (size_t i=0; i<parsers.size(); i++) {
+                Bottle *reply = response.get((int)i).asList();
+                if (!sent || reply==YARP_NULLPTR || !CHECK_FAIL(true, *reply) || !parsers[i](*reply)) {
+                    ok = false;
+                }
+            }
+        } else {
+            // older wrappers, one round trip per query
+            for (size_t i=0; i<parsers.size(); i++) {
+                Bottle response;
+                bool sent = rpc_p.write(*cmd.get((int)i+1).asList(), response);
+                if (!CHECK_FAIL(sent, response) || !parsers[i](response)) {
+                    ok = false;
+                }
+            }
+        }
+        batch.ok = batch.ok && ok;
+    }
+
+    /**
+     * Send a command and wait for the reply, after the queries batched by
+     * the calling thread, if any, so that the order of the calls is kept.
+     */
+    bool rpcWrite(Bottle& cmd, Bottle& response) const
+    {
+        Batch *batch = callerBatch();
+        if (batch!=YARP_NULLPTR) {
+            flushBatch(*batch);
+        }
+        return rpc_p.write(cmd, response);
+    }
+
+    /**
+     * Send a query and parse its reply, or just queue it if the calling
+     * thread is collecting a batch.
+     * @param cmd is the query
+     * @param parse reads the results from a successful reply
+     * @return true/false on success/failure, always true when queued
+     */
+    bool rpcQuery(Bottle& cmd, const ReplyParser& parse) const
+    {
+        Batch *batch = callerBatch();
+        if (batch!=YARP_NULLPTR) {
+            batch->commands.addList() = cmd;
+            batch->parsers.push_back(parse);
+            return true;
+        }
+        Bottle response;
+        bool ok = rpc_p.write(cmd, response);
+        return CHECK_FAIL(ok, response) && parse(response);
+    }
+
     // Check for number of joints, if needed.
     // This is to allow for delayed connection to the remote control board.
     bool isLive() {
@@ -206,7 +314,7 @@ protected:
     {
         Bottle cmd, response;
         cmd.addVocab(v);
-        bool ok=rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         if (CHECK_FAIL(ok, response)) {
             return true;
         }
@@ -218,7 +326,7 @@ protected:
         Bottle cmd, response;
         cmd.addVocab(v1);
         cmd.addVocab(v2);
-        bool ok=rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         if (CHECK_FAIL(ok, response)) {
             return true;
         }
@@ -231,7 +339,7 @@ protected:
         cmd.addVocab(v1);
         cmd.addVocab(v2);
         cmd.addInt(axis);
-        bool ok=rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         if (CHECK_FAIL(ok, response)) {
             return true;
         }
@@ -243,7 +351,7 @@ protected:
         Bottle cmd, response;
         cmd.addVocab(v);
         cmd.addInt(axis);
-        bool ok=rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         if (CHECK_FAIL(ok, response)) {
             return true;
         }
@@ -257,7 +365,7 @@ protected:
         cmd.addVocab(v2);
         cmd.addVocab(v3);
         cmd.addInt(j);
-        bool ok=rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         if (CHECK_FAIL(ok, response)) {
             return true;
         }
@@ -273,7 +381,7 @@ protected:
         cmd.addVocab(VOCAB_SET);
         cmd.addVocab(code);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -291,7 +399,7 @@ protected:
         cmd.addVocab(code);
         cmd.addDouble(v);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
 
         return CHECK_FAIL(ok, response);
     }
@@ -309,7 +417,7 @@ protected:
         cmd.addVocab(code);
         cmd.addInt(v);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
 
         return CHECK_FAIL(ok, response);
     }
@@ -326,7 +434,7 @@ protected:
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(code);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
 
         if (CHECK_FAIL(ok, response)) {
             // response should be [cmd] [name] value
@@ -351,7 +459,7 @@ protected:
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(code);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
 
         if (CHECK_FAIL(ok, response)) {
             // response should be [cmd] [name] value
@@ -377,7 +485,7 @@ protected:
         cmd.addVocab(code);
         cmd.addInt(j);
         cmd.addDouble(val);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -390,7 +498,7 @@ protected:
         cmd.addDouble(val1);
         cmd.addDouble(val2);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -409,7 +517,7 @@ protected:
         int i;
         for (i = 0; i < nj; i++)
             l.addDouble(val[i]);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -423,7 +531,7 @@ protected:
         int i;
         for (i = 0; i < nj; i++)
             l.addDouble(val[i]);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -440,7 +548,7 @@ protected:
         Bottle& l2 = cmd.addList();
         for (i = 0; i < nj; i++)
             l2.addDouble(val2[i]);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -457,7 +565,7 @@ protected:
         Bottle& l2 = cmd.addList();
         for (i = 0; i < len; i++)
             l2.addDouble(val2[i]);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -468,7 +576,7 @@ protected:
         cmd.addVocab(v2);
         cmd.addInt(axis);
         cmd.addDouble(val);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -482,7 +590,7 @@ protected:
         cmd.addVocab(type);
         cmd.addInt(axis);
         cmd.addDouble(val);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -498,40 +606,34 @@ protected:
         int i;
         for (i = 0; i < nj; i++)
             l.addDouble(val_arr[i]);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
     bool getValWithPidType(int voc, PidControlTypeEnum type, int j, double *val)
     {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_PID);
         cmd.addVocab(voc);
         cmd.addVocab(type);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response))
-        {
+        return rpcQuery(cmd, [this, val](Bottle& response) -> bool {
             *val = response.get(2).asDouble();
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     bool getValWithPidType(int voc, PidControlTypeEnum type, double *val)
     {
         if (!isLive()) return false;
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_PID);
         cmd.addVocab(voc);
         cmd.addVocab(type);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response))
-        {
+        return rpcQuery(cmd, [this, val](Bottle& response) -> bool {
             int i;
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
@@ -543,8 +645,7 @@ protected:
                 val[i] = l.get(i).asDouble();
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     bool set2V1I(int v1, int v2, int axis) {
@@ -553,7 +654,7 @@ protected:
         cmd.addVocab(v1);
         cmd.addVocab(v2);
         cmd.addInt(axis);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -565,20 +666,17 @@ protected:
      * @return true/false on success/failure
      */
     bool get1V1I1D(int v, int j, double *val) {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, val](Bottle& response) -> bool {
             // ok
             *val = response.get(2).asDouble();
 
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
 
@@ -590,72 +688,62 @@ protected:
      * @return true/false on success/failure
      */
     bool get1V1I1I(int v, int j, int *val) {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, val](Bottle& response) -> bool {
             // ok
             *val = response.get(2).asInt();
 
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     bool get2V1I1D(int v1, int v2, int j, double *val) {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v1);
         cmd.addVocab(v2);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, val](Bottle& response) -> bool {
             // ok
             *val = response.get(2).asDouble();
 
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     bool get2V1I2D(int v1, int v2, int j, double *val1, double *val2) {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v1);
         cmd.addVocab(v2);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, val1, val2](Bottle& response) -> bool {
             // ok
             *val1 = response.get(2).asDouble();
             *val2 = response.get(3).asDouble();
 
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     bool get1V1I2D(int code, int axis, double *v1, double *v2)
     {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(code);
         cmd.addInt(axis);
 
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [v1, v2](Bottle& response) -> bool {
             *v1 = response.get(2).asDouble();
             *v2 = response.get(3).asDouble();
             return true;
-        }
-        return false;
+        });
     }
 
     /**
@@ -666,21 +754,19 @@ protected:
      * @return true/false on success/failure
      */
     bool get1V1I1B(int v, int j, bool &val) {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, &val](Bottle& response) -> bool {
             val = (response.get(2).asInt()!=0);
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     bool get1V1I1IA1B(int v,  const int len, const int *val1, bool &retVal ) {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v);
         cmd.addInt(len);
@@ -688,19 +774,16 @@ protected:
         for (int i = 0; i < len; i++)
             l1.addInt(val1[i]);
 
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, &retVal](Bottle& response) -> bool {
             retVal = (response.get(2).asInt()!=0);
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     bool get2V1I1IA1DA(int v1, int v2, const int n_joints, const int *joints, double *retVals, yarp::os::ConstString functionName = "")
     {
-        Bottle cmd, response;
+        Bottle cmd;
         if (!isLive()) return false;
 
         cmd.addVocab(VOCAB_GET);
@@ -712,10 +795,7 @@ protected:
         for (int i = 0; i < n_joints; i++)
             l1.addInt(joints[i]);
 
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response))
-        {
+        return rpcQuery(cmd, [n_joints, retVals, functionName](Bottle& response) -> bool {
             int i;
             Bottle& list = *(response.get(0).asList());
             yAssert(list.size() >= n_joints)
@@ -733,21 +813,18 @@ protected:
                 }
                 return true;
             }
-        }
-        return false;
+        });
     }
 
     bool get1V1B(int v, bool &val) {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, &val](Bottle& response) -> bool {
             val = (response.get(2).asInt()!=0);
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     /**
@@ -758,11 +835,10 @@ protected:
      */
     bool get1VIA(int v, int *val) {
         if (!isLive()) return false;
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, val](Bottle& response) -> bool {
             int i;
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
@@ -777,8 +853,7 @@ protected:
             getTimeStamp(response, lastStamp);
 
             return true;
-        }
-        return false;
+        });
     }
 
     /**
@@ -789,11 +864,10 @@ protected:
      */
     bool get1VDA(int v, double *val) {
         if (!isLive()) return false;
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, val](Bottle& response) -> bool {
             int i;
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
@@ -808,8 +882,7 @@ protected:
             getTimeStamp(response, lastStamp);
 
             return true;
-        }
-        return false;
+        });
     }
 
     /**
@@ -820,12 +893,10 @@ protected:
      */
     bool get1V1DA(int v1, double *val) {
         if (!isLive()) return false;
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v1);
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, val](Bottle& response) -> bool {
             int i;
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
@@ -839,8 +910,7 @@ protected:
 
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     /**
@@ -852,13 +922,11 @@ protected:
      */
     bool get2V1DA(int v1, int v2, double *val) {
         if (!isLive()) return false;
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v1);
         cmd.addVocab(v2);
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, val](Bottle& response) -> bool {
             int i;
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
@@ -872,18 +940,16 @@ protected:
 
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     bool get2V2DA(int v1, int v2, double *val1, double *val2) {
         if (!isLive()) return false;
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v1);
         cmd.addVocab(v2);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, val1, val2](Bottle& response) -> bool {
             int i;
             Bottle* lp1 = response.get(2).asList();
             if (lp1 == 0)
@@ -906,23 +972,19 @@ protected:
 
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
     bool get1V1I1S(int code, int j, yarp::os::ConstString &name)
     {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(code);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [&name](Bottle& response) -> bool {
             name = response.get(2).asString();
             return true;
-        }
-        return false;
+        });
     }
 
 
@@ -930,7 +992,7 @@ protected:
     {
         if(!isLive()) return false;
 
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(v);
         cmd.addInt(len);
@@ -938,9 +1000,7 @@ protected:
         for(int i = 0; i < len; i++)
             l1.addInt(val1[i]);
 
-        bool ok = rpc_p.write(cmd, response);
-
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [this, len, val2](Bottle& response) -> bool {
             int i;
             Bottle* lp2 = response.get(2).asList();
             if (lp2 == 0)
@@ -958,8 +1018,7 @@ protected:
 
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        return false;
+        });
     }
 
 #endif /*DOXYGEN_SHOULD_SKIP_THIS*/
@@ -984,6 +1043,43 @@ public:
     }
 
 
+    template <class Connect>
+    void connectExtendedState(Connect& connect)
+    {
+        ConstString s1 = remote;
+        s1 += "/stateExt:o";
+        // not checking return value for now since it is wip (different machines can have different compilation flags
+        if (!connect(s1, extendedIntputStatePort.getName()))
+        {
+            yError("*** Extended port %s was not found on the controlBoardWrapper I'm connecting to. Falling back to compatibility behaviour\n", s1.c_str());
+            yWarning("Updating to newer yarp and the usage of controlBoardWrapper2 is suggested***\n");
+        }
+    }
+
+    // read from stateCompact:o only the given fields, if the wrapper can do it
+    template <class Connect>
+    bool connectCompactState(Connect& connect, int fields)
+    {
+        if (!(protocolVersion.minor>9 || (protocolVersion.minor==9 && protocolVersion.tweak>=2))) {
+            return false;
+        }
+        ConstString s1 = remote;
+        s1 += "/stateCompact:o";
+        if (!connect(s1, compactInputStatePort.getName())) {
+            return false;
+        }
+        Bottle cmd, response;
+        cmd.addVocab(VOCAB_SET);
+        cmd.addVocab(VOCAB_STATE_FIELDS);
+        cmd.addInt(fields);
+        cmd.addString(compactInputStatePort.getName());
+        bool ok = rpc_p.write(cmd, response) && CHECK_FAIL(true, response);
+        if (!ok) {
+            Network::disconnect(s1, compactInputStatePort.getName());
+        }
+        return ok;
+    }
+
     /**
      * Default open.
      * @return always true.
@@ -1054,6 +1150,27 @@ public:
             Value("udp"),
             "default carrier for streaming robot state").asString().c_str();
 
+        int stateFields = 0;
+        if (config.check("stateFields"))
+        {
+            bool ok;
+            stateFields = yarp::dev::impl::StateMessage::parseFields(config.find("stateFields"), ok);
+            if (!ok || stateFields == 0)
+            {
+                yError("Unknown field in 'stateFields', the fields are the ones of jointData\n");
+                return false;
+            }
+        }
+
+        auto connectState = [&](const ConstString& from, const ConstString& to) -> bool
+        {
+            bool ok = Network::connect(from, to, carrier);
+            // set the QoS preferences for the 'state' port
+            if (ok && (config.check("local_qos") || config.check("remote_qos")))
+                NetworkBase::setConnectionQos(from, to, remoteQos, localQos, false);
+            return ok;
+        };
+
         bool portProblem = false;
         if (local != "") {
             ConstString s1 = local;
@@ -1069,6 +1186,17 @@ public:
             {
                 extendedIntputStatePort.useCallback();
             }
+            if (stateFields != 0)
+            {
+                s1 = local;
+                s1 += "/stateCompact:i";
+                if (!compactInputStatePort.open(s1.c_str())) { portProblem = true; }
+                if (!portProblem)
+                {
+                    compactInputStatePort.setOwner(&extendedIntputStatePort);
+                    compactInputStatePort.useCallback();
+                }
+            }
         }
 
         bool connectionProblem = false;
@@ -1103,22 +1231,10 @@ public:
             if (config.check("local_qos") || config.check("remote_qos"))
                 NetworkBase::setConnectionQos(command_p.getName(), s1.c_str(), localQos, remoteQos, false);
 
-            s1 = remote;
-            s1 += "/stateExt:o";
-            s2 = local;
-            s2 += "/stateExt:i";
-            // not checking return value for now since it is wip (different machines can have different compilation flags
-            ok = Network::connect(s1, extendedIntputStatePort.getName(), carrier);
-            if (ok)
-            {
-                // set the QoS preferences for the 'state' port
-                if (config.check("local_qos") || config.check("remote_qos"))
-                    NetworkBase::setConnectionQos(s1, extendedIntputStatePort.getName(), remoteQos, localQos, false);
-            }
-            else
+            // with stateFields, the state port is connected once the protocol of the wrapper is known
+            if (stateFields == 0)
             {
-                yError("*** Extended port %s was not found on the controlBoardWrapper I'm connecting to. Falling back to compatibility behaviour\n", s1.c_str());
-                yWarning("Updating to newer yarp and the usage of controlBoardWrapper2 is suggested***\n");
+                connectExtendedState(connectState);
             }
         }
 
@@ -1127,6 +1243,7 @@ public:
             rpc_p.close();
             command_p.close();
             extendedIntputStatePort.close();
+            compactInputStatePort.close();
             return false;
         }
 
@@ -1140,6 +1257,7 @@ public:
             rpc_p.close();
             command_p.close();
             extendedIntputStatePort.close();
+            compactInputStatePort.close();
             return false;
         }
 
@@ -1150,10 +1268,18 @@ public:
                 rpc_p.close();
                 command_p.close();
                 extendedIntputStatePort.close();
+                compactInputStatePort.close();
                 return false;
             }
         }
 
+        if (stateFields != 0 && !connectCompactState(connectState, stateFields))
+        {
+            yWarning("Cannot stream only the fields in 'stateFields' from %s, streaming all of them\n", remote.c_str());
+            compactInputStatePort.close();
+            connectExtendedState(connectState);
+        }
+
         if (config.check("diagnostic"))
         {
             diagnosticThread = new DiagnosticThread(DIAGNOSTIC_THREAD_RATE);
@@ -1163,32 +1289,6 @@ public:
         else
             diagnosticThread=0;
 
-        // allocate memory for helper struct
-        // single joint
-        last_singleJoint.jointPosition.resize(1);
-        last_singleJoint.jointVelocity.resize(1);
-        last_singleJoint.jointAcceleration.resize(1);
-        last_singleJoint.motorPosition.resize(1);
-        last_singleJoint.motorVelocity.resize(1);
-        last_singleJoint.motorAcceleration.resize(1);
-        last_singleJoint.torque.resize(1);
-        last_singleJoint.pwmDutycycle.resize(1);
-        last_singleJoint.current.resize(1);
-        last_singleJoint.controlMode.resize(1);
-        last_singleJoint.interactionMode.resize(1);
-
-        // whole part  (safe here because we already got the nj
-        last_wholePart.jointPosition.resize(nj);
-        last_wholePart.jointVelocity.resize(nj);
-        last_wholePart.jointAcceleration.resize(nj);
-        last_wholePart.motorPosition.resize(nj);
-        last_wholePart.motorVelocity.resize(nj);
-        last_wholePart.motorAcceleration.resize(nj);
-        last_wholePart.torque.resize(nj);
-        last_wholePart.current.resize(nj);
-        last_wholePart.pwmDutycycle.resize(nj);
-        last_wholePart.controlMode.resize(nj);
-        last_wholePart.interactionMode.resize(nj);
         return true;
     }
 
@@ -1207,6 +1307,7 @@ public:
         rpc_p.close();
         command_p.close();
         extendedIntputStatePort.close();
+        compactInputStatePort.close();
         return true;
     }
 
@@ -1228,7 +1329,7 @@ public:
         l.addDouble(pid.stiction_up_val);
         l.addDouble(pid.stiction_down_val);
         l.addDouble(pid.kff);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -1255,7 +1356,7 @@ public:
             m.addDouble(pids[i].kff);
         }
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -1285,14 +1386,13 @@ public:
     }
 
     virtual bool getPid(const PidControlTypeEnum& pidtype, int j, Pid *pid) override {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_PID);
         cmd.addVocab(VOCAB_PID);
         cmd.addVocab(pidtype);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [pid](Bottle& response) -> bool {
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
                 return false;
@@ -1308,20 +1408,17 @@ public:
             pid->stiction_down_val = l.get(8).asDouble();
             pid->kff = l.get(9).asDouble();
             return true;
-        }
-        return false;
+        });
     }
 
     virtual bool getPids(const PidControlTypeEnum& pidtype, Pid *pids) override {
         if (!isLive()) return false;
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_PID);
         cmd.addVocab(VOCAB_PIDS);
         cmd.addVocab(pidtype);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response))
-        {
+        return rpcQuery(cmd, [this, pids](Bottle& response) -> bool {
             int i;
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
@@ -1345,8 +1442,7 @@ public:
                 pids[i].kff = mp->get(9).asDouble();
             }
             return true;
-        }
-        return false;
+        });
     }
 
     virtual bool getPidReference(const PidControlTypeEnum& pidtype, int j, double *ref) override {
@@ -1373,7 +1469,7 @@ public:
         cmd.addVocab(VOCAB_RESET);
         cmd.addVocab(pidtype);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -1385,7 +1481,7 @@ public:
         cmd.addVocab(VOCAB_DISABLE);
         cmd.addVocab(pidtype);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -1397,25 +1493,22 @@ public:
         cmd.addVocab(VOCAB_ENABLE);
         cmd.addVocab(pidtype);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
     virtual bool isPidEnabled(const PidControlTypeEnum& pidtype, int j, bool* enabled) override
     {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_PID);
         cmd.addVocab(VOCAB_ENABLE);
         cmd.addVocab(pidtype);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response))
-        {
+        return rpcQuery(cmd, [enabled](Bottle& response) -> bool {
             *enabled = response.get(2).asBool();
             return true;
-        }
-        return false;
+        });
     }
 
     virtual bool getPidOutput(const PidControlTypeEnum& pidtype, int j, double *out) override
@@ -1481,9 +1574,9 @@ public:
     {
         double localArrivalTime = 0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_ENCODER, v, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_ENCODER, v, stamp, localArrivalTime);
+        lastStamp = stamp;
 
         if (ret && ( (Time::now()-localArrivalTime) > TIMEOUT) )
             ret = false;
@@ -1501,10 +1594,10 @@ public:
     {
         double localArrivalTime = 0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_ENCODER, v, lastStamp, localArrivalTime);
-        *t=lastStamp.getTime();
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_ENCODER, v, stamp, localArrivalTime);
+        lastStamp = stamp;
+        *t=stamp.getTime();
 
         if (ret && ( (Time::now()-localArrivalTime) > TIMEOUT) )
             ret = false;
@@ -1524,9 +1617,9 @@ public:
     virtual bool getEncoders(double *encs) override {
         double localArrivalTime = 0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_ENCODERS, encs, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_ENCODERS, encs, stamp, localArrivalTime);
+        lastStamp = stamp;
 
         return ret;
     }
@@ -1540,10 +1633,10 @@ public:
     virtual bool getEncodersTimed(double *encs, double *ts) override {
         double localArrivalTime=0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_ENCODERS, encs, lastStamp, localArrivalTime);
-        std::fill_n(ts, nj, lastStamp.getTime());
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_ENCODERS, encs, stamp, localArrivalTime);
+        lastStamp = stamp;
+        std::fill_n(ts, nj, stamp.getTime());
 
         if ( (Time::now()-localArrivalTime) > TIMEOUT)
             ret=false;
@@ -1560,9 +1653,9 @@ public:
     {
         double localArrivalTime=0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_ENCODER_SPEED, sp, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_ENCODER_SPEED, sp, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -1576,9 +1669,9 @@ public:
     {
         double localArrivalTime=0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_ENCODER_SPEEDS, spds, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_ENCODER_SPEEDS, spds, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -1591,9 +1684,9 @@ public:
     virtual bool getEncoderAcceleration(int j, double *acc) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_ENCODER_ACCELERATION, acc, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_ENCODER_ACCELERATION, acc, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -1605,26 +1698,50 @@ public:
     virtual bool getEncoderAccelerations(double *accs) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_ENCODER_ACCELERATIONS, accs, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_ENCODER_ACCELERATIONS, accs, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
+    /* IRpcBatch */
+    virtual bool beginBatch() override
+    {
+        LockGuard guard(batchMutex);
+        long key = Thread::getKeyOfCaller();
+        if (batches.find(key)!=batches.end()) {
+            return false;
+        }
+        Batch& batch = batches[key];
+        batch.ok = true;
+        batch.commands.addVocab(VOCAB_BATCH);
+        return true;
+    }
+
+    virtual bool endBatch() override
+    {
+        Batch *batch = callerBatch();
+        if (batch==YARP_NULLPTR) {
+            return false;
+        }
+        flushBatch(*batch);
+        bool ok = batch->ok;
+        LockGuard guard(batchMutex);
+        batches.erase(Thread::getKeyOfCaller());
+        return ok;
+    }
+
     /* IRemoteVariable */
     virtual bool getRemoteVariable(yarp::os::ConstString key, yarp::os::Bottle& val) override {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_REMOTE_VARIABILE_INTERFACE);
         cmd.addVocab(VOCAB_VARIABLE);
         cmd.addString(key);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response))
-        {
+        return rpcQuery(cmd, [&val](Bottle& response) -> bool {
             val = *(response.get(2).asList());
             return true;
-        }
-        return false;
+        });
     }
 
     virtual bool setRemoteVariable(yarp::os::ConstString key, const yarp::os::Bottle& val) override {
@@ -1635,26 +1752,23 @@ public:
         cmd.addString(key);
         cmd.append(val);
         //std::string s = cmd.toString();
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
 
         return CHECK_FAIL(ok, response);
     }
 
 
     virtual bool getRemoteVariablesList(yarp::os::Bottle* listOfKeys) override {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_REMOTE_VARIABILE_INTERFACE);
         cmd.addVocab(VOCAB_LIST_VARIABLES);
-        bool ok = rpc_p.write(cmd, response);
-        //std::string s = response.toString();
-        if (CHECK_FAIL(ok, response))
-        {
+        return rpcQuery(cmd, [listOfKeys](Bottle& response) -> bool {
+            //std::string s = response.toString();
             *listOfKeys = *(response.get(2).asList());
             //std::string s = listOfKeys->toString();
             return true;
-        }
-        return false;
+        });
     }
 
     /* IMotor */
@@ -1753,9 +1867,9 @@ public:
     {
         double localArrivalTime = 0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_MOTOR_ENCODER, v, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_MOTOR_ENCODER, v, stamp, localArrivalTime);
+        lastStamp = stamp;
 
         if(ret && ((Time::now()-localArrivalTime) > TIMEOUT) )
             ret=false;
@@ -1773,10 +1887,10 @@ public:
     {
         double localArrivalTime = 0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_MOTOR_ENCODER, v, lastStamp, localArrivalTime);
-        *t=lastStamp.getTime();
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_MOTOR_ENCODER, v, stamp, localArrivalTime);
+        lastStamp = stamp;
+        *t=stamp.getTime();
 
         if(ret && ((Time::now()-localArrivalTime) > TIMEOUT) )
             ret=false;
@@ -1797,9 +1911,9 @@ public:
     {
         double localArrivalTime=0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_MOTOR_ENCODERS, encs, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_MOTOR_ENCODERS, encs, stamp, localArrivalTime);
+        lastStamp = stamp;
 
         return ret;
     }
@@ -1814,10 +1928,10 @@ public:
     {
         double localArrivalTime=0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_MOTOR_ENCODERS, encs, lastStamp, localArrivalTime);
-        std::fill_n(ts, nj, lastStamp.getTime());
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_MOTOR_ENCODERS, encs, stamp, localArrivalTime);
+        lastStamp = stamp;
+        std::fill_n(ts, nj, stamp.getTime());
 
         if(ret && ((Time::now()-localArrivalTime) > TIMEOUT) )
             ret=false;
@@ -1833,9 +1947,9 @@ public:
     virtual bool getMotorEncoderSpeed(int j, double *sp) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_MOTOR_ENCODER_SPEED, sp, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_MOTOR_ENCODER_SPEED, sp, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -1847,9 +1961,9 @@ public:
     virtual bool getMotorEncoderSpeeds(double *spds) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_MOTOR_ENCODER_SPEEDS, spds, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_MOTOR_ENCODER_SPEEDS, spds, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -1862,9 +1976,9 @@ public:
     virtual bool getMotorEncoderAcceleration(int j, double *acc) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_MOTOR_ENCODER_ACCELERATION, acc, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_MOTOR_ENCODER_ACCELERATION, acc, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -1876,9 +1990,9 @@ public:
     virtual bool getMotorEncoderAccelerations(double *accs) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_MOTOR_ENCODER_SPEEDS, accs, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_MOTOR_ENCODER_ACCELERATIONS, accs, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -2195,7 +2309,7 @@ public:
         for (i = 0; i < len; i++)
             l1.addInt(val1[i]);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -2379,9 +2493,9 @@ public:
     virtual bool getPWM(int m, double* val) override
     {
         double localArrivalTime = 0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(m, VOCAB_PWMCONTROL_PWM_OUTPUT, val, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(m, VOCAB_PWMCONTROL_PWM_OUTPUT, val, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -2485,7 +2599,7 @@ public:
         cmd.addDouble(v2);
         cmd.addDouble(v3);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
 
         if (CHECK_FAIL(ok, response)) {
             return true;
@@ -2505,7 +2619,7 @@ public:
         cmd.addDouble(params.param3);
         cmd.addDouble(params.param4);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
 
         if (CHECK_FAIL(ok, response)) {
             return true;
@@ -2594,19 +2708,18 @@ public:
         b.addDouble(params.bemf_scale);
         b.addDouble(params.ktau);
         b.addDouble(params.ktau_scale);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
     bool getMotorTorqueParams(int j, MotorTorqueParameters *params) override
     {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_TORQUE);
         cmd.addVocab(VOCAB_MOTOR_PARAMS);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [params](Bottle& response) -> bool {
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
                 return false;
@@ -2621,25 +2734,24 @@ public:
             params->ktau        = l.get(2).asDouble();
             params->ktau_scale  = l.get(3).asDouble();
             return true;
-        }
-        return false;
+        });
     }
 
     bool getTorque(int j, double *t) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_TRQ, t, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_TRQ, t, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
     bool getTorques(double *t) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_TRQS, t, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_TRQS, t, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -2651,13 +2763,12 @@ public:
 
     bool getImpedance(int j, double *stiffness, double *damping) override
     {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_IMPEDANCE);
         cmd.addVocab(VOCAB_IMP_PARAM);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [stiffness, damping](Bottle& response) -> bool {
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
                 return false;
@@ -2665,27 +2776,24 @@ public:
             *stiffness = l.get(0).asDouble();
             *damping   = l.get(1).asDouble();
             return true;
-        }
-        return false;
+        });
     }
 
     bool getImpedanceOffset(int j, double *offset) override
     {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_IMPEDANCE);
         cmd.addVocab(VOCAB_IMP_OFFSET);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [offset](Bottle& response) -> bool {
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
                 return false;
             Bottle& l = *lp;
             *offset    = l.get(0).asDouble();
             return true;
-        }
-        return false;
+        });
     }
 
     bool setImpedance(int j, double stiffness, double damping) override
@@ -2700,7 +2808,7 @@ public:
         b.addDouble(stiffness);
         b.addDouble(damping);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -2715,19 +2823,18 @@ public:
         Bottle& b = cmd.addList();
         b.addDouble(offset);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
     bool getCurrentImpedanceLimit(int j, double *min_stiff, double *max_stiff, double *min_damp, double *max_damp) override
     {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_IMPEDANCE);
         cmd.addVocab(VOCAB_LIMITS);
         cmd.addInt(j);
-        bool ok = rpc_p.write(cmd, response);
-        if (CHECK_FAIL(ok, response)) {
+        return rpcQuery(cmd, [min_stiff, max_stiff, min_damp, max_damp](Bottle& response) -> bool {
             Bottle* lp = response.get(2).asList();
             if (lp == 0)
                 return false;
@@ -2737,17 +2844,16 @@ public:
             *min_damp     = l.get(2).asDouble();
             *max_damp     = l.get(3).asDouble();
             return true;
-        }
-        return false;
+        });
     }
 
     // IControlMode
     bool getControlMode(int j, int *mode) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_CM_CONTROL_MODE, mode, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_CM_CONTROL_MODE, mode, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -2756,17 +2862,9 @@ public:
     {
         double localArrivalTime=0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_CM_CONTROL_MODES, last_wholePart.controlMode.getFirst(), lastStamp, localArrivalTime);
-        if(ret)
-        {
-            for (int i = 0; i < n_joint; i++)
-                modes[i] = last_wholePart.controlMode[joints[i]];
-        }
-        else
-            ret = false;
-
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_CM_CONTROL_MODES, n_joint, joints, modes, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -2774,9 +2872,9 @@ public:
     bool getControlModes(int *modes) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_CM_CONTROL_MODES, modes, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_CM_CONTROL_MODES, modes, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -2791,7 +2889,7 @@ public:
         cmd.addInt(j);
         cmd.addVocab(mode);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -2812,7 +2910,7 @@ public:
         for (i = 0; i < n_joint; i++)
             l2.addVocab(modes[i]);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -2829,7 +2927,7 @@ public:
         for (i = 0; i < nj; i++)
             l2.addVocab(modes[i]);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -2932,9 +3030,9 @@ public:
     bool getInteractionMode(int axis, yarp::dev::InteractionModeEnum* mode) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(axis, VOCAB_INTERACTION_MODE, (int*) mode, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(axis, VOCAB_INTERACTION_MODE, (int*) mode, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -2942,26 +3040,18 @@ public:
     {
         double localArrivalTime=0.0;
 
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_CM_CONTROL_MODES, last_wholePart.interactionMode.getFirst(), lastStamp, localArrivalTime);
-        if(ret)
-        {
-            for (int i = 0; i < n_joints; i++)
-                modes[i] = (yarp::dev::InteractionModeEnum)last_wholePart.interactionMode[joints[i]];
-        }
-        else
-            ret = false;
-
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_INTERACTION_MODES, n_joints, joints, (int*) modes, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
     bool getInteractionModes(yarp::dev::InteractionModeEnum* modes) override
     {
         double localArrivalTime=0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_INTERACTION_MODES, (int*) modes, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_INTERACTION_MODES, (int*) modes, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
@@ -2976,7 +3066,7 @@ public:
         cmd.addInt(axis);
         cmd.addVocab(mode);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -2999,7 +3089,7 @@ public:
         {
             l2.addVocab(modes[i]);
         }
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -3016,7 +3106,7 @@ public:
         for (int i = 0; i < nj; i++)
             l1.addVocab(modes[i]);
 
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -3027,7 +3117,7 @@ public:
         Bottle cmd, reply;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_PROTOCOL_VERSION);
-        rpc_p.write(cmd, reply);
+        rpcWrite(cmd, reply);
 
         // check size and format of messages, expected [prot] int int int [ok]
         if (reply.size()!=5)
@@ -3085,7 +3175,7 @@ public:
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_REMOTE_CALIBRATOR_INTERFACE);
         cmd.addVocab(VOCAB_IS_CALIBRATOR_PRESENT);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         if(ok)
         {
             *isCalib = response.get(2).asInt()!=0;
@@ -3117,7 +3207,7 @@ public:
         cmd.addVocab(VOCAB_SET);
         cmd.addVocab(VOCAB_REMOTE_CALIBRATOR_INTERFACE);
         cmd.addVocab(VOCAB_CALIBRATE_WHOLE_PART);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -3141,7 +3231,7 @@ public:
         cmd.addVocab(VOCAB_SET);
         cmd.addVocab(VOCAB_REMOTE_CALIBRATOR_INTERFACE);
         cmd.addVocab(VOCAB_HOMING_WHOLE_PART);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         yDebug() << "Sent homing whole part message";
         return CHECK_FAIL(ok, response);
     }
@@ -3165,7 +3255,7 @@ public:
         cmd.addVocab(VOCAB_SET);
         cmd.addVocab(VOCAB_REMOTE_CALIBRATOR_INTERFACE);
         cmd.addVocab(VOCAB_PARK_WHOLE_PART);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -3179,7 +3269,7 @@ public:
         cmd.addVocab(VOCAB_SET);
         cmd.addVocab(VOCAB_REMOTE_CALIBRATOR_INTERFACE);
         cmd.addVocab(VOCAB_QUIT_CALIBRATE);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -3193,7 +3283,7 @@ public:
         cmd.addVocab(VOCAB_SET);
         cmd.addVocab(VOCAB_REMOTE_CALIBRATOR_INTERFACE);
         cmd.addVocab(VOCAB_QUIT_PARK);
-        bool ok = rpc_p.write(cmd, response);
+        bool ok = rpcWrite(cmd, response);
         return CHECK_FAIL(ok, response);
     }
 
@@ -3312,25 +3402,19 @@ public:
 
     virtual bool getRefDutyCycle(int j, double *ref) override
     {
-        Bottle cmd, response;
+        Bottle cmd;
         cmd.addVocab(VOCAB_GET);
         cmd.addVocab(VOCAB_PWMCONTROL_INTERFACE);
         cmd.addVocab(VOCAB_PWMCONTROL_REF_PWM);
         cmd.addInt(j);
-        response.clear();
-
-        bool ok = rpc_p.write(cmd, response);
 
-        if (CHECK_FAIL(ok, response))
-        {
+        return rpcQuery(cmd, [this, ref](Bottle& response) -> bool {
             // ok
             *ref = response.get(2).asDouble();
 
             getTimeStamp(response, lastStamp);
             return true;
-        }
-        else
-            return false;
+        });
     }
 
     virtual bool getRefDutyCycles(double *refs) override
@@ -3341,18 +3425,18 @@ public:
     virtual bool getDutyCycle(int j, double *out) override
     {
         double localArrivalTime = 0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_PWMCONTROL_PWM_OUTPUT, out, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastSingle(j, VOCAB_PWMCONTROL_PWM_OUTPUT, out, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
     virtual bool getDutyCycles(double *outs) override
     {
         double localArrivalTime = 0.0;
-        extendedPortMutex.wait();
-        bool ret = extendedIntputStatePort.getLastVector(VOCAB_PWMCONTROL_PWM_OUTPUTS, outs, lastStamp, localArrivalTime);
-        extendedPortMutex.post();
+        Stamp stamp;
+        bool ret = extendedIntputStatePort.getLastVector(VOCAB_PWMCONTROL_PWM_OUTPUTS, outs, stamp, localArrivalTime);
+        lastStamp = stamp;
         return ret;
     }
 
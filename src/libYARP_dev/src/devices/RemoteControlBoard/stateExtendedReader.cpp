@@ -5,6 +5,7 @@
  */
 
 #include "stateExtendedReader.hpp"
+#include <algorithm>
 #include <cstring>
 
 #include <yarp/os/PortablePair.h>
@@ -15,6 +16,7 @@
 #include <yarp/os/Vocab.h>
 #include <yarp/os/Stamp.h>
 #include <yarp/os/Semaphore.h>
+#include <yarp/os/LockGuard.h>
 #include <yarp/os/LogStream.h>
 
 #include <yarp/sig/Vector.h>
@@ -30,268 +32,310 @@ using namespace yarp::os;
 using namespace yarp::dev;
 using namespace yarp::sig;
 
+typedef yarp::dev::impl::StateMessage StateMessage;
+
 void StateExtendedInputPort::resetStat()
 {
-    mutex.wait();
+    LockGuard guard(writeMutex);
     count=0;
     deltaT=0;
     deltaTMax=0;
     deltaTMin=1e22;
-    now=Time::now();
-    prev=now;
-    mutex.post();
+    prev=Time::now();
 }
 
-StateExtendedInputPort::StateExtendedInputPort()
+StateExtendedInputPort::StateExtendedInputPort() :
+        joints(0),
+        validFields(0),
+        now(0),
+        valid(false),
+        sequence(0)
 {
-    valid=false;
     resetStat();
 }
 
-void StateExtendedInputPort::init(int numberOfJoints)
+int StateExtendedInputPort::getField(int vocab)
 {
-    last.jointPosition.resize(numberOfJoints);
-    last.jointVelocity.resize(numberOfJoints);
-    last.jointAcceleration.resize(numberOfJoints);
-    last.motorPosition.resize(numberOfJoints);
-    last.motorVelocity.resize(numberOfJoints);
-    last.motorAcceleration.resize(numberOfJoints);
-    last.torque.resize(numberOfJoints);
-    last.pwmDutycycle.resize(numberOfJoints);
-    last.current.resize(numberOfJoints);
-    last.controlMode.resize(numberOfJoints);
-    last.interactionMode.resize(numberOfJoints);
+    switch(vocab)
+    {
+        case VOCAB_ENCODER:
+        case VOCAB_ENCODERS:
+            return StateMessage::JointPosition;
+        case VOCAB_ENCODER_SPEED:
+        case VOCAB_ENCODER_SPEEDS:
+            return StateMessage::JointVelocity;
+        case VOCAB_ENCODER_ACCELERATION:
+        case VOCAB_ENCODER_ACCELERATIONS:
+            return StateMessage::JointAcceleration;
+        case VOCAB_MOTOR_ENCODER:
+        case VOCAB_MOTOR_ENCODERS:
+            return StateMessage::MotorPosition;
+        case VOCAB_MOTOR_ENCODER_SPEED:
+        case VOCAB_MOTOR_ENCODER_SPEEDS:
+            return StateMessage::MotorVelocity;
+        case VOCAB_MOTOR_ENCODER_ACCELERATION:
+        case VOCAB_MOTOR_ENCODER_ACCELERATIONS:
+            return StateMessage::MotorAcceleration;
+        case VOCAB_TRQ:
+        case VOCAB_TRQS:
+            return StateMessage::Torque;
+        case VOCAB_PWMCONTROL_PWM_OUTPUT:
+        case VOCAB_PWMCONTROL_PWM_OUTPUTS:
+            return StateMessage::PwmDutycycle;
+        case VOCAB_AMP_CURRENTS:
+            return StateMessage::Current;
+        case VOCAB_CM_CONTROL_MODE:
+        case VOCAB_CM_CONTROL_MODES:
+            return StateMessage::ControlMode;
+        case VOCAB_INTERACTION_MODE:
+        case VOCAB_INTERACTION_MODES:
+            return StateMessage::InteractionMode;
+        default:
+            return -1;
+    }
 }
 
 void StateExtendedInputPort::onRead(jointData &v)
 {
-    now=Time::now();
-    mutex.wait();
+    // only this port's thread uses the converted message
+    int n = v.jointPosition.size();
+    converted.resize(n);
+    yarp::sig::VectorOf<double>* fields[StateMessage::FirstIntField] = {
+        &v.jointPosition, &v.jointVelocity, &v.jointAcceleration,
+        &v.motorPosition, &v.motorVelocity, &v.motorAcceleration,
+        &v.torque, &v.pwmDutycycle, &v.current };
+    bool fieldsValid[StateMessage::FieldCount] = {
+        v.jointPosition_isValid, v.jointVelocity_isValid, v.jointAcceleration_isValid,
+        v.motorPosition_isValid, v.motorVelocity_isValid, v.motorAcceleration_isValid,
+        v.torque_isValid, v.pwmDutycycle_isValid, v.current_isValid,
+        v.controlMode_isValid, v.interactionMode_isValid };
+
+    converted.fields = 0;
+    converted.valid = 0;
+    for (int field = 0; field < StateMessage::FieldCount; field++)
+    {
+        int size = (field < StateMessage::FirstIntField) ? (int)fields[field]->size() :
+                   (field == StateMessage::ControlMode) ? (int)v.controlMode.size() : (int)v.interactionMode.size();
+        if (size != n)
+        {
+            continue;
+        }
+        if (field < StateMessage::FirstIntField)
+        {
+            std::copy(fields[field]->getFirst(), fields[field]->getFirst() + n, converted.getDoubles(field));
+        }
+        else
+        {
+            const int *modes = (field == StateMessage::ControlMode) ? v.controlMode.getFirst() : v.interactionMode.getFirst();
+            std::copy(modes, modes + n, converted.getInts(field));
+        }
+        converted.fields |= 1 << field;
+        if (fieldsValid[field])
+        {
+            converted.valid |= 1 << field;
+        }
+    }
+
+    Stamp stamp;
+    getEnvelope(stamp);
+    update(converted, stamp);
+}
+
+void StateCompactInputPort::onRead(StateMessage &v)
+{
+    if (owner == YARP_NULLPTR)
+    {
+        return;
+    }
+    Stamp stamp;
+    getEnvelope(stamp);
+    owner->update(v, stamp);
+}
+
+void StateExtendedInputPort::update(const StateMessage& msg, const Stamp& stamp)
+{
+    LockGuard guard(writeMutex);
+    double arrival=Time::now();
+
+    // the size of the state is fixed by the first message
+    int n = msg.getJoints();
+    if (n == 0 || (joints != 0 && n != joints))
+    {
+        yError() << "RemoteControlBoard received the state of" << n << "joints instead of" << joints << ", ignoring it";
+        return;
+    }
 
     if (count>0)
     {
-        double tmpDT=now-prev;
+        double tmpDT=arrival-prev;
         deltaT+=tmpDT;
         if (tmpDT>deltaTMax)
             deltaTMax=tmpDT;
         if (tmpDT<deltaTMin)
             deltaTMin=tmpDT;
     }
-
-    prev=now;
+    prev=arrival;
     count++;
 
-    valid=true;
-    last=v;
-    getEnvelope(lastStamp);
+    sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (joints == 0)
+    {
+        // nobody reads the vectors until valid is set
+        joints = n;
+        doubles.resize(StateMessage::FirstIntField * n);
+        ints.resize((StateMessage::FieldCount - StateMessage::FirstIntField) * n);
+    }
+    for (int field = 0; field < StateMessage::FieldCount; field++)
+    {
+        if (!(msg.fields & (1 << field)))
+        {
+            continue;
+        }
+        if (field < StateMessage::FirstIntField)
+        {
+            std::copy(msg.getDoubles(field), msg.getDoubles(field) + n, &doubles[field * n]);
+        }
+        else
+        {
+            std::copy(msg.getInts(field), msg.getInts(field) + n, &ints[(field - StateMessage::FirstIntField) * n]);
+        }
+    }
+    // fields not carried by the message keep their last value
+    validFields = (validFields & ~msg.fields) | (msg.valid & msg.fields);
+    lastStamp = stamp;
     //check that timestamp are available
     if (!lastStamp.isValid())
-        lastStamp.update(now);
-    mutex.post();
+        lastStamp.update(arrival);
+    now = arrival;
+    valid = true;
+
+    sequence.fetch_add(1, std::memory_order_release);
 }
 
-bool StateExtendedInputPort::getLastSingle(int j, int field, double *data, Stamp &stamp, double &localArrivalTime)
+bool StateExtendedInputPort::getLast(int field, int first, int n, const int *group, double *data, int *idata, Stamp &stamp, double &localArrivalTime)
 {
-    mutex.wait();
-    bool ret = valid;
-    if (ret)
+    for (;;)
     {
-        switch(field)
+        unsigned int seq = sequence.load(std::memory_order_acquire);
+        if (seq & 1)
         {
-            case VOCAB_ENCODER:
-                *data = last.jointPosition[j];
-                ret  = last.jointPosition_isValid;
-            break;
-
-            case VOCAB_ENCODER_SPEED:
-                ret = last.jointVelocity_isValid;
-                *data = last.jointVelocity[j];
-                break;
-
-            case VOCAB_ENCODER_ACCELERATION:
-                ret = last.jointAcceleration_isValid;
-                *data = last.jointAcceleration[j];
-            break;
-
-            case VOCAB_MOTOR_ENCODER:
-                ret = last.motorPosition_isValid;
-                *data = last.motorPosition[j];
-            break;
-
-            case VOCAB_MOTOR_ENCODER_SPEED:
-                ret = last.motorVelocity_isValid;
-                *data = last.motorVelocity[j];
-            break;
-
-            case VOCAB_MOTOR_ENCODER_ACCELERATION:
-                ret = last.motorAcceleration_isValid;
-                *data = last.motorAcceleration[j];
-            break;
-
-            case VOCAB_TRQ:
-                ret = last.torque_isValid;
-                *data = last.torque[j];
-            break;
-
-            case VOCAB_PWMCONTROL_PWM_OUTPUT:
-                ret = last.pwmDutycycle_isValid;
-                *data = last.pwmDutycycle[j];
-            break;
-
-            case VOCAB_AMP_CURRENTS:
-                ret = last.current_isValid;
-                *data = last.current[j];
-                break;
+            // being updated, it takes no longer than copying a message
+            Time::yield();
+            continue;
+        }
 
-            default:
-                yError() << "RemoteControlBoard internal error while reading data. Cannot get 'single' data of type " << yarp::os::Vocab::decode(field);
-            break;
+        bool ret = valid;
+        if (ret)
+        {
+            int size = (n < 0) ? joints : n;
+            ret = (validFields & (1 << field)) != 0;
+            for (int i = 0; i < size && ret; i++)
+            {
+                int j = group ? group[i] : first + i;
+                if (j < 0 || j >= joints)
+                {
+                    ret = false;
+                }
+                else if (data)
+                {
+                    data[i] = doubles[field * joints + j];
+                }
+                else
+                {
+                    idata[i] = ints[(field - StateMessage::FirstIntField) * joints + j];
+                }
+            }
+            localArrivalTime=now;
+            stamp = lastStamp;
         }
 
-        localArrivalTime=now;
-        stamp = lastStamp;
+        // what was copied is good only if no update started meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == seq)
+        {
+            return ret;
+        }
     }
-    mutex.post();
+}
 
-    return ret;
+bool StateExtendedInputPort::getLastSingle(int j, int field, double *data, Stamp &stamp, double &localArrivalTime)
+{
+    int f = getField(field);
+    if (f < 0 || f >= StateMessage::FirstIntField)
+    {
+        yError() << "RemoteControlBoard internal error while reading data. Cannot get 'single' data of type " << yarp::os::Vocab::decode(field);
+        return false;
+    }
+    return getLast(f, j, 1, YARP_NULLPTR, data, YARP_NULLPTR, stamp, localArrivalTime);
 }
 
 bool StateExtendedInputPort::getLastSingle(int j, int field, int *data, Stamp &stamp, double &localArrivalTime)
 {
-    mutex.wait();
-    bool ret = valid;
-    if (ret)
+    int f = getField(field);
+    if (f < StateMessage::FirstIntField)
     {
-        switch(field)
-        {
-            case VOCAB_CM_CONTROL_MODE:
-                ret = last.controlMode_isValid;
-                *data = last.controlMode[j];
-            break;
-
-            case VOCAB_INTERACTION_MODE:
-                ret = last.interactionMode_isValid;
-                *data = last.interactionMode[j];
-            break;
-
-            default:
-                yError() << "RemoteControlBoard internal error while reading data. Cannot get 'single' data of type " << yarp::os::Vocab::decode(field);
-            break;
-        }
-        localArrivalTime=now;
-        stamp = lastStamp;
+        yError() << "RemoteControlBoard internal error while reading data. Cannot get 'single' data of type " << yarp::os::Vocab::decode(field);
+        return false;
     }
-    mutex.post();
-    return ret;
+    return getLast(f, j, 1, YARP_NULLPTR, YARP_NULLPTR, data, stamp, localArrivalTime);
 }
 
 bool StateExtendedInputPort::getLastVector(int field, double* data, Stamp& stamp, double& localArrivalTime)
 {
-    mutex.wait();
-    bool ret = valid;
-    if (ret)
+    int f = getField(field);
+    if (f < 0 || f >= StateMessage::FirstIntField)
     {
-        switch(field)
-        {
-            case VOCAB_ENCODERS:
-                ret = last.jointPosition_isValid;
-                memcpy(data, last.jointPosition.getFirst(), last.jointPosition.size() * last.jointPosition.getElementSize() );
-            break;
-
-            case VOCAB_ENCODER_SPEEDS:
-                ret = last.jointVelocity_isValid;
-                memcpy(data, last.jointVelocity.getFirst(), last.jointVelocity.size() * last.jointVelocity.getElementSize() );
-            break;
-
-            case VOCAB_ENCODER_ACCELERATIONS:
-                ret = last.jointAcceleration_isValid;
-                memcpy(data, last.jointAcceleration.getFirst(), last.jointAcceleration.size() * last.jointAcceleration.getElementSize() );
-            break;
-
-            case VOCAB_MOTOR_ENCODERS:
-                ret = last.motorPosition_isValid;
-                memcpy(data, last.motorPosition.getFirst(), last.motorPosition.size() * last.motorPosition.getElementSize() );
-            break;
-
-            case VOCAB_MOTOR_ENCODER_SPEEDS:
-                ret = last.motorVelocity_isValid;
-                memcpy(data, last.motorVelocity.getFirst(), last.motorVelocity.size() * last.motorVelocity.getElementSize() );
-            break;
-
-            case VOCAB_MOTOR_ENCODER_ACCELERATIONS:
-                ret = last.motorAcceleration_isValid;
-                memcpy(data, last.motorAcceleration.getFirst(), last.motorAcceleration.size() * last.motorAcceleration.getElementSize() );
-            break;
-
-            case VOCAB_TRQS:
-                ret = last.torque_isValid;
-                memcpy(data, last.torque.getFirst(), last.torque.size() * last.torque.getElementSize() );
-            break;
-
-            case VOCAB_PWMCONTROL_PWM_OUTPUTS:
-                ret = last.pwmDutycycle_isValid;
-                memcpy(data, last.pwmDutycycle.getFirst(), last.pwmDutycycle.size() * last.pwmDutycycle.getElementSize());
-            break;
-
-            case VOCAB_AMP_CURRENTS:
-                ret = last.current_isValid;
-                memcpy(data, last.current.getFirst(), last.current.size() * last.current.getElementSize());
-                break;
-
-            default:
-                yError() << "RemoteControlBoard internal error while reading data. Cannot get 'vector' data of type " << yarp::os::Vocab::decode(field);
-            break;
-        }
-
-        localArrivalTime=now;
-        stamp = lastStamp;
+        yError() << "RemoteControlBoard internal error while reading data. Cannot get 'vector' data of type " << yarp::os::Vocab::decode(field);
+        return false;
     }
-    mutex.post();
-
-    return ret;
+    return getLast(f, 0, -1, YARP_NULLPTR, data, YARP_NULLPTR, stamp, localArrivalTime);
 }
 
 bool StateExtendedInputPort::getLastVector(int field, int* data, Stamp& stamp, double& localArrivalTime)
 {
-    mutex.wait();
-    bool ret = valid;
-    if (ret)
+    int f = getField(field);
+    if (f < StateMessage::FirstIntField)
     {
-        switch(field)
-        {
-            case VOCAB_CM_CONTROL_MODES:
-                ret = last.controlMode_isValid;
-                memcpy(data, last.controlMode.getFirst(), last.controlMode.size() * last.controlMode.getElementSize());
-            break;
+        yError() << "RemoteControlBoard internal error while reading data. Cannot get 'vector' data of type " << yarp::os::Vocab::decode(field);
+        return false;
+    }
+    return getLast(f, 0, -1, YARP_NULLPTR, YARP_NULLPTR, data, stamp, localArrivalTime);
+}
 
-            case VOCAB_INTERACTION_MODES:
-                ret = last.interactionMode_isValid;
-                memcpy(data, last.interactionMode.getFirst(), last.interactionMode.size() * last.interactionMode.getElementSize());
-            break;
+bool StateExtendedInputPort::getLastVector(int field, int n, const int *joints, double* data, Stamp& stamp, double& localArrivalTime)
+{
+    int f = getField(field);
+    if (f < 0 || f >= StateMessage::FirstIntField)
+    {
+        yError() << "RemoteControlBoard internal error while reading data. Cannot get 'vector' data of type " << yarp::os::Vocab::decode(field);
+        return false;
+    }
+    return getLast(f, 0, n, joints, data, YARP_NULLPTR, stamp, localArrivalTime);
+}
 
-            default:
-                yError() << "RemoteControlBoard internal error while reading data. Cannot get 'vector' data of type " << yarp::os::Vocab::decode(field);
-            break;
-        }
-        localArrivalTime=now;
-        stamp = lastStamp;
+bool StateExtendedInputPort::getLastVector(int field, int n, const int *joints, int* data, Stamp& stamp, double& localArrivalTime)
+{
+    int f = getField(field);
+    if (f < StateMessage::FirstIntField)
+    {
+        yError() << "RemoteControlBoard internal error while reading data. Cannot get 'vector' data of type " << yarp::os::Vocab::decode(field);
+        return false;
     }
-    mutex.post();
-    return ret;
+    return getLast(f, 0, n, joints, YARP_NULLPTR, data, stamp, localArrivalTime);
 }
 
 int StateExtendedInputPort::getIterations()
 {
-    mutex.wait();
-    int ret=count;
-    mutex.post();
-    return ret;
+    LockGuard guard(writeMutex);
+    return count;
 }
 
 // time is in ms
 void StateExtendedInputPort::getEstFrequency(int &ite, double &av, double &min, double &max)
 {
-    mutex.wait();
+    LockGuard guard(writeMutex);
     ite=count;
     min=deltaTMin*1000;
     max=deltaTMax*1000;
@@ -304,5 +348,4 @@ void StateExtendedInputPort::getEstFrequency(int &ite, double &av, double &min,
         av=deltaT/count;
     }
     av=av*1000;
-    mutex.post();
 }
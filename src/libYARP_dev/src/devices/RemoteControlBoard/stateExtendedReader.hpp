@@ -8,7 +8,9 @@
 #define YARP_DEV_REMOTECONTROLBOARD_STATEEXTENDEDREADER_H
 
 
+#include <atomic>
 #include <cstring>
+#include <vector>
 
 #include <yarp/os/PortablePair.h>
 #include <yarp/os/BufferedPort.h>
@@ -18,6 +20,7 @@
 #include <yarp/os/Vocab.h>
 #include <yarp/os/Stamp.h>
 #include <yarp/os/Semaphore.h>
+#include <yarp/os/Mutex.h>
 #include <yarp/os/Log.h>
 
 #include <yarp/sig/Vector.h>
@@ -29,6 +32,7 @@
 #include <yarp/dev/PreciselyTimed.h>
 
 #include "jointData.h"
+#include "StateMessage.h"
 
 
 // encoders should arrive at least every 0.5s to be considered valide
@@ -39,29 +43,53 @@ using namespace yarp::os;
 using namespace yarp::dev;
 using namespace yarp::sig;
 
+/*
+ * Reads the state of the joints streamed on the stateExt:o port and keeps
+ * the last one received, also for the messages of the stateCompact:o port
+ * handed over by a StateCompactInputPort.
+ *
+ * The last state is guarded by a sequence lock: the thread receiving the
+ * messages makes the sequence odd while it updates the state, and the
+ * getLast* methods, called at high rate by the users of the remote control
+ * board, copy what they need without locking and try again if the
+ * sequence changed meanwhile.
+ */
 class StateExtendedInputPort:public yarp::os::BufferedPort<jointData>
 {
-    jointData last;
-    Semaphore mutex;
+    // the last state, written only with the sequence odd
+    std::vector<double> doubles;
+    std::vector<int> ints;
+    int joints;
+    int validFields;
     Stamp lastStamp;
+    double now;
+    bool valid;
+    std::atomic<unsigned int> sequence;
+
+    Mutex writeMutex;       // writers and statistics
+    yarp::dev::impl::StateMessage converted;    // jointData messages, as a StateMessage
+
     double deltaT;
     double deltaTMax;
     double deltaTMin;
     double prev;
-    double now;
-
-    bool valid;
     int count;
+
+    static int getField(int vocab);
+    bool getLast(int field, int first, int n, const int *joints, double *data, int *idata, Stamp &stamp, double &localArrivalTime);
+
 public:
 
     StateExtendedInputPort();
 
     void resetStat();
-    void init(int numberOfJoints);
 
     using yarp::os::BufferedPort<jointData>::onRead;
     virtual void onRead(jointData &v) override;
 
+    // store the fields carried by a message of the stateCompact:o port
+    void update(const yarp::dev::impl::StateMessage& msg, const Stamp& stamp);
+
     // use vocab to identify the data to be read
     // get a value for a single joint
     bool getLastSingle(int j, int field, double *data, Stamp &stamp, double &localArrivalTime);
@@ -70,10 +98,33 @@ public:
     // get a value for all joints
     bool getLastVector(int field, double *data, Stamp &stamp, double &localArrivalTime);
     bool getLastVector(int field, int    *data, Stamp &stamp, double &localArrivalTime);
+
+    // get a value for a group of joints
+    bool getLastVector(int field, int n, const int *joints, double *data, Stamp &stamp, double &localArrivalTime);
+    bool getLastVector(int field, int n, const int *joints, int    *data, Stamp &stamp, double &localArrivalTime);
     int  getIterations();
 
     // time is in ms
     void getEstFrequency(int &ite, double &av, double &min, double &max);
 };
 
+
+/*
+ * Receives the messages of the stateCompact:o port and stores them in a
+ * StateExtendedInputPort, so that the state is read in the same way
+ * whichever port it comes from.
+ */
+class StateCompactInputPort:public yarp::os::BufferedPort<yarp::dev::impl::StateMessage>
+{
+    StateExtendedInputPort *owner;
+
+public:
+    StateCompactInputPort() : owner(YARP_NULLPTR) {}
+
+    void setOwner(StateExtendedInputPort *o) { owner = o; }
+
+    using yarp::os::BufferedPort<yarp::dev::impl::StateMessage>::onRead;
+    virtual void onRead(yarp::dev::impl::StateMessage &v) override;
+};
+
 #endif // YARP_DEV_REMOTECONTROLBOARD_STATEEXTENDEDREADER_H
@@ -258,7 +258,8 @@ void LoggerEngine::logger_thread::run()
                 return;
             }
 
-            if (b->size()!=2)
+            // the header, then one or more messages
+            if (b->size()<2)
             {
                 fprintf (stderr, "ERROR: unknown log format!\n");
                 unknown_format_received++;
@@ -279,117 +280,124 @@ void LoggerEngine::logger_thread::run()
                 continue;
             }
 
-            MessageEntry body;
-            std::string s;
-
-            if (b->get(1).isString())
-            {
-                s = b->get(1).asString();
-            }
-            else
+            for (int i=1; i<b->size(); i++)
             {
-                fprintf(stderr, "ERROR: unknown log format!\n");
-                unknown_format_received++;
-                continue;
-            }
+                MessageEntry body;
+                std::string s;
 
-            body.text = s;
-            char ttstr [20];
-            static int count=0;
-            sprintf(ttstr,"%d",count++);
-            body.yarprun_timestamp = string(ttstr);
-            body.local_timestamp   = machine_current_time_s;
-            body.level = LOGLEVEL_UNDEFINED;
-
-            size_t str = s.find('[',0);
-            size_t end = s.find(']',0);
-            if (str==std::string::npos || end==std::string::npos )
-            {
-                body.level = LOGLEVEL_UNDEFINED;
-            }
-            else if (str==0)
-            {
-                std::string level = s.substr(str,end+1);
-                body.level = LOGLEVEL_UNDEFINED;
-                if      (level.find("TRACE")!=std::string::npos)   body.level = LOGLEVEL_TRACE;
-                else if (level.find("DEBUG")!=std::string::npos)   body.level = LOGLEVEL_DEBUG;
-                else if (level.find("INFO")!=std::string::npos)    body.level = LOGLEVEL_INFO;
-                else if (level.find("WARNING")!=std::string::npos) body.level = LOGLEVEL_WARNING;
-                else if (level.find("ERROR")!=std::string::npos)   body.level = LOGLEVEL_ERROR;
-                else if (level.find("FATAL")!=std::string::npos)   body.level = LOGLEVEL_FATAL;
-                body.text = s.substr(end+1);
-            }
-            else
-            {
+                if (b->get(i).isString())
+                {
+                    s = b->get(i).asString();
+                }
+                else
+                {
+                    fprintf(stderr, "ERROR: unknown log format!\n");
+                    unknown_format_received++;
+                    continue;
+                }
+
+                body.text = s;
+                char ttstr [20];
+                static int count=0;
+                sprintf(ttstr,"%d",count++);
+                body.yarprun_timestamp = string(ttstr);
+                body.local_timestamp   = machine_current_time_s;
                 body.level = LOGLEVEL_UNDEFINED;
-            }
 
-            if (body.level == LOGLEVEL_UNDEFINED && listen_to_LOGLEVEL_UNDEFINED == false) {continue;}
-            if (body.level == LOGLEVEL_TRACE     && listen_to_LOGLEVEL_TRACE     == false) {continue;}
-            if (body.level == LOGLEVEL_DEBUG     && listen_to_LOGLEVEL_DEBUG     == false) {continue;}
-            if (body.level == LOGLEVEL_INFO      && listen_to_LOGLEVEL_INFO      == false) {continue;}
-            if (body.level == LOGLEVEL_WARNING   && listen_to_LOGLEVEL_WARNING   == false) {continue;}
-            if (body.level == LOGLEVEL_ERROR     && listen_to_LOGLEVEL_ERROR     == false) {continue;}
-            if (body.level == LOGLEVEL_FATAL     && listen_to_LOGLEVEL_FATAL     == false) {continue;}
-
-            this->mutex.wait();
-            LogEntry entry;
-            entry.logInfo.port_complete = header;
-            entry.logInfo.port_complete.erase(0,1);
-            entry.logInfo.port_complete.erase(entry.logInfo.port_complete.size()-1);
-            std::istringstream iss(header);
-            std::string token;
-            getline(iss, token, '/');
-            getline(iss, token, '/'); entry.logInfo.port_system  = token;
-            getline(iss, token, '/'); entry.logInfo.port_prefix  = "/"+ token;
-            getline(iss, token, '/'); entry.logInfo.process_name = token;
-            getline(iss, token, '/'); entry.logInfo.process_pid  = token.erase(token.size()-1);
-            if (entry.logInfo.port_system == "log" && listen_to_YARP_MESSAGES==false)    continue;
-            if (entry.logInfo.port_system == "yarprunlog" && listen_to_YARPRUN_MESSAGES==false) continue;
-
-            std::list<LogEntry>::iterator it;
-            for (it = log_list.begin(); it != log_list.end(); it++)
-            {
-                if (it->logInfo.port_complete==entry.logInfo.port_complete)
+                size_t str = s.find('[',0);
+                size_t end = s.find(']',0);
+                if (str==std::string::npos || end==std::string::npos )
                 {
-                    if (it->logging_enabled)
-                    {
-                        it->logInfo.setNewError(body.level);
-                        it->logInfo.last_update=machine_current_time;
-                        it->append_logEntry(body);
-                    }
-                    else
+                    body.level = LOGLEVEL_UNDEFINED;
+                }
+                else if (str==0)
+                {
+                    std::string level = s.substr(str,end+1);
+                    body.level = LOGLEVEL_UNDEFINED;
+                    if      (level.find("TRACE")!=std::string::npos)   body.level = LOGLEVEL_TRACE;
+                    else if (level.find("DEBUG")!=std::string::npos)   body.level = LOGLEVEL_DEBUG;
+                    else if (level.find("INFO")!=std::string::npos)    body.level = LOGLEVEL_INFO;
+                    else if (level.find("WARNING")!=std::string::npos) body.level = LOGLEVEL_WARNING;
+                    else if (level.find("ERROR")!=std::string::npos)   body.level = LOGLEVEL_ERROR;
+                    else if (level.find("FATAL")!=std::string::npos)   body.level = LOGLEVEL_FATAL;
+                    body.text = s.substr(end+1);
+                }
+                else
+                {
+                    body.level = LOGLEVEL_UNDEFINED;
+                }
+
+                if (body.level == LOGLEVEL_UNDEFINED && listen_to_LOGLEVEL_UNDEFINED == false) {continue;}
+                if (body.level == LOGLEVEL_TRACE     && listen_to_LOGLEVEL_TRACE     == false) {continue;}
+                if (body.level == LOGLEVEL_DEBUG     && listen_to_LOGLEVEL_DEBUG     == false) {continue;}
+                if (body.level == LOGLEVEL_INFO      && listen_to_LOGLEVEL_INFO      == false) {continue;}
+                if (body.level == LOGLEVEL_WARNING   && listen_to_LOGLEVEL_WARNING   == false) {continue;}
+                if (body.level == LOGLEVEL_ERROR     && listen_to_LOGLEVEL_ERROR     == false) {continue;}
+                if (body.level == LOGLEVEL_FATAL     && listen_to_LOGLEVEL_FATAL     == false) {continue;}
+
+                this->mutex.wait();
+                LogEntry entry;
+                entry.logInfo.port_complete = header;
+                entry.logInfo.port_complete.erase(0,1);
+                entry.logInfo.port_complete.erase(entry.logInfo.port_complete.size()-1);
+                std::istringstream iss(header);
+                std::string token;
+                getline(iss, token, '/');
+                getline(iss, token, '/'); entry.logInfo.port_system  = token;
+                getline(iss, token, '/'); entry.logInfo.port_prefix  = "/"+ token;
+                getline(iss, token, '/'); entry.logInfo.process_name = token;
+                getline(iss, token, '/'); entry.logInfo.process_pid  = token.erase(token.size()-1);
+                if ((entry.logInfo.port_system == "log" && listen_to_YARP_MESSAGES==false) ||
+                    (entry.logInfo.port_system == "yarprunlog" && listen_to_YARPRUN_MESSAGES==false))
+                {
+                    this->mutex.post();
+                    continue;
+                }
+
+                std::list<LogEntry>::iterator it;
+                for (it = log_list.begin(); it != log_list.end(); it++)
+                {
+                    if (it->logInfo.port_complete==entry.logInfo.port_complete)
                     {
-                        //just skipping this message
+                        if (it->logging_enabled)
+                        {
+                            it->logInfo.setNewError(body.level);
+                            it->logInfo.last_update=machine_current_time;
+                            it->append_logEntry(body);
+                        }
+                        else
+                        {
+                            //just skipping this message
+                        }
+                        break;
                     }
-                    break;
                 }
-            }
-            if (it == log_list.end())
-            {
-                if (log_list.size() < log_list_max_size || log_list_max_size_enabled==false )
+                if (it == log_list.end())
                 {
-                    yarp::os::Contact contact = yarp::os::Network::queryName(entry.logInfo.port_complete);
-                    if (contact.isValid())
+                    if (log_list.size() < log_list_max_size || log_list_max_size_enabled==false )
                     {
-                        entry.logInfo.setNewError(body.level);
-                        entry.logInfo.ip_address = contact.getHost();
+                        yarp::os::Contact contact = yarp::os::Network::queryName(entry.logInfo.port_complete);
+                        if (contact.isValid())
+                        {
+                            entry.logInfo.setNewError(body.level);
+                            entry.logInfo.ip_address = contact.getHost();
+                        }
+                        else
+                        {
+                            printf("ERROR: invalid contact: %s\n", entry.logInfo.port_complete.c_str());
+                        };
+                        entry.append_logEntry(body);
+                        entry.logInfo.last_update=machine_current_time;
+                        log_list.push_back(entry);
                     }
-                    else
-                    {
-                        printf("ERROR: invalid contact: %s\n", entry.logInfo.port_complete.c_str());
-                    };
-                    entry.append_logEntry(body);
-                    entry.logInfo.last_update=machine_current_time;
-                    log_list.push_back(entry);
+                    //else
+                    //{
+                    //    printf("WARNING: exceeded log_list_max_size=%d\n",log_list_max_size);
+                    //}
                 }
-                //else
-                //{
-                //    printf("WARNING: exceeded log_list_max_size=%d\n",log_list_max_size);
-                //}
-            }
 
-            this->mutex.post();
+                this->mutex.post();
+            }
         }
     }
 
@@ -114,6 +114,8 @@ public:
 
     bool cmdQuery(NameTripleState& act, bool nested = false);
 
+    bool cmdQueryMany(NameTripleState& act);
+
     bool cmdRegister(NameTripleState& act);
 
     bool cmdUnregister(NameTripleState& act);
@@ -371,6 +371,25 @@ bool NameServiceOnTriples::cmdUnregister(NameTripleState& act) {
 }
 
 
+bool NameServiceOnTriples::cmdQueryMany(NameTripleState& act) {
+    if (act.bottleMode) {
+        act.reply.addString("ports");
+    }
+    Bottle names = act.cmd.tail();
+    lock();
+    act.nestedMode = true;
+    for (int i=0; i<names.size(); i++) {
+        act.cmd.clear();
+        act.cmd.addString("query");
+        act.cmd.add(names.get(i));
+        act.mem.reset();
+        cmdQuery(act,true);
+    }
+    unlock();
+    return true;
+}
+
+
 bool NameServiceOnTriples::cmdList(NameTripleState& act) {
     if (!act.bottleMode) {
         act.reply.addString("old");
@@ -565,7 +584,7 @@ bool NameServiceOnTriples::cmdHelp(NameTripleState& act) {
     bot.addString("+ register $portname $carrier $ipAddress $portNumber");
     bot.addString("  (if you want a field set automatically, write '...')");
     bot.addString("+ unregister $portname");
-    bot.addString("+ query $portname");
+    bot.addString("+ query $portname [$portname ...]");
     bot.addString("+ set $portname $property $value");
     bot.addString("+ get $portname $property");
     bot.addString("+ check $portname $property");
@@ -625,6 +644,9 @@ bool NameServiceOnTriples::apply(yarp::os::Bottle& cmd,
     } else if (key=="unregister") {
         return cmdUnregister(act);
     } else if (key=="query") {
+        if (cmd.size()>2 && !cmd.check("format")) {
+            return cmdQueryMany(act);
+        }
         return cmdQuery(act);
     } else if (key=="list") {
         return cmdList(act);
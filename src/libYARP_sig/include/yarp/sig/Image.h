@@ -49,6 +49,16 @@ class YARP_sig_API yarp::sig::Image : public yarp::os::Portable {
 
 public:
 
+    /**
+     * Filters available to the scaled copy.
+     */
+    enum ResampleMode
+    {
+        RESAMPLE_NEAREST,   ///< copy the closest pixel, fast but aliased
+        RESAMPLE_BILINEAR,  ///< interpolate the four closest pixels
+        RESAMPLE_AREA       ///< average the pixels covered, best to shrink images
+    };
+
     /**
      * Default constructor.
      * Creates an empty image.
@@ -86,7 +96,7 @@ public:
     /**
      * Scaled copy.
      * Clones the content of another image, and resizes in a fast but
-     * low-quality way.
+     * low-quality way (RESAMPLE_NEAREST).
      * @param alt the image to copy
      * @param w target width for image
      * @param h target height for image
@@ -94,6 +104,20 @@ public:
     bool copy(const Image& alt, int w, int h);
 
 
+    /**
+     * Scaled copy, with a choice of filter.
+     * Clones the content of another image, and resizes it.  Images with
+     * 8 bit, 16 bit, integer and floating point channels are filtered
+     * channel by channel; other pixel types (Bayer, YUV) are always copied
+     * with RESAMPLE_NEAREST.
+     * @param alt the image to copy
+     * @param w target width for image
+     * @param h target height for image
+     * @param mode the filter used
+     */
+    bool copy(const Image& alt, int w, int h, ResampleMode mode);
+
+
     /**
      * Gets width of image in pixels.
      * @return the width of the image in pixels (0 if no image present)
@@ -331,6 +355,8 @@ private:
                     unsigned char *dest, int id2, int w, int h,
                     int imageSize, int quantum1, int quantum2,
                     bool topIsLow1, bool topIsLow2);
+
+    void resamplePixels(const Image& alt, ResampleMode mode);
 };
 
 
@@ -39,7 +39,7 @@ inline bool isBayer16(int v)
 }
 
 /*
- * Nearest neighbor debayer implementation (warning: skip borders)
+ * Bilinear debayer, see yarp::sig::impl::Demosaic
  */
 bool deBayer_GRBG8_TO_RGB(yarp::sig::Image &source, yarp::sig::Image &dest, int pixelSize);
 
@@ -48,12 +48,12 @@ bool deBayer_BGGR8_TO_RGB(yarp::sig::Image &source, yarp::sig::Image &dest, int
 bool deBayer_RGGB8_TO_RGB(yarp::sig::Image &source, yarp::sig::Image &dest, int pixelSize);
 
 /*
- * Nearest neighbor debayer implementation (warning: skip borders)
+ * Bilinear debayer, see yarp::sig::impl::Demosaic
  */
 bool deBayer_GRBG8_TO_BGR(yarp::sig::Image &source, yarp::sig::Image &dest, int pixelSize);
 
 bool deBayer_BGGR8_TO_BGR(yarp::sig::Image &source, yarp::sig::Image &dest, int pixelSize);
 
-inline bool deBayer_RGGB8_TO_BGR(yarp::sig::Image &source, yarp::sig::Image &dest, int pixelSize);
+bool deBayer_RGGB8_TO_BGR(yarp::sig::Image &source, yarp::sig::Image &dest, int pixelSize);
 
 #endif // YARP_SIG_IMPL_DEBAYER_H
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_SIG_IMPL_DEMOSAIC_H
+#define YARP_SIG_IMPL_DEMOSAIC_H
+
+#include <yarp/sig/api.h>
+#include <yarp/sig/Image.h>
+
+namespace yarp {
+    namespace sig {
+        namespace impl {
+            class Demosaic;
+        }
+    }
+}
+
+/**
+ * Conversion of raw Bayer images, with 8 or 16 bit samples, to RGB, BGR,
+ * RGBA or BGRA images.
+ *
+ * Rows are written directly into the destination image.  The borders are
+ * interpolated as if the image was mirrored around its first and last
+ * rows and columns.  On x86 processors with SSSE3 the 8 bit methods, and
+ * the bilinear method for 16 bit samples, are vectorized; large images
+ * are split in bands of rows converted by different threads.
+ */
+class YARP_sig_API yarp::sig::impl::Demosaic
+{
+public:
+    enum Method
+    {
+        DEMOSAIC_BILINEAR,  ///< average of the closest samples of each colour
+        DEMOSAIC_MALVAR,    ///< bilinear corrected by the gradient of the other colours (Malvar, He, Cutler)
+        DEMOSAIC_HALF       ///< one pixel from each 2x2 cell, half the size of the source
+    };
+
+    /**
+     * Demosaic a Bayer image.
+     *
+     * @param src the raw image, one 8 bit (MONO) or 16 bit (MONO16)
+     * sample per pixel
+     * @param bayerCode the pattern of the samples, one of the
+     * VOCAB_PIXEL_ENCODING_BAYER codes
+     * @param dest an RGB, BGR, RGBA or BGRA image, resized to the size of
+     * the source (half of it for DEMOSAIC_HALF)
+     * @param method the interpolation used
+     * @param depth the significant bits of 16 bit samples, scaled down to
+     * the 8 bits of the destination
+     * @return false if the formats of the images are not supported,
+     * as 16 bit samples are on big endian hosts
+     */
+    static bool convert(const yarp::sig::Image& src, int bayerCode,
+                        yarp::sig::Image& dest,
+                        Method method = DEMOSAIC_BILINEAR,
+                        int depth = 16);
+
+    /**
+     * @return true for the codes of 8 and 16 bit Bayer images
+     */
+    static bool isBayer(int code);
+
+    /**
+     * Choose how many threads convert a large image, 0 (the default) for
+     * one per core, up to 4.
+     */
+    static void setThreads(int threads);
+};
+
+#endif // YARP_SIG_IMPL_DEMOSAIC_H
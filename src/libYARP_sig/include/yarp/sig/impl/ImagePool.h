@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_SIG_IMPL_IMAGEPOOL_H
+#define YARP_SIG_IMPL_IMAGEPOOL_H
+
+#include <yarp/sig/api.h>
+
+#include <cstddef>
+
+namespace yarp {
+    namespace sig {
+        namespace impl {
+            class ImagePool;
+        }
+    }
+}
+
+/**
+ * Process-wide pool of the memory used by images: pixels, IplImage
+ * headers and row tables.
+ *
+ * Blocks are aligned to ImagePool::ALIGNMENT bytes and rounded up to a
+ * size class, with four classes for each power of two.  Released blocks
+ * are kept for the next request of the same class, so images destroyed
+ * and recreated, or resized back and forth, at each frame (as the
+ * temporary images of Image::copy() and Image::read(), or the ones
+ * dropped by a BufferedPort) stop going through malloc and page faults.
+ * The memory kept is limited by setCacheLimit().
+ */
+class YARP_sig_API yarp::sig::impl::ImagePool
+{
+public:
+    static const size_t ALIGNMENT = 64;
+
+    struct Statistics
+    {
+        size_t allocations;     ///< blocks obtained from the system
+        size_t reuses;          ///< requests served with a released block
+        size_t releases;        ///< blocks given back to the pool
+        size_t frees;           ///< blocks given back to the system
+        size_t usedBytes;       ///< bytes of the blocks in use
+        size_t peakUsedBytes;   ///< highest usedBytes since the last reset
+        size_t cachedBytes;     ///< bytes of the blocks kept for reuse
+        size_t cachedBlocks;    ///< number of blocks kept for reuse
+    };
+
+    /**
+     * @return a block of at least size bytes, aligned to ALIGNMENT
+     */
+    static void *allocate(size_t size);
+
+    /**
+     * Give back a block obtained with allocate(), NULL is ignored.
+     */
+    static void release(void *ptr);
+
+    /**
+     * @return the usable size of a block obtained with allocate()
+     */
+    static size_t getCapacity(const void *ptr);
+
+    /**
+     * Enable or disable the reuse of released blocks (enabled by
+     * default).  Disabling it frees the blocks kept.
+     */
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled();
+
+    /**
+     * Set the most bytes kept for reuse, 256MB by default.  Blocks
+     * released beyond it are given back to the system.
+     */
+    static void setCacheLimit(size_t bytes);
+
+    static size_t getCacheLimit();
+
+    /**
+     * Give back to the system all the blocks kept for reuse.
+     */
+    static void trim();
+
+    static Statistics getStatistics();
+
+    /**
+     * Clear the counters, keeping the bytes in use and cached.
+     */
+    static void resetStatistics();
+};
+
+#endif // YARP_SIG_IMPL_IMAGEPOOL_H
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_SIG_IMPL_PARALLELBANDS_H
+#define YARP_SIG_IMPL_PARALLELBANDS_H
+
+#include <yarp/sig/api.h>
+
+#include <functional>
+
+namespace yarp {
+    namespace sig {
+        namespace impl {
+            class ParallelBands;
+        }
+    }
+}
+
+/**
+ * Splits the processing of a large image in bands run at the same time,
+ * as the conversions of PixelConversion and Demosaic or the compression
+ * of the mjpeg carrier do.
+ *
+ * The bands are run by a pool of threads shared by the whole process,
+ * started on first use and kept until exit, and by the calling thread,
+ * which takes its share of the bands instead of just waiting for them.
+ */
+class YARP_sig_API yarp::sig::impl::ParallelBands
+{
+public:
+    /**
+     * Images smaller than this, in bytes, are processed in a single band.
+     */
+    static const long PARALLEL_BYTES = 1 << 20;
+
+    /**
+     * Most bands used when the number of threads is left to the default.
+     */
+    static const int MAX_THREADS = 4;
+
+    /**
+     * @param bytes the size of the image
+     * @param threads the number of threads requested, 0 for one per core
+     * up to MAX_THREADS
+     * @param maxBands the most bands the image can be split in, e.g. its
+     * rows
+     * @return how many bands to process the image in, at least 1
+     */
+    static int getBandCount(long bytes, int threads, int maxBands);
+
+    /**
+     * Call band(0) ... band(count-1) on the threads of the pool and on
+     * the calling thread, and return when all of them returned.
+     */
+    static void run(int count, const std::function<void(int)>& band);
+};
+
+#endif // YARP_SIG_IMPL_PARALLELBANDS_H
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#ifndef YARP_SIG_IMPL_PIXELCONVERSION_H
+#define YARP_SIG_IMPL_PIXELCONVERSION_H
+
+#include <yarp/sig/api.h>
+
+namespace yarp {
+    namespace sig {
+        namespace impl {
+            class PixelConversion;
+        }
+    }
+}
+
+/**
+ * Vectorized conversions between the most common pixel formats, used by
+ * Image::copy() in place of its per pixel loop.
+ *
+ * The instructions used are chosen at runtime among the ones supported by
+ * the processor: SSSE3 and AVX2 on x86, NEON on ARM builds with NEON
+ * enabled.  Large images are split in bands of rows converted by
+ * different threads.  The results are the same as the ones of the per
+ * pixel loop.
+ */
+class YARP_sig_API yarp::sig::impl::PixelConversion
+{
+public:
+    enum InstructionSet
+    {
+        SIMD_NONE,
+        SIMD_SSSE3,
+        SIMD_AVX2,
+        SIMD_NEON
+    };
+
+    /**
+     * Convert an image, with rows padded as in Image.
+     *
+     * @param src the pixels of the source image
+     * @param srcCode the pixel code of the source image
+     * @param srcQuantum the row alignment of the source image, in bytes
+     * @param dest the pixels of the destination image
+     * @param destCode the pixel code of the destination image
+     * @param destQuantum the row alignment of the destination image, in bytes
+     * @param w the width of the images
+     * @param h the height of the images
+     * @param flip true to copy the rows in reverse order
+     * @return false, without converting anything, if there is no
+     * vectorized conversion between the two formats
+     */
+    static bool convert(const unsigned char *src, int srcCode, int srcQuantum,
+                        unsigned char *dest, int destCode, int destQuantum,
+                        int w, int h, bool flip);
+
+    /**
+     * @return true if the conversion between two pixel codes is vectorized
+     * with the instructions in use
+     */
+    static bool isVectorized(int srcCode, int destCode);
+
+    /**
+     * @return the best instructions supported by the processor
+     */
+    static InstructionSet getSupportedInstructionSet();
+
+    /**
+     * Limit the instructions used, SIMD_NONE to leave all the conversions
+     * to the per pixel loop.  Only meant for benchmarking and testing.
+     */
+    static void setInstructionSet(InstructionSet set);
+
+    /**
+     * @return the instructions in use
+     */
+    static InstructionSet getInstructionSet();
+
+    static const char *getInstructionSetName(InstructionSet set);
+
+    /**
+     * Choose how many threads convert a large image, 0 (the default) for
+     * one per core, up to 4.
+     */
+    static void setThreads(int threads);
+};
+
+#endif // YARP_SIG_IMPL_PIXELCONVERSION_H
@@ -0,0 +1,505 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/conf/numeric.h>
+#include <yarp/sig/impl/Demosaic.h>
+#include <yarp/sig/impl/ParallelBands.h>
+#include <yarp/sig/impl/PixelConversion.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  define DEMOSAIC_X86
+#  define TARGET_SSSE3 __attribute__((target("ssse3")))
+#  include <tmmintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  define DEMOSAIC_X86
+#  define TARGET_SSSE3
+#  include <tmmintrin.h>
+#endif
+
+using namespace yarp::sig;
+using namespace yarp::sig::impl;
+
+static std::atomic<int> threadCount(0);
+
+
+/*
+ * Each output row is computed from the source rows around it, y-2 to y+2.
+ * On each row the green samples are on the columns of one parity, and
+ * the samples of the other colour of the row (red or blue) on the other
+ * ones.  For every pixel three values are interpolated: the colour of
+ * the row, green, and the colour of the rows above and below.
+ */
+
+namespace {
+
+struct RowContext
+{
+    int w;
+    int gCol;       // parity of the columns of the green samples
+    bool red;       // the other samples of the row are red
+    int shift;      // from the samples to 8 bits
+    int maxValue;   // of the samples
+    int channels;   // of the destination
+    bool bgr;       // the destination stores blue first
+    bool simd;
+};
+
+}
+
+
+static inline int reflect(int i, int n)
+{
+    if (i<0) {
+        i = -i;
+    }
+    if (i>=n) {
+        i = 2*n-2-i;
+    }
+    return std::max(0, std::min(i, n-1));
+}
+
+static inline int avg2(int a, int b)
+{
+    return (a+b+1)>>1;
+}
+
+static inline void storePixel(unsigned char *d, int rowColor, int g, int other, const RowContext& ctx)
+{
+    int v[3] = { rowColor>>ctx.shift, g>>ctx.shift, other>>ctx.shift };
+    for (int i=0; i<3; i++) {
+        v[i] = std::min(std::max(v[i], 0), 255);
+    }
+    int r = ctx.red ? v[0] : v[2];
+    int b = ctx.red ? v[2] : v[0];
+    d[0] = (unsigned char)(ctx.bgr ? b : r);
+    d[1] = (unsigned char)v[1];
+    d[2] = (unsigned char)(ctx.bgr ? r : b);
+    if (ctx.channels==4) {
+        d[3] = 255;
+    }
+}
+
+
+template <class T>
+static void bilinearScalar(const T * const *rows, unsigned char *dest, const RowContext& ctx, int x0, int x1)
+{
+    const T *n = rows[1];
+    const T *c = rows[2];
+    const T *s = rows[3];
+    for (int x=x0; x<x1; x++) {
+        int l = reflect(x-1, ctx.w);
+        int r = reflect(x+1, ctx.w);
+        int rowColor, g, other;
+        if ((x&1)==ctx.gCol) {
+            g = c[x];
+            rowColor = avg2(c[l], c[r]);
+            other = avg2(n[x], s[x]);
+        } else {
+            rowColor = c[x];
+            g = avg2(avg2(n[x], s[x]), avg2(c[l], c[r]));
+            other = avg2(avg2(n[l], n[r]), avg2(s[l], s[r]));
+        }
+        storePixel(dest+x*ctx.channels, rowColor, g, other, ctx);
+    }
+}
+
+
+template <class T>
+static void malvarScalar(const T * const *rows, unsigned char *dest, const RowContext& ctx, int x0, int x1)
+{
+    // the filters of the paper, times 16
+    const T *nn = rows[0];
+    const T *n = rows[1];
+    const T *c = rows[2];
+    const T *s = rows[3];
+    const T *ss = rows[4];
+    for (int x=x0; x<x1; x++) {
+        int l = reflect(x-1, ctx.w);
+        int r = reflect(x+1, ctx.w);
+        int ll = reflect(x-2, ctx.w);
+        int rr = reflect(x+2, ctx.w);
+        int center = c[x];
+        int diagonal = n[l]+n[r]+s[l]+s[r];
+        int rowColor, g, other;
+        if ((x&1)==ctx.gCol) {
+            g = center;
+            rowColor = (10*center + 8*(c[l]+c[r]) - 2*(c[ll]+c[rr]) - 2*diagonal + (nn[x]+ss[x]) + 8)>>4;
+            other = (10*center + 8*(n[x]+s[x]) - 2*(nn[x]+ss[x]) - 2*diagonal + (c[ll]+c[rr]) + 8)>>4;
+        } else {
+            int far = nn[x]+ss[x]+c[ll]+c[rr];
+            rowColor = center;
+            g = (8*center + 4*(n[x]+s[x]+c[l]+c[r]) - 2*far + 8)>>4;
+            other = (12*center + 4*diagonal - 3*far + 8)>>4;
+        }
+        rowColor = std::min(std::max(rowColor, 0), ctx.maxValue);
+        g = std::min(std::max(g, 0), ctx.maxValue);
+        other = std::min(std::max(other, 0), ctx.maxValue);
+        storePixel(dest+x*ctx.channels, rowColor, g, other, ctx);
+    }
+}
+
+
+#ifdef DEMOSAIC_X86
+
+/*
+ * 16 pixels at a time, from x=2 to the last block ending 2 pixels before
+ * the end of the row; x is even, so the lanes of the green samples are
+ * the even or the odd ones.
+ */
+
+TARGET_SSSE3 static inline __m128i blend(__m128i mask, __m128i a, __m128i b)
+{
+    // a where the mask is set, b elsewhere
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+TARGET_SSSE3 static inline __m128i load(const unsigned char *p)
+{
+    return _mm_loadu_si128((const __m128i*)p);
+}
+
+TARGET_SSSE3 static void storePixels(unsigned char *d, __m128i rowColor, __m128i g, __m128i other, const RowContext& ctx)
+{
+    __m128i r = ctx.red ? rowColor : other;
+    __m128i b = ctx.red ? other : rowColor;
+    __m128i first = ctx.bgr ? b : r;
+    __m128i third = ctx.bgr ? r : b;
+    if (ctx.channels==4) {
+        const __m128i alpha = _mm_set1_epi8((char)0xFF);
+        __m128i lo = _mm_unpacklo_epi8(first, g);
+        __m128i hi = _mm_unpackhi_epi8(first, g);
+        __m128i lo2 = _mm_unpacklo_epi8(third, alpha);
+        __m128i hi2 = _mm_unpackhi_epi8(third, alpha);
+        _mm_storeu_si128((__m128i*)d, _mm_unpacklo_epi16(lo, lo2));
+        _mm_storeu_si128((__m128i*)(d+16), _mm_unpackhi_epi16(lo, lo2));
+        _mm_storeu_si128((__m128i*)(d+32), _mm_unpacklo_epi16(hi, hi2));
+        _mm_storeu_si128((__m128i*)(d+48), _mm_unpackhi_epi16(hi, hi2));
+        return;
+    }
+    // byte k of each 16 byte block of output from the channel of k
+    const __m128i m00 = _mm_setr_epi8(0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1,-1, 5);
+    const __m128i m01 = _mm_setr_epi8(-1,0,-1, -1,1,-1, -1,2,-1, -1,3,-1, -1,4,-1, -1);
+    const __m128i m02 = _mm_setr_epi8(-1,-1,0, -1,-1,1, -1,-1,2, -1,-1,3, -1,-1,4, -1);
+    const __m128i m10 = _mm_setr_epi8(-1,-1,6, -1,-1,7, -1,-1,8, -1,-1,9, -1,-1,10, -1);
+    const __m128i m11 = _mm_setr_epi8(5,-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1, 10);
+    const __m128i m12 = _mm_setr_epi8(-1,5,-1, -1,6,-1, -1,7,-1, -1,8,-1, -1,9,-1, -1);
+    const __m128i m20 = _mm_setr_epi8(-1,11,-1, -1,12,-1, -1,13,-1, -1,14,-1, -1,15,-1, -1);
+    const __m128i m21 = _mm_setr_epi8(-1,-1,11, -1,-1,12, -1,-1,13, -1,-1,14, -1,-1,15, -1);
+    const __m128i m22 = _mm_setr_epi8(10,-1,-1, 11,-1,-1, 12,-1,-1, 13,-1,-1, 14,-1,-1, 15);
+    _mm_storeu_si128((__m128i*)d, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(first, m00), _mm_shuffle_epi8(g, m01)), _mm_shuffle_epi8(third, m02)));
+    _mm_storeu_si128((__m128i*)(d+16), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(first, m10), _mm_shuffle_epi8(g, m11)), _mm_shuffle_epi8(third, m12)));
+    _mm_storeu_si128((__m128i*)(d+32), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(first, m20), _mm_shuffle_epi8(g, m21)), _mm_shuffle_epi8(third, m22)));
+}
+
+TARGET_SSSE3 static int bilinearSSSE3(const unsigned char * const *rows, unsigned char *dest, const RowContext& ctx)
+{
+    const unsigned char *n = rows[1];
+    const unsigned char *c = rows[2];
+    const unsigned char *s = rows[3];
+    const __m128i gMask = _mm_set1_epi16(ctx.gCol==0 ? 0x00FF : (short)0xFF00);
+    int x = 2;
+    for (; x+18<=ctx.w; x+=16) {
+        __m128i center = load(c+x);
+        __m128i h = _mm_avg_epu8(load(c+x-1), load(c+x+1));
+        __m128i v = _mm_avg_epu8(load(n+x), load(s+x));
+        __m128i d = _mm_avg_epu8(_mm_avg_epu8(load(n+x-1), load(n+x+1)),
+                                 _mm_avg_epu8(load(s+x-1), load(s+x+1)));
+        __m128i cross = _mm_avg_epu8(v, h);
+        storePixels(dest+x*ctx.channels,
+                    blend(gMask, h, center),
+                    blend(gMask, center, cross),
+                    blend(gMask, v, d),
+                    ctx);
+    }
+    return x;
+}
+
+TARGET_SSSE3 static inline void malvarHalf(const __m128i *p, __m128i gMask, __m128i& rowColor, __m128i& g, __m128i& other)
+{
+    // p: nn, n, n-1, n+1, c-2, c-1, c, c+1, c+2, s, s-1, s+1, ss as 16 bit lanes
+    const __m128i round = _mm_set1_epi16(8);
+    __m128i center = p[6];
+    __m128i diagonal = _mm_add_epi16(_mm_add_epi16(p[2], p[3]), _mm_add_epi16(p[10], p[11]));
+    __m128i vertical = _mm_add_epi16(p[1], p[9]);
+    __m128i horizontal = _mm_add_epi16(p[5], p[7]);
+    __m128i farV = _mm_add_epi16(p[0], p[12]);
+    __m128i farH = _mm_add_epi16(p[4], p[8]);
+    __m128i far = _mm_add_epi16(farV, farH);
+    __m128i c10 = _mm_mullo_epi16(center, _mm_set1_epi16(10));
+    __m128i d2 = _mm_slli_epi16(diagonal, 1);
+
+    __m128i rowOnG = _mm_add_epi16(_mm_sub_epi16(_mm_add_epi16(c10, _mm_slli_epi16(horizontal, 3)),
+                                                 _mm_add_epi16(_mm_slli_epi16(farH, 1), d2)),
+                                   _mm_add_epi16(farV, round));
+    __m128i otherOnG = _mm_add_epi16(_mm_sub_epi16(_mm_add_epi16(c10, _mm_slli_epi16(vertical, 3)),
+                                                   _mm_add_epi16(_mm_slli_epi16(farV, 1), d2)),
+                                     _mm_add_epi16(farH, round));
+    __m128i gOff = _mm_add_epi16(_mm_sub_epi16(_mm_add_epi16(_mm_slli_epi16(center, 3),
+                                                             _mm_slli_epi16(_mm_add_epi16(vertical, horizontal), 2)),
+                                               _mm_slli_epi16(far, 1)),
+                                 round);
+    __m128i otherOff = _mm_add_epi16(_mm_sub_epi16(_mm_add_epi16(_mm_mullo_epi16(center, _mm_set1_epi16(12)),
+                                                                 _mm_slli_epi16(diagonal, 2)),
+                                                   _mm_mullo_epi16(far, _mm_set1_epi16(3))),
+                                     round);
+
+    rowColor = blend(gMask, _mm_srai_epi16(rowOnG, 4), center);
+    g = blend(gMask, center, _mm_srai_epi16(gOff, 4));
+    other = blend(gMask, _mm_srai_epi16(otherOnG, 4), _mm_srai_epi16(otherOff, 4));
+}
+
+TARGET_SSSE3 static int malvarSSSE3(const unsigned char * const *rows, unsigned char *dest, const RowContext& ctx)
+{
+    const unsigned char *nn = rows[0];
+    const unsigned char *n = rows[1];
+    const unsigned char *c = rows[2];
+    const unsigned char *s = rows[3];
+    const unsigned char *ss = rows[4];
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i gMask = _mm_set1_epi32(ctx.gCol==0 ? 0x0000FFFF : (int)0xFFFF0000);
+    int x = 2;
+    for (; x+18<=ctx.w; x+=16) {
+        const unsigned char *src[13] = { nn+x, n+x, n+x-1, n+x+1, c+x-2, c+x-1, c+x, c+x+1, c+x+2, s+x, s+x-1, s+x+1, ss+x };
+        __m128i lo[13], hi[13];
+        for (int i=0; i<13; i++) {
+            __m128i v = load(src[i]);
+            lo[i] = _mm_unpacklo_epi8(v, zero);
+            hi[i] = _mm_unpackhi_epi8(v, zero);
+        }
+        __m128i r0, g0, o0, r1, g1, o1;
+        malvarHalf(lo, gMask, r0, g0, o0);
+        malvarHalf(hi, gMask, r1, g1, o1);
+        storePixels(dest+x*ctx.channels,
+                    _mm_packus_epi16(r0, r1),
+                    _mm_packus_epi16(g0, g1),
+                    _mm_packus_epi16(o0, o1),
+                    ctx);
+    }
+    return x;
+}
+
+TARGET_SSSE3 static inline __m128i load16(const unsigned short *p)
+{
+    return _mm_loadu_si128((const __m128i*)p);
+}
+
+TARGET_SSSE3 static inline __m128i to8(__m128i v, __m128i shift)
+{
+    // scaled down and saturated to 255, still as 16 bit lanes
+    v = _mm_srl_epi16(v, shift);
+    return _mm_sub_epi16(v, _mm_subs_epu16(v, _mm_set1_epi16(255)));
+}
+
+TARGET_SSSE3 static int bilinear16SSSE3(const unsigned short * const *rows, unsigned char *dest, const RowContext& ctx)
+{
+    const unsigned short *n = rows[1];
+    const unsigned short *c = rows[2];
+    const unsigned short *s = rows[3];
+    const __m128i gMask = _mm_set1_epi32(ctx.gCol==0 ? 0x0000FFFF : (int)0xFFFF0000);
+    const __m128i shift = _mm_cvtsi32_si128(ctx.shift);
+    int x = 2;
+    for (; x+18<=ctx.w; x+=16) {
+        __m128i out[3][2];
+        for (int k=0; k<2; k++) {
+            int i = x+8*k;
+            __m128i center = load16(c+i);
+            __m128i h = _mm_avg_epu16(load16(c+i-1), load16(c+i+1));
+            __m128i v = _mm_avg_epu16(load16(n+i), load16(s+i));
+            __m128i d = _mm_avg_epu16(_mm_avg_epu16(load16(n+i-1), load16(n+i+1)),
+                                      _mm_avg_epu16(load16(s+i-1), load16(s+i+1)));
+            __m128i cross = _mm_avg_epu16(v, h);
+            out[0][k] = to8(blend(gMask, h, center), shift);
+            out[1][k] = to8(blend(gMask, center, cross), shift);
+            out[2][k] = to8(blend(gMask, v, d), shift);
+        }
+        storePixels(dest+x*ctx.channels,
+                    _mm_packus_epi16(out[0][0], out[0][1]),
+                    _mm_packus_epi16(out[1][0], out[1][1]),
+                    _mm_packus_epi16(out[2][0], out[2][1]),
+                    ctx);
+    }
+    return x;
+}
+
+#endif // DEMOSAIC_X86
+
+
+template <class T>
+static void demosaicRow(const T * const *rows, unsigned char *dest, const RowContext& ctx, Demosaic::Method method);
+
+template <>
+void demosaicRow<unsigned char>(const unsigned char * const *rows, unsigned char *dest, const RowContext& ctx, Demosaic::Method method)
+{
+    int x = 0;
+    if (method==Demosaic::DEMOSAIC_MALVAR) {
+#ifdef DEMOSAIC_X86
+        if (ctx.simd) {
+            x = malvarSSSE3(rows, dest, ctx);
+            malvarScalar(rows, dest, ctx, 0, std::min(2, ctx.w));
+        }
+#endif
+        malvarScalar(rows, dest, ctx, x, ctx.w);
+    } else {
+#ifdef DEMOSAIC_X86
+        if (ctx.simd) {
+            x = bilinearSSSE3(rows, dest, ctx);
+            bilinearScalar(rows, dest, ctx, 0, std::min(2, ctx.w));
+        }
+#endif
+        bilinearScalar(rows, dest, ctx, x, ctx.w);
+    }
+}
+
+template <>
+void demosaicRow<unsigned short>(const unsigned short * const *rows, unsigned char *dest, const RowContext& ctx, Demosaic::Method method)
+{
+    int x = 0;
+    if (method==Demosaic::DEMOSAIC_MALVAR) {
+        malvarScalar(rows, dest, ctx, x, ctx.w);
+    } else {
+#ifdef DEMOSAIC_X86
+        if (ctx.simd) {
+            x = bilinear16SSSE3(rows, dest, ctx);
+            bilinearScalar(rows, dest, ctx, 0, std::min(2, ctx.w));
+        }
+#endif
+        bilinearScalar(rows, dest, ctx, x, ctx.w);
+    }
+}
+
+
+template <class T>
+static void halfRow(const T *row0, const T *row1, unsigned char *dest, const RowContext& ctx, int w)
+{
+    // ctx describes the first row of each cell
+    const int g0 = ctx.gCol;
+    const int c0 = 1-ctx.gCol;
+    for (int x=0; x<w; x++) {
+        const T *a = row0+2*x;
+        const T *b = row1+2*x;
+        storePixel(dest+x*ctx.channels, a[c0], avg2(a[g0], b[c0]), b[g0], ctx);
+    }
+}
+
+
+template <class T>
+static void demosaicRows(const Image *src, Image *dest, RowContext base, int gCol0, bool red0,
+                         Demosaic::Method method, int y0, int y1)
+{
+    const int h = src->height();
+    for (int y=y0; y<y1; y++) {
+        RowContext ctx = base;
+        if (method==Demosaic::DEMOSAIC_HALF) {
+            ctx.gCol = gCol0;
+            ctx.red = red0;
+            halfRow<T>((const T*)src->getRow(2*y), (const T*)src->getRow(2*y+1),
+                       dest->getRow(y), ctx, dest->width());
+            continue;
+        }
+        ctx.gCol = gCol0^(y&1);
+        ctx.red = red0^((y&1)!=0);
+        const T *rows[5];
+        for (int k=0; k<5; k++) {
+            rows[k] = (const T*)src->getRow(reflect(y-2+k, h));
+        }
+        demosaicRow<T>(rows, dest->getRow(y), ctx, method);
+    }
+}
+
+
+static bool getPattern(int code, int& gCol0, bool& red0, int& sampleSize)
+{
+    switch (code) {
+    case VOCAB_PIXEL_ENCODING_BAYER_GRBG8: gCol0 = 0; red0 = true; sampleSize = 1; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_GRBG16: gCol0 = 0; red0 = true; sampleSize = 2; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_BGGR8: gCol0 = 1; red0 = false; sampleSize = 1; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_BGGR16: gCol0 = 1; red0 = false; sampleSize = 2; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_GBRG8: gCol0 = 0; red0 = false; sampleSize = 1; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_GBRG16: gCol0 = 0; red0 = false; sampleSize = 2; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_RGGB8: gCol0 = 1; red0 = true; sampleSize = 1; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_RGGB16: gCol0 = 1; red0 = true; sampleSize = 2; return true;
+    default:
+        return false;
+    }
+}
+
+
+bool Demosaic::isBayer(int code)
+{
+    int gCol0, sampleSize;
+    bool red0;
+    return getPattern(code, gCol0, red0, sampleSize);
+}
+
+
+bool Demosaic::convert(const Image& src, int bayerCode, Image& dest, Method method, int depth)
+{
+    int gCol0, sampleSize;
+    bool red0;
+    if (!getPattern(bayerCode, gCol0, red0, sampleSize) || src.getPixelSize()!=sampleSize) {
+        return false;
+    }
+#ifndef YARP_LITTLE_ENDIAN
+    // 16 bit samples are little endian, as on the network, and not swapped
+    if (sampleSize==2) {
+        return false;
+    }
+#endif
+
+    RowContext ctx;
+    switch (dest.getPixelCode()) {
+    case VOCAB_PIXEL_RGB: ctx.channels = 3; ctx.bgr = false; break;
+    case VOCAB_PIXEL_BGR: ctx.channels = 3; ctx.bgr = true; break;
+    case VOCAB_PIXEL_RGBA: ctx.channels = 4; ctx.bgr = false; break;
+    case VOCAB_PIXEL_BGRA: ctx.channels = 4; ctx.bgr = true; break;
+    default:
+        return false;
+    }
+    if (dest.getPixelSize()!=ctx.channels) {
+        return false;
+    }
+
+    int w = src.width();
+    int h = src.height();
+    if (method==DEMOSAIC_HALF) {
+        w /= 2;
+        h /= 2;
+    }
+    if (dest.width()!=w || dest.height()!=h) {
+        dest.resize(w, h);
+    }
+    if (w==0 || h==0) {
+        return true;
+    }
+
+    ctx.w = src.width();
+    ctx.gCol = gCol0;
+    ctx.red = red0;
+    ctx.maxValue = (sampleSize==1) ? 255 : 65535;
+    ctx.shift = (sampleSize==1) ? 0 : std::min(std::max(depth-8, 0), 8);
+    PixelConversion::InstructionSet set = PixelConversion::getInstructionSet();
+    ctx.simd = (set==PixelConversion::SIMD_SSSE3 || set==PixelConversion::SIMD_AVX2);
+
+    void (*rows)(const Image*, Image*, RowContext, int, bool, Method, int, int) =
+        (sampleSize==1) ? demosaicRows<unsigned char> : demosaicRows<unsigned short>;
+
+    // a band of rows for each thread
+    int bands = ParallelBands::getBandCount((long)w*h*ctx.channels, threadCount.load(), h);
+    ParallelBands::run(bands, [&](int i) {
+        rows(&src, &dest, ctx, gCol0, red0, method,
+             (int)((long)h*i/bands), (int)((long)h*(i+1)/bands));
+    });
+    return true;
+}
+
+
+void Demosaic::setThreads(int threads)
+{
+    threadCount = (threads>0) ? threads : 0;
+}
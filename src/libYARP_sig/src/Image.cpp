@@ -22,6 +22,8 @@
 #include <yarp/os/Time.h>
 
 #include <yarp/sig/impl/DeBayer.h>
+#include <yarp/sig/impl/Demosaic.h>
+#include <yarp/sig/impl/ImagePool.h>
 
 #include <cstdio>
 #include <cstring>
@@ -196,7 +198,7 @@ void ImageStorage::_alloc_data (void)
 
     yAssert(Data==NULL);
 
-    char **ptr = new char *[pImage->height];
+    char **ptr = (char **)yarp::sig::impl::ImagePool::allocate(pImage->height*sizeof(char *));
 
     Data = ptr;
 
@@ -228,18 +230,8 @@ void ImageStorage::_free (void)
                 if (is_owner)
                     {
                         iplDeallocateImage (pImage);
-                        if (Data!=NULL)
-                            {
-                                delete[] Data;
-                            }
-                    }
-                else
-                    {
-                        if (Data!=NULL)
-                            {
-                                delete[] Data;
-                            }
                     }
+                yarp::sig::impl::ImagePool::release(Data);
 
                 is_owner = 1;
                 Data = NULL;
@@ -904,37 +896,21 @@ bool Image::read(yarp::os::ConnectionReader& connection) {
     // Received and current images are binary incompatible do our best to convert
     //
 
-    // handle here all bayer encoding 8 bits
-    if (isBayer8(header.id))
+    // handle here all bayer encodings, 8 and 16 bits
+    if (isBayer8(header.id) || isBayer16(header.id))
     {
         FlexImage flex;
-        flex.setPixelCode(VOCAB_PIXEL_MONO);
+        flex.setPixelCode(isBayer8(header.id) ? VOCAB_PIXEL_MONO : VOCAB_PIXEL_MONO16);
+        flex.setPixelSize(isBayer8(header.id) ? 1 : 2);
         flex.setQuantum(header.quantum);
 
         bool ok = readFromConnection(flex, header, connection);
         if (!ok)
             return false;
 
-        if (getPixelCode() == VOCAB_PIXEL_BGR && header.id==VOCAB_PIXEL_ENCODING_BAYER_GRBG8)
-            return deBayer_GRBG8_TO_BGR(flex, *this, 3);
-        else if (getPixelCode() == VOCAB_PIXEL_BGRA && header.id == VOCAB_PIXEL_ENCODING_BAYER_GRBG8)
-            return deBayer_GRBG8_TO_BGR(flex, *this, 4);
-        if (getPixelCode() == VOCAB_PIXEL_RGB && header.id==VOCAB_PIXEL_ENCODING_BAYER_GRBG8)
-            return deBayer_GRBG8_TO_RGB(flex, *this, 3);
-        if (getPixelCode() == VOCAB_PIXEL_RGBA && header.id == VOCAB_PIXEL_ENCODING_BAYER_GRBG8)
-            return deBayer_GRBG8_TO_RGB(flex, *this, 4);
-        else
-        {
-            YARP_FIXME_NOTIMPLEMENTED("Conversion from bayer encoding not yet implemented\n");
-            return false;
-        }
-    }
-
-    // handle here all bayer encodings 16 bits
-    if (isBayer16(header.id))
-    {
-        // as bayer16 seems unlikely we defer implementation for later
-        YARP_FIXME_NOTIMPLEMENTED("Conversion from bayer encoding 16 bits not yet implemented\n");
+        if (yarp::sig::impl::Demosaic::convert(flex, header.id, *this))
+            return true;
+        YARP_FIXME_NOTIMPLEMENTED("Conversion from bayer encoding not yet implemented\n");
         return false;
     }
 
@@ -1052,6 +1028,11 @@ void Image::setExternal(const void *data, int imgWidth, int imgHeight) {
 
 
 bool Image::copy(const Image& alt, int w, int h) {
+    return copy(alt,w,h,RESAMPLE_NEAREST);
+}
+
+
+bool Image::copy(const Image& alt, int w, int h, ResampleMode mode) {
     if (getPixelCode()==0) {
         setPixelCode(alt.getPixelCode());
         setPixelSize(alt.getPixelSize());
@@ -1060,7 +1041,7 @@ bool Image::copy(const Image& alt, int w, int h) {
     if (&alt==this) {
         FlexImage img;
         img.copy(alt);
-        return copy(img,w,h);
+        return copy(img,w,h,mode);
     }
 
     if (getPixelCode()!=alt.getPixelCode()) {
@@ -1069,30 +1050,16 @@ bool Image::copy(const Image& alt, int w, int h) {
         img.setPixelSize(getPixelSize());
         img.setQuantum(getQuantum());
         img.copy(alt);
-        return copy(img,w,h);
+        return copy(img,w,h,mode);
     }
 
     resize(w,h);
-    int d = getPixelSize();
-
-    int nw = w;
-    int nh = h;
-    w = alt.width();
-    h = alt.height();
-
-    float di = ((float)h)/nh;
-    float dj = ((float)w)/nw;
-
-    for (int i=0; i<nh; i++)
-        {
-            int i0 = (int)(di*i);
-            for (int j=0; j<nw; j++)
-                {
-                    int j0 = (int)(dj*j);
-                    memcpy(getPixelAddress(j,i),
-                           alt.getPixelAddress(j0,i0),
-                           d);
-                }
-        }
+    if (w==0 || h==0) {
+        return true;
+    }
+    if (alt.width()==0 || alt.height()==0) {
+        return false;
+    }
+    resamplePixels(alt,mode);
     return true;
 }
@@ -7,6 +7,7 @@
 #include <yarp/os/Log.h>
 #include <yarp/sig/Image.h>
 #include <yarp/sig/IplImage.h>
+#include <yarp/sig/impl/PixelConversion.h>
 
 #include <cstring>
 #include <cstdio>
@@ -595,6 +596,10 @@ void Image::copyPixels(const unsigned char *src, int id1,
         return;
     }
 
+    if (yarp::sig::impl::PixelConversion::convert(src,id1,quantum1,dest,id2,quantum2,w,h,topIsLow1!=topIsLow2)) {
+        return;
+    }
+
 
     switch(HASH(id1,id2))
         {
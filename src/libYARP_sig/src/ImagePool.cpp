@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/sig/impl/ImagePool.h>
+
+#include <yarp/os/Log.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+using namespace yarp::sig::impl;
+
+static const unsigned int blockMagic = 0x59504f4c;
+// blocks up to 64 bytes, then four classes per power of two
+static const int minClassBits = 6;
+static const int classCount = (int)(sizeof(size_t)*8 - minClassBits)*4 + 1;
+
+/*
+ * Kept right before the aligned memory handed out.
+ */
+struct BlockHeader
+{
+    void *base;
+    BlockHeader *next;
+    size_t size;
+    int sizeClass;
+    unsigned int magic;
+};
+
+// all zero initialized before any image is created, the mutex too
+static std::mutex poolMutex;
+static BlockHeader *freeBlocks[classCount];
+static ImagePool::Statistics statistics;
+static size_t cacheLimit = (size_t)256 << 20;
+static bool reuse = true;
+static bool finished = false;
+
+static int getSizeClass(size_t size, size_t& classSize)
+{
+    if (size <= ((size_t)1 << minClassBits)) {
+        classSize = (size_t)1 << minClassBits;
+        return 0;
+    }
+    size_t s = size - 1;
+    int bits = minClassBits;
+    while ((s >> (bits+1)) != 0) {
+        bits++;
+    }
+    size_t quarter = (s >> (bits-2)) & 3;
+    classSize = (4+quarter+1) << (bits-2);
+    return (bits-minClassBits)*4 + (int)quarter + 1;
+}
+
+static BlockHeader *getHeader(const void *ptr)
+{
+    BlockHeader *header = ((BlockHeader *)ptr) - 1;
+    yAssert(header->magic == blockMagic);
+    return header;
+}
+
+// called with the mutex locked
+static void freeCached()
+{
+    for (int i=0; i<classCount; i++) {
+        while (freeBlocks[i] != NULL) {
+            BlockHeader *header = freeBlocks[i];
+            freeBlocks[i] = header->next;
+            statistics.cachedBytes -= header->size;
+            statistics.cachedBlocks--;
+            statistics.frees++;
+            free(header->base);
+        }
+    }
+}
+
+/*
+ * Gives the cached blocks back when the library is unloaded, and stops
+ * caching the ones of images destroyed later on.
+ */
+class PoolCleanup
+{
+public:
+    ~PoolCleanup() {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        finished = true;
+        freeCached();
+    }
+};
+
+static PoolCleanup cleanup;
+
+
+void *ImagePool::allocate(size_t size)
+{
+    size_t classSize = 0;
+    int sizeClass = getSizeClass(size, classSize);
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        statistics.usedBytes += classSize;
+        if (statistics.usedBytes > statistics.peakUsedBytes) {
+            statistics.peakUsedBytes = statistics.usedBytes;
+        }
+        BlockHeader *header = freeBlocks[sizeClass];
+        if (header != NULL) {
+            freeBlocks[sizeClass] = header->next;
+            header->next = NULL;
+            statistics.cachedBytes -= classSize;
+            statistics.cachedBlocks--;
+            statistics.reuses++;
+            return header + 1;
+        }
+        statistics.allocations++;
+    }
+
+    void *base = malloc(classSize + sizeof(BlockHeader) + ALIGNMENT - 1);
+    yAssert(base != NULL);
+    size_t start = ((size_t)base + sizeof(BlockHeader) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    BlockHeader *header = ((BlockHeader *)start) - 1;
+    header->base = base;
+    header->next = NULL;
+    header->size = classSize;
+    header->sizeClass = sizeClass;
+    header->magic = blockMagic;
+    return header + 1;
+}
+
+
+void ImagePool::release(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    BlockHeader *header = getHeader(ptr);
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        statistics.usedBytes -= header->size;
+        statistics.releases++;
+        if (reuse && !finished &&
+            statistics.cachedBytes + header->size <= cacheLimit) {
+            header->next = freeBlocks[header->sizeClass];
+            freeBlocks[header->sizeClass] = header;
+            statistics.cachedBytes += header->size;
+            statistics.cachedBlocks++;
+            return;
+        }
+        statistics.frees++;
+    }
+    header->magic = 0;
+    free(header->base);
+}
+
+
+size_t ImagePool::getCapacity(const void *ptr)
+{
+    return getHeader(ptr)->size;
+}
+
+
+void ImagePool::setEnabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    reuse = enabled;
+    if (!reuse) {
+        freeCached();
+    }
+}
+
+
+bool ImagePool::isEnabled()
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return reuse;
+}
+
+
+void ImagePool::setCacheLimit(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    cacheLimit = bytes;
+    // drop the largest blocks first, they are the cheapest to give back
+    for (int i=classCount-1; i>=0 && statistics.cachedBytes>cacheLimit; i--) {
+        while (freeBlocks[i] != NULL && statistics.cachedBytes > cacheLimit) {
+            BlockHeader *header = freeBlocks[i];
+            freeBlocks[i] = header->next;
+            statistics.cachedBytes -= header->size;
+            statistics.cachedBlocks--;
+            statistics.frees++;
+            free(header->base);
+        }
+    }
+}
+
+
+size_t ImagePool::getCacheLimit()
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return cacheLimit;
+}
+
+
+void ImagePool::trim()
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    freeCached();
+}
+
+
+ImagePool::Statistics ImagePool::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return statistics;
+}
+
+
+void ImagePool::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(poolMutex);
+    statistics.allocations = 0;
+    statistics.reuses = 0;
+    statistics.releases = 0;
+    statistics.frees = 0;
+    statistics.peakUsedBytes = statistics.usedBytes;
+}
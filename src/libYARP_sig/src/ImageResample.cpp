@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/conf/numeric.h>
+#include <yarp/sig/Image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define RESAMPLE_SSE2
+#  include <emmintrin.h>
+#endif
+
+using namespace yarp::sig;
+
+/*
+ * Images are resampled in two passes: each source row needed is filtered
+ * horizontally into a buffer, then the buffered rows are combined into
+ * each destination row.  The source pixels contributing to each column
+ * and row, and their weights, are computed once per copy.
+ */
+
+namespace {
+
+enum ChannelType
+{
+    CHANNEL_U8,
+    CHANNEL_S8,
+    CHANNEL_U16,
+    CHANNEL_S32,
+    CHANNEL_F32
+};
+
+struct Taps
+{
+    int maxCount;
+    std::vector<int> first;     // taps of output i are [first[i], first[i+1])
+    std::vector<int> index;
+    std::vector<float> weight;
+
+    Taps() : maxCount(0) { first.push_back(0); }
+
+    void add(int i, double w)
+    {
+        index.push_back(i);
+        weight.push_back((float)w);
+    }
+
+    void next()
+    {
+        first.push_back((int)index.size());
+        maxCount = std::max(maxCount, first[first.size()-1] - first[first.size()-2]);
+    }
+};
+
+}
+
+
+static bool getChannels(int code, int pixelSize, ChannelType& type, int& channels)
+{
+    int size;
+    switch (code) {
+    case VOCAB_PIXEL_MONO: type = CHANNEL_U8; channels = 1; size = 1; break;
+    case VOCAB_PIXEL_RGB:
+    case VOCAB_PIXEL_BGR:
+    case VOCAB_PIXEL_HSV: type = CHANNEL_U8; channels = 3; size = 1; break;
+    case VOCAB_PIXEL_RGBA:
+    case VOCAB_PIXEL_BGRA: type = CHANNEL_U8; channels = 4; size = 1; break;
+    case VOCAB_PIXEL_MONO_SIGNED: type = CHANNEL_S8; channels = 1; size = 1; break;
+    case VOCAB_PIXEL_RGB_SIGNED: type = CHANNEL_S8; channels = 3; size = 1; break;
+#ifdef YARP_LITTLE_ENDIAN
+    // stored in network order, read as native integers
+    case VOCAB_PIXEL_MONO16: type = CHANNEL_U16; channels = 1; size = 2; break;
+    case VOCAB_PIXEL_INT: type = CHANNEL_S32; channels = 1; size = 4; break;
+    case VOCAB_PIXEL_RGB_INT: type = CHANNEL_S32; channels = 3; size = 4; break;
+#endif
+    case VOCAB_PIXEL_MONO_FLOAT: type = CHANNEL_F32; channels = 1; size = 4; break;
+    case VOCAB_PIXEL_RGB_FLOAT:
+    case VOCAB_PIXEL_HSV_FLOAT: type = CHANNEL_F32; channels = 3; size = 4; break;
+    default:
+        return false;
+    }
+    return channels*size==pixelSize;
+}
+
+
+static void bilinearTaps(int srcLen, int destLen, Taps& taps)
+{
+    // pixel centres aligned, clamped at the borders
+    double scale = (double)srcLen/destLen;
+    for (int i=0; i<destLen; i++) {
+        double s = std::max((i+0.5)*scale-0.5, 0.0);
+        int i0 = (int)s;
+        double f = s-i0;
+        if (i0>=srcLen-1) {
+            i0 = srcLen-1;
+            f = 0;
+        }
+        taps.add(i0, 1-f);
+        if (f>0) {
+            taps.add(i0+1, f);
+        }
+        taps.next();
+    }
+}
+
+
+static void areaTaps(int srcLen, int destLen, Taps& taps)
+{
+    // each source pixel weighted by how much of it the output pixel covers
+    double scale = (double)srcLen/destLen;
+    for (int i=0; i<destLen; i++) {
+        double a = i*scale;
+        double b = std::min((i+1)*scale, (double)srcLen);
+        for (int k=(int)a; k<b; k++) {
+            double overlap = std::min(b, k+1.0) - std::max(a, (double)k);
+            if (overlap>1e-6) {
+                taps.add(k, overlap/scale);
+            }
+        }
+        taps.next();
+    }
+}
+
+
+template <class T, class Acc, int C>
+static void filterRow(const T *src, Acc *dest, const Taps& taps, int destLen)
+{
+    const int *index = taps.index.data();
+    const float *weight = taps.weight.data();
+    for (int x=0; x<destLen; x++) {
+        Acc sum[C];
+        for (int c=0; c<C; c++) {
+            sum[c] = 0;
+        }
+        for (int t=taps.first[x]; t<taps.first[x+1]; t++) {
+            const T *s = src + index[t]*C;
+            Acc w = weight[t];
+            for (int c=0; c<C; c++) {
+                sum[c] += w*(Acc)s[c];
+            }
+        }
+        for (int c=0; c<C; c++) {
+            dest[x*C+c] = sum[c];
+        }
+    }
+}
+
+
+template <class Acc>
+static void accumulate(Acc *acc, const Acc *row, Acc w, int n, bool first)
+{
+    if (first) {
+        for (int i=0; i<n; i++) {
+            acc[i] = w*row[i];
+        }
+    } else {
+        for (int i=0; i<n; i++) {
+            acc[i] += w*row[i];
+        }
+    }
+}
+
+#ifdef RESAMPLE_SSE2
+template <>
+void accumulate<float>(float *acc, const float *row, float w, int n, bool first)
+{
+    const __m128 vw = _mm_set1_ps(w);
+    int i = 0;
+    if (first) {
+        for (; i+4<=n; i+=4) {
+            _mm_storeu_ps(acc+i, _mm_mul_ps(vw, _mm_loadu_ps(row+i)));
+        }
+        for (; i<n; i++) {
+            acc[i] = w*row[i];
+        }
+    } else {
+        for (; i+4<=n; i+=4) {
+            __m128 a = _mm_loadu_ps(acc+i);
+            _mm_storeu_ps(acc+i, _mm_add_ps(a, _mm_mul_ps(vw, _mm_loadu_ps(row+i))));
+        }
+        for (; i<n; i++) {
+            acc[i] += w*row[i];
+        }
+    }
+}
+#endif
+
+
+// rounded to the nearest value and saturated for integer channels
+template <class T, class Acc>
+static inline T saturate(Acc v, Acc lo, Acc hi)
+{
+    if (v<lo) {
+        return (T)lo;
+    }
+    if (v>hi) {
+        return (T)hi;
+    }
+    return (T)std::lrint(v);
+}
+
+template <class T, class Acc>
+static void store(const Acc *acc, T *dest, int n)
+{
+    const Acc lo = (Acc)std::numeric_limits<T>::min();
+    const Acc hi = (Acc)std::numeric_limits<T>::max();
+    for (int i=0; i<n; i++) {
+        dest[i] = saturate<T, Acc>(acc[i], lo, hi);
+    }
+}
+
+template <>
+void store<float, float>(const float *acc, float *dest, int n)
+{
+    memcpy(dest, acc, n*sizeof(float));
+}
+
+#ifdef RESAMPLE_SSE2
+template <>
+void store<unsigned char, float>(const float *acc, unsigned char *dest, int n)
+{
+    int i = 0;
+    for (; i+16<=n; i+=16) {
+        __m128i a = _mm_cvtps_epi32(_mm_loadu_ps(acc+i));
+        __m128i b = _mm_cvtps_epi32(_mm_loadu_ps(acc+i+4));
+        __m128i c = _mm_cvtps_epi32(_mm_loadu_ps(acc+i+8));
+        __m128i d = _mm_cvtps_epi32(_mm_loadu_ps(acc+i+12));
+        _mm_storeu_si128((__m128i*)(dest+i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    }
+    for (; i<n; i++) {
+        dest[i] = saturate<unsigned char, float>(acc[i], 0.0f, 255.0f);
+    }
+}
+#endif
+
+
+template <class T, class Acc, int C>
+static void resample(const Image& src, Image& dest, const Taps& xTaps, const Taps& yTaps)
+{
+    const int w = dest.width();
+    const int h = dest.height();
+    const int n = w*C;
+
+    // the rows filtered horizontally, enough for the taps of any output row
+    const int slots = yTaps.maxCount+1;
+    std::vector<Acc> rows((size_t)slots*n);
+    std::vector<int> rowIndex(slots, -1);
+    std::vector<Acc> acc(n);
+
+    for (int y=0; y<h; y++) {
+        for (int t=yTaps.first[y]; t<yTaps.first[y+1]; t++) {
+            int sy = yTaps.index[t];
+            int slot = sy%slots;
+            Acc *row = &rows[(size_t)slot*n];
+            if (rowIndex[slot]!=sy) {
+                filterRow<T, Acc, C>((const T*)src.getRow(sy), row, xTaps, w);
+                rowIndex[slot] = sy;
+            }
+            accumulate<Acc>(acc.data(), row, (Acc)yTaps.weight[t], n, t==yTaps.first[y]);
+        }
+        store<T, Acc>(acc.data(), (T*)dest.getRow(y), n);
+    }
+}
+
+
+template <class T, class Acc>
+static void resample(const Image& src, Image& dest, int channels, const Taps& xTaps, const Taps& yTaps)
+{
+    switch (channels) {
+    case 1: resample<T, Acc, 1>(src, dest, xTaps, yTaps); break;
+    case 3: resample<T, Acc, 3>(src, dest, xTaps, yTaps); break;
+    case 4: resample<T, Acc, 4>(src, dest, xTaps, yTaps); break;
+    }
+}
+
+
+template <class T, class Sum, int C>
+static void resampleBlocks(const Image& src, Image& dest, int kx, int ky)
+{
+    // shrinking by whole factors, the blocks are summed as integers: the
+    // rows first, then the columns of their sum; Sum holds kx*ky values
+    const int w = dest.width();
+    const int h = dest.height();
+    const int n = w*C;
+    const int srcN = src.width()*C;
+    const float scale = 1.0f/(kx*ky);
+    std::vector<Sum> rows(srcN);
+    std::vector<Sum> sum(n);
+    std::vector<float> acc(n);
+
+    for (int y=0; y<h; y++) {
+        std::fill(rows.begin(), rows.end(), 0);
+        for (int k=0; k<ky; k++) {
+            const T *s = (const T*)src.getRow(y*ky+k);
+            for (int i=0; i<srcN; i++) {
+                rows[i] += s[i];
+            }
+        }
+        const Sum *r = rows.data();
+        for (int x=0; x<w; x++) {
+            Sum total[C];
+            for (int c=0; c<C; c++) {
+                total[c] = r[c];
+            }
+            for (int j=1; j<kx; j++) {
+                for (int c=0; c<C; c++) {
+                    total[c] += r[j*C+c];
+                }
+            }
+            for (int c=0; c<C; c++) {
+                sum[x*C+c] = total[c];
+            }
+            r += kx*C;
+        }
+        for (int i=0; i<n; i++) {
+            acc[i] = (float)sum[i]*scale;
+        }
+        store<T, float>(acc.data(), (T*)dest.getRow(y), n);
+    }
+}
+
+
+template <class T, class Sum>
+static void resampleBlocks(const Image& src, Image& dest, int channels, int kx, int ky)
+{
+    switch (channels) {
+    case 1: resampleBlocks<T, Sum, 1>(src, dest, kx, ky); break;
+    case 3: resampleBlocks<T, Sum, 3>(src, dest, kx, ky); break;
+    case 4: resampleBlocks<T, Sum, 4>(src, dest, kx, ky); break;
+    }
+}
+
+
+template <int D>
+static void copyNearest(const unsigned char *src, unsigned char *dest, const int *offsets, int w)
+{
+    for (int x=0; x<w; x++) {
+        memcpy(dest+x*D, src+offsets[x], D);
+    }
+}
+
+
+static void resampleNearest(const Image& src, Image& dest)
+{
+    const int d = dest.getPixelSize();
+    const int w = dest.width();
+    const int h = dest.height();
+
+    // the same coordinates as the original per pixel loop
+    float di = ((float)src.height())/h;
+    float dj = ((float)src.width())/w;
+    std::vector<int> offsets(w);
+    for (int x=0; x<w; x++) {
+        offsets[x] = ((int)(dj*x))*d;
+    }
+
+    for (int y=0; y<h; y++) {
+        const unsigned char *s = src.getRow((int)(di*y));
+        unsigned char *t = dest.getRow(y);
+        switch (d) {
+        case 1: copyNearest<1>(s, t, offsets.data(), w); break;
+        case 2: copyNearest<2>(s, t, offsets.data(), w); break;
+        case 3: copyNearest<3>(s, t, offsets.data(), w); break;
+        case 4: copyNearest<4>(s, t, offsets.data(), w); break;
+        case 12: copyNearest<12>(s, t, offsets.data(), w); break;
+        default:
+            for (int x=0; x<w; x++) {
+                memcpy(t+x*d, s+offsets[x], d);
+            }
+        }
+    }
+}
+
+
+void Image::resamplePixels(const Image& alt, ResampleMode mode)
+{
+    ChannelType type;
+    int channels;
+    if (mode==RESAMPLE_NEAREST ||
+            !getChannels(getPixelCode(), getPixelSize(), type, channels)) {
+        resampleNearest(alt, *this);
+        return;
+    }
+
+    int kx = alt.width()/width();
+    int ky = alt.height()/height();
+    if (mode==RESAMPLE_AREA && kx*width()==alt.width() && ky*height()==alt.height()) {
+        switch (type) {
+        case CHANNEL_U8: resampleBlocks<unsigned char, int>(alt, *this, channels, kx, ky); return;
+        case CHANNEL_S8: resampleBlocks<signed char, int>(alt, *this, channels, kx, ky); return;
+        // 16 bit sums overflow an int beyond blocks of 32768 pixels
+        case CHANNEL_U16: resampleBlocks<unsigned short, YARP_INT64>(alt, *this, channels, kx, ky); return;
+        default: break;
+        }
+    }
+
+    Taps xTaps, yTaps;
+    if (mode==RESAMPLE_AREA) {
+        areaTaps(alt.width(), width(), xTaps);
+        areaTaps(alt.height(), height(), yTaps);
+    } else {
+        bilinearTaps(alt.width(), width(), xTaps);
+        bilinearTaps(alt.height(), height(), yTaps);
+    }
+
+    switch (type) {
+    case CHANNEL_U8: resample<unsigned char, float>(alt, *this, channels, xTaps, yTaps); break;
+    case CHANNEL_S8: resample<signed char, float>(alt, *this, channels, xTaps, yTaps); break;
+    case CHANNEL_U16: resample<unsigned short, float>(alt, *this, channels, xTaps, yTaps); break;
+    case CHANNEL_S32: resample<int, double>(alt, *this, channels, xTaps, yTaps); break;
+    case CHANNEL_F32: resample<float, float>(alt, *this, channels, xTaps, yTaps); break;
+    }
+}
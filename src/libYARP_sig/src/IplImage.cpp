@@ -10,6 +10,7 @@
 
 #include <yarp/os/Log.h>
 #include <yarp/sig/IplImage.h>
+#include <yarp/sig/impl/ImagePool.h>
 
 static int implemented_yet = 1;
 
@@ -666,7 +667,7 @@ IPLAPIIMPL(void, iplAllocateImage,(IplImage* image, int doFill, int fillValue))
     ///yAssert(image->widthStep == image->width * (image->depth & IPL_DEPTH_MASK) / 8 * image->nChannels);
     yAssert(image->imageSize == image->widthStep * image->height);
 
-    image->imageData = AllocAligned<char> (image->imageSize); // new char[image->imageSize];
+    image->imageData = (char *)yarp::sig::impl::ImagePool::allocate(image->imageSize);
     yAssert(image->imageData != NULL);
 
     if (image->origin == IPL_ORIGIN_TL)
@@ -698,7 +699,7 @@ IPLAPIIMPL(void, iplAllocateImageFP,(IplImage* image, int doFill, float fillValu
     // yAssert(image->widthStep == image->width * (image->depth & IPL_DEPTH_MASK) / 8 * image->nChannels);
     yAssert(image->imageSize == image->widthStep * image->height);
 
-    image->imageData = AllocAligned<char> (image->imageSize);
+    image->imageData = (char *)yarp::sig::impl::ImagePool::allocate(image->imageSize);
     yAssert(image->imageData != NULL);
 
     if (image->origin == IPL_ORIGIN_TL)
@@ -730,8 +731,7 @@ IPLAPIIMPL(void, iplAllocateImageFP,(IplImage* image, int doFill, float fillValu
 
 IPLAPIIMPL(void, iplDeallocateImage,(IplImage* image))
 {
-    if (image->imageData != NULL)
-        FreeAligned<char> (image->imageData); ///delete[] image->imageData;
+    yarp::sig::impl::ImagePool::release(image->imageData);
     image->imageData = NULL;
 
     // Not allocated.
@@ -801,7 +801,7 @@ IPLAPIIMPL(IplImage*, iplCreateImageHeader,
         }
 
     IplImage *r = NULL;
-    r = new IplImage;
+    r = (IplImage *)yarp::sig::impl::ImagePool::allocate(sizeof(IplImage));
     yAssert(r != NULL);
 
     r->nSize = sizeof(IplImage);
@@ -888,13 +888,8 @@ IPLAPIIMPL(void, iplDeallocateHeader,(IplImage* image))
         return;
 
     yAssert(image->nSize == sizeof(IplImage));
-    if (image->imageData != NULL)
-        {
-            FreeAligned<char> (image->imageData);
-            ///delete[] image->imageData;
-        }
-
-    delete image;
+    yarp::sig::impl::ImagePool::release(image->imageData);
+    yarp::sig::impl::ImagePool::release(image);
 }
 
 IPLAPIIMPL(void, iplDeallocate,(IplImage* image, int flag))
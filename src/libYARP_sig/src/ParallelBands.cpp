@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/sig/impl/ParallelBands.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace yarp::sig::impl;
+
+const long ParallelBands::PARALLEL_BYTES;
+const int ParallelBands::MAX_THREADS;
+
+
+namespace {
+
+/*
+ * The bands of one call to ParallelBands::run(), on its caller's stack.
+ */
+struct Job
+{
+    const std::function<void(int)> *band;
+    int count;
+    int next;       // first band not taken yet
+    int pending;    // bands not done yet
+};
+
+class BandPool
+{
+public:
+    BandPool() : stopping(false)
+    {
+    }
+
+    ~BandPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+            work.notify_all();
+        }
+        for (size_t i=0; i<workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    void run(Job& job)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        // with no more threads, or once stopped, the caller runs them all
+        while ((int)workers.size()<job.count-1 && !stopping) {
+            try {
+                workers.push_back(std::thread(&BandPool::loop, this));
+            } catch (...) {
+                break;
+            }
+        }
+        jobs.push_back(&job);
+        work.notify_all();
+        while (job.next<job.count) {
+            runBand(lock, job);
+        }
+        while (job.pending>0) {
+            done.wait(lock);
+        }
+    }
+
+private:
+    // with the mutex held
+    void runBand(std::unique_lock<std::mutex>& lock, Job& job)
+    {
+        int i = job.next++;
+        if (job.next==job.count) {
+            jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+        }
+        lock.unlock();
+        (*job.band)(i);
+        lock.lock();
+        if (--job.pending==0) {
+            done.notify_all();
+        }
+    }
+
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (jobs.empty()) {
+                work.wait(lock);
+                continue;
+            }
+            runBand(lock, *jobs.front());
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable work;   // wakes the workers
+    std::condition_variable done;   // wakes the callers waiting for their bands
+    std::deque<Job *> jobs;         // the ones with bands not taken yet
+    std::vector<std::thread> workers;
+    bool stopping;
+};
+
+} // namespace
+
+
+static BandPool& getPool()
+{
+    static BandPool pool;
+    return pool;
+}
+
+
+int ParallelBands::getBandCount(long bytes, int threads, int maxBands)
+{
+    if (bytes<PARALLEL_BYTES) {
+        return 1;
+    }
+    if (threads<=0) {
+        threads = std::min((int)std::thread::hardware_concurrency(), MAX_THREADS);
+    }
+    return std::max(1, std::min(threads, maxBands));
+}
+
+
+void ParallelBands::run(int count, const std::function<void(int)>& band)
+{
+    if (count<=1) {
+        if (count==1) {
+            band(0);
+        }
+        return;
+    }
+    Job job;
+    job.band = &band;
+    job.count = count;
+    job.next = 0;
+    job.pending = count;
+    getPool().run(job);
+}
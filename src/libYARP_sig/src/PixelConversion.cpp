@@ -0,0 +1,815 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/sig/impl/PixelConversion.h>
+#include <yarp/sig/impl/ParallelBands.h>
+#include <yarp/sig/Image.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  define PIXEL_CONVERSION_X86
+#  define TARGET_SSSE3 __attribute__((target("ssse3")))
+#  define TARGET_AVX2 __attribute__((target("avx2")))
+#  include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  define PIXEL_CONVERSION_X86
+#  define TARGET_SSSE3
+#  define TARGET_AVX2
+#  include <immintrin.h>
+#  include <intrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define PIXEL_CONVERSION_NEON
+#  include <arm_neon.h>
+#endif
+
+using namespace yarp::sig;
+using namespace yarp::sig::impl;
+
+typedef void (*RowFunction)(const unsigned char *src, unsigned char *dest, int w);
+
+static std::atomic<int> instructionSet(-1);
+static std::atomic<int> threadCount(0);
+
+
+/*
+ * Per pixel conversions, the same as the ones of ImageCopy.cpp, for the
+ * pixels left over by the vectorized loops.
+ */
+
+static void swap3Tail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[3*x] = s[3*x+2];
+        d[3*x+1] = s[3*x+1];
+        d[3*x+2] = s[3*x];
+    }
+}
+
+static void expand3Tail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[4*x] = s[3*x];
+        d[4*x+1] = s[3*x+1];
+        d[4*x+2] = s[3*x+2];
+        d[4*x+3] = 255;
+    }
+}
+
+static void expand3SwapTail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[4*x] = s[3*x+2];
+        d[4*x+1] = s[3*x+1];
+        d[4*x+2] = s[3*x];
+        d[4*x+3] = 255;
+    }
+}
+
+static void shrink4Tail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[3*x] = s[4*x];
+        d[3*x+1] = s[4*x+1];
+        d[3*x+2] = s[4*x+2];
+    }
+}
+
+static void shrink4SwapTail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[3*x] = s[4*x+2];
+        d[3*x+1] = s[4*x+1];
+        d[3*x+2] = s[4*x];
+    }
+}
+
+static void swap4Tail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[4*x] = s[4*x+2];
+        d[4*x+1] = s[4*x+1];
+        d[4*x+2] = s[4*x];
+        d[4*x+3] = s[4*x+3];
+    }
+}
+
+static void gray3Tail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[x] = (unsigned char)((s[3*x] + s[3*x+1] + s[3*x+2])/3);
+    }
+}
+
+static void gray4Tail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[x] = (unsigned char)((s[4*x] + s[4*x+1] + s[4*x+2])/3);
+    }
+}
+
+static void mono3Tail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[3*x] = d[3*x+1] = d[3*x+2] = s[x];
+    }
+}
+
+static void mono4Tail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    for (; x<w; x++) {
+        d[4*x] = d[4*x+1] = d[4*x+2] = s[x];
+        d[4*x+3] = 255;
+    }
+}
+
+static void mono16ToMonoTail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    const PixelMono16 *s16 = (const PixelMono16*)s;
+    for (; x<w; x++) {
+        d[x] = (PixelMono)s16[x];
+    }
+}
+
+static void monoToMono16Tail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    PixelMono16 *d16 = (PixelMono16*)d;
+    for (; x<w; x++) {
+        d16[x] = s[x];
+    }
+}
+
+static void floatToMonoTail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    const PixelFloat *sf = (const PixelFloat*)s;
+    for (; x<w; x++) {
+        d[x] = (unsigned char)sf[x];
+    }
+}
+
+static void monoToFloatTail(const unsigned char *s, unsigned char *d, int x, int w)
+{
+    PixelFloat *df = (PixelFloat*)d;
+    for (; x<w; x++) {
+        df[x] = s[x];
+    }
+}
+
+
+#ifdef PIXEL_CONVERSION_X86
+
+/*
+ * SSSE3, 128 bit registers.  The sums of three channels are divided by 3
+ * as (sum*21846)>>16, exact for sums up to 765.
+ */
+
+TARGET_SSSE3 static void swap3SSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    // 5 pixels at a time; the 16th byte is written again by the next step
+    const __m128i mask = _mm_setr_epi8(2,1,0, 5,4,3, 8,7,6, 11,10,9, 14,13,12, 15);
+    int x = 0;
+    for (; x+6<=w; x+=5) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s+3*x));
+        _mm_storeu_si128((__m128i*)(d+3*x), _mm_shuffle_epi8(v, mask));
+    }
+    swap3Tail(s, d, x, w);
+}
+
+TARGET_SSSE3 static inline void expand3Step(const unsigned char *s, unsigned char *d, __m128i mask)
+{
+    // 16 pixels, 48 bytes in, 64 bytes out
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    __m128i v0 = _mm_loadu_si128((const __m128i*)s);
+    __m128i v1 = _mm_loadu_si128((const __m128i*)(s+16));
+    __m128i v2 = _mm_loadu_si128((const __m128i*)(s+32));
+    _mm_storeu_si128((__m128i*)d, _mm_or_si128(_mm_shuffle_epi8(v0, mask), alpha));
+    _mm_storeu_si128((__m128i*)(d+16), _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(v1, v0, 12), mask), alpha));
+    _mm_storeu_si128((__m128i*)(d+32), _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(v2, v1, 8), mask), alpha));
+    _mm_storeu_si128((__m128i*)(d+48), _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(v2, 4), mask), alpha));
+}
+
+TARGET_SSSE3 static void expand3SSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i mask = _mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        expand3Step(s+3*x, d+4*x, mask);
+    }
+    expand3Tail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void expand3SwapSSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i mask = _mm_setr_epi8(2,1,0,-1, 5,4,3,-1, 8,7,6,-1, 11,10,9,-1);
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        expand3Step(s+3*x, d+4*x, mask);
+    }
+    expand3SwapTail(s, d, x, w);
+}
+
+TARGET_SSSE3 static inline void shrink4Step(const unsigned char *s, unsigned char *d, __m128i mask)
+{
+    // 16 pixels, 64 bytes in, 48 bytes out; the mask leaves the last 4 bytes at 0
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), mask);
+    __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s+16)), mask);
+    __m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s+32)), mask);
+    __m128i e = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s+48)), mask);
+    _mm_storeu_si128((__m128i*)d, _mm_or_si128(a, _mm_slli_si128(b, 12)));
+    _mm_storeu_si128((__m128i*)(d+16), _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+    _mm_storeu_si128((__m128i*)(d+32), _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(e, 4)));
+}
+
+TARGET_SSSE3 static void shrink4SSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i mask = _mm_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1);
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        shrink4Step(s+4*x, d+3*x, mask);
+    }
+    shrink4Tail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void shrink4SwapSSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i mask = _mm_setr_epi8(2,1,0, 6,5,4, 10,9,8, 14,13,12, -1,-1,-1,-1);
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        shrink4Step(s+4*x, d+3*x, mask);
+    }
+    shrink4SwapTail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void swap4SSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i mask = _mm_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+    int x = 0;
+    for (; x+4<=w; x+=4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s+4*x));
+        _mm_storeu_si128((__m128i*)(d+4*x), _mm_shuffle_epi8(v, mask));
+    }
+    swap4Tail(s, d, x, w);
+}
+
+TARGET_SSSE3 static inline __m128i graySum(__m128i v0, __m128i v1, __m128i maskRG, __m128i maskB)
+{
+    // the first and second channels of 4 pixels of each register, as 16 bit lanes
+    __m128i rg0 = _mm_shuffle_epi8(v0, maskRG);
+    __m128i rg1 = _mm_shuffle_epi8(v1, maskRG);
+    __m128i b = _mm_unpacklo_epi64(_mm_shuffle_epi8(v0, maskB), _mm_shuffle_epi8(v1, maskB));
+    __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi64(rg0, rg1), _mm_unpackhi_epi64(rg0, rg1)), b);
+    return _mm_mulhi_epu16(sum, _mm_set1_epi16(21846));
+}
+
+TARGET_SSSE3 static void gray3SSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i maskRG = _mm_setr_epi8(0,-1, 3,-1, 6,-1, 9,-1, 1,-1, 4,-1, 7,-1, 10,-1);
+    const __m128i maskB = _mm_setr_epi8(2,-1, 5,-1, 8,-1, 11,-1, -1,-1, -1,-1, -1,-1, -1,-1);
+    int x = 0;
+    // 8 pixels at a time, reading 4 bytes past them
+    for (; x+10<=w; x+=8) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(s+3*x));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(s+3*x+12));
+        __m128i q = graySum(v0, v1, maskRG, maskB);
+        _mm_storel_epi64((__m128i*)(d+x), _mm_packus_epi16(q, q));
+    }
+    gray3Tail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void gray4SSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i maskRG = _mm_setr_epi8(0,-1, 4,-1, 8,-1, 12,-1, 1,-1, 5,-1, 9,-1, 13,-1);
+    const __m128i maskB = _mm_setr_epi8(2,-1, 6,-1, 10,-1, 14,-1, -1,-1, -1,-1, -1,-1, -1,-1);
+    int x = 0;
+    for (; x+8<=w; x+=8) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(s+4*x));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(s+4*x+16));
+        __m128i q = graySum(v0, v1, maskRG, maskB);
+        _mm_storel_epi64((__m128i*)(d+x), _mm_packus_epi16(q, q));
+    }
+    gray4Tail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void mono3SSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i mask0 = _mm_setr_epi8(0,0,0, 1,1,1, 2,2,2, 3,3,3, 4,4,4, 5);
+    const __m128i mask1 = _mm_setr_epi8(5,5, 6,6,6, 7,7,7, 8,8,8, 9,9,9, 10,10);
+    const __m128i mask2 = _mm_setr_epi8(10, 11,11,11, 12,12,12, 13,13,13, 14,14,14, 15,15,15);
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s+x));
+        _mm_storeu_si128((__m128i*)(d+3*x), _mm_shuffle_epi8(v, mask0));
+        _mm_storeu_si128((__m128i*)(d+3*x+16), _mm_shuffle_epi8(v, mask1));
+        _mm_storeu_si128((__m128i*)(d+3*x+32), _mm_shuffle_epi8(v, mask2));
+    }
+    mono3Tail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void mono4SSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    const __m128i mask = _mm_setr_epi8(0,0,0,-1, 1,1,1,-1, 2,2,2,-1, 3,3,3,-1);
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s+x));
+        for (int i=0; i<4; i++) {
+            __m128i p = _mm_shuffle_epi8(v, mask);
+            _mm_storeu_si128((__m128i*)(d+4*x+16*i), _mm_or_si128(p, alpha));
+            v = _mm_srli_si128(v, 4);
+        }
+    }
+    mono4Tail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void mono16ToMonoSSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i low = _mm_set1_epi16(0xFF);
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(s+2*x)), low);
+        __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(s+2*x+16)), low);
+        _mm_storeu_si128((__m128i*)(d+x), _mm_packus_epi16(a, b));
+    }
+    mono16ToMonoTail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void monoToMono16SSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s+x));
+        _mm_storeu_si128((__m128i*)(d+2*x), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(d+2*x+16), _mm_unpackhi_epi8(v, zero));
+    }
+    monoToMono16Tail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void floatToMonoSSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    // truncated, keeping the low byte as the cast of the per pixel loop
+    const __m128i low = _mm_set1_epi32(0xFF);
+    const float *f = (const float*)s;
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        __m128i a = _mm_and_si128(_mm_cvttps_epi32(_mm_loadu_ps(f+x)), low);
+        __m128i b = _mm_and_si128(_mm_cvttps_epi32(_mm_loadu_ps(f+x+4)), low);
+        __m128i c = _mm_and_si128(_mm_cvttps_epi32(_mm_loadu_ps(f+x+8)), low);
+        __m128i e = _mm_and_si128(_mm_cvttps_epi32(_mm_loadu_ps(f+x+12)), low);
+        _mm_storeu_si128((__m128i*)(d+x), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, e)));
+    }
+    floatToMonoTail(s, d, x, w);
+}
+
+TARGET_SSSE3 static void monoToFloatSSSE3(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m128i zero = _mm_setzero_si128();
+    float *f = (float*)d;
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s+x));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(f+x, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_ps(f+x+4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_ps(f+x+8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_ps(f+x+12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+    }
+    monoToFloatTail(s, d, x, w);
+}
+
+
+/*
+ * AVX2, 256 bit registers, for the conversions whose shuffles do not
+ * cross the two 128 bit halves.
+ */
+
+TARGET_AVX2 static void swap4AVX2(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m256i mask = _mm256_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15,
+                                          2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+    int x = 0;
+    for (; x+8<=w; x+=8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s+4*x));
+        _mm256_storeu_si256((__m256i*)(d+4*x), _mm256_shuffle_epi8(v, mask));
+    }
+    swap4Tail(s, d, x, w);
+}
+
+TARGET_AVX2 static void mono4AVX2(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    const __m256i spread = _mm256_set1_epi32(0x010101);
+    int x = 0;
+    for (; x+8<=w; x+=8) {
+        __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(s+x)));
+        _mm256_storeu_si256((__m256i*)(d+4*x), _mm256_or_si256(_mm256_mullo_epi32(v, spread), alpha));
+    }
+    mono4Tail(s, d, x, w);
+}
+
+TARGET_AVX2 static void mono16ToMonoAVX2(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m256i low = _mm256_set1_epi16(0xFF);
+    int x = 0;
+    for (; x+32<=w; x+=32) {
+        __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(s+2*x)), low);
+        __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(s+2*x+32)), low);
+        // packing works on each half, put the 64 bit groups back in order
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(d+x), p);
+    }
+    mono16ToMonoTail(s, d, x, w);
+}
+
+TARGET_AVX2 static void monoToMono16AVX2(const unsigned char *s, unsigned char *d, int w)
+{
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(s+x)));
+        _mm256_storeu_si256((__m256i*)(d+2*x), v);
+    }
+    monoToMono16Tail(s, d, x, w);
+}
+
+TARGET_AVX2 static void floatToMonoAVX2(const unsigned char *s, unsigned char *d, int w)
+{
+    const __m256i low = _mm256_set1_epi32(0xFF);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const float *f = (const float*)s;
+    int x = 0;
+    for (; x+32<=w; x+=32) {
+        __m256i a = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_loadu_ps(f+x)), low);
+        __m256i b = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_loadu_ps(f+x+8)), low);
+        __m256i c = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_loadu_ps(f+x+16)), low);
+        __m256i e = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_loadu_ps(f+x+24)), low);
+        __m256i p = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, e));
+        _mm256_storeu_si256((__m256i*)(d+x), _mm256_permutevar8x32_epi32(p, order));
+    }
+    floatToMonoTail(s, d, x, w);
+}
+
+TARGET_AVX2 static void monoToFloatAVX2(const unsigned char *s, unsigned char *d, int w)
+{
+    float *f = (float*)d;
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(s+x)));
+        __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(s+x+8)));
+        _mm256_storeu_ps(f+x, _mm256_cvtepi32_ps(a));
+        _mm256_storeu_ps(f+x+8, _mm256_cvtepi32_ps(b));
+    }
+    monoToFloatTail(s, d, x, w);
+}
+
+#endif // PIXEL_CONVERSION_X86
+
+
+#ifdef PIXEL_CONVERSION_NEON
+
+/*
+ * NEON, interleaved loads and stores of 16 pixels.
+ */
+
+static void swap3NEON(const unsigned char *s, unsigned char *d, int w)
+{
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x16x3_t v = vld3q_u8(s+3*x);
+        uint8x16_t t = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = t;
+        vst3q_u8(d+3*x, v);
+    }
+    swap3Tail(s, d, x, w);
+}
+
+static void expand3NEON(const unsigned char *s, unsigned char *d, int w)
+{
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x16x3_t v = vld3q_u8(s+3*x);
+        uint8x16x4_t o;
+        o.val[0] = v.val[0];
+        o.val[1] = v.val[1];
+        o.val[2] = v.val[2];
+        o.val[3] = vdupq_n_u8(255);
+        vst4q_u8(d+4*x, o);
+    }
+    expand3Tail(s, d, x, w);
+}
+
+static void expand3SwapNEON(const unsigned char *s, unsigned char *d, int w)
+{
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x16x3_t v = vld3q_u8(s+3*x);
+        uint8x16x4_t o;
+        o.val[0] = v.val[2];
+        o.val[1] = v.val[1];
+        o.val[2] = v.val[0];
+        o.val[3] = vdupq_n_u8(255);
+        vst4q_u8(d+4*x, o);
+    }
+    expand3SwapTail(s, d, x, w);
+}
+
+static void shrink4NEON(const unsigned char *s, unsigned char *d, int w)
+{
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x16x4_t v = vld4q_u8(s+4*x);
+        uint8x16x3_t o;
+        o.val[0] = v.val[0];
+        o.val[1] = v.val[1];
+        o.val[2] = v.val[2];
+        vst3q_u8(d+3*x, o);
+    }
+    shrink4Tail(s, d, x, w);
+}
+
+static void shrink4SwapNEON(const unsigned char *s, unsigned char *d, int w)
+{
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x16x4_t v = vld4q_u8(s+4*x);
+        uint8x16x3_t o;
+        o.val[0] = v.val[2];
+        o.val[1] = v.val[1];
+        o.val[2] = v.val[0];
+        vst3q_u8(d+3*x, o);
+    }
+    shrink4SwapTail(s, d, x, w);
+}
+
+static void swap4NEON(const unsigned char *s, unsigned char *d, int w)
+{
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x16x4_t v = vld4q_u8(s+4*x);
+        uint8x16_t t = v.val[0];
+        v.val[0] = v.val[2];
+        v.val[2] = t;
+        vst4q_u8(d+4*x, v);
+    }
+    swap4Tail(s, d, x, w);
+}
+
+static void mono3NEON(const unsigned char *s, unsigned char *d, int w)
+{
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x16x3_t o;
+        o.val[0] = o.val[1] = o.val[2] = vld1q_u8(s+x);
+        vst3q_u8(d+3*x, o);
+    }
+    mono3Tail(s, d, x, w);
+}
+
+static void mono4NEON(const unsigned char *s, unsigned char *d, int w)
+{
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x16x4_t o;
+        o.val[0] = o.val[1] = o.val[2] = vld1q_u8(s+x);
+        o.val[3] = vdupq_n_u8(255);
+        vst4q_u8(d+4*x, o);
+    }
+    mono4Tail(s, d, x, w);
+}
+
+static void mono16ToMonoNEON(const unsigned char *s, unsigned char *d, int w)
+{
+    const uint16_t *s16 = (const uint16_t*)s;
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x8_t a = vmovn_u16(vld1q_u16(s16+x));
+        uint8x8_t b = vmovn_u16(vld1q_u16(s16+x+8));
+        vst1q_u8(d+x, vcombine_u8(a, b));
+    }
+    mono16ToMonoTail(s, d, x, w);
+}
+
+static void monoToMono16NEON(const unsigned char *s, unsigned char *d, int w)
+{
+    uint16_t *d16 = (uint16_t*)d;
+    int x = 0;
+    for (; x+16<=w; x+=16) {
+        uint8x16_t v = vld1q_u8(s+x);
+        vst1q_u16(d16+x, vmovl_u8(vget_low_u8(v)));
+        vst1q_u16(d16+x+8, vmovl_u8(vget_high_u8(v)));
+    }
+    monoToMono16Tail(s, d, x, w);
+}
+
+#endif // PIXEL_CONVERSION_NEON
+
+
+namespace {
+
+struct Conversion
+{
+    int srcCode;
+    int destCode;
+    int srcSize;
+    int destSize;
+    RowFunction ssse3;
+    RowFunction avx2;
+    RowFunction neon;
+};
+
+}
+
+#if defined(PIXEL_CONVERSION_X86)
+#  define KERNELS(name, has_avx2, has_neon) name##SSSE3, has_avx2(name), YARP_NULLPTR
+#elif defined(PIXEL_CONVERSION_NEON)
+#  define KERNELS(name, has_avx2, has_neon) YARP_NULLPTR, YARP_NULLPTR, has_neon(name)
+#else
+#  define KERNELS(name, has_avx2, has_neon) YARP_NULLPTR, YARP_NULLPTR, YARP_NULLPTR
+#endif
+#define WITH_AVX2(name) name##AVX2
+#define WITH_NEON(name) name##NEON
+#define NONE(name) YARP_NULLPTR
+
+static const Conversion conversions[] = {
+    { VOCAB_PIXEL_RGB, VOCAB_PIXEL_BGR, 3, 3, KERNELS(swap3, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_BGR, VOCAB_PIXEL_RGB, 3, 3, KERNELS(swap3, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_RGB, VOCAB_PIXEL_RGBA, 3, 4, KERNELS(expand3, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_BGR, VOCAB_PIXEL_BGRA, 3, 4, KERNELS(expand3, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_RGB, VOCAB_PIXEL_BGRA, 3, 4, KERNELS(expand3Swap, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_BGR, VOCAB_PIXEL_RGBA, 3, 4, KERNELS(expand3Swap, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_RGBA, VOCAB_PIXEL_RGB, 4, 3, KERNELS(shrink4, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_BGRA, VOCAB_PIXEL_BGR, 4, 3, KERNELS(shrink4, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_RGBA, VOCAB_PIXEL_BGR, 4, 3, KERNELS(shrink4Swap, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_BGRA, VOCAB_PIXEL_RGB, 4, 3, KERNELS(shrink4Swap, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_RGBA, VOCAB_PIXEL_BGRA, 4, 4, KERNELS(swap4, WITH_AVX2, WITH_NEON) },
+    { VOCAB_PIXEL_BGRA, VOCAB_PIXEL_RGBA, 4, 4, KERNELS(swap4, WITH_AVX2, WITH_NEON) },
+    { VOCAB_PIXEL_RGB, VOCAB_PIXEL_MONO, 3, 1, KERNELS(gray3, NONE, NONE) },
+    { VOCAB_PIXEL_BGR, VOCAB_PIXEL_MONO, 3, 1, KERNELS(gray3, NONE, NONE) },
+    { VOCAB_PIXEL_RGBA, VOCAB_PIXEL_MONO, 4, 1, KERNELS(gray4, NONE, NONE) },
+    { VOCAB_PIXEL_BGRA, VOCAB_PIXEL_MONO, 4, 1, KERNELS(gray4, NONE, NONE) },
+    { VOCAB_PIXEL_MONO, VOCAB_PIXEL_RGB, 1, 3, KERNELS(mono3, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_MONO, VOCAB_PIXEL_BGR, 1, 3, KERNELS(mono3, NONE, WITH_NEON) },
+    { VOCAB_PIXEL_MONO, VOCAB_PIXEL_RGBA, 1, 4, KERNELS(mono4, WITH_AVX2, WITH_NEON) },
+    { VOCAB_PIXEL_MONO, VOCAB_PIXEL_BGRA, 1, 4, KERNELS(mono4, WITH_AVX2, WITH_NEON) },
+    { VOCAB_PIXEL_MONO16, VOCAB_PIXEL_MONO, 2, 1, KERNELS(mono16ToMono, WITH_AVX2, WITH_NEON) },
+    { VOCAB_PIXEL_MONO, VOCAB_PIXEL_MONO16, 1, 2, KERNELS(monoToMono16, WITH_AVX2, WITH_NEON) },
+    { VOCAB_PIXEL_MONO_FLOAT, VOCAB_PIXEL_MONO, 4, 1, KERNELS(floatToMono, WITH_AVX2, NONE) },
+    { VOCAB_PIXEL_MONO, VOCAB_PIXEL_MONO_FLOAT, 1, 4, KERNELS(monoToFloat, WITH_AVX2, NONE) }
+};
+
+
+static PixelConversion::InstructionSet detectInstructionSet()
+{
+#if defined(PIXEL_CONVERSION_X86)
+#  if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int leaves = info[0];
+    __cpuid(info, 1);
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    // AVX2 also needs the operating system to save the 256 bit registers
+    bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+               (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (avx && leaves >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#  else
+    __builtin_cpu_init();
+    bool ssse3 = __builtin_cpu_supports("ssse3") != 0;
+    bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#  endif
+    if (avx2) {
+        return PixelConversion::SIMD_AVX2;
+    }
+    return ssse3 ? PixelConversion::SIMD_SSSE3 : PixelConversion::SIMD_NONE;
+#elif defined(PIXEL_CONVERSION_NEON)
+    return PixelConversion::SIMD_NEON;
+#else
+    return PixelConversion::SIMD_NONE;
+#endif
+}
+
+
+static RowFunction findRowFunction(int srcCode, int destCode, const Conversion **found)
+{
+    int set = PixelConversion::getInstructionSet();
+    if (set==PixelConversion::SIMD_NONE) {
+        return YARP_NULLPTR;
+    }
+    for (size_t i=0; i<sizeof(conversions)/sizeof(conversions[0]); i++) {
+        const Conversion& c = conversions[i];
+        if (c.srcCode!=srcCode || c.destCode!=destCode) {
+            continue;
+        }
+        *found = &c;
+        if (set==PixelConversion::SIMD_NEON) {
+            return c.neon;
+        }
+        if (set==PixelConversion::SIMD_AVX2 && c.avx2!=YARP_NULLPTR) {
+            return c.avx2;
+        }
+        return c.ssse3;
+    }
+    return YARP_NULLPTR;
+}
+
+
+static void convertRows(RowFunction f,
+                        const unsigned char *src, int srcStep,
+                        unsigned char *dest, int destStep,
+                        int w, int y0, int y1)
+{
+    for (int y=y0; y<y1; y++) {
+        f(src + (ptrdiff_t)y*srcStep, dest + (ptrdiff_t)y*destStep, w);
+    }
+}
+
+
+bool PixelConversion::convert(const unsigned char *src, int srcCode, int srcQuantum,
+                              unsigned char *dest, int destCode, int destQuantum,
+                              int w, int h, bool flip)
+{
+    const Conversion *c = YARP_NULLPTR;
+    RowFunction f = findRowFunction(srcCode, destCode, &c);
+    if (f==YARP_NULLPTR) {
+        return false;
+    }
+
+    int srcStep = w*c->srcSize + PAD_BYTES(w*c->srcSize, srcQuantum);
+    int destStep = w*c->destSize + PAD_BYTES(w*c->destSize, destQuantum);
+    if (flip) {
+        dest += (ptrdiff_t)destStep*(h-1);
+        destStep = -destStep;
+    }
+
+    // a band of rows for each thread
+    int bands = ParallelBands::getBandCount((long)w*h*c->destSize, threadCount.load(), h);
+    ParallelBands::run(bands, [=](int i) {
+        convertRows(f, src, srcStep, dest, destStep, w,
+                    (int)((long)h*i/bands), (int)((long)h*(i+1)/bands));
+    });
+    return true;
+}
+
+
+bool PixelConversion::isVectorized(int srcCode, int destCode)
+{
+    const Conversion *c = YARP_NULLPTR;
+    return findRowFunction(srcCode, destCode, &c)!=YARP_NULLPTR;
+}
+
+
+PixelConversion::InstructionSet PixelConversion::getSupportedInstructionSet()
+{
+    static const InstructionSet supported = detectInstructionSet();
+    return supported;
+}
+
+
+void PixelConversion::setInstructionSet(InstructionSet set)
+{
+    InstructionSet supported = getSupportedInstructionSet();
+    if (set==SIMD_NONE || supported==SIMD_NONE) {
+        instructionSet = SIMD_NONE;
+    } else if (supported==SIMD_NEON || set==SIMD_NEON) {
+        instructionSet = supported;
+    } else {
+        instructionSet = std::min(set, supported);
+    }
+}
+
+
+PixelConversion::InstructionSet PixelConversion::getInstructionSet()
+{
+    int set = instructionSet.load();
+    if (set<0) {
+        set = getSupportedInstructionSet();
+        instructionSet = set;
+    }
+    return (InstructionSet)set;
+}
+
+
+const char *PixelConversion::getInstructionSetName(InstructionSet set)
+{
+    switch (set) {
+    case SIMD_SSSE3: return "SSSE3";
+    case SIMD_AVX2: return "AVX2";
+    case SIMD_NEON: return "NEON";
+    default: return "none";
+    }
+}
+
+
+void PixelConversion::setThreads(int threads)
+{
+    threadCount = (threads>0) ? threads : 0;
+}
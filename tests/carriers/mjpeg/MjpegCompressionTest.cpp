@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/os/Network.h>
+#include <yarp/os/ManagedBytes.h>
+#include <yarp/os/Route.h>
+#include <yarp/os/impl/BufferedConnectionWriter.h>
+#include <yarp/os/impl/FakeTwoWayStream.h>
+#include <yarp/os/impl/Protocol.h>
+#include <yarp/os/impl/UnitTest.h>
+#include <yarp/sig/Image.h>
+
+#include <MjpegCarrier.h>
+#include <MjpegCompression.h>
+#include <MjpegDecompression.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace yarp::os;
+using namespace yarp::os::impl;
+using namespace yarp::sig;
+using namespace yarp::mjpeg;
+
+class MjpegCompressionTest : public UnitTest {
+public:
+    virtual ConstString getName() override { return "MjpegCompressionTest"; }
+
+    // a smooth pattern, that the encoder reproduces closely
+    void makeImage(FlexImage& img, int code, int w, int h) {
+        img.setPixelCode(code);
+        img.setPixelSize((code==VOCAB_PIXEL_MONO)?1:3);
+        img.resize(w,h);
+        for (int y=0; y<h; y++) {
+            unsigned char *row = img.getRow(y);
+            for (int x=0; x<w*img.getPixelSize(); x++) {
+                int c = x%img.getPixelSize();
+                row[x] = (unsigned char)((x/img.getPixelSize())/5+y/4+c*60);
+            }
+        }
+    }
+
+    bool encode(MjpegCompression& compression, const Image& img,
+                ManagedBytes& jpeg) {
+        Bytes data;
+        if (!compression.compress(img, "", data)) {
+            return false;
+        }
+        jpeg.allocate(data.length());
+        memcpy(jpeg.get(), data.get(), data.length());
+        return true;
+    }
+
+    bool decode(ManagedBytes& jpeg, ImageOf<PixelRgb>& img) {
+        MjpegDecompression decompression;
+        return decompression.decompress(jpeg.bytes(), img);
+    }
+
+    bool sameImage(const Image& a, const Image& b) {
+        if (a.width()!=b.width() || a.height()!=b.height()) {
+            return false;
+        }
+        for (int y=0; y<a.height(); y++) {
+            if (memcmp(a.getRow(y), b.getRow(y), a.width()*a.getPixelSize())!=0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // the restart markers after each band, in order
+    ConstString restartMarkers(const ManagedBytes& jpeg) {
+        ConstString markers;
+        const unsigned char *data = (const unsigned char *)jpeg.get();
+        for (size_t i=0; i+1<jpeg.length(); i++) {
+            if (data[i]==0xFF && data[i+1]>=0xD0 && data[i+1]<=0xD7) {
+                markers += (char)('0'+(data[i+1]-0xD0));
+            }
+        }
+        return markers;
+    }
+
+    bool hasMarker(const ManagedBytes& jpeg, unsigned char marker) {
+        const unsigned char *data = (const unsigned char *)jpeg.get();
+        for (size_t i=0; i+1<jpeg.length(); i++) {
+            if (data[i]==0xFF && data[i+1]==marker) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int frameHeight(const ManagedBytes& jpeg) {
+        const unsigned char *data = (const unsigned char *)jpeg.get();
+        for (size_t i=0; i+6<jpeg.length(); i++) {
+            if (data[i]==0xFF && data[i+1]==0xC0) {
+                return (data[i+5]<<8)|data[i+6];
+            }
+        }
+        return -1;
+    }
+
+    void checkBands(int code, int w, int h, int subsampling) {
+        char buf[256];
+        sprintf(buf, "compressing a %dx%d %s image in bands, subsampling %d",
+                w, h, (code==VOCAB_PIXEL_MONO)?"mono":"rgb", subsampling);
+        report(0, buf);
+        FlexImage img;
+        makeImage(img, code, w, h);
+
+        MjpegCompression single;
+        single.setThreads(1);
+        single.setSubsampling(subsampling);
+        ManagedBytes reference;
+        ImageOf<PixelRgb> expected;
+        checkTrue(encode(single, img, reference), "single band compressed");
+        checkFalse(hasMarker(reference, 0xDD), "no restart interval in a single band");
+        checkTrue(decode(reference, expected), "single band decompressed");
+        checkEqual(expected.height(), h, "single band height");
+
+        // one band per MCU row less than the threads on an odd height
+        int mcuHeight = (code==VOCAB_PIXEL_MONO || subsampling!=420) ? 8 : 16;
+        int mcuRows = (h+mcuHeight-1)/mcuHeight;
+        for (int threads=2; threads<=4; threads++) {
+            MjpegCompression compression;
+            compression.setThreads(threads);
+            compression.setSubsampling(subsampling);
+            ManagedBytes jpeg;
+            ImageOf<PixelRgb> result;
+            checkTrue(encode(compression, img, jpeg), "bands compressed");
+            int bandRows = (mcuRows+threads-1)/threads;
+            int bands = (mcuRows+bandRows-1)/bandRows;
+            ConstString markers = restartMarkers(jpeg);
+            ConstString expectedMarkers;
+            for (int i=1; i<bands; i++) {
+                expectedMarkers += (char)('0'+(i-1)%8);
+            }
+            checkEqual(markers, expectedMarkers, "restart markers numbered between the bands");
+            checkTrue(hasMarker(jpeg, 0xDD), "restart interval defined");
+            checkEqual(frameHeight(jpeg), h, "frame height of the joined image");
+            checkTrue(decode(jpeg, result), "bands decompressed");
+            checkTrue(sameImage(result, expected), "bands decompress as a single band");
+        }
+    }
+
+    void testBands() {
+        // larger than 1MB, with heights that are no multiple of the bands
+        checkBands(VOCAB_PIXEL_RGB, 640, 547, 420);
+        checkBands(VOCAB_PIXEL_RGB, 640, 547, 422);
+        checkBands(VOCAB_PIXEL_RGB, 640, 547, 444);
+        checkBands(VOCAB_PIXEL_MONO, 1100, 1001, 420);
+    }
+
+    void testMono() {
+        report(0, "compressing a mono image");
+        FlexImage img;
+        makeImage(img, VOCAB_PIXEL_MONO, 320, 241);
+        MjpegCompression compression;
+        ManagedBytes jpeg;
+        ImageOf<PixelRgb> result;
+        checkTrue(encode(compression, img, jpeg), "mono compressed");
+        checkTrue(decode(jpeg, result), "mono decompressed");
+        checkEqual(result.width(), 320, "mono width");
+        checkEqual(result.height(), 241, "mono height");
+        int error = 0;
+        bool gray = true;
+        for (int y=0; y<result.height(); y++) {
+            unsigned char *src = img.getRow(y);
+            for (int x=0; x<result.width(); x++) {
+                PixelRgb& p = result.pixel(x,y);
+                gray = gray && p.r==p.g && p.g==p.b;
+                error = std::max(error, abs(p.g-src[x]));
+            }
+        }
+        checkTrue(gray, "mono decompressed as gray");
+        checkTrue(error<8, "mono close to the original");
+    }
+
+    void testParameters() {
+        report(0, "checking the compression parameters");
+        FlexImage img;
+        makeImage(img, VOCAB_PIXEL_RGB, 320, 240);
+
+        MjpegCompression defaults;
+        ManagedBytes reference;
+        checkTrue(encode(defaults, img, reference), "default compressed");
+
+        MjpegCompression compression;
+        ManagedBytes jpeg;
+        compression.setQuality(20);
+        checkTrue(encode(compression, img, jpeg), "quality 20 compressed");
+        checkTrue(jpeg.length()<reference.length(), "lower quality, smaller image");
+        compression.setQuality(75);
+        compression.setSubsampling(444);
+        checkTrue(encode(compression, img, jpeg), "subsampling 444 compressed");
+        checkTrue(jpeg.length()>reference.length(), "less subsampling, larger image");
+
+        compression.setSubsampling(411);
+        checkTrue(encode(compression, img, jpeg), "subsampling 411 compressed");
+        checkTrue(jpeg.length()>reference.length(), "unknown subsampling ignored");
+        compression.setSubsampling(420);
+        checkTrue(encode(compression, img, jpeg), "subsampling 420 compressed");
+        checkEqual(jpeg.length(), reference.length(), "back to the default subsampling");
+
+        ManagedBytes best;
+        compression.setQuality(100);
+        checkTrue(encode(compression, img, best), "quality 100 compressed");
+        compression.setQuality(1000);
+        checkTrue(encode(compression, img, jpeg), "quality 1000 compressed");
+        checkEqual(jpeg.length(), best.length(), "quality limited to 100");
+        compression.setQuality(75);
+        compression.setThreads(-1);
+        checkTrue(encode(compression, img, jpeg), "threads -1 compressed");
+        checkEqual(jpeg.length(), reference.length(), "threads -1 as the default");
+    }
+
+    ConstString sendHeader(const char *carrierName) {
+        FakeTwoWayStream *fake = new FakeTwoWayStream();
+        Protocol proto(fake);
+        proto.setRoute(Route("/in", "/out", carrierName));
+        MjpegCarrier carrier;
+        carrier.sendHeader(proto);
+        ConstString request = fake->getOutputText();
+        size_t end = request.find('\n');
+        return request.substr(0, end);
+    }
+
+    void testRequest() {
+        report(0, "checking the compression parameters of mjpeg requests");
+        checkEqual(sendHeader("mjpeg"), "GET /?action=stream",
+                   "default request");
+        checkEqual(sendHeader("mjpeg+quality.30+subsampling.444+threads.2"),
+                   "GET /?action=stream&quality=30&subsampling=444&threads=2",
+                   "request with parameters");
+        checkEqual(sendHeader("mjpeg+path.video.cgi+quality.30"),
+                   "GET /video.cgi?quality=30 HTTP/1.1",
+                   "parameters after a path");
+        checkEqual(sendHeader("mjpeg+path.video.cgi?resolution=320x240+quality.30"),
+                   "GET /video.cgi?resolution=320x240&quality=30 HTTP/1.1",
+                   "parameters after the query of a path");
+
+        // the sender compresses as requested
+        FlexImage img;
+        makeImage(img, VOCAB_PIXEL_RGB, 320, 240);
+        MjpegCompression compression;
+        compression.setQuality(30);
+        compression.setSubsampling(444);
+        ManagedBytes expected;
+        checkTrue(encode(compression, img, expected), "compressed as requested");
+
+        FakeTwoWayStream *fake = new FakeTwoWayStream();
+        Protocol proto(fake);
+        // what follows the "GET /?ac" header
+        fake->addInputText("tion=stream&quality=30&subsampling=444 HTTP/1.1\r\n\r\n");
+        MjpegCarrier carrier;
+        checkTrue(carrier.expectExtraHeader(proto), "request read");
+        BufferedConnectionWriter writer;
+        img.write(writer);
+        checkTrue(carrier.write(proto, writer), "image sent");
+        ConstString sent = fake->getOutputText();
+        checkTrue(sent.find(ConstString(expected.get(), expected.length()))!=ConstString::npos,
+                  "image compressed with the requested parameters");
+    }
+
+    virtual void runTests() override {
+        testBands();
+        testMono();
+        testParameters();
+        testRequest();
+    }
+};
+
+int main(int argc, char *argv[]) {
+    Network yarp;
+    UnitTest::startTestSystem();
+    MjpegCompressionTest test;
+    UnitTest::getRoot().add(test);
+    int result = UnitTest::getRoot().run();
+    UnitTest::stopTestSystem();
+    return result;
+}
@@ -639,6 +639,58 @@ public:
         checkEqual(s3.getCount(),42,"bottle-to-stamp ok");
     }
 
+    void testFlatStorage() {
+        report(0,"test flat element storage against per-element storage");
+        bool flat = BottleImpl::getFlatStorage();
+        ConstString wire[2];
+        for (int k=0; k<2; k++) {
+            BottleImpl::setFlatStorage(k==0);
+            Bottle b;
+            b.addInt(42);
+            b.addDouble(2.5);
+            b.addString("hello");
+            b.addVocab(VOCAB3('s','e','t'));
+            b.addInt64(1234567890123LL);
+            Bottle& lst = b.addList();
+            lst.addDouble(1.0);
+            lst.addDouble(-2.0);
+            b.addList().addString("nested");
+            size_t len = 0;
+            const char *data = b.toBinary(&len);
+            wire[k] = ConstString(data, len);
+        }
+        BottleImpl::setFlatStorage(flat);
+        checkTrue(wire[0]==wire[1], "same serialization with both layouts");
+
+        Bottle b;
+        b.fromBinary(wire[0].c_str(), (int)wire[0].length());
+        size_t len = 0;
+        const char *data = b.toBinary(&len);
+        checkTrue(ConstString(data,len)==wire[0], "unmodified bottle sent as received");
+        checkEqual(b.toString(), "42 2.5 hello [set] 1234567890123 (1.0 -2.0) (nested)",
+                   "read back from binary");
+        data = b.toBinary(&len);
+        checkTrue(ConstString(data,len)==wire[0], "bottle sent as received after reading its elements");
+
+        Bottle b2;
+        b2.fromBinary(wire[0].c_str(), (int)wire[0].length());
+        b2.get(0) = Value(7);
+        b2.get(5).asList()->addDouble(3.0);
+        data = b2.toBinary(&len);
+        b.fromBinary(data, (int)len);
+        checkEqual(b.get(0).asInt(), 7, "change after read is sent");
+        checkEqual(b.get(5).asList()->size(), 3, "nested change after read is sent");
+
+        Bottle b3 = b2;
+        checkEqual(b3.toString(), b2.toString(), "copy of a received bottle");
+        Value v = b3.pop();
+        checkTrue(v.isList() && v.asList()->get(0).asString()=="nested", "pop of a received list");
+        checkTrue(b3.get(4).isInt64(), "type kept");
+        b3.clear();
+        b3.addDouble(1.5);
+        checkEqualish(b3.get(0).asDouble(), 1.5, "bottle reused after clear");
+    }
+
     virtual void runTests() override {
         testClear();
         testSize();
@@ -675,6 +727,7 @@ public:
         testLoopBug();
         testManyMinus();
         testCopyPortable();
+        testFlatStorage();
     }
 
     virtual ConstString getName() override {
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/os/Bottle.h>
+#include <yarp/os/BottleView.h>
+#include <yarp/os/DummyConnector.h>
+#include <yarp/os/Portable.h>
+#include <yarp/os/Property.h>
+#include <yarp/os/Vocab.h>
+
+#include <yarp/os/impl/UnitTest.h>
+
+using namespace yarp::os::impl;
+using namespace yarp::os;
+
+class BottleViewTest : public UnitTest
+{
+public:
+    virtual ConstString getName() override { return "BottleViewTest"; }
+
+    void makeState(Bottle& b)
+    {
+        b.clear();
+        b.addInt(42);
+        b.addDouble(2.5);
+        b.addString("hello");
+        b.addVocab(VOCAB3('s','e','t'));
+        b.addInt64(1234567890123LL);
+        Bottle& joints = b.addList();
+        for (int i=0; i<5; i++) {
+            joints.addDouble(i*0.5);
+        }
+        Bottle& nested = b.addList();
+        nested.addString("deep");
+        nested.addList().addInt(7);
+        b.addDict().put("key", 15);
+    }
+
+    void checkRead()
+    {
+        report(0, "checking elements are read on demand...");
+        Bottle b;
+        makeState(b);
+        BottleView view;
+        checkTrue(Portable::copyPortable(b, view), "view read ok");
+        checkEqual(view.size(), 8, "size ok");
+        checkTrue(view.isInt(0), "int type ok");
+        checkEqual(view.getInt(0), 42, "int ok");
+        checkTrue(view.isDouble(1), "double type ok");
+        checkEqualish(view.getDouble(1), 2.5, "double ok");
+        checkEqual(view.getDouble(0), 42.0, "int read as double ok");
+        checkTrue(view.isString(2), "string type ok");
+        checkEqual(view.getString(2), "hello", "string ok");
+        checkEqual(view.getCode(3), BOTTLE_TAG_VOCAB, "vocab type ok");
+        checkEqual(view.getInt(3), VOCAB3('s','e','t'), "vocab ok");
+        checkTrue(view.getInt64(4) == 1234567890123LL, "int64 ok");
+        checkTrue(view.isList(5), "list type ok");
+        checkFalse(view.isList(0), "int is not a list");
+        checkTrue(view.isDict(7), "dict type ok");
+        checkFalse(view.isList(7), "dict is not a list");
+        checkEqual(view.getCode(8), 0, "no element past the end");
+        checkEqual(view.getInt(-1), 0, "no element before the start");
+
+        BottleView joints = view.getList(5);
+        checkEqual(joints.size(), 5, "nested homogeneous list size ok");
+        checkEqualish(joints.getDouble(4), 2.0, "nested homogeneous list ok");
+        BottleView nested = view.getList(6);
+        checkEqual(nested.size(), 2, "nested list size ok");
+        checkEqual(nested.getString(0), "deep", "nested string ok");
+        checkEqual(nested.getList(1).getInt(0), 7, "doubly nested int ok");
+        BottleView dict = view.getList(7);
+        checkEqual(dict.toString(), "(key 15)", "dict ok");
+        checkEqual(view.getList(0).size(), 0, "int has no nested list");
+
+        Value v = view.get(6);
+        checkTrue(v.isList(), "decoded list ok");
+        checkEqual(v.toString(), "deep (7)", "decoded list content ok");
+        checkEqual(view.get(2).asString(), "hello", "decoded string ok");
+        checkTrue(view.get(8).isNull(), "decoded missing element is null");
+    }
+
+    void checkPromote()
+    {
+        report(0, "checking a view can become a bottle...");
+        Bottle b;
+        makeState(b);
+        BottleView view;
+        Portable::copyPortable(b, view);
+        Bottle full;
+        checkTrue(view.toBottle(full), "promotion ok");
+        checkEqual(full.toString(), b.toString(), "promoted bottle ok");
+        checkEqual(view.toString(), b.toString(), "text form ok");
+
+        Bottle part;
+        checkTrue(view.getList(6).toBottle(part), "nested promotion ok");
+        checkEqual(part.toString(), b.get(6).asList()->toString(),
+                   "promoted nested bottle ok");
+    }
+
+    void checkWrite()
+    {
+        report(0, "checking a view is written as received...");
+        Bottle b;
+        makeState(b);
+        BottleView view;
+        Portable::copyPortable(b, view);
+        Bottle out;
+        checkTrue(Portable::copyPortable(view, out), "write ok");
+        checkEqual(out.toString(), b.toString(), "round trip ok");
+
+        BottleView joints = view.getList(5);
+        checkTrue(Portable::copyPortable(joints, out), "nested write ok");
+        checkEqual(out.toString(), "0.0 0.5 1.0 1.5 2.0", "nested round trip ok");
+
+        BottleView empty;
+        checkTrue(Portable::copyPortable(empty, out), "empty write ok");
+        checkEqual(out.size(), 0, "empty round trip ok");
+    }
+
+    void checkCopy()
+    {
+        report(0, "checking views can be copied...");
+        Bottle b;
+        makeState(b);
+        BottleView copy;
+        {
+            BottleView view;
+            Portable::copyPortable(b, view);
+            view.getString(2);
+            copy = view;
+        }
+        checkEqual(copy.getString(2), "hello", "copy keeps its data");
+        checkEqual(copy.getList(6).getString(0), "deep", "copy keeps nested data");
+        BottleView again(copy);
+        copy.clear();
+        checkEqual(copy.size(), 0, "clear ok");
+        checkEqual(again.getInt(0), 42, "copy constructor ok");
+    }
+
+    void checkText()
+    {
+        report(0, "checking text mode...");
+        DummyConnector dummy;
+        dummy.setTextMode(true);
+        Bottle b("10 \"text\" (1 2)");
+        b.write(dummy.getWriter());
+        BottleView view;
+        checkTrue(view.read(dummy.getReader()), "text read ok");
+        checkEqual(view.size(), 3, "text size ok");
+        checkEqual(view.getString(1), "text", "text string ok");
+        checkEqual(view.getList(2).getInt(1), 2, "text list ok");
+
+        dummy.setTextMode(true);
+        view.write(dummy.getCleanWriter());
+        Bottle back;
+        back.read(dummy.getReader());
+        checkEqual(back.toString(), b.toString(), "text write ok");
+    }
+
+    void checkMalformed()
+    {
+        report(0, "checking malformed data is refused...");
+        Bottle b;
+        makeState(b);
+        size_t len = 0;
+        const char *data = b.toBinary(&len);
+        BottleView view;
+        checkTrue(view.fromBinary(data, len), "well-formed data accepted");
+        checkFalse(view.fromBinary(data, len-1), "truncated data refused");
+        checkEqual(view.size(), 0, "refused data leaves view empty");
+        checkFalse(view.fromBinary(data, 3), "short data refused");
+    }
+
+    virtual void runTests() override
+    {
+        checkRead();
+        checkPromote();
+        checkWrite();
+        checkCopy();
+        checkText();
+        checkMalformed();
+    }
+};
+
+static BottleViewTest theBottleViewTest;
+
+UnitTest& getBottleViewTest()
+{
+    return theBottleViewTest;
+}
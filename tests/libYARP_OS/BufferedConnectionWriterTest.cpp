@@ -7,9 +7,11 @@
 
 #include <yarp/os/DummyConnector.h>
 #include <yarp/os/Stamp.h>
+#include <yarp/os/Property.h>
 #include <yarp/os/PortablePair.h>
 #include <yarp/os/StringOutputStream.h>
 #include <yarp/os/impl/BufferedConnectionWriter.h>
+#include <yarp/os/impl/BlockPool.h>
 #include <yarp/os/impl/UnitTest.h>
 #include <yarp/sig/Image.h>
 
@@ -155,9 +157,46 @@ public:
         }
     }
 
+    void testBlockPool() {
+        report(0,"test writers drawing memory from a block pool...");
+        BlockPool pool;
+        ConstString big(100000,'x');
+        char ext[4] = {0, 0, 0, 0};
+        for (int i=0; i<3; i++) {
+            StringOutputStream sos;
+            BufferedConnectionWriter bbr;
+            bbr.setBlockPool(&pool);
+            bbr.appendLine("Hello");
+            bbr.appendLine("Greetings");
+            bbr.appendExternalBlock(ext, 4);
+            bbr.appendLine(big);
+            bbr.write(sos);
+            ConstString expect = ConstString("Hello\r\nGreetings\r\n") +
+                ConstString(4,'\0') + big + "\r\n";
+            checkTrue(sos.toString()==expect,"content written");
+            if (i==0) {
+                checkTrue(pool.getMisses()>0,"first writer allocates");
+                checkEqual((int)pool.getHits(),0,"nothing to reuse yet");
+                pool.resetCounters();
+            }
+        }
+        checkTrue(pool.getHits()>0,"later writers reuse blocks");
+        checkEqual((int)pool.getMisses(),2,"only oversized blocks allocated");
+        checkTrue(pool.getCachedBytes()>0,"blocks cached");
+
+        Property stats;
+        pool.getStats(stats);
+        checkEqual(stats.find("hits").asInt(),(int)pool.getHits(),"stats hits");
+        checkEqual(stats.find("unpooled").asInt(),2,"stats unpooled");
+
+        pool.clear();
+        checkEqual((int)pool.getCachedBytes(),0,"pool cleared");
+    }
+
     virtual void runTests() override {
         testWrite();
         testRestart();
+        testBlockPool();
     }
 };
 
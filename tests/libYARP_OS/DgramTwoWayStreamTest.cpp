@@ -10,7 +10,20 @@
 #include <yarp/os/ConstString.h>
 #include <yarp/os/impl/UnitTest.h>
 #include <yarp/os/NetType.h>
+#include <yarp/os/SystemClock.h>
 #include <cstdio>
+#include <cstring>
+#include <deque>
+
+#ifndef YARP_HAS_ACE
+#  include <atomic>
+#  include <thread>
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <poll.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
@@ -112,6 +125,140 @@ public:
 };
 
 
+class LossyDgram : public DgramTwoWayStream {
+public:
+    std::deque<ManagedBytes> inbox;
+    std::deque<ManagedBytes> outbox;
+    LossyDgram *writer;
+
+    LossyDgram() {
+        writer = YARP_NULLPTR;
+    }
+
+    virtual void onMonitorInput() override {
+        removeMonitor();
+        if (inbox.empty() && writer!=YARP_NULLPTR && !outbox.empty()) {
+            // pass our requests to the writer, and let it answer them
+            // as it would while sending its next message
+            move(outbox, writer->inbox, -1);
+            writer->beginPacket();
+            writer->endPacket();
+            move(writer->outbox, inbox, -1);
+        }
+        if (!inbox.empty()) {
+            setMonitor(inbox.front().bytes());
+            inbox.pop_front();
+        }
+    }
+
+    virtual void onMonitorOutput() override {
+        ManagedBytes data(getMonitor(), false);
+        data.copy();
+        outbox.push_back(data);
+        removeMonitor();
+    }
+
+    static void move(std::deque<ManagedBytes>& from,
+                     std::deque<ManagedBytes>& to,
+                     int skip) {
+        for (int i=0; !from.empty(); i++) {
+            if (i!=skip) {
+                to.push_back(from.front());
+            }
+            from.pop_front();
+        }
+    }
+};
+
+
+#ifndef YARP_HAS_ACE
+/**
+ * Passes datagrams between a writer and a reader on the loopback
+ * interface, dropping one datagram sent by the writer.
+ */
+class DgramRelay {
+public:
+    int fd;
+    int port;
+    int drop;
+    int count;
+    bool haveWriter;
+    struct sockaddr_in writerAddr;
+    struct sockaddr_in readerAddr;
+    std::atomic<bool> running;
+    std::thread thread;
+
+    DgramRelay() : fd(-1), port(-1), drop(-1), count(0), haveWriter(false), running(false) {}
+
+    bool open(int readerPort, int dropIndex) {
+        fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (fd<0) {
+            return false;
+        }
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr))!=0 ||
+            getsockname(fd, (struct sockaddr *)&addr, &len)!=0) {
+            return false;
+        }
+        port = ntohs(addr.sin_port);
+        readerAddr = addr;
+        readerAddr.sin_port = htons(readerPort);
+        drop = dropIndex;
+        running = true;
+        thread = std::thread(&DgramRelay::run, this);
+        return true;
+    }
+
+    void run() {
+        static char buf[65536];
+        while (running) {
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, 50)<=0) {
+                continue;
+            }
+            struct sockaddr_in from;
+            socklen_t len = sizeof(from);
+            YARP_SSIZE_T n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &len);
+            if (n<0) {
+                continue;
+            }
+            if (from.sin_port==readerAddr.sin_port) {
+                // a request from the reader
+                if (haveWriter) {
+                    sendto(fd, buf, n, 0, (struct sockaddr *)&writerAddr, sizeof(writerAddr));
+                }
+                continue;
+            }
+            writerAddr = from;
+            haveWriter = true;
+            if (count++!=drop) {
+                sendto(fd, buf, n, 0, (struct sockaddr *)&readerAddr, sizeof(readerAddr));
+            }
+        }
+    }
+
+    void close() {
+        if (thread.joinable()) {
+            running = false;
+            thread.join();
+        }
+        if (fd>=0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+};
+#endif
+
+
 class DgramTwoWayStreamTest : public UnitTest {
 public:
     virtual ConstString getName() override { return "DgramTwoWayStreamTest"; }
@@ -255,8 +402,140 @@ public:
         }
     }
 
+    void sendMessage(DgramTwoWayStream& out, ManagedBytes& msg) {
+        out.beginPacket();
+        out.write(msg.bytes());
+        out.flush();
+        out.endPacket();
+    }
+
+    bool readMessage(DgramTwoWayStream& in, ManagedBytes& msg) {
+        ManagedBytes recv(msg.length());
+        memset(recv.get(), 0, recv.length());
+        in.beginPacket();
+        YARP_SSIZE_T len = in.readFull(recv.bytes());
+        in.endPacket();
+        return len==(YARP_SSIZE_T)msg.length() &&
+            memcmp(recv.get(), msg.get(), msg.length())==0;
+    }
+
+    void checkRecovery() {
+        report(0, "checking lost dgrams can be rebuilt from parity");
+
+        int sz = 100;
+        ManagedBytes msg(1000);
+        for (size_t i=0; i<msg.length(); i++) {
+            msg.get()[i] = (char)(i%251);
+        }
+
+        DgramTest out;
+        out.openMonitor(sz,sz);
+        out.setRecovery(4,0);
+        sendMessage(out, msg);
+        sendMessage(out, msg);
+        // 72 bytes per fragment, so 14 fragments, each group of 4
+        // followed by a parity dgram
+        checkEqual(out.size(),36,"right number of dgrams");
+
+        for (int problem=0; problem<6; problem++) {
+            // a fresh reader each time, since replayed messages would
+            // be taken for stale ones
+            DgramTest in;
+            in.openMonitor(sz,sz);
+            in.copyMonitor(out);
+
+            switch (problem) {
+            case 0:
+                checkTrue(readMessage(in, msg),"intact message ok");
+                break;
+            case 1:
+                in.corruptDrop(1);
+                checkTrue(readMessage(in, msg),"message with a dropped dgram ok");
+                break;
+            case 2:
+                in.corruptDrop(16);
+                checkTrue(readMessage(in, msg),"message with its last dgram dropped ok");
+                break;
+            case 3:
+                in.corrupt(6,20);
+                checkTrue(readMessage(in, msg),"message with a corrupted dgram ok");
+                break;
+            case 4:
+                in.corruptSwap(1,2);
+                in.corruptSwap(5,4);
+                checkTrue(readMessage(in, msg),"message with dgrams out of order ok");
+                break;
+            case 5:
+                in.corruptDrop(1);
+                in.corruptDrop(1);
+                checkFalse(readMessage(in, msg),"two drops in a group are too many");
+                break;
+            };
+            checkTrue(readMessage(in, msg),"following message ok");
+        }
+
+
+        report(0, "checking lost dgrams can be asked for again");
+
+        LossyDgram writer;
+        writer.openMonitor(sz,sz);
+        writer.setRecovery(0,0.05);
+        LossyDgram reader;
+        reader.openMonitor(sz,sz);
+        reader.setRecovery(0,0.05);
+        reader.writer = &writer;
+
+        sendMessage(writer, msg);
+        checkEqual((int)writer.outbox.size(),14,"right number of dgrams");
+        LossyDgram::move(writer.outbox, reader.inbox, 3);
+        checkTrue(readMessage(reader, msg),"dgram lost in the middle resent");
+
+        sendMessage(writer, msg);
+        LossyDgram::move(writer.outbox, reader.inbox, 13);
+        checkTrue(readMessage(reader, msg),"last dgram resent");
+
+        sendMessage(writer, msg);
+        LossyDgram::move(writer.outbox, reader.inbox, -1);
+        checkTrue(readMessage(reader, msg),"intact message ok");
+    }
+
+    void checkLostTail() {
+#ifndef YARP_HAS_ACE
+        report(0, "checking the lost end of the last message is sent again");
+
+        ManagedBytes msg(150000);
+        for (size_t i=0; i<msg.length(); i++) {
+            msg.get()[i] = (char)(i%251);
+        }
+
+        DgramTwoWayStream reader;
+        checkTrue(reader.open(Contact(), Contact("127.0.0.1", 0)), "reader open");
+        reader.setRecovery(0, 0.1);
+        DgramRelay relay;
+        // three datagrams at most 65507 bytes long, drop the third
+        checkTrue(relay.open(reader.getLocalAddress().getPort(), 2), "relay open");
+        DgramTwoWayStream writer;
+        checkTrue(writer.open(Contact("127.0.0.1", 0), Contact("127.0.0.1", relay.port)),
+                  "writer open");
+        writer.setRecovery(0, 0.1);
+
+        // nothing else is written after this message
+        sendMessage(writer, msg);
+        double start = SystemClock::nowSystem();
+        checkTrue(readMessage(reader, msg), "last dgram resent without another message");
+        checkTrue(SystemClock::nowSystem()-start<1.0, "resent within the window");
+        checkEqual(relay.count, 4, "three dgrams and the one resent");
+
+        writer.close();
+        relay.close();
+        reader.close();
+#endif
+    }
+
     virtual void runTests() override {
         checkNormal();
+        checkRecovery();
+        checkLostTail();
     }
 };
 
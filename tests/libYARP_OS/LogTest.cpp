@@ -7,9 +7,20 @@
 
 
 #include <yarp/os/Log.h>
-
+#include <yarp/os/Bottle.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Network.h>
+#include <yarp/os/Port.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/Semaphore.h>
+#include <yarp/os/Time.h>
+
+#include <yarp/os/impl/LogForwarder.h>
 #include <yarp/os/impl/UnitTest.h>
 
+#include <cstdio>
+#include <vector>
+
 
 class LogTest : public yarp::os::impl::UnitTest {
 public:
@@ -43,8 +54,96 @@ public:
 
     }
 
+    /*
+     * A logger that holds the first message it gets, so that the ones
+     * forwarded meanwhile pile up.
+     */
+    class BlockedLogger : public yarp::os::PortReader {
+    public:
+        yarp::os::Semaphore received;   // posted at each message
+        yarp::os::Semaphore release;    // waited for by the first message
+        yarp::os::Mutex mutex;
+        std::vector<yarp::os::Bottle> messages;
+
+        BlockedLogger() : received(0), release(0) {}
+
+        virtual bool read(yarp::os::ConnectionReader& connection) override {
+            yarp::os::Bottle b;
+            if (!b.read(connection)) {
+                return false;
+            }
+            mutex.lock();
+            messages.push_back(b);
+            bool first = (messages.size()==1);
+            mutex.unlock();
+            received.post();
+            if (first) {
+                release.wait();
+            }
+            return true;
+        }
+    };
+
+    void checkForward() {
+        report(0, "checking log forwarding...");
+        yarp::os::Network::setLocalMode(true);
+        BlockedLogger reader;
+        yarp::os::Port logger;
+        logger.setReader(reader);
+        logger.open("/yarplogger");
+
+        yarp::os::LogForwarder *forwarder = yarp::os::LogForwarder::getInstance();
+        int total = 200;
+        forwarder->forward("[INFO] line 0\n");
+        // the sender now waits for the logger to take the first message
+        reader.received.wait();
+        for (int i=1; i<total; i++) {
+            char line[100];
+            sprintf(line, "[INFO] line %d\n", i);
+            forwarder->forward(line);
+        }
+        reader.release.post();
+
+        int lines = 0;
+        bool ordered = true;
+        bool header = true;
+        size_t messages = 0;
+        while (lines<total && reader.received.waitWithTimeout(10)) {
+            reader.mutex.lock();
+            for (; messages<reader.messages.size(); messages++) {
+                yarp::os::Bottle& b = reader.messages[messages];
+                header = header && b.size()>=2 &&
+                    b.get(0).asString().find("[/log/")==0;
+                for (int i=1; i<b.size(); i++) {
+                    char line[100];
+                    sprintf(line, "[INFO] line %d\n", lines);
+                    ordered = ordered && (b.get(i).asString()==line);
+                    lines++;
+                }
+            }
+            reader.mutex.unlock();
+        }
+        checkEqual(lines, total, "all messages forwarded");
+        checkTrue(header, "header and messages");
+        checkTrue(ordered, "messages forwarded in order");
+        // the first one, then the 199 that piled up by 64
+        checkEqual((int)messages, 1+(total-1+63)/64, "messages batched when piling up");
+        checkEqual((int)forwarder->getDroppedCount(), 0, "no message dropped");
+
+        yarp::os::LogForwarder::clearInstance();
+        reader.received.waitWithTimeout(10);
+        reader.mutex.lock();
+        yarp::os::Bottle last = reader.messages.back();
+        reader.mutex.unlock();
+        checkTrue(last.get(1).asString().find("terminated")!=std::string::npos,
+                  "termination forwarded");
+        logger.close();
+        yarp::os::Network::setLocalMode(false);
+    }
+
     virtual void runTests() override {
         checkLog();
+        checkForward();
     }
 };
 
@@ -5,6 +5,7 @@
  *
  */
 
+#include <yarp/os/impl/NameCache.h>
 #include <yarp/os/impl/NameServer.h>
 #include <yarp/os/impl/Companion.h>
 
@@ -12,6 +13,7 @@
 //#include "TestList.h"
 
 #include <yarp/os/Network.h>
+#include <yarp/os/SystemClock.h>
 
 using namespace yarp::os::impl;
 using namespace yarp::os;
@@ -49,6 +51,42 @@ public:
         NetworkBase::setLocalMode(false);
     }
 
+    void checkQueryMany() {
+        report(0,"checking query of several ports...");
+        NameServer ns;
+        ns.registerName("/many1",Contact("tcp", "127.0.0.1", safePort()));
+        ns.registerName("/many2",Contact("tcp", "127.0.0.1", safePort()+1));
+        ConstString result = ns.apply("NAME_SERVER query /many1 /nothing /many2");
+        size_t at1 = result.find("registration name /many1 ");
+        size_t at2 = result.find("registration name /many2 ");
+        checkTrue(at1!=ConstString::npos,"first port found");
+        checkTrue(at2!=ConstString::npos,"second port found");
+        checkTrue(at1<at2,"ports in order");
+        checkTrue(result.find("/nothing")==ConstString::npos,"unknown port skipped");
+    }
+
+    void checkCache() {
+        report(0,"checking cache of port addresses...");
+        NetworkBase::setLocalMode(true);
+        Contact address("/cached", "tcp", "127.0.0.1", safePort());
+        Contact result;
+        NameCache::setTtl(0);
+        NameCache::store("/cached",address);
+        checkFalse(NameCache::lookup("/cached",result),"nothing cached when off");
+        NameCache::setTtl(0.5);
+        NameCache::store("/cached",address);
+        checkTrue(NameCache::lookup("/cached",result),"address cached");
+        checkEqual(result.getPort(),safePort(),"cached address matches");
+        NameCache::invalidate("/cached");
+        checkFalse(NameCache::lookup("/cached",result),"address forgotten");
+        NameCache::store("/cached",address);
+        SystemClock::delaySystem(1);
+        checkFalse(NameCache::lookup("/cached",result),"address expired");
+        NameCache::fini();
+        NameCache::setTtl(0);
+        NetworkBase::setLocalMode(false);
+    }
+
     void checkCompanion(bool fake) {
         report(0,"checking dud connections don't affect memory...");
         NetworkBase::setLocalMode(fake);
@@ -67,6 +105,8 @@ public:
     virtual void runTests() override {
         checkRegister();
         checkClientInterface();
+        checkQueryMany();
+        checkCache();
         checkCompanion(true);
         //checkCompanion(false);
     }
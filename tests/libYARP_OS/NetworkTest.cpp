@@ -13,7 +13,9 @@
 #include <yarp/os/ConstString.h>
 #include <yarp/os/Time.h>
 #include <yarp/os/Bottle.h>
+#include <yarp/os/NetType.h>
 #include <yarp/os/QosStyle.h>
+#include <yarp/os/Route.h>
 
 #include <yarp/os/impl/UnitTest.h>
 #include <yarp/os/impl/TcpFace.h>
@@ -114,6 +116,57 @@ public:
     }
 
 
+    void checkConnectMany() {
+        report(0,"checking connecting many ports at once");
+        const int n = 4;
+        Port sources[n];
+        Port other;
+        Port dest;
+        bool ok = dest.open("/many/dest") && other.open("/many/src/udp");
+        for (int i=0; i<n; i++) {
+            ok = ok && sources[i].open(ConstString("/many/src/") + NetType::toString(i));
+        }
+        checkTrue(ok,"ports opened ok");
+        if (!ok) {
+            return;
+        }
+        std::vector<Route> routes;
+        for (int i=0; i<n; i++) {
+            routes.push_back(Route(sources[i].getName(), dest.getName(), ""));
+        }
+        routes.push_back(Route(sources[0].getName(), "/many/nothing", ""));
+        routes.push_back(Route(other.getName(), dest.getName(), "udp"));
+        ContactStyle style;
+        style.quiet = true;
+        std::vector<bool> result = Network::connectMany(routes, style);
+        checkEqual((int)result.size(),n+2,"one result per route");
+        for (int i=0; i<n; i++) {
+            checkTrue(result[i],"good connect");
+            checkTrue(Network::isConnected(sources[i].getName(), dest.getName()),
+                      "connection made");
+        }
+        checkFalse(result[n],"bad connect, not existing destination");
+        checkTrue(result[n+1],"carrier of route used");
+        ContactStyle udp;
+        udp.quiet = true;
+        udp.carrier = "udp";
+        checkTrue(Network::isConnected(other.getName(), dest.getName(), udp),
+                  "connection uses carrier of route");
+        result = Network::disconnectMany(routes, style);
+        for (int i=0; i<n; i++) {
+            checkTrue(result[i],"good disconnect");
+            checkFalse(Network::isConnected(sources[i].getName(), dest.getName()),
+                       "connection removed");
+        }
+        checkFalse(Network::isConnected(other.getName(), dest.getName(), udp),
+                   "connection with carrier of route removed");
+        for (int i=0; i<n; i++) {
+            sources[i].close();
+        }
+        other.close();
+        dest.close();
+    }
+
     void checkSync() {
         report(0,"checking port synchronization");
         Port p1;
@@ -261,6 +314,7 @@ public:
     virtual void runTests() override {
         Network::setLocalMode(true);
         checkConnect();
+        checkConnectMany();
         checkSync();
         checkComms();
         checkPropertySetGet();
@@ -175,6 +175,76 @@ public:
         }
     }
 
+    void checkLatestOnly() {
+        report(0, "checking latest-only mailbox...");
+
+        PortReaderBuffer<Bottle> buffer;
+        buffer.setLatestOnly();
+        checkTrue(buffer.isLatestOnly(), "mode set");
+        Bottle data1("1"), data2("2"), data3("3");
+        buffer.acceptObject(&data1, NULL);
+        buffer.acceptObject(&data2, NULL);
+        buffer.acceptObject(&data3, NULL);
+        checkEqual(buffer.getPendingReads(), 1, "one message pending");
+        Bottle *bot = buffer.read(false);
+        checkTrue(bot!=NULL, "newest message received");
+        if (bot!=NULL) {
+            checkEqual(bot->get(0).asInt(), 3, "newest value ok");
+        }
+        checkEqual((int)buffer.getDroppedCount(), 2, "older messages dropped");
+        checkTrue(buffer.read(false)==NULL, "nothing left");
+        checkTrue(buffer.lastRead()==NULL, "no current message");
+
+        BufferedPort<Bottle> out;
+        BufferedPort<Bottle> in;
+        in.setLatestOnly();
+        out.open("/out");
+        in.open("/in");
+        Network::connect("/out", "/in");
+        Network::sync("/out");
+        Network::sync("/in");
+
+        out.prepare().fromString("0");
+        out.writeStrict();
+        bot = in.read();
+        checkTrue(bot!=NULL, "blocking read woken");
+        if (bot!=NULL) {
+            checkEqual(bot->get(0).asInt(), 0, "first value ok");
+        }
+        void *held = in.acquire();
+        checkTrue(held!=NULL, "message acquired");
+
+        int total = 20;
+        for (int i=1; i<=total; i++) {
+            Bottle& b = out.prepare();
+            b.clear();
+            b.addInt(i);
+            out.writeStrict();
+        }
+        out.waitForWrite();
+        int reads = 0;
+        int value = 0;
+        while (value<total) {
+            bot = in.read();
+            if (bot==NULL) {
+                break;
+            }
+            if (bot->get(0).asInt()<=value) {
+                checkTrue(false, "messages arrive in order");
+                break;
+            }
+            value = bot->get(0).asInt();
+            reads++;
+        }
+        checkEqual(value, total, "newest value reached");
+        checkEqual(reads+(int)in.getDroppedCount(), total,
+                   "every message is either read or counted as dropped");
+        in.release(held);
+
+        out.close();
+        in.close();
+    }
+
     virtual void runTests() override {
         Network::setLocalMode(true);
 
@@ -184,6 +254,7 @@ public:
         checkAccept();
         checkCallback();
         checkCallbackNoOpen();
+        checkLatestOnly();
         Network::setLocalMode(false);
     }
 };
@@ -5,6 +5,7 @@
  *
  */
 
+#include <yarp/conf/system.h>
 #include <yarp/os/Port.h>
 #include <yarp/os/impl/Companion.h>
 #include <yarp/os/Time.h>
@@ -17,6 +18,7 @@
 #include <yarp/os/PortablePair.h>
 #include <yarp/os/BinPortable.h>
 #include <yarp/os/impl/Logger.h>
+#include <yarp/os/impl/PortCoreReactor.h>
 #include <yarp/os/NetType.h>
 #include <yarp/os/impl/UnitTest.h>
 
@@ -27,12 +29,21 @@
 #include <yarp/os/RpcClient.h>
 #include <yarp/os/RpcServer.h>
 #include <yarp/os/PortInfo.h>
+#include <yarp/os/Stamp.h>
 
 #include <yarp/dev/PolyDriver.h>
 #include <yarp/dev/Drivers.h>
 
 #include <yarp/sig/Image.h>
 
+#ifdef YARP_HAS_SYS_MMAN_H
+# include <yarp/os/impl/ShmRing.h>
+# include <cstring>
+# include <sys/mman.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
 //#include "TestList.h"
 
 using namespace yarp::os;
@@ -333,6 +344,21 @@ public:
     }
 };
 
+class CountingWriter : public PortWriter {
+public:
+    Bottle b;
+    int writes;
+
+    CountingWriter() {
+        writes = 0;
+    }
+
+    virtual bool write(ConnectionWriter& connection) override {
+        writes++;
+        return b.write(connection);
+    }
+};
+
 #endif /*DOXYGEN_SHOULD_SKIP_THIS*/
 
 
@@ -478,6 +504,52 @@ public:
     }
 
 
+    void testUdpRecovery() {
+        report(0,"checking udp with loss recovery");
+
+        Bottle bot1;
+        PortReaderBuffer<Bottle> buf;
+
+        bot1.fromString("1 2 3");
+        for (int i=0; i<10000; i++) {
+            bot1.addInt(i);
+        }
+
+        Port input, output;
+        input.open("/in");
+        output.open("/out");
+
+        buf.setStrict();
+        buf.attach(input);
+
+        output.addOutput(Contact("/in", "udp+fec.4+nack.20"));
+
+        report(0,"writing three times...");
+        for (int j=0; j<3; j++) {
+            output.write(bot1);
+            Time::delay(0.1);
+        }
+
+        report(0,"checking for whatever got through...");
+        int ct = 0;
+        while (buf.check()) {
+            ct++;
+            Bottle *result = buf.read();
+            checkTrue(result!=NULL,"got something check");
+            if (result!=NULL) {
+                checkEqual(bot1.size(),result->size(),"size check");
+                checkEqual(bot1.get(9000).asInt(),result->get(9000).asInt(),
+                           "content check");
+            }
+        }
+        if (ct==0) {
+            report(0,"NOTHING got through - possible but sad");
+        }
+
+        output.close();
+        input.close();
+    }
+
     void testHeavy() {
         report(0,"checking heavy udp");
 
@@ -693,6 +765,289 @@ public:
         checkEqual(bin->content(),999,"good send");
     }
 
+    void testSharedContent() {
+        report(0,"checking message is serialized once for several outputs");
+        Port output;
+        BufferedPort<Bottle> input1, input2, input3;
+        output.open("/out");
+        input1.open("/in1");
+        input2.open("/in2");
+        input3.open("/in3");
+        input3.setStrict();
+
+        Network::connect("/out", "/in1", "tcp");
+        Network::connect("/out", "/in2", "fast_tcp");
+        Network::connect("/out", "/in3", "text");
+
+        CountingWriter writer;
+        writer.b.fromString("10 (1 2 3) \"shared\" 4.5");
+        output.write(writer);
+        checkEqual(writer.writes,2,"one serialization shared + one for text");
+
+        Bottle *b1 = input1.read();
+        Bottle *b2 = input2.read();
+        Bottle *b3 = input3.read();
+        checkTrue(b1!=YARP_NULLPTR && b2!=YARP_NULLPTR && b3!=YARP_NULLPTR,
+                  "all inputs got a message");
+        if (b1 && b2 && b3) {
+            checkEqual(b1->toString(),writer.b.toString(),"tcp content");
+            checkEqual(b2->toString(),writer.b.toString(),"fast_tcp content");
+            checkEqual(b3->toString(),writer.b.toString(),"text content");
+        }
+
+        writer.writes = 0;
+        writer.b.addString("again");
+        output.write(writer);
+        checkEqual(writer.writes,2,"buffers reused for next message");
+        b1 = input1.read();
+        b2 = input2.read();
+        checkTrue(b1!=YARP_NULLPTR && b2!=YARP_NULLPTR, "second message arrived");
+        if (b1 && b2) {
+            checkEqual(b1->toString(),writer.b.toString(),"tcp content again");
+            checkEqual(b2->toString(),writer.b.toString(),"fast_tcp content again");
+        }
+
+        output.close();
+        input1.close();
+        input2.close();
+        input3.close();
+    }
+
+    void testShmRing() {
+#ifdef YARP_HAS_SYS_MMAN_H
+        report(0,"checking shared memory ring carrier");
+        BufferedPort<yarp::sig::ImageOf<yarp::sig::PixelRgb> > output, input;
+        output.open("/out");
+        input.open("/in");
+        input.setStrict();
+
+        // small slots, so that each frame has to wrap around the ring
+        checkTrue(Network::connect("/out", "/in", "shm+slots.2+size.8192"),
+                  "shm connection");
+
+        for (int k=0; k<3; k++) {
+            yarp::sig::ImageOf<yarp::sig::PixelRgb>& img = output.prepare();
+            img.resize(160, 120);
+            for (int y=0; y<img.height(); y++) {
+                for (int x=0; x<img.width(); x++) {
+                    img.pixel(x,y) = yarp::sig::PixelRgb(x+k, y, x^y);
+                }
+            }
+            output.writeStrict();
+        }
+        for (int k=0; k<3; k++) {
+            yarp::sig::ImageOf<yarp::sig::PixelRgb> *img = input.read();
+            checkTrue(img!=YARP_NULLPTR, "got an image");
+            if (img==YARP_NULLPTR) {
+                break;
+            }
+            checkEqual(img->width(), 160, "width");
+            checkEqual(img->height(), 120, "height");
+            bool same = true;
+            for (int y=0; y<img->height(); y++) {
+                for (int x=0; x<img->width(); x++) {
+                    yarp::sig::PixelRgb& p = img->pixel(x,y);
+                    if (p.r!=(unsigned char)(x+k) || p.g!=(unsigned char)y ||
+                            p.b!=(unsigned char)(x^y)) {
+                        same = false;
+                    }
+                }
+            }
+            checkTrue(same, "image content");
+        }
+        output.close();
+        input.close();
+
+        report(0,"checking replies over shared memory ring");
+        ServiceProvider provider;
+        Port in, out;
+        in.open("/in");
+        out.open("/out");
+        in.setReader(provider);
+        out.addOutput(Contact("/in", "shm"));
+        ServiceTester tester(*this);
+        tester.send.fromString("1 2 3");
+        out.write(tester);
+        tester.finalCheck();
+        out.close();
+        in.close();
+
+        report(0,"checking the shared memory ring against its peer");
+        ShmRing writer, reader;
+        checkTrue(writer.create(2, 4096), "ring created");
+        checkTrue(reader.attach(writer.getName()), "ring attached");
+        // the peer breaks the geometry after it was checked
+        int fd = shm_open(writer.getName().c_str(), O_RDWR, 0);
+        checkTrue(fd>=0, "segment opened");
+        if (fd>=0) {
+            void *mem = mmap(YARP_NULLPTR, 4096, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mem!=MAP_FAILED) {
+                // slotCount and slotSize, after the magic number
+                static_cast<uint32_t*>(mem)[1] = 0;
+                static_cast<uint64_t*>(mem)[1] = (uint64_t)1 << 40;
+                munmap(mem, 4096);
+            }
+        }
+        writer.unlink();
+        char data[3*4096];
+        for (size_t i=0; i<sizeof(data); i++) {
+            data[i] = (char)(i*7);
+        }
+        checkTrue(writer.write(data, 100) && writer.flush(), "written");
+        char buf[4096];
+        checkEqual((int)reader.read(buf, sizeof(buf)), 100, "read with the checked geometry");
+        checkTrue(memcmp(buf, data, 100)==0, "data read");
+
+        // a message that cannot be sent whole closes the ring
+        writer.setTimeout(0.2);
+        checkFalse(writer.write(data, sizeof(data)), "write timed out");
+        checkFalse(writer.isOk(), "ring closed after a partial write");
+        int got = 0;
+        YARP_SSIZE_T n;
+        while ((n=reader.read(buf, sizeof(buf)))>0) {
+            got += (int)n;
+        }
+        checkEqual(got, 2*4096, "slots published before the timeout read");
+        checkFalse(reader.isOk(), "reader sees the ring closed");
+#endif
+    }
+
+    void checkBatchedMessages(Port& output, BufferedPort<Bottle>& input,
+                              const char *name) {
+        const int count = 20;
+        for (int i=0; i<count; i++) {
+            Bottle b;
+            b.addString(name);
+            b.addInt(i);
+            Stamp stamp(i, 0.5*i);
+            output.setEnvelope(stamp);
+            output.write(b);
+        }
+        bool ordered = true;
+        bool stamped = true;
+        for (int i=0; i<count; i++) {
+            Bottle *b = input.read();
+            checkTrue(b!=YARP_NULLPTR, "got a message");
+            if (b==YARP_NULLPTR) {
+                return;
+            }
+            if (b->get(0).asString()!=name || b->get(1).asInt()!=i) {
+                ordered = false;
+            }
+            Stamp stamp;
+            input.getEnvelope(stamp);
+            if (stamp.getCount()!=i || stamp.getTime()!=0.5*i) {
+                stamped = false;
+            }
+        }
+        checkTrue(ordered, "messages arrived in order");
+        checkTrue(stamped, "each message kept its envelope");
+    }
+
+    void testBatching() {
+        report(0,"checking small messages can be sent in batches");
+        Port output;
+        BufferedPort<Bottle> input;
+        output.open("/out");
+        input.open("/in");
+        input.setStrict();
+
+        // the last messages only go when the delay runs out
+        checkTrue(Network::connect("/out", "/in", "tcp+batch.300+batchdelay.0.01"),
+                  "batching connection");
+        checkBatchedMessages(output, input, "modifier");
+
+        Network::disconnect("/out", "/in");
+        Network::sync("/in");
+        Network::connect("/out", "/in", "tcp");
+        QosStyle style;
+        style.setMessageBatching(300, 0.01);
+        checkTrue(Network::setConnectionQos("/out", "/in", style, QosStyle(), false),
+                  "batching set through qos");
+        QosStyle srcStyle, destStyle;
+        Network::getConnectionQos("/out", "/in", srcStyle, destStyle, false);
+        checkEqual(srcStyle.getMessageBatchSize(), 300, "batch size read back");
+        checkBatchedMessages(output, input, "qos");
+
+        style.setMessageBatching(0);
+        checkTrue(Network::setConnectionQos("/out", "/in", style, QosStyle(), false),
+                  "batching turned off");
+        checkBatchedMessages(output, input, "plain");
+
+        output.close();
+        input.close();
+    }
+
+    void testReactor() {
+        report(0,"checking inputs can share a few threads");
+        PortCoreReactor::setThreadCount(2);
+
+        BufferedPort<Bottle> input;
+        input.setStrict();
+        input.open("/in");
+
+        const int senders = 6;
+        Port outputs[senders];
+        for (int i=0; i<senders; i++) {
+            outputs[i].open(ConstString("/out") + NetType::toString(i));
+            checkTrue(Network::connect(outputs[i].getName(), "/in"),
+                      "connection ok");
+        }
+        Network::sync("/in");
+        checkEqual(input.getInputCount(), senders, "all inputs present");
+
+        for (int k=0; k<3; k++) {
+            for (int i=0; i<senders; i++) {
+                Bottle b;
+                b.addInt(i);
+                outputs[i].write(b);
+            }
+        }
+        int total = 0;
+        int ct = 0;
+        for (ct=0; ct<senders*3; ct++) {
+            Bottle *b = input.read();
+            if (b==NULL) {
+                break;
+            }
+            total += b->get(0).asInt();
+        }
+        checkEqual(ct, senders*3, "all messages received");
+        checkEqual(total, 3*(senders*(senders-1))/2, "messages intact");
+
+        report(0,"checking replies from a shared thread");
+        ServiceProvider provider;
+        Port server, client;
+        server.setReader(provider);
+        server.open("/server");
+        client.open("/client");
+        checkTrue(Network::connect("/client", "/server"), "rpc connection ok");
+        Bottle cmd("1 2 3");
+        Bottle reply;
+        client.write(cmd, reply);
+        checkEqual(reply.size(), 4, "reply received");
+        client.close();
+
+        report(0,"checking text connections keep their own thread");
+        checkTrue(Network::connect("/out1", "/in", "text"), "text connection ok");
+        Network::sync("/in");
+        Bottle msg("10 20");
+        outputs[1].write(msg);
+        Bottle *b = input.read();
+        checkTrue(b!=NULL, "text message received");
+        if (b!=NULL) {
+            checkEqual(b->toString(), msg.toString(), "text message intact");
+        }
+
+        input.close();
+        for (int i=0; i<senders; i++) {
+            outputs[i].close();
+        }
+        server.close();
+        PortCoreReactor::setThreadCount(0);
+    }
+
     void testCloseOrder() {
         report(0,"check that port close order doesn't matter...");
 
@@ -1551,11 +1906,16 @@ public:
         testPair();
         testReply();
         testUdp();
+        testUdpRecovery();
         //testHeavy();
 
         testBackground();
         testWriteBuffer();
         testBufferedPort();
+        testSharedContent();
+        testShmRing();
+        testBatching();
+        testReactor();
         testCloseOrder();
         testDelegatedReadReply();
         testReaderHandler();
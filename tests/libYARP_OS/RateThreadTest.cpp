@@ -10,6 +10,8 @@
 
 #include <yarp/os/RateThread.h>
 #include <yarp/os/impl/NameServer.h>
+#include <yarp/os/impl/RateThreadExecutor.h>
+#include <yarp/os/impl/ThreadImpl.h>
 #include <yarp/os/Network.h>
 #include <yarp/os/Time.h>
 #include <yarp/os/Clock.h>
@@ -200,6 +202,27 @@ private:
         }
     };
 
+    class RateThread6: public RateThread
+    {
+    public:
+        RateThread& other;
+        int count;
+        bool started;
+
+        RateThread6(int r, RateThread& other): RateThread(r),other(other),count(0),started(false){}
+
+        virtual void run() override {
+            count++;
+            // start and stop another thread from run()
+            if (count==1)
+                started=other.start();
+            if (count==20) {
+                other.stop();
+                askToStop();
+            }
+        }
+    };
+
     class UgoThread : public RateThread {
     public:
         bool done;
@@ -408,6 +431,89 @@ public:
         }
     }
 
+    void testExecutor() {
+        report(0,"testing rate threads sharing a pool of threads");
+        RateThreadExecutor::setThreadCount(2);
+
+        testInitSuccessFailure();
+        testInitReleaseSynchro();
+        testStartAskForStopStart();
+
+        int threads = ThreadImpl::getCount();
+        RateThread5 *pool[6];
+        for (int i=0; i<6; i++) {
+            pool[i] = new RateThread5(10);
+            pool[i]->start();
+        }
+        checkEqual(ThreadImpl::getCount(), threads,
+                   "no new thread for each rate thread");
+        Time::delay(1);
+        for (int i=0; i<6; i++) {
+            pool[i]->stop();
+            checkTrue(!pool[i]->isRunning(), "pooled thread stopped");
+            char message[255];
+            sprintf(message, "pooled thread ran %d times in 1 s at 10 ms",
+                    pool[i]->count);
+            report(0, message);
+            checkTrue(pool[i]->count>=80 && pool[i]->count<=110,
+                      "pooled thread keeps its period");
+            double av, std;
+            pool[i]->getEstPeriod(av, std);
+            checkTrue(av>9 && av<11, "estimated period ok");
+            double jitter, maxJitter;
+            pool[i]->getEstJitter(jitter, maxJitter);
+            checkTrue(jitter<=maxJitter, "jitter statistics consistent");
+            checkEqual((int)pool[i]->getOverruns(), 0, "no overruns");
+            unsigned int periods[50];
+            unsigned int jitters[50];
+            pool[i]->getPeriodHistogram(periods, 50);
+            pool[i]->getJitterHistogram(jitters, 50);
+            unsigned int periodCount=0;
+            unsigned int jitterCount=0;
+            for (int b=0; b<50; b++) {
+                periodCount+=periods[b];
+                jitterCount+=jitters[b];
+            }
+            checkEqual((int)periodCount, (int)pool[i]->getIterations()-1,
+                       "period histogram counts all the periods");
+            checkEqual((int)jitterCount, (int)periodCount,
+                       "jitter histogram counts all the periods");
+            checkTrue(periods[9]+periods[10]>periodCount/2,
+                      "period histogram centered on the period");
+            delete pool[i];
+        }
+
+        RateThread4 once(10);
+        once.start();
+        Time::delay(0.5);
+        checkTrue(!once.isRunning(), "pooled thread stopped itself");
+        checkEqual(once.count, 0, "pooled thread ran until it asked to stop");
+
+        RateThreadExecutor::setThreadCount(0);
+        report(0,"done");
+    }
+
+    void testExecutorNesting() {
+        report(0,"testing a pooled rate thread starting and stopping another one");
+        // a single worker, busy running the thread that starts the other
+        RateThreadExecutor::fini();
+        RateThreadExecutor::setThreadCount(1);
+
+        RateThread5 child(10);
+        RateThread6 parent(10, child);
+        checkTrue(parent.start(), "pooled thread started");
+        Time::delay(1);
+        checkTrue(!parent.isRunning(), "pooled thread stopped itself");
+        checkEqual(parent.count, 20, "pooled thread ran until it asked to stop");
+        checkTrue(parent.started, "other thread started from run()");
+        checkTrue(!child.isRunning(), "other thread stopped from run()");
+        checkTrue(child.count>0, "other thread ran on the same worker");
+
+        RateThreadExecutor::fini();
+        RateThreadExecutor::setThreadCount(0);
+        report(0,"done");
+    }
+
     virtual void runTests() override {
         testInitSuccessFailure();
         testInitReleaseSynchro();
@@ -415,6 +521,8 @@ public:
         testRateThread();
         testSimTime();
         testStartAskForStopStart();
+        testExecutor();
+        testExecutorNesting();
     }
 };
 
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <yarp/os/impl/Protocol.h>
+#include <yarp/os/impl/TcpFace.h>
+#include <yarp/os/impl/UnitTest.h>
+#include <yarp/os/InputProtocol.h>
+#include <yarp/os/ManagedBytes.h>
+#include <yarp/os/StringOutputStream.h>
+#include <yarp/os/Thread.h>
+#include <yarp/os/Time.h>
+
+#include <cstring>
+
+using namespace yarp::os::impl;
+using namespace yarp::os;
+
+class SocketTwoWayStreamTest : public UnitTest {
+public:
+    virtual ConstString getName() override { return "SocketTwoWayStreamTest"; }
+
+    /*
+     * Answers "ping" with "pong", on the accepted side of a connection.
+     */
+    class Responder : public Thread {
+    public:
+        InputStream& is;
+        OutputStream& os;
+        bool pinged;
+
+        Responder(InputStream& is, OutputStream& os) : is(is), os(os), pinged(false) {}
+
+        virtual void run() override {
+            char buf[4];
+            Bytes b(buf, 4);
+            if (is.readFull(b)!=4) {
+                return;
+            }
+            pinged = (memcmp(buf, "ping", 4)==0);
+            Bytes reply((char*)"pong", 4);
+            os.write(reply);
+        }
+    };
+
+    // tcp connections carry their data through a SocketTwoWayStream
+    InputProtocol *connect(TcpFace& face, Protocol *& client) {
+        Contact address("127.0.0.1", face.getLocalAddress().getPort());
+        client = static_cast<Protocol*>(face.write(address));
+        if (client==YARP_NULLPTR) {
+            return YARP_NULLPTR;
+        }
+        return face.read();
+    }
+
+    void disconnect(Protocol *client) {
+        if (client!=YARP_NULLPTR) {
+            client->close();
+            delete client;
+        }
+    }
+
+    void fill(ManagedBytes& data, int seed) {
+        for (size_t i=0; i<data.length(); i++) {
+            data.get()[i] = (char)(i*7+seed);
+        }
+    }
+
+    void checkGatherWrite() {
+        report(0, "checking gather writes on tcp sockets...");
+        TcpFace face;
+        checkTrue(face.open(Contact("127.0.0.1", 0)), "listening");
+        Protocol *proto = YARP_NULLPTR;
+        InputProtocol *server = connect(face, proto);
+        checkTrue(server!=YARP_NULLPTR, "connected");
+        if (server==YARP_NULLPTR) {
+            disconnect(proto);
+            face.close();
+            return;
+        }
+        TwoWayStream& client = proto->getStreams();
+        OutputStream& out = proto->getOutputStream();
+
+        // an index held back, then more blocks than a single gather write
+        // takes, some of them empty
+        const int count = 100;
+        ManagedBytes data[count];
+        Bytes blocks[count];
+        size_t total = 4;
+        for (int i=0; i<count; i++) {
+            data[i].allocate((i%10==0) ? 0 : 10+i);
+            fill(data[i], i);
+            blocks[i] = data[i].bytes();
+            total += data[i].length();
+        }
+        client.beginPacket();
+        Bytes index((char*)"idx!", 4);
+        out.write(index);
+        out.writeBlocks(blocks, count);
+        client.endPacket();
+        checkTrue(client.isOk(), "blocks written");
+
+        ManagedBytes received(total);
+        checkEqual((int)server->getInputStream().readFull(received.bytes()), (int)total,
+                   "all the bytes received");
+        bool same = (memcmp(received.get(), "idx!", 4)==0);
+        size_t at = 4;
+        for (int i=0; i<count; i++) {
+            same = same && memcmp(received.get()+at, data[i].get(), data[i].length())==0;
+            at += data[i].length();
+        }
+        checkTrue(same, "blocks received in order");
+
+        // a small write held back in a packet goes out before any read,
+        // or the peer, waiting for it, would never answer
+        Responder responder(server->getInputStream(), server->getOutputStream());
+        responder.start();
+        proto->getInputStream().setReadTimeout(5);
+        client.beginPacket();
+        Bytes ping((char*)"ping", 4);
+        out.write(ping);
+        char buf[4];
+        Bytes pong(buf, 4);
+        checkEqual((int)proto->getInputStream().readFull(pong), 4, "answer received");
+        client.endPacket();
+        responder.join();
+        checkTrue(responder.pinged, "held back write sent before reading");
+        checkTrue(memcmp(buf, "pong", 4)==0, "answer ok");
+
+        // writing to a closed connection fails, and then does nothing
+        server->close();
+        delete server;
+        ManagedBytes big(100000);
+        fill(big, 0);
+        Bytes bigBlocks[2] = { index, big.bytes() };
+        for (int i=0; i<100 && client.isOk(); i++) {
+            client.beginPacket();
+            out.write(index);
+            out.writeBlocks(bigBlocks, 2);
+            client.endPacket();
+            Time::delay(0.01);
+        }
+        checkFalse(client.isOk(), "write to a closed connection fails");
+        client.beginPacket();
+        out.write(index);
+        out.writeBlocks(bigBlocks, 2);
+        client.endPacket();
+        checkFalse(client.isOk(), "writes after a failure ignored");
+        disconnect(proto);
+        face.close();
+    }
+
+    void checkHeldBack() {
+        report(0, "checking small writes are held back in packets...");
+        TcpFace face;
+        face.open(Contact("127.0.0.1", 0));
+        Protocol *proto = YARP_NULLPTR;
+        InputProtocol *server = connect(face, proto);
+        checkTrue(server!=YARP_NULLPTR, "connected");
+        if (server==YARP_NULLPTR) {
+            disconnect(proto);
+            face.close();
+            return;
+        }
+        TwoWayStream& client = proto->getStreams();
+        OutputStream& out = proto->getOutputStream();
+        client.beginPacket();
+        Bytes index((char*)"idx!", 4);
+        out.write(index);
+        char buf[4];
+        Bytes b(buf, 4);
+        server->setTimeout(0.2);
+        checkTrue(server->getInputStream().read(b)<=0, "small write held back");
+        client.endPacket();
+        disconnect(proto);
+        server->close();
+        delete server;
+        face.close();
+    }
+
+    void checkDefaultWriteBlocks() {
+        report(0, "checking writeBlocks() of other streams...");
+        StringOutputStream os;
+        Bytes blocks[3] = { Bytes((char*)"ab", 2), Bytes((char*)"", 0), Bytes((char*)"cde", 3) };
+        os.writeBlocks(blocks, 3);
+        checkEqual(os.toString(), "abcde", "blocks written one by one");
+    }
+
+    virtual void runTests() override {
+        checkGatherWrite();
+        checkHeldBack();
+        checkDefaultWriteBlocks();
+    }
+};
+
+static SocketTwoWayStreamTest theSocketTwoWayStreamTest;
+
+UnitTest& getSocketTwoWayStreamTest() {
+    return theSocketTwoWayStreamTest;
+}
@@ -21,6 +21,7 @@ namespace yarp {
 // need to made one function for each new test, and add to collectTests()
 // method
 extern yarp::os::impl::UnitTest& getBottleTest();
+extern yarp::os::impl::UnitTest& getBottleViewTest();
 extern yarp::os::impl::UnitTest& getStringTest();
 extern yarp::os::impl::UnitTest& getContactTest();
 extern yarp::os::impl::UnitTest& getRouteTest();
@@ -51,6 +52,7 @@ extern yarp::os::impl::UnitTest& getPortReaderBufferTest();
 extern yarp::os::impl::UnitTest& getNetworkTest();
 extern yarp::os::impl::UnitTest& getResourceFinderTest();
 extern yarp::os::impl::UnitTest& getDgramTwoWayStreamTest();
+extern yarp::os::impl::UnitTest& getSocketTwoWayStreamTest();
 extern yarp::os::impl::UnitTest& getSemaphoreTest();
 extern yarp::os::impl::UnitTest& getEventTest();
 extern yarp::os::impl::UnitTest& getRunTest();
@@ -68,6 +70,7 @@ public:
     static void collectTests() {
         UnitTest& root = UnitTest::getRoot();
         root.add(getBottleTest());
+        root.add(getBottleViewTest());
         root.add(getStringTest());
         root.add(getContactTest());
         root.add(getRouteTest());
@@ -98,6 +101,7 @@ public:
         root.add(getNetworkTest());
         root.add(getResourceFinderTest());
         root.add(getDgramTwoWayStreamTest());
+        root.add(getSocketTwoWayStreamTest());
         root.add(getSemaphoreTest());
         root.add(getEventTest());
         root.add(getNodeTest());
@@ -0,0 +1,427 @@
+/*
+ * Copyright (C) 2017 Istituto Italiano di Tecnologia (IIT)
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+#include <vector>
+
+#include <yarp/os/Thread.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/impl/UnitTest.h>
+
+#include <yarp/dev/ControlBoardInterfaces.h>
+#include <yarp/dev/PolyDriver.h>
+#include <yarp/dev/PolyDriverList.h>
+#include <yarp/dev/Wrapper.h>
+#include <yarp/dev/Drivers.h>
+
+using namespace yarp::os::impl;
+using namespace yarp::os;
+using namespace yarp::dev;
+
+static const char *boardA_file_content   = "device fakeMotionControl\n"
+                                           "[GENERAL]\n"
+                                           "Joints 4\n"
+                                           "\n"
+                                           "AxisName \"axisA1\" \"axisA2\" \"axisA3\" \"axisA4\"\n";
+
+static const char *boardB_file_content   = "device fakeMotionControl\n"
+                                           "[GENERAL]\n"
+                                           "Joints 3\n"
+                                           "\n"
+                                           "AxisName \"axisB1\" \"axisB2\" \"axisB3\"\n";
+
+// joints 0-1 are joints 1-2 of board A, joints 2-4 are all the joints of board B
+static const char *wrapper_file_content  = "device controlboardwrapper2\n"
+                                           "name /testControlBoardWrapper\n"
+                                           "period 10\n"
+                                           "networks (net_a net_b)\n"
+                                           "joints 5\n"
+                                           "net_a 0 1 1 2\n"
+                                           "net_b 2 4 0 2\n";
+
+// joint 1 is mapped twice, joint 3 is not mapped
+static const char *overlap_file_content  = "device controlboardwrapper2\n"
+                                           "name /testControlBoardWrapper/overlap\n"
+                                           "period 10\n"
+                                           "networks (net_a net_b)\n"
+                                           "joints 4\n"
+                                           "net_a 0 1 0 1\n"
+                                           "net_b 1 2 0 1\n";
+
+
+// joints 0-2 are all the joints of board B, joints 3-4 are the joints of a board with more motors
+static const char *motors_file_content   = "device controlboardwrapper2\n"
+                                           "name /testControlBoardWrapper/motors\n"
+                                           "period 10\n"
+                                           "networks (net_b net_m)\n"
+                                           "joints 5\n"
+                                           "net_b 0 2 0 2\n"
+                                           "net_m 3 4 0 1\n";
+
+/*
+ * A board with 2 joints moved by 4 motors: the multi-motor reads fill in 4
+ * values.  Joint j reads 50+j, motor m reads 100+m.
+ */
+class MoreMotorsBoard : public DeviceDriver,
+                        public IPositionControl,
+                        public IVelocityControl,
+                        public IEncodersTimed,
+                        public IMotorEncoders
+{
+public:
+    static const int joints = 2;
+    static const int motors = 4;
+
+    virtual bool getAxes(int *ax) override { *ax = joints; return true; }
+
+    virtual bool positionMove(int j, double ref) override { return true; }
+    virtual bool positionMove(const double *refs) override { return true; }
+    virtual bool relativeMove(int j, double delta) override { return true; }
+    virtual bool relativeMove(const double *deltas) override { return true; }
+    virtual bool checkMotionDone(int j, bool *flag) override { *flag = true; return true; }
+    virtual bool checkMotionDone(bool *flag) override { *flag = true; return true; }
+    virtual bool setRefSpeed(int j, double sp) override { return true; }
+    virtual bool setRefSpeeds(const double *spds) override { return true; }
+    virtual bool setRefAcceleration(int j, double acc) override { return true; }
+    virtual bool setRefAccelerations(const double *accs) override { return true; }
+    virtual bool getRefSpeed(int j, double *ref) override { *ref = 0; return true; }
+    virtual bool getRefSpeeds(double *spds) override { return fill(spds, joints, 0); }
+    virtual bool getRefAcceleration(int j, double *acc) override { *acc = 0; return true; }
+    virtual bool getRefAccelerations(double *accs) override { return fill(accs, joints, 0); }
+    virtual bool stop(int j) override { return true; }
+    virtual bool stop() override { return true; }
+    virtual bool velocityMove(int j, double sp) override { return true; }
+    virtual bool velocityMove(const double *sp) override { return true; }
+
+    virtual bool resetEncoder(int j) override { return true; }
+    virtual bool resetEncoders() override { return true; }
+    virtual bool setEncoder(int j, double val) override { return true; }
+    virtual bool setEncoders(const double *vals) override { return true; }
+    virtual bool getEncoder(int j, double *v) override { *v = 50+j; return true; }
+    virtual bool getEncoders(double *encs) override { return fill(encs, joints, 50); }
+    virtual bool getEncoderSpeed(int j, double *sp) override { *sp = 0; return true; }
+    virtual bool getEncoderSpeeds(double *spds) override { return fill(spds, joints, 0); }
+    virtual bool getEncoderAcceleration(int j, double *acc) override { *acc = 0; return true; }
+    virtual bool getEncoderAccelerations(double *accs) override { return fill(accs, joints, 0); }
+    virtual bool getEncodersTimed(double *encs, double *time) override { fill(time, joints, 1); return fill(encs, joints, 50); }
+    virtual bool getEncoderTimed(int j, double *enc, double *time) override { *time = 1; *enc = 50+j; return true; }
+
+    virtual bool getNumberOfMotorEncoders(int *num) override { *num = motors; return true; }
+    virtual bool resetMotorEncoder(int m) override { return true; }
+    virtual bool resetMotorEncoders() override { return true; }
+    virtual bool setMotorEncoderCountsPerRevolution(int m, const double cpr) override { return true; }
+    virtual bool getMotorEncoderCountsPerRevolution(int m, double *cpr) override { *cpr = 1; return true; }
+    virtual bool setMotorEncoder(int m, const double val) override { return true; }
+    virtual bool setMotorEncoders(const double *vals) override { return true; }
+    virtual bool getMotorEncoder(int m, double *v) override { *v = 100+m; return true; }
+    virtual bool getMotorEncoders(double *encs) override { return fill(encs, motors, 100); }
+    virtual bool getMotorEncodersTimed(double *encs, double *time) override { fill(time, motors, 1); return fill(encs, motors, 100); }
+    virtual bool getMotorEncoderTimed(int m, double *enc, double *time) override { *time = 1; *enc = 100+m; return true; }
+    virtual bool getMotorEncoderSpeed(int m, double *sp) override { *sp = 0; return true; }
+    virtual bool getMotorEncoderSpeeds(double *spds) override { return fill(spds, motors, 0); }
+    virtual bool getMotorEncoderAcceleration(int m, double *acc) override { *acc = 0; return true; }
+    virtual bool getMotorEncoderAccelerations(double *accs) override { return fill(accs, motors, 0); }
+
+private:
+    bool fill(double *v, int n, double first) {
+        for (int i=0; i<n; i++) {
+            v[i] = first+i;
+        }
+        return true;
+    }
+};
+
+
+class ControlBoardWrapperTest : public UnitTest
+{
+public:
+    virtual ConstString getName() override { return "ControlBoardWrapperTest"; }
+
+    void checkMultiJointReads()
+    {
+        report(0, "checking multi-joint reads through the wrapper");
+
+        PolyDriver boardA, boardB, wrapper;
+        Property p;
+        p.fromConfig(boardA_file_content);
+        checkTrue(boardA.open(p), "board A opened");
+        p.fromConfig(boardB_file_content);
+        checkTrue(boardB.open(p), "board B opened");
+
+        // give each joint of the boards a different position
+        IControlMode2 *modeA = 0, *modeB = 0;
+        IPositionDirect *posA = 0, *posB = 0;
+        IEncoders *encA = 0, *encB = 0;
+        checkTrue(boardA.view(modeA) && boardA.view(posA) && boardA.view(encA), "board A interfaces");
+        checkTrue(boardB.view(modeB) && boardB.view(posB) && boardB.view(encB), "board B interfaces");
+        if (!modeA || !posA || !encA || !modeB || !posB || !encB) {
+            return;
+        }
+        for (int j=0; j<4; j++) {
+            modeA->setControlMode(j, VOCAB_CM_POSITION_DIRECT);
+            posA->setPosition(j, 10.0+j);
+        }
+        for (int j=0; j<3; j++) {
+            posB->setPosition(j, 20.0+j);
+        }
+
+        p.fromConfig(wrapper_file_content);
+        checkTrue(wrapper.open(p), "wrapper opened");
+        IMultipleWrapper *iwrap = 0;
+        wrapper.view(iwrap);
+        checkTrue(iwrap!=0, "wrapper can attach");
+        if (!iwrap) {
+            return;
+        }
+        PolyDriverList boards;
+        boards.push(&boardA, "net_a");
+        boards.push(&boardB, "net_b");
+        checkTrue(iwrap->attachAll(boards), "wrapper attached to both boards");
+
+        IEncodersTimed *enc = 0;
+        IControlMode *mode = 0;
+        checkTrue(wrapper.view(enc) && wrapper.view(mode), "wrapper interfaces");
+        double expected[5];
+        int expectedModes[5];
+        if (enc && mode) {
+            encA->getEncoder(1, &expected[0]);
+            encA->getEncoder(2, &expected[1]);
+            modeA->getControlMode(1, &expectedModes[0]);
+            modeA->getControlMode(2, &expectedModes[1]);
+            for (int j=0; j<3; j++) {
+                encB->getEncoder(j, &expected[2+j]);
+                modeB->getControlMode(j, &expectedModes[2+j]);
+            }
+
+            std::vector<double> encs(5, -1), stamps(5, -1);
+            std::vector<int> modes(5, -1);
+            checkTrue(enc->getEncoders(encs.data()), "getEncoders");
+            for (int j=0; j<5; j++) {
+                checkEqualish(encs[j], expected[j], "encoder read from the right joint of the right board");
+            }
+            checkTrue(enc->getEncodersTimed(encs.data(), stamps.data()), "getEncodersTimed");
+            for (int j=0; j<5; j++) {
+                double single, stamp;
+                enc->getEncoderTimed(j, &single, &stamp);
+                checkEqualish(encs[j], single, "timed encoder matches single joint read");
+            }
+            checkTrue(mode->getControlModes(modes.data()), "getControlModes");
+            for (int j=0; j<5; j++) {
+                checkEqual(modes[j], expectedModes[j], "control mode read from the right joint of the right board");
+            }
+        }
+
+        checkBatchedQueries();
+        checkCompactState(expected, expectedModes);
+
+        iwrap->detachAll();
+        wrapper.close();
+        boardB.close();
+        boardA.close();
+    }
+
+    // queries from a thread other than the one collecting a batch
+    class OtherQueries : public Thread
+    {
+    public:
+        IRpcBatch *batch;
+        IPositionControl *pos;
+        double direct;
+        double batched;
+        bool began;
+        bool ended;
+
+        OtherQueries(IRpcBatch *batch, IPositionControl *pos) :
+                batch(batch), pos(pos), direct(-1), batched(-1), began(false), ended(false)
+        {
+        }
+
+        virtual void run() override
+        {
+            pos->getRefSpeed(0, &direct);
+            began = batch->beginBatch();
+            pos->getRefSpeed(1, &batched);
+            ended = batch->endBatch();
+        }
+    };
+
+    void checkBatchedQueries()
+    {
+        report(0, "checking queries batched by a remote control board");
+
+        PolyDriver remote;
+        Property p;
+        p.put("device", "remote_controlboard");
+        p.put("remote", "/testControlBoardWrapper");
+        p.put("local", "/testControlBoardWrapper/client");
+        checkTrue(remote.open(p), "remote control board opened");
+
+        IRpcBatch *batch = 0;
+        IAxisInfo *info = 0;
+        IPositionControl *pos = 0;
+        checkTrue(remote.view(batch) && remote.view(info) && remote.view(pos), "remote interfaces");
+        if (!batch || !info || !pos) {
+            return;
+        }
+
+        const char *names[5] = { "axisA2", "axisA3", "axisB1", "axisB2", "axisB3" };
+        std::vector<ConstString> bnames(5);
+        std::vector<double> speed(5), acc(5);
+        std::vector<double> bspeed(5, -1), bacc(5, -1);
+        for (int j=0; j<5; j++) {
+            pos->getRefSpeed(j, &speed[j]);
+            pos->getRefAcceleration(j, &acc[j]);
+        }
+
+        checkTrue(batch->beginBatch(), "batch started");
+        checkFalse(batch->beginBatch(), "batches do not nest");
+        for (int j=0; j<5; j++) {
+            checkTrue(info->getAxisName(j, bnames[j]), "getAxisName queued");
+            pos->getRefSpeed(j, &bspeed[j]);
+            pos->getRefAcceleration(j, &bacc[j]);
+        }
+        checkEqualish(bspeed[0], -1, "queued query not sent yet");
+        OtherQueries other(batch, pos);
+        other.start();
+        other.join();
+        checkEqualish(other.direct, speed[0], "other threads query directly");
+        checkTrue(other.began && other.ended, "other threads have batches of their own");
+        checkEqualish(other.batched, speed[1], "query batched by another thread");
+        checkTrue(batch->endBatch(), "batch completed");
+        for (int j=0; j<5; j++) {
+            checkEqual(bnames[j], names[j], "batched axis name");
+            checkEqualish(bspeed[j], speed[j], "batched ref speed");
+            checkEqualish(bacc[j], acc[j], "batched ref acceleration");
+        }
+
+        // a command is sent after the queries before it and before the ones after it
+        double before = -1, after = -1;
+        checkTrue(batch->beginBatch(), "second batch started");
+        pos->getRefSpeed(3, &before);
+        pos->setRefSpeed(3, speed[3]+5);
+        pos->getRefSpeed(3, &after);
+        checkTrue(batch->endBatch(), "second batch completed");
+        checkEqualish(before, speed[3], "query before the command");
+        checkEqualish(after, speed[3]+5, "query after the command");
+
+        checkFalse(batch->endBatch(), "no batch to end");
+        remote.close();
+    }
+
+    void checkCompactState(const double *expected, const int *expectedModes)
+    {
+        report(0, "checking a remote control board streaming only some fields");
+
+        PolyDriver remote;
+        Property p;
+        p.fromString("(device remote_controlboard) (remote /testControlBoardWrapper) (local /testControlBoardWrapper/compact) (carrier tcp) (stateFields (jointPosition controlMode))");
+        checkTrue(remote.open(p), "remote control board opened");
+
+        IEncoders *enc = 0;
+        IControlMode2 *mode = 0;
+        ITorqueControl *trq = 0;
+        checkTrue(remote.view(enc) && remote.view(mode) && remote.view(trq), "remote interfaces");
+        if (!enc || !mode || !trq) {
+            return;
+        }
+
+        std::vector<double> encs(5, -1), torques(5);
+        bool ok = false;
+        for (int i=0; i<100 && !ok; i++) {
+            ok = enc->getEncoders(encs.data());
+            if (!ok) {
+                Time::delay(0.02);
+            }
+        }
+        checkTrue(ok, "encoders streamed");
+        for (int j=0; j<5; j++) {
+            checkEqualish(encs[j], expected[j], "streamed encoder");
+        }
+
+        int joints[2] = { 4, 1 };
+        int modes[2] = { -1, -1 };
+        checkTrue(mode->getControlModes(2, joints, modes), "control modes of a group of joints streamed");
+        checkEqual(modes[0], expectedModes[4], "control mode of joint 4");
+        checkEqual(modes[1], expectedModes[1], "control mode of joint 1");
+
+        checkFalse(trq->getTorques(torques.data()), "torques not streamed");
+        remote.close();
+    }
+
+    void checkOverlappingMap()
+    {
+        report(0, "checking a wrapper mapping a joint twice does not open");
+        PolyDriver wrapper;
+        Property p;
+        p.fromConfig(overlap_file_content);
+        checkFalse(wrapper.open(p), "wrapper with overlapping networks refused");
+    }
+
+    void checkMoreMotorsThanJoints()
+    {
+        report(0, "checking motor reads of a board with more motors than joints");
+
+        PolyDriver boardB, boardM, wrapper;
+        Property p;
+        p.fromConfig(boardB_file_content);
+        checkTrue(boardB.open(p), "board B opened");
+        p.clear();
+        p.put("device", "moremotorsboard");
+        checkTrue(boardM.open(p), "board with more motors opened");
+
+        p.fromConfig(motors_file_content);
+        checkTrue(wrapper.open(p), "wrapper opened");
+        IMultipleWrapper *iwrap = 0;
+        wrapper.view(iwrap);
+        if (!iwrap) {
+            return;
+        }
+        PolyDriverList boards;
+        boards.push(&boardB, "net_b");
+        boards.push(&boardM, "net_m");
+        checkTrue(iwrap->attachAll(boards), "wrapper attached to both boards");
+
+        IMotorEncoders *menc = 0;
+        wrapper.view(menc);
+        checkTrue(menc!=0, "wrapper motor encoders");
+        if (menc) {
+            // a guard value after the 5 joints, the last board must not write there
+            std::vector<double> encs(6, -1), stamps(6, -1);
+            checkTrue(menc->getMotorEncoders(encs.data()), "getMotorEncoders");
+            checkEqualish(encs[3], 100, "first motor of the board");
+            checkEqualish(encs[4], 101, "second motor of the board");
+            checkEqualish(encs[5], -1, "nothing written after the last joint");
+            checkTrue(menc->getMotorEncodersTimed(encs.data(), stamps.data()), "getMotorEncodersTimed");
+            checkEqualish(encs[5], -1, "nothing written after the last joint, timed");
+            checkEqualish(stamps[5], -1, "nothing written after the last stamp");
+        }
+
+        // the wrapper thread refreshes the motor encoders of each board too
+        Time::delay(0.1);
+
+        iwrap->detachAll();
+        wrapper.close();
+        boardM.close();
+        boardB.close();
+    }
+
+    virtual void runTests() override
+    {
+        Network::setLocalMode(true);
+        Drivers::factory().add(new DriverCreatorOf<MoreMotorsBoard>("moremotorsboard",
+                                                                    "",
+                                                                    "MoreMotorsBoard"));
+        checkMultiJointReads();
+        checkOverlappingMap();
+        checkMoreMotorsThanJoints();
+        Network::setLocalMode(false);
+    }
+};
+
+static ControlBoardWrapperTest theControlBoardWrapperTest;
+
+UnitTest& getControlBoardWrapperTest()
+{
+    return theControlBoardWrapperTest;
+}
@@ -5,6 +5,7 @@
  *
  */
 
+#include <algorithm>
 #include <vector>
 
 #include <yarp/os/impl/UnitTest.h>
@@ -379,6 +380,39 @@ public:
             checkTrue(a && b && c, "itf->setTransformStatic still working after duplicate transform");
         }
 
+        //test 13
+        {
+            itf->clear();
+            double before = yarp::os::Time::now();
+            yarp::os::Time::delay(0.020);
+            itf->setTransform("frame2", "frame1", m1);
+            yarp::os::Time::delay(0.050);
+            double between = yarp::os::Time::now();
+            yarp::os::Time::delay(0.050);
+            itf->setTransform("frame2", "frame1", m2);
+            itf->setTransformStatic("frame3", "frame2", m2);
+            yarp::os::Time::delay(0.050);
+            double after = yarp::os::Time::now();
+
+            yarp::sig::Matrix mt;
+            checkFalse(itf->getTransform("frame2", "frame1", before, mt), "getTransform older than the transform fails");
+            bool b_after = itf->getTransform("frame3", "frame1", after, mt);
+            checkTrue(b_after && isEqual(mt, m2*m2, precision), "getTransform at a time after the last update");
+
+            yarp::sig::Matrix mb;
+            bool b_between = itf->getTransform("frame2", "frame1", between, mb);
+            bool in_range = b_between;
+            for (int i = 0; i < 3 && in_range; i++)
+            {
+                double lo = std::min(m1[i][3], m2[i][3]);
+                double hi = std::max(m1[i][3], m2[i][3]);
+                in_range = mb[i][3] >= lo - precision && mb[i][3] <= hi + precision;
+            }
+            yarp::sig::Matrix rot = mb.submatrix(0, 2, 0, 2);
+            in_range = in_range && isEqual(rot * rot.transposed(), yarp::math::eye(3), 1e-6);
+            checkTrue(in_range, "getTransform in between two updates is interpolated");
+        }
+
         // Close devices
         bool cl1 = ddtransformclient.close();
         bool cl2 = ddtransformserver.close();
@@ -20,8 +20,11 @@
 #include <yarp/dev/IMap2D.h>
 #include <yarp/os/Port.h>
 #include <yarp/os/Bottle.h>
+#include <yarp/os/Portable.h>
 #include <yarp/os/Time.h>
 
+#include <cmath>
+
 #include "TestList.h"
 
 using namespace yarp::dev;
@@ -173,11 +176,160 @@ public:
         return true;
     }
 
+    void testEnlargeObstacles()
+    {
+        report(0, "checking the clearance and the enlargement of the obstacles");
+
+        MapGrid2D test_map;
+        test_map.setResolution(0.5);
+        test_map.setSize_in_cells(7, 7);
+        MapGrid2D::XYCell center(3, 3);
+        double distance = 0;
+        checkTrue(test_map.getClearance(center, distance), "getClearance() of a cell inside the map");
+        checkTrue(distance > 1e30, "clearance of a map without obstacles is infinite");
+        checkFalse(test_map.getClearance(MapGrid2D::XYCell(7, 0), distance), "getClearance() of a cell outside the map");
+
+        test_map.setMapFlag(center, MapGrid2D::map_flags::MAP_CELL_WALL);
+        test_map.getClearance(center, distance);
+        checkEqualish(distance, 0.0, "clearance of an obstacle");
+        test_map.getClearance(MapGrid2D::XYCell(5, 3), distance);
+        checkEqualish(distance, 1.0, "clearance along a row");
+        test_map.getClearance(MapGrid2D::XYCell(3, 0), distance);
+        checkEqualish(distance, 1.5, "clearance along a column");
+        test_map.getClearance(MapGrid2D::XYCell(5, 5), distance);
+        checkEqualish(distance, sqrt(8.0)*0.5, "euclidean clearance along a diagonal");
+
+        test_map.enlargeObstacles(0.6);
+        checkTrue(test_map.isNotFree(MapGrid2D::XYCell(4, 3)), "cell next to the obstacle enlarged");
+        checkTrue(test_map.isNotFree(MapGrid2D::XYCell(3, 2)), "cell above the obstacle enlarged");
+        checkTrue(test_map.isFree(MapGrid2D::XYCell(4, 4)), "diagonal cell farther than the enlargement still free");
+        checkTrue(test_map.isFree(MapGrid2D::XYCell(5, 3)), "cell two cells away still free");
+        test_map.getClearance(MapGrid2D::XYCell(5, 3), distance);
+        checkEqualish(distance, 1.0, "enlarged cells are not obstacles");
+
+        test_map.enlargeObstacles(0.5);
+        checkTrue(test_map.isNotFree(MapGrid2D::XYCell(4, 4)), "enlargements sum up, diagonal cell");
+        checkTrue(test_map.isNotFree(MapGrid2D::XYCell(5, 3)), "enlargements sum up, cell two cells away");
+        checkTrue(test_map.isFree(MapGrid2D::XYCell(5, 4)), "cell farther than the sum still free");
+
+        //as for a map read from a file, the size of the enlargement is not known
+        test_map.enlargeObstacles(0);
+        test_map.enlargeObstacles(0.6);
+        MapGrid2D received_map;
+        checkTrue(Portable::copyPortable(test_map, received_map), "enlarged map sent");
+        test_map = received_map;
+        test_map.enlargeObstacles(0.5);
+        checkTrue(test_map.isNotFree(MapGrid2D::XYCell(5, 3)), "enlargements of an enlarged map sum up");
+        checkTrue(test_map.isFree(MapGrid2D::XYCell(5, 4)), "enlarged map, cell farther than the sum still free");
+
+        test_map.enlargeObstacles(0);
+        checkTrue(test_map.isFree(MapGrid2D::XYCell(4, 3)), "enlargement cleaned up");
+        checkTrue(test_map.isWall(center), "obstacle kept");
+
+        test_map.setMapFlag(MapGrid2D::XYCell(6, 3), MapGrid2D::map_flags::MAP_CELL_KEEP_OUT);
+        test_map.getClearance(MapGrid2D::XYCell(5, 3), distance);
+        checkEqualish(distance, 0.5, "clearance updated after the map is changed");
+
+        MapGrid2D empty_map;
+        empty_map.setSize_in_cells(4, 0);
+        checkTrue(empty_map.enlargeObstacles(1.0), "enlargement of a map without cells");
+    }
+
+    void testTiles()
+    {
+        report(0, "checking the maps exchanged by tiles");
+
+        MapGrid2D map1;
+        map1.setMapName("tiled_map");
+        map1.setSize_in_cells(70, 40);
+        map1.setMapFlag(MapGrid2D::XYCell(40, 10), MapGrid2D::map_flags::MAP_CELL_WALL);
+        map1.setMapFlag(MapGrid2D::XYCell(69, 39), MapGrid2D::map_flags::MAP_CELL_KEEP_OUT);
+        size_t tiles_x = 0, tiles_y = 0;
+        map1.getSize_in_tiles(tiles_x, tiles_y);
+        checkTrue(tiles_x == 3 && tiles_y == 2, "number of tiles");
+
+        MapGrid2D map2;
+        map2.setMapName("tiled_map");
+        map2.setSize_in_cells(70, 40);
+        checkTrue(map1.isTileIdenticalTo(map2, 0, 0), "identical tile");
+        checkFalse(map1.isTileIdenticalTo(map2, 1, 0), "tile with a wall");
+        std::string data;
+        checkTrue(map1.getTileData(0, 0, data), "getTileData()");
+        checkTrue(data.size() < 50, "uniform tile compressed");
+        for (size_t y = 0; y < tiles_y; y++)
+        {
+            for (size_t x = 0; x < tiles_x; x++)
+            {
+                map1.getTileData(x, y, data);
+                map2.setTileData(x, y, data);
+            }
+        }
+        checkTrue(map1.isIdenticalTo(map2), "map copied by tiles");
+        checkFalse(map1.getTileData(3, 0, data), "tile outside the map");
+        checkFalse(map2.setTileData(0, 0, "x"), "invalid tile data");
+
+        PolyDriver ddmapserver, ddclient1, ddclient2;
+        Property p;
+        p.put("device", "map2DServer");
+        p.put("name", "/mapServerTiles/rpc");
+        checkTrue(ddmapserver.open(p), "server opened");
+        p.clear();
+        p.put("device", "map2DClient");
+        p.put("local", "/mapClientTiles1");
+        p.put("remote", "/mapServerTiles");
+        p.put("updates", 1);
+        checkTrue(ddclient1.open(p), "client receiving the updates opened");
+        p.put("local", "/mapClientTiles2");
+        p.put("updates", 0);
+        checkTrue(ddclient2.open(p), "client opened");
+        IMap2D *imap1 = 0, *imap2 = 0;
+        ddclient1.view(imap1);
+        ddclient2.view(imap2);
+        if (imap1 == 0 || imap2 == 0)
+        {
+            return;
+        }
+
+        MapGrid2D got;
+        checkTrue(imap1->store_map(map1), "map stored");
+        checkTrue(imap2->get_map("tiled_map", got), "map retrieved");
+        checkTrue(got.isIdenticalTo(map1), "retrieved map identical");
+
+        got.setMapFlag(MapGrid2D::XYCell(5, 35), MapGrid2D::map_flags::MAP_CELL_TEMPORARY_OBSTACLE);
+        checkTrue(imap2->store_map(got), "changed map stored");
+        Time::delay(0.2);
+        MapGrid2D got1;
+        checkTrue(imap1->get_map("tiled_map", got1), "changed map retrieved by the other client");
+        checkTrue(got1.isIdenticalTo(got), "changed map identical");
+
+        got1.setMapFlag(MapGrid2D::XYCell(6, 35), MapGrid2D::map_flags::MAP_CELL_TEMPORARY_OBSTACLE);
+        checkTrue(imap1->store_map(got1), "map changed again");
+        got.setOrigin(1, 2, 0);
+        checkTrue(imap2->store_map(got), "outdated map stored");
+        checkTrue(imap1->get_map("tiled_map", got1), "map retrieved after a conflicting change");
+        checkTrue(got1.isIdenticalTo(got), "the last map stored wins");
+
+        map2.setSize_in_cells(20, 20);
+        map2.setMapFlag(MapGrid2D::XYCell(3, 3), MapGrid2D::map_flags::MAP_CELL_WALL);
+        checkTrue(imap2->store_map(map2), "map resized");
+        checkTrue(imap1->get_map("tiled_map", got1), "resized map retrieved");
+        checkTrue(got1.isIdenticalTo(map2), "resized map identical");
+
+        imap1->remove_map("tiled_map");
+        checkFalse(imap2->get_map("tiled_map", got), "removed map not retrieved");
+
+        ddclient2.close();
+        ddclient1.close();
+        ddmapserver.close();
+    }
+
     virtual void runTests() override
     {
         Network::setLocalMode(true);
         testDataType();
+        testEnlargeObstacles();
         testClientServer();
+        testTiles();
         Network::setLocalMode(false);
     }
 };
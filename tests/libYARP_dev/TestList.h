@@ -25,6 +25,7 @@ extern yarp::os::impl::UnitTest& getRobotDescriptionTest();
 
 #ifdef YARP_CONTROLBOARDREMAPPER_TESTS
 extern yarp::os::impl::UnitTest& getControlBoardRemapperTest();
+extern yarp::os::impl::UnitTest& getControlBoardWrapperTest();
 #endif
 
 #ifdef YARP_ANALOGWRAPPER_TESTS
@@ -48,6 +49,7 @@ public:
         root.add(getRobotDescriptionTest());
 #ifdef YARP_CONTROLBOARDREMAPPER_TESTS
         root.add(getControlBoardRemapperTest());
+        root.add(getControlBoardWrapperTest());
 #endif
 #ifdef YARP_ANALOGWRAPPER_TESTS
         root.add(getAnalogWrapperTest());
@@ -106,6 +106,37 @@ public:
         checkTrue(result.find(target)!=ConstString::npos,"answer found");
     }
 
+    void checkQueryMany() {
+        report(0,"checking query of several ports...");
+        NameClient& nic = NameClient::getNameClient();
+        nic.registerName("/check/many1",Contact("tcp", "192.168.1.101", 9997));
+        nic.registerName("/check/many2",Contact("tcp", "192.168.1.102", 9996));
+        Bottle cmd("bot query /check/many1 /check/nothing /check/many2");
+        Bottle reply;
+        nic.send(cmd,reply);
+        checkEqual(reply.get(0).asString(),"ports","reply to a query of several ports");
+        checkEqual(reply.size(),4,"one entry per port");
+        Bottle *p1 = reply.get(1).asList();
+        Bottle *p2 = reply.get(2).asList();
+        Bottle *p3 = reply.get(3).asList();
+        checkTrue(p1!=YARP_NULLPTR&&p2!=YARP_NULLPTR&&p3!=YARP_NULLPTR,"entries are lists");
+        if (p1!=YARP_NULLPTR&&p2!=YARP_NULLPTR&&p3!=YARP_NULLPTR) {
+            checkEqual(p1->find("port_number").asInt(),9997,"first port found");
+            checkTrue(p2->check("error"),"unknown port reported");
+            checkEqual(p3->find("port_number").asInt(),9996,"second port found");
+        }
+
+        std::vector<ConstString> names;
+        names.push_back("/check/many2");
+        names.push_back("/check/nothing");
+        names.push_back("/check/many1");
+        std::vector<Contact> contacts = nic.queryNames(names);
+        checkEqual((int)contacts.size(),3,"one address per port");
+        checkEqual(contacts[0].getPort(),9996,"first address");
+        checkFalse(contacts[1].isValid(),"no address for unknown port");
+        checkEqual(contacts[2].getPort(),9997,"third address");
+    }
+
     virtual void runTests() override {
         NetworkBase::setLocalMode(true);
 
@@ -115,6 +146,7 @@ public:
         checkPortRegister();
         checkList();
         checkSetGet();
+        checkQueryMany();
 
         NetworkBase::setLocalMode(false);
 
@@ -16,12 +16,21 @@
 #include <yarp/os/impl/BufferedConnectionWriter.h>
 #include <yarp/sig/Image.h>
 #include <yarp/sig/ImageDraw.h>
+#include <yarp/sig/impl/Demosaic.h>
+#include <yarp/sig/impl/ImagePool.h>
+#include <yarp/sig/impl/ParallelBands.h>
+#include <yarp/sig/impl/PixelConversion.h>
 #include <yarp/os/Network.h>
 #include <yarp/os/PortReaderBuffer.h>
 #include <yarp/os/Port.h>
 #include <yarp/os/Bottle.h>
 #include <yarp/os/Time.h>
 
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
 #include "TestList.h"
 
 using namespace yarp::os::impl;
@@ -360,6 +369,88 @@ public:
         checkEqual(img.width(),4,"dimension check");
     }
 
+    void testResample() {
+        report(0,"checking scaling filters...");
+
+        // nearest keeps the coordinates of the original scaled copy
+        ImageOf<PixelMono> ramp;
+        ramp.resize(8,6);
+        for (int x=0; x<ramp.width(); x++) {
+            for (int y=0; y<ramp.height(); y++) {
+                ramp(x,y) = (unsigned char)(x*20+y*2);
+            }
+        }
+        ImageOf<PixelMono> out;
+        out.copy(ramp,5,4);
+        int mismatch = 0;
+        for (int x=0; x<5; x++) {
+            for (int y=0; y<4; y++) {
+                if (out(x,y)!=ramp((int)((8.0f/5)*x),(int)((6.0f/4)*y))) {
+                    mismatch++;
+                }
+            }
+        }
+        checkEqual(mismatch,0,"nearest scaling");
+
+        out.copy(ramp,4,3,Image::RESAMPLE_AREA);
+        checkEqual(out(0,0),11,"area averages 2x2 blocks");
+        checkEqual(out(3,2),(int)ramp(6,4)+11,"area averages 2x2 blocks");
+        out.copy(ramp,5,3,Image::RESAMPLE_AREA);
+        checkEqual(out(2,1),75,"area averages fractional blocks");
+        out.copy(ramp,4,3,Image::RESAMPLE_BILINEAR);
+        checkEqual(out(1,1),(int)ramp(2,2)+11,"bilinear halving averages 2x2 blocks");
+        out.copy(ramp,16,12,Image::RESAMPLE_BILINEAR);
+        checkEqual(out(0,0),0,"bilinear borders clamped");
+        checkEqual(out(2,0),15,"bilinear doubling interpolates");
+        checkEqual(out(15,11),(int)ramp(7,5),"bilinear borders clamped");
+
+        // channels are filtered separately, and saturated
+        ImageOf<PixelRgba> color;
+        color.resize(6,6);
+        for (int x=0; x<6; x++) {
+            for (int y=0; y<6; y++) {
+                color(x,y) = PixelRgba(255,(x<3)?0:90,(unsigned char)(y*40),7);
+            }
+        }
+        ImageOf<PixelRgba> color2;
+        color2.copy(color,2,2,Image::RESAMPLE_AREA);
+        checkEqual(color2(1,1).r,255,"red channel");
+        checkEqual(color2(0,1).g,0,"green channel");
+        checkEqual(color2(1,1).g,90,"green channel");
+        checkEqual(color2(1,0).b,40,"blue channel");
+        checkEqual(color2(1,1).a,7,"alpha channel");
+
+        // deep pixel types keep their range
+        ImageOf<PixelMono16> depth;
+        depth.resize(4,4);
+        ImageOf<PixelFloat> fdepth;
+        fdepth.resize(4,4);
+        for (int x=0; x<4; x++) {
+            for (int y=0; y<4; y++) {
+                depth(x,y) = (PixelMono16)(1000*x+10*y);
+                fdepth(x,y) = 0.25f*x;
+            }
+        }
+        ImageOf<PixelMono16> depth2;
+        depth2.copy(depth,2,2,Image::RESAMPLE_AREA);
+        checkEqual((int)depth2(1,1),2525,"16 bit area");
+        // blocks of 16 bit values whose sum does not fit in an int
+        ImageOf<PixelMono16> bright;
+        bright.resize(256,256);
+        for (int x=0; x<256; x++) {
+            for (int y=0; y<256; y++) {
+                bright(x,y) = 60000;
+            }
+        }
+        depth2.copy(bright,1,1,Image::RESAMPLE_AREA);
+        checkEqual((int)depth2(0,0),60000,"16 bit area of large blocks");
+        ImageOf<PixelFloat> fdepth2;
+        fdepth2.copy(fdepth,2,1,Image::RESAMPLE_BILINEAR);
+        checkEqualish(fdepth2(1,0),0.625,"float bilinear");
+        fdepth2.copy(fdepth,3,3,Image::RESAMPLE_AREA);
+        checkEqualish(fdepth2(1,1),0.375,"float area with fractional coverage");
+    }
+
     // test row pointer access (getRow())
     // this function only tests if getRow(r)[c] is consistent with the operator ()
     void testRowPointer()
@@ -556,6 +647,282 @@ public:
     }
 
 
+    void fillRandom(FlexImage& img) {
+        for (int y=0; y<img.height(); y++) {
+            unsigned char *row = img.getRow(y);
+            if (img.getPixelCode()==VOCAB_PIXEL_MONO_FLOAT) {
+                float *f = (float*)row;
+                for (int x=0; x<img.width(); x++) {
+                    f[x] = (rand()%3000)/10.0f;
+                }
+            } else {
+                for (int x=0; x<img.width()*img.getPixelSize(); x++) {
+                    row[x] = (unsigned char)rand();
+                }
+            }
+        }
+    }
+
+    bool sameRows(const Image& a, const Image& b) {
+        for (int y=0; y<a.height(); y++) {
+            if (memcmp(a.getRow(y),b.getRow(y),a.width()*a.getPixelSize())!=0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void testVectorizedCopy() {
+        report(0,"checking vectorized copies match the per pixel ones...");
+
+        using yarp::sig::impl::PixelConversion;
+        const int codes[][2] = {
+            { VOCAB_PIXEL_MONO, 1 },
+            { VOCAB_PIXEL_MONO16, 2 },
+            { VOCAB_PIXEL_MONO_FLOAT, 4 },
+            { VOCAB_PIXEL_RGB, 3 },
+            { VOCAB_PIXEL_BGR, 3 },
+            { VOCAB_PIXEL_RGBA, 4 },
+            { VOCAB_PIXEL_BGRA, 4 }
+        };
+        const int ncodes = sizeof(codes)/sizeof(codes[0]);
+        // odd widths leave pixels to the per pixel loop, large images are split among threads
+        const int sizes[][2] = { { 1, 3 }, { 37, 5 }, { 67, 4 }, { 1031, 700 } };
+        PixelConversion::InstructionSet supported = PixelConversion::getSupportedInstructionSet();
+        report(0,ConstString("instructions: ") + PixelConversion::getInstructionSetName(supported));
+
+        int pairs = 0;
+        int mismatch = 0;
+        for (int i=0; i<ncodes; i++) {
+            for (int j=0; j<ncodes; j++) {
+                PixelConversion::setInstructionSet(supported);
+                if (!PixelConversion::isVectorized(codes[i][0],codes[j][0])) {
+                    continue;
+                }
+                pairs++;
+                for (int k=0; k<4; k++) {
+                    FlexImage src;
+                    src.setPixelCode(codes[i][0]);
+                    src.setPixelSize(codes[i][1]);
+                    src.setQuantum((k%2==0)?1:8);
+                    src.resize(sizes[k][0],sizes[k][1]);
+                    fillRandom(src);
+
+                    FlexImage expected, actual;
+                    expected.setPixelCode(codes[j][0]);
+                    expected.setPixelSize(codes[j][1]);
+                    expected.setQuantum((k<2)?4:1);
+                    expected.setTopIsLowIndex(k!=1);
+                    actual.setPixelCode(codes[j][0]);
+                    actual.setPixelSize(codes[j][1]);
+                    actual.setQuantum((k<2)?4:1);
+                    actual.setTopIsLowIndex(k!=1);
+
+                    PixelConversion::setInstructionSet(PixelConversion::SIMD_NONE);
+                    expected.copy(src);
+                    // AVX2 leaves some conversions to SSSE3, check both
+                    for (int set=supported; set>=PixelConversion::SIMD_SSSE3; set--) {
+                        PixelConversion::setInstructionSet((PixelConversion::InstructionSet)set);
+                        actual.copy(src);
+                        if (!sameRows(expected,actual)) {
+                            mismatch++;
+                        }
+                        if (set==PixelConversion::SIMD_NEON) {
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        PixelConversion::setInstructionSet(supported);
+        report(0,ConstString("vectorized conversions: ") + NetType::toString(pairs));
+        checkEqual(mismatch,0,"same pixels as the per pixel copy");
+    }
+
+    // sample a colour image with a Bayer pattern, like "grbg"
+    void mosaic(const ImageOf<PixelRgb>& img, const char *pattern, int shift, FlexImage& raw) {
+        raw.resize(img.width(),img.height());
+        for (int y=0; y<img.height(); y++) {
+            for (int x=0; x<img.width(); x++) {
+                const PixelRgb& p = img(x,y);
+                char c = pattern[(y%2)*2+x%2];
+                int v = (c=='r') ? p.r : ((c=='g') ? p.g : p.b);
+                if (raw.getPixelSize()==1) {
+                    raw.getRow(y)[x] = (unsigned char)v;
+                } else {
+                    ((PixelMono16*)raw.getRow(y))[x] = (PixelMono16)(v<<shift);
+                }
+            }
+        }
+    }
+
+    void testDemosaic() {
+        report(0,"checking demosaicing...");
+
+        using yarp::sig::impl::Demosaic;
+        using yarp::sig::impl::PixelConversion;
+        const char *patterns[4] = { "grbg", "bggr", "gbrg", "rggb" };
+        const int codes8[4] = { VOCAB_PIXEL_ENCODING_BAYER_GRBG8, VOCAB_PIXEL_ENCODING_BAYER_BGGR8,
+                                VOCAB_PIXEL_ENCODING_BAYER_GBRG8, VOCAB_PIXEL_ENCODING_BAYER_RGGB8 };
+        const int codes16[4] = { VOCAB_PIXEL_ENCODING_BAYER_GRBG16, VOCAB_PIXEL_ENCODING_BAYER_BGGR16,
+                                 VOCAB_PIXEL_ENCODING_BAYER_GBRG16, VOCAB_PIXEL_ENCODING_BAYER_RGGB16 };
+        const Demosaic::Method methods[3] = { Demosaic::DEMOSAIC_BILINEAR, Demosaic::DEMOSAIC_MALVAR, Demosaic::DEMOSAIC_HALF };
+
+        // a flat colour is kept everywhere, borders included
+        ImageOf<PixelRgb> flat;
+        flat.resize(41,7);
+        for (int x=0; x<flat.width(); x++) {
+            for (int y=0; y<flat.height(); y++) {
+                flat(x,y) = PixelRgb(200,100,30);
+            }
+        }
+        int mismatch = 0;
+        for (int i=0; i<4; i++) {
+            for (int depth=0; depth<2; depth++) {
+                FlexImage raw;
+                raw.setPixelCode(depth ? VOCAB_PIXEL_MONO16 : VOCAB_PIXEL_MONO);
+                raw.setPixelSize(depth ? 2 : 1);
+                mosaic(flat,patterns[i],4,raw);
+                for (int m=0; m<3; m++) {
+                    ImageOf<PixelBgra> out;
+                    checkTrue(Demosaic::convert(raw,depth ? codes16[i] : codes8[i],out,methods[m],12),"converted");
+                    for (int x=0; x<out.width(); x++) {
+                        for (int y=0; y<out.height(); y++) {
+                            const PixelBgra& p = out(x,y);
+                            if (p.r!=200 || p.g!=100 || p.b!=30 || p.a!=255) {
+                                mismatch++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        checkEqual(mismatch,0,"flat colour kept");
+
+        // the vectorized rows match the per pixel ones
+        PixelConversion::InstructionSet supported = PixelConversion::getSupportedInstructionSet();
+        ImageOf<PixelRgb> noise;
+        noise.resize(67,9);
+        for (int x=0; x<noise.width(); x++) {
+            for (int y=0; y<noise.height(); y++) {
+                noise(x,y) = PixelRgb((unsigned char)rand(),(unsigned char)rand(),(unsigned char)rand());
+            }
+        }
+        mismatch = 0;
+        for (int i=0; i<4; i++) {
+            for (int depth=0; depth<2; depth++) {
+                FlexImage raw;
+                raw.setPixelCode(depth ? VOCAB_PIXEL_MONO16 : VOCAB_PIXEL_MONO);
+                raw.setPixelSize(depth ? 2 : 1);
+                mosaic(noise,patterns[i],8,raw);
+                for (int m=0; m<2; m++) {
+                    ImageOf<PixelRgb> expected, actual;
+                    ImageOf<PixelRgba> expected4, actual4;
+                    int code = depth ? codes16[i] : codes8[i];
+                    PixelConversion::setInstructionSet(PixelConversion::SIMD_NONE);
+                    Demosaic::convert(raw,code,expected,methods[m]);
+                    Demosaic::convert(raw,code,expected4,methods[m]);
+                    PixelConversion::setInstructionSet(supported);
+                    Demosaic::convert(raw,code,actual,methods[m]);
+                    Demosaic::convert(raw,code,actual4,methods[m]);
+                    if (!sameRows(expected,actual) || !sameRows(expected4,actual4)) {
+                        mismatch++;
+                    }
+                }
+            }
+        }
+        checkEqual(mismatch,0,"same pixels with and without vector instructions");
+
+        // bayer images are demosaiced when read into colour images
+        FlexImage raw;
+        raw.setPixelCode(VOCAB_PIXEL_MONO);
+        raw.setPixelSize(1);
+        mosaic(flat,"rggb",0,raw);
+        raw.setPixelCode(VOCAB_PIXEL_ENCODING_BAYER_RGGB8);
+        ImageOf<PixelRgb> received;
+        checkTrue(Portable::copyPortable(raw,received),"bayer image received");
+        checkEqual(received.width(),flat.width(),"width check");
+        checkEqual(received(20,3).r,200,"red");
+        checkEqual(received(20,3).g,100,"green");
+        checkEqual(received(20,3).b,30,"blue");
+    }
+
+    void testImagePool() {
+        report(0,"checking images reuse the memory released...");
+
+        using yarp::sig::impl::ImagePool;
+        ImageOf<PixelRgb> src;
+        src.resize(320,240);
+        for (int x=0; x<src.width(); x++) {
+            for (int y=0; y<src.height(); y++) {
+                src(x,y) = PixelRgb((unsigned char)x,(unsigned char)y,(unsigned char)(x+y));
+            }
+        }
+        checkEqual((int)(((size_t)src.getRawImage())%ImagePool::ALIGNMENT),0,"pixels aligned");
+
+        // a received image needing a conversion goes through a temporary one
+        ImageOf<PixelBgr> dest;
+        for (int i=0; i<5; i++) {
+            if (i==1) {
+                ImagePool::resetStatistics();
+            }
+            checkTrue(Portable::copyPortable(src,dest),"converted");
+            ImageOf<PixelMono> scaled;
+            scaled.copy(dest,160,120);
+        }
+        ImagePool::Statistics stats = ImagePool::getStatistics();
+        checkEqual((int)stats.allocations,0,"no allocation in steady state");
+        checkTrue(stats.reuses>0,"released memory reused");
+        checkEqual((int)stats.reuses,(int)stats.releases,"every block released is reused");
+        checkEqual(dest(10,20).r,src(10,20).r,"pixels converted");
+
+        ImagePool::setEnabled(false);
+        checkEqual((int)ImagePool::getStatistics().cachedBytes,0,"cache emptied when disabled");
+        checkTrue(Portable::copyPortable(src,dest),"converted without reuse");
+        checkTrue(ImagePool::getStatistics().allocations>0,"memory allocated without reuse");
+        ImagePool::setEnabled(true);
+
+        size_t limit = ImagePool::getCacheLimit();
+        ImagePool::setCacheLimit(0);
+        {
+            ImageOf<PixelRgb> tmp;
+            tmp.resize(64,64);
+        }
+        checkEqual((int)ImagePool::getStatistics().cachedBytes,0,"cache limited");
+        ImagePool::setCacheLimit(limit);
+    }
+
+    void testParallelBands() {
+        report(0,"checking images processed in bands");
+        using yarp::sig::impl::ParallelBands;
+
+        checkEqual(ParallelBands::getBandCount(ParallelBands::PARALLEL_BYTES-1,8,100),1,"small image in one band");
+        checkEqual(ParallelBands::getBandCount(ParallelBands::PARALLEL_BYTES,3,100),3,"threads requested");
+        checkEqual(ParallelBands::getBandCount(ParallelBands::PARALLEL_BYTES,8,2),2,"no more bands than allowed");
+        int bands = ParallelBands::getBandCount(ParallelBands::PARALLEL_BYTES,0,100);
+        checkTrue(bands>=1 && bands<=ParallelBands::MAX_THREADS,"default number of bands");
+
+        // two callers at once, sharing the pool, more bands than workers
+        std::vector<int> first(7,0), second(9,0);
+        std::thread other([&second]() {
+            for (int k=0; k<50; k++) {
+                ParallelBands::run((int)second.size(), [&second](int i) { second[i]++; });
+            }
+        });
+        for (int k=0; k<50; k++) {
+            ParallelBands::run((int)first.size(), [&first](int i) { first[i]++; });
+        }
+        other.join();
+        bool ok = true;
+        for (size_t i=0; i<first.size(); i++) {
+            ok = ok && first[i]==50;
+        }
+        for (size_t i=0; i<second.size(); i++) {
+            ok = ok && second[i]==50;
+        }
+        checkTrue(ok,"each band run once per call");
+    }
+
     virtual void runTests() override {
         testCreate();
         bool netMode = Network::setLocalMode(true);
@@ -569,6 +936,7 @@ public:
         testStandard();
         testDraw();
         testScale();
+        testResample();
         testRowPointer();
         testConstMethods();
         testBlank();
@@ -576,6 +944,10 @@ public:
         testRgbInt();
         testOrigin();
         testExternalRepeat();
+        testVectorizedCopy();
+        testDemosaic();
+        testImagePool();
+        testParallelBands();
     }
 };
 